@@ -0,0 +1,443 @@
+/**
+ * @file bench_dht_lookup.cpp
+ * @brief DHT 迭代查找基准（进程内模拟网络，本地回环）
+ *
+ * 用法: bench_dht_lookup [模拟节点数，默认 10000] [查找次数，默认 40] [adaptive|fixed]
+ *
+ * 一个 UDP socket 绑定 0.0.0.0，模拟节点 i 的地址是 127.x.y.z（Linux 上整个
+ * 127/8 都路由到回环），按 IP_PKTINFO 给出的目的地址区分被查询的节点。
+ * 每个模拟节点有自己的 Kademlia 路由表（每个桶最多 8 个节点，取自全体节点），
+ * 按自己的延迟回复：
+ *   - 60% 快节点  10-40ms
+ *   - 25% 慢节点  200-800ms
+ *   - 15% 死节点  不回复
+ * 离目标最近的 8 个节点持有 Peer（get_peers 返回 values），其余返回更近的节点。
+ *
+ * 被测的 DhtClient 先向 8 个存活节点 bootstrap，然后依次查找随机 InfoHash，
+ * 统计成功率、找到的持有者数、首个 Peer 耗时、查找耗时、get_peers 查询数，
+ * 以及 QueryManager 的查询延迟、超时和重试。
+ * 查询超时按 DownloadController 的配置：adaptive（默认）按 RTT 自适应，
+ * fixed 为原来的固定 10 秒超时、重试 6 次。
+ * 模拟网络和 DhtClient 共用一个 io_context，在单线程上运行。
+ */
+
+#include <magnet/protocols/dht_client.h>
+#include <magnet/utils/logger.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+using namespace magnet;
+using namespace magnet::protocols;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+#if defined(__linux__)
+
+constexpr size_t kBucketSize = 8;
+
+// ============================================================================
+// 模拟网络
+// ============================================================================
+
+struct SimNode {
+    NodeId id;
+    std::chrono::milliseconds latency{0};
+    bool alive{true};
+    std::vector<uint32_t> table;   // 路由表（节点下标）
+};
+
+class SimNetwork {
+public:
+    SimNetwork(asio::io_context& io, size_t count, std::mt19937& rng)
+        : io_(io)
+        , socket_(io, asio::ip::udp::endpoint(asio::ip::address_v4::any(), 0))
+    {
+        int on = 1;
+        ::setsockopt(socket_.native_handle(), IPPROTO_IP, IP_PKTINFO, &on, sizeof(on));
+        socket_.non_blocking(true);
+        asio::socket_base::receive_buffer_size buffer(4 << 20);
+        socket_.set_option(buffer);
+
+        std::uniform_int_distribution<int> percent(0, 99);
+        nodes_.resize(count);
+        for (auto& node : nodes_) {
+            node.id = NodeId::random();
+            int kind = percent(rng);
+            if (kind < 60) {
+                node.latency = std::chrono::milliseconds(10 + rng() % 31);
+            } else if (kind < 85) {
+                node.latency = std::chrono::milliseconds(200 + rng() % 601);
+            } else {
+                node.alive = false;
+            }
+        }
+
+        sorted_.resize(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            sorted_[i] = i;
+        }
+        std::sort(sorted_.begin(), sorted_.end(),
+                  [this](uint32_t a, uint32_t b) { return nodes_[a].id < nodes_[b].id; });
+
+        for (auto& node : nodes_) {
+            buildTable(node, rng);
+        }
+    }
+
+    uint16_t port() const { return socket_.local_endpoint().port(); }
+
+    std::string address(uint32_t index) const {
+        return "127." + std::to_string(1 + (index >> 16)) + "." +
+               std::to_string((index >> 8) & 0xff) + "." + std::to_string(index & 0xff);
+    }
+
+    const SimNode& node(uint32_t index) const { return nodes_[index]; }
+
+    size_t queries() const { return get_peers_; }
+
+    /** @brief 登记一次查找的目标：离它最近的 8 个节点持有 Peer，返回其中存活的个数 */
+    size_t addTarget(const InfoHash& hash) {
+        NodeId target = NodeId::fromInfoHash(hash);
+        std::vector<uint32_t> all(sorted_);
+        std::partial_sort(all.begin(), all.begin() + kBucketSize, all.end(),
+            [&](uint32_t a, uint32_t b) {
+                return target.compareDistance(nodes_[a].id, nodes_[b].id) < 0;
+            });
+        all.resize(kBucketSize);
+        holders_[target] = all;
+        return static_cast<size_t>(std::count_if(all.begin(), all.end(),
+            [this](uint32_t i) { return nodes_[i].alive; }));
+    }
+
+    void start() {
+        socket_.async_wait(asio::ip::udp::socket::wait_read, [this](const asio::error_code& ec) {
+            if (ec) {
+                return;
+            }
+            drain();
+            start();
+        });
+    }
+
+    void close() {
+        asio::error_code ec;
+        socket_.close(ec);
+    }
+
+private:
+    void buildTable(SimNode& node, std::mt19937& rng) {
+        // 与 node 恰好共享 d 位前缀的节点在排序后的数组中是连续的一段
+        const auto& own = node.id.bytes();
+        for (size_t depth = 0; depth < 160; ++depth) {
+            NodeId::ByteArray low = own;
+            size_t byte = depth / 8;
+            uint8_t bit = static_cast<uint8_t>(0x80 >> (depth % 8));
+            low[byte] = static_cast<uint8_t>((low[byte] ^ bit) & ~(bit - 1));
+            NodeId::ByteArray high = low;
+            high[byte] = static_cast<uint8_t>(high[byte] | (bit - 1));
+            for (size_t i = byte + 1; i < low.size(); ++i) {
+                low[i] = 0;
+                high[i] = 0xff;
+            }
+
+            auto first = std::lower_bound(sorted_.begin(), sorted_.end(), NodeId(low),
+                [this](uint32_t i, const NodeId& id) { return nodes_[i].id < id; });
+            auto last = std::upper_bound(first, sorted_.end(), NodeId(high),
+                [this](const NodeId& id, uint32_t i) { return id < nodes_[i].id; });
+            size_t size = static_cast<size_t>(last - first);
+            if (size == 0) {
+                continue;
+            }
+            size_t start = rng() % size;
+            for (size_t i = 0; i < std::min(size, kBucketSize); ++i) {
+                node.table.push_back(*(first + (start + i) % size));
+            }
+        }
+    }
+
+    std::vector<DhtNode> closest(const SimNode& node, const NodeId& target) const {
+        std::vector<uint32_t> candidates = node.table;
+        size_t count = std::min(candidates.size(), kBucketSize);
+        std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+            [&](uint32_t a, uint32_t b) {
+                return target.compareDistance(nodes_[a].id, nodes_[b].id) < 0;
+            });
+        std::vector<DhtNode> result;
+        for (size_t i = 0; i < count; ++i) {
+            result.emplace_back(nodes_[candidates[i]].id, address(candidates[i]), port());
+        }
+        return result;
+    }
+
+    void drain() {
+        uint8_t buffer[2048];
+        alignas(cmsghdr) uint8_t control[CMSG_SPACE(sizeof(in_pktinfo))];
+        for (;;) {
+            sockaddr_in from{};
+            iovec iov{buffer, sizeof(buffer)};
+            msghdr header{};
+            header.msg_name = &from;
+            header.msg_namelen = sizeof(from);
+            header.msg_iov = &iov;
+            header.msg_iovlen = 1;
+            header.msg_control = control;
+            header.msg_controllen = sizeof(control);
+            ssize_t size = ::recvmsg(socket_.native_handle(), &header, 0);
+            if (size <= 0) {
+                return;
+            }
+
+            uint32_t destination = 0;
+            for (auto* cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(&header, cmsg)) {
+                if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO) {
+                    in_pktinfo info;
+                    std::memcpy(&info, CMSG_DATA(cmsg), sizeof(info));
+                    destination = ntohl(info.ipi_addr.s_addr);
+                }
+            }
+            uint32_t index = (((destination >> 16) & 0xff) - 1) << 16 | (destination & 0xffff);
+            if ((destination >> 24) != 127 || index >= nodes_.size()) {
+                continue;
+            }
+
+            auto query = DhtMessage::parse(buffer, static_cast<size_t>(size));
+            if (query && query->isQuery()) {
+                reply(index, *query, asio::ip::udp::endpoint(
+                    asio::ip::address_v4(ntohl(from.sin_addr.s_addr)), ntohs(from.sin_port)));
+            }
+        }
+    }
+
+    void reply(uint32_t index, const DhtMessage& query, const asio::ip::udp::endpoint& to) {
+        const SimNode& node = nodes_[index];
+        if (query.queryType() == DhtQueryType::GetPeers) {
+            get_peers_++;
+        }
+        if (!node.alive) {
+            return;
+        }
+
+        DhtMessage response;
+        switch (query.queryType()) {
+            case DhtQueryType::FindNode:
+                response = DhtMessage::createFindNodeResponse(
+                    query.transactionId(), node.id, closest(node, query.targetId()));
+                break;
+            case DhtQueryType::GetPeers: {
+                NodeId target = NodeId::fromInfoHash(query.infoHash());
+                auto holders = holders_.find(target);
+                if (holders != holders_.end() &&
+                    std::find(holders->second.begin(), holders->second.end(), index) !=
+                        holders->second.end()) {
+                    // 每个持有者返回一个以自己下标编号的 Peer，便于统计找到了几个持有者
+                    PeerInfo peer("10." + std::to_string((index >> 16) & 0xff) + "." +
+                                  std::to_string((index >> 8) & 0xff) + "." +
+                                  std::to_string(index & 0xff), 6881);
+                    response = DhtMessage::createGetPeersResponseWithPeers(
+                        query.transactionId(), node.id, "token", {peer});
+                } else {
+                    response = DhtMessage::createGetPeersResponseWithNodes(
+                        query.transactionId(), node.id, "token", closest(node, target));
+                }
+                break;
+            }
+            default:
+                response = DhtMessage::createPingResponse(query.transactionId(), node.id);
+                break;
+        }
+
+        auto data = std::make_shared<std::vector<uint8_t>>(response.encode());
+        auto timer = std::make_shared<asio::steady_timer>(io_, node.latency);
+        timer->async_wait([this, timer, data, to](const asio::error_code& ec) {
+            if (!ec) {
+                asio::error_code send_ec;
+                socket_.send_to(asio::buffer(*data), to, 0, send_ec);
+            }
+        });
+    }
+
+    asio::io_context& io_;
+    asio::ip::udp::socket socket_;
+    std::vector<SimNode> nodes_;
+    std::vector<uint32_t> sorted_;
+    std::map<NodeId, std::vector<uint32_t>> holders_;
+    size_t get_peers_{0};
+};
+
+// ============================================================================
+// 查找
+// ============================================================================
+
+struct LookupSample {
+    bool success{false};
+    size_t holders_found{0};
+    size_t holders_alive{0};
+    double first_peer_ms{0};
+    double total_ms{0};
+    size_t queries{0};
+};
+
+bool runUntil(asio::io_context& io, const bool& done, std::chrono::seconds timeout) {
+    auto deadline = Clock::now() + timeout;
+    while (!done && Clock::now() < deadline) {
+        io.run_one_for(std::chrono::milliseconds(10));
+    }
+    return done;
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+}
+
+#endif
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+#if defined(__linux__)
+    size_t node_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    size_t lookups = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 40;
+    std::string mode = argc > 3 ? argv[3] : "adaptive";
+    if (node_count < 64 || node_count >= (255u << 16) || lookups == 0 ||
+        (mode != "adaptive" && mode != "fixed")) {
+        std::fprintf(stderr, "usage: %s [node count, 64..16M] [lookup count] [adaptive|fixed]\n",
+                     argv[0]);
+        return 1;
+    }
+
+    utils::Logger::instance().set_level(utils::LogLevel::Error);
+
+    asio::io_context io;
+    std::mt19937 rng(20240601);
+    auto build_start = Clock::now();
+    SimNetwork network(io, node_count, rng);
+    network.start();
+    std::printf("simulated nodes: %zu (60%% 10-40ms, 25%% 200-800ms, 15%% dead), built in %.1fs\n",
+                node_count, std::chrono::duration<double>(Clock::now() - build_start).count());
+
+    DhtClientConfig config;
+    if (mode == "fixed") {
+        config.query_config.adaptive_timeout = false;
+        config.query_config.default_timeout = std::chrono::milliseconds(10000);
+        config.query_config.default_max_retries = 6;
+    } else {
+        config.query_config.default_timeout = std::chrono::milliseconds(3000);
+        config.query_config.max_timeout = std::chrono::milliseconds(10000);
+        config.query_config.max_query_time = std::chrono::milliseconds(20000);
+        config.query_config.default_max_retries = 3;
+    }
+    config.bootstrap_nodes.clear();
+    for (uint32_t index = 0; config.bootstrap_nodes.size() < 8; ++index) {
+        if (network.node(index).alive) {
+            config.bootstrap_nodes.emplace_back(network.address(index), network.port());
+        }
+    }
+    auto client = std::make_shared<DhtClient>(io, config);
+    client->start();
+
+    bool bootstrapped = false;
+    client->bootstrap([&](bool, size_t) { bootstrapped = true; });
+    if (!runUntil(io, bootstrapped, std::chrono::seconds(30))) {
+        std::fprintf(stderr, "bootstrap did not finish\n");
+        return 1;
+    }
+    std::printf("bootstrapped with %zu nodes\n", client->nodeCount());
+
+    std::vector<LookupSample> samples;
+    for (size_t i = 0; i < lookups; ++i) {
+        InfoHash::ByteArray bytes;
+        for (auto& byte : bytes) {
+            byte = static_cast<uint8_t>(rng());
+        }
+        InfoHash hash(bytes);
+
+        LookupSample sample;
+        sample.holders_alive = network.addTarget(hash);
+        size_t queries_before = network.queries();
+        auto start = Clock::now();
+        bool done = false;
+        client->findPeers(hash,
+            [&](const PeerInfo&) {
+                if (sample.holders_found++ == 0) {
+                    sample.first_peer_ms =
+                        std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                }
+            },
+            [&](bool success, const std::vector<PeerInfo>&) {
+                sample.success = success;
+                done = true;
+            });
+        runUntil(io, done, std::chrono::seconds(60));
+        sample.total_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        sample.queries = network.queries() - queries_before;
+        samples.push_back(sample);
+    }
+
+    size_t successes = 0;
+    size_t holders_found = 0;
+    size_t holders_alive = 0;
+    size_t queries = 0;
+    std::vector<double> first_peer;
+    std::vector<double> total;
+    for (const auto& sample : samples) {
+        successes += sample.success ? 1 : 0;
+        holders_found += sample.holders_found;
+        holders_alive += sample.holders_alive;
+        queries += sample.queries;
+        if (sample.holders_found > 0) {
+            first_peer.push_back(sample.first_peer_ms);
+        }
+        total.push_back(sample.total_ms);
+    }
+
+    std::printf("lookups: %zu, success %zu/%zu, holders found %zu/%zu alive\n",
+                lookups, successes, lookups, holders_found, holders_alive);
+    std::printf("  first peer  p50 %7.0f ms   p90 %7.0f ms\n",
+                percentile(first_peer, 0.5), percentile(first_peer, 0.9));
+    std::printf("  lookup      p50 %7.0f ms   p90 %7.0f ms\n",
+                percentile(total, 0.5), percentile(total, 0.9));
+    std::printf("  get_peers per lookup: %.1f\n", static_cast<double>(queries) / lookups);
+
+    auto query_stats = client->getQueryStatistics();
+    std::printf("queries (%s): sent %zu, ok %zu, timed out %zu, retries %zu, SRTT %.0f ms\n",
+                mode.c_str(), query_stats.queries_sent, query_stats.queries_succeeded,
+                query_stats.queries_timeout, query_stats.retries_total,
+                query_stats.smoothed_rtt_ms);
+    std::printf("  latency     p50 %7lld ms   p90 %7lld ms   (histogram bucket bounds)\n",
+                static_cast<long long>(query_stats.latency_histogram.percentile(0.5).count()),
+                static_cast<long long>(query_stats.latency_histogram.percentile(0.9).count()));
+    std::printf("  timeout     p50 %7lld ms   p90 %7lld ms\n",
+                static_cast<long long>(query_stats.timeout_histogram.percentile(0.5).count()),
+                static_cast<long long>(query_stats.timeout_histogram.percentile(0.9).count()));
+
+    client->stop();
+    network.close();
+    return 0;
+#else
+    (void)argc;
+    (void)argv;
+    std::printf("bench_dht_lookup needs IP_PKTINFO and the 127/8 loopback range (Linux only)\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,190 @@
+/**
+ * @file bench_peer_receive.cpp
+ * @brief Peer 接收路径回放微基准
+ *
+ * 用法: bench_peer_receive [读取块大小 KiB，默认 64] [录制的数据流文件]
+ *
+ * 数据流以对端发来的握手开头，后面是按线上格式编码的消息。未给出文件时
+ * 合成一段典型的下载流：握手 + Bitfield + 大量 Have + 16KB Piece 交错。
+ *
+ * 按读取块大小切片后分别回放给：
+ *   - legacy:  旧实现的 vector insert + 头部 erase 分帧
+ *   - cursor:  ReceiveBuffer 读写游标分帧
+ *   - peer:    PeerConnection::feed（完整的握手 + processMessages 路径）
+ */
+
+#include <magnet/network/receive_buffer.h>
+#include <magnet/protocols/bt_message.h>
+#include <magnet/protocols/peer_connection.h>
+#include <magnet/utils/logger.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace magnet;
+using namespace magnet::protocols;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 防止编译器把结果优化掉
+volatile size_t g_sink = 0;
+
+const char* kPeerId = "-BENCH0-000000000000";
+
+InfoHash benchInfoHash() {
+    InfoHash::ByteArray bytes{};
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<uint8_t>(i * 7 + 1);
+    }
+    return InfoHash(bytes);
+}
+
+void appendMessage(std::vector<uint8_t>& stream, const BtMessage& msg) {
+    auto encoded = msg.encode();
+    stream.insert(stream.end(), encoded.begin(), encoded.end());
+}
+
+// 合成数据流：每 32 条 Have 后跟 4 个 16KB Piece，共约 64MB
+std::vector<uint8_t> synthesizeStream(const InfoHash& info_hash) {
+    std::vector<uint8_t> stream = Handshake::create(info_hash, kPeerId).encode();
+
+    const uint32_t piece_count = 4096;
+    appendMessage(stream, BtMessage::createBitfield(std::vector<bool>(piece_count, false)));
+
+    std::vector<uint8_t> block(BlockInfo::kDefaultBlockSize, 0xAB);
+    uint32_t have_index = 0;
+    for (uint32_t round = 0; round < 1024; ++round) {
+        for (int i = 0; i < 32; ++i) {
+            appendMessage(stream, BtMessage::createHave(have_index++ % piece_count));
+        }
+        for (uint32_t i = 0; i < 4; ++i) {
+            appendMessage(stream, BtMessage::createPiece(
+                PieceBlock(round % piece_count, i * BlockInfo::kDefaultBlockSize, block)));
+        }
+        appendMessage(stream, BtMessage::createKeepAlive());
+    }
+    return stream;
+}
+
+// 旧实现：每条消息后从 vector 头部 erase，剩余数据整体前移
+size_t replayLegacy(const std::vector<uint8_t>& stream, size_t chunk) {
+    std::vector<uint8_t> buffer;
+    size_t messages = 0;
+    bool handshake = false;
+
+    for (size_t pos = 0; pos < stream.size(); pos += chunk) {
+        size_t length = std::min(chunk, stream.size() - pos);
+        buffer.insert(buffer.end(), stream.begin() + pos, stream.begin() + pos + length);
+
+        if (!handshake) {
+            if (buffer.size() < Handshake::kSize) continue;
+            buffer.erase(buffer.begin(), buffer.begin() + Handshake::kSize);
+            handshake = true;
+        }
+        while (buffer.size() >= 4) {
+            size_t msg_len = BtMessage::getMessageLength(buffer.data(), buffer.size());
+            if (msg_len == 0 || buffer.size() < msg_len) break;
+            auto msg = BtMessage::decode(buffer.data(), msg_len);
+            if (msg) ++messages;
+            buffer.erase(buffer.begin(), buffer.begin() + msg_len);
+        }
+    }
+    return messages;
+}
+
+// 新实现：消息在缓冲区内原地解析，consume 只移动读游标
+size_t replayCursor(const std::vector<uint8_t>& stream, size_t chunk) {
+    network::ReceiveBuffer buffer;
+    size_t messages = 0;
+    bool handshake = false;
+
+    for (size_t pos = 0; pos < stream.size(); pos += chunk) {
+        buffer.append(stream.data() + pos, std::min(chunk, stream.size() - pos));
+
+        if (!handshake) {
+            if (buffer.size() < Handshake::kSize) continue;
+            buffer.consume(Handshake::kSize);
+            handshake = true;
+        }
+        while (buffer.size() >= 4) {
+            size_t msg_len = BtMessage::getMessageLength(buffer.data(), buffer.size());
+            if (msg_len == 0 || buffer.size() < msg_len) break;
+            auto msg = BtMessage::decode(buffer.data(), msg_len);
+            if (msg) ++messages;
+            buffer.consume(msg_len);
+        }
+    }
+    return messages;
+}
+
+// 完整路径：未连接的 PeerConnection，sendMessage 在没有 TcpClient 时为空操作
+size_t replayPeer(asio::io_context& io, const InfoHash& info_hash,
+                  const std::vector<uint8_t>& stream, size_t chunk) {
+    auto peer = std::make_shared<PeerConnection>(io, info_hash, kPeerId);
+    for (size_t pos = 0; pos < stream.size(); pos += chunk) {
+        peer->feed(stream.data() + pos, std::min(chunk, stream.size() - pos));
+    }
+    return static_cast<size_t>(peer->getStatistics().messages_received);
+}
+
+template <typename Replay>
+void report(const char* name, size_t bytes, Replay&& replay) {
+    double best = 0;
+    size_t messages = 0;
+    for (int round = 0; round < 3; ++round) {
+        auto start = Clock::now();
+        messages = replay();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        best = std::max(best, seconds > 0 ? 1.0 / seconds : 0);
+    }
+    g_sink = g_sink + messages;
+    std::printf("  %-8s %10.1f MB/s %12.0f msg/s  (%zu messages)\n",
+                name, static_cast<double>(bytes) * best / 1e6,
+                static_cast<double>(messages) * best, messages);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t chunk_kib = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    if (chunk_kib == 0) {
+        std::fprintf(stderr, "usage: %s [chunk KiB] [stream file]\n", argv[0]);
+        return 1;
+    }
+    size_t chunk = chunk_kib * 1024;
+
+    utils::Logger::instance().set_level(utils::LogLevel::Warn);
+
+    InfoHash info_hash = benchInfoHash();
+    std::vector<uint8_t> stream;
+    if (argc > 2) {
+        std::ifstream in(argv[2], std::ios::binary);
+        if (!in) {
+            std::fprintf(stderr, "cannot open %s\n", argv[2]);
+            return 1;
+        }
+        stream.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        // 录制流的握手里带着原始 info_hash，PeerConnection 以它为准
+        if (auto handshake = Handshake::decode(stream.data(), stream.size())) {
+            info_hash = InfoHash(handshake->info_hash);
+        }
+    } else {
+        stream = synthesizeStream(info_hash);
+    }
+
+    std::printf("stream: %.1f MiB, chunk: %zu KiB\n",
+                static_cast<double>(stream.size()) / (1024 * 1024), chunk_kib);
+
+    asio::io_context io;
+    report("legacy", stream.size(), [&] { return replayLegacy(stream, chunk); });
+    report("cursor", stream.size(), [&] { return replayCursor(stream, chunk); });
+    report("peer", stream.size(), [&] { return replayPeer(io, info_hash, stream, chunk); });
+    return 0;
+}
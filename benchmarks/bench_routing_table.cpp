@@ -0,0 +1,173 @@
+/**
+ * @file bench_routing_table.cpp
+ * @brief 路由表最近节点查询微基准
+ *
+ * 用法: bench_routing_table [查询次数，默认 20000]
+ *
+ * 两种路由表形态：
+ *   - typical: 插入 100k 个随机节点后的表（只有靠近本地 ID 的十几个桶非空）
+ *   - full:    160 个桶全部填满（1280 个节点，最坏情况）
+ *
+ * 对比：
+ *   - legacy:  旧实现，拷贝所有节点（含 std::string 地址）后整体排序
+ *   - nodes:   findCloset，逐组收集 + 部分排序，只转换返回的 k 个节点
+ *   - records: findClosest，结果写入调用方的定长数组，不分配内存
+ */
+
+#include <magnet/protocols/routing_table.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace magnet::protocols;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 防止编译器把结果优化掉
+volatile size_t g_sink = 0;
+
+// 旧实现：每个桶一个 vector<DhtNode>，查询时拷贝全部节点并排序
+class LegacyTable {
+public:
+    explicit LegacyTable(const NodeId& local_id) : local_id_(local_id) {}
+
+    void addNode(const DhtNode& node) {
+        size_t idx = std::min(local_id_.distance(node.id_).bucketIndex(),
+                              RoutingTable::s_kBucketCount - 1);
+        if (buckets_[idx].size() < RoutingTable::s_kBucketSize) {
+            buckets_[idx].push_back(node);
+        }
+    }
+
+    std::vector<DhtNode> findCloset(const NodeId& target, size_t count) const {
+        std::vector<std::pair<NodeId, DhtNode>> candidates;
+        for (const auto& bucket : buckets_) {
+            for (const auto& node : bucket) {
+                if (node.isBad()) {
+                    continue;
+                }
+                candidates.emplace_back(target.distance(node.id_), node);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        std::vector<DhtNode> result;
+        for (size_t i = 0; i < std::min(count, candidates.size()); ++i) {
+            result.push_back(candidates[i].second);
+        }
+        return result;
+    }
+
+private:
+    NodeId local_id_;
+    std::array<std::vector<DhtNode>, RoutingTable::s_kBucketCount> buckets_;
+};
+
+std::string randomIp(std::mt19937& rng) {
+    return std::to_string(rng() % 223 + 1) + "." + std::to_string(rng() % 256) + "." +
+           std::to_string(rng() % 256) + "." + std::to_string(rng() % 254 + 1);
+}
+
+// 与 local_id 共享前 (159 - bucket) 位、第一个不同位落在 bucket 的随机 ID
+NodeId idInBucket(const NodeId& local_id, size_t bucket, std::mt19937& rng) {
+    NodeId::ByteArray bytes;
+    for (auto& b : bytes) {
+        b = static_cast<uint8_t>(rng());
+    }
+    size_t same_bits = 159 - bucket;
+    for (size_t bit = 0; bit <= same_bits; ++bit) {
+        size_t byte = bit / 8;
+        uint8_t mask = static_cast<uint8_t>(0x80 >> (bit % 8));
+        bool local_bit = (local_id.bytes()[byte] & mask) != 0;
+        bool set = bit < same_bits ? local_bit : !local_bit;
+        bytes[byte] = set ? (bytes[byte] | mask) : (bytes[byte] & ~mask);
+    }
+    return NodeId(bytes);
+}
+
+template <typename Query>
+void report(const char* name, size_t queries, Query&& query) {
+    double best = 0;
+    for (int round = 0; round < 3; ++round) {
+        size_t found = 0;
+        auto start = Clock::now();
+        for (size_t i = 0; i < queries; ++i) {
+            found += query(i);
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        g_sink = g_sink + found;
+        best = std::max(best, seconds > 0 ? static_cast<double>(queries) / seconds : 0);
+    }
+    std::printf("  %-8s %12.0f queries/s %10.2f us/query\n", name, best, 1e6 / best);
+}
+
+void run(const char* shape, RoutingTable& table, LegacyTable& legacy,
+         const std::vector<NodeId>& targets, size_t queries) {
+    std::printf("%s: %zu nodes\n", shape, table.nodeCount());
+    report("legacy", queries, [&](size_t i) {
+        return legacy.findCloset(targets[i % targets.size()], RoutingTable::s_kBucketSize).size();
+    });
+    report("nodes", queries, [&](size_t i) {
+        return table.findCloset(targets[i % targets.size()], RoutingTable::s_kBucketSize).size();
+    });
+    std::array<RoutingTable::NodeRecord, RoutingTable::s_kBucketSize> out;
+    report("records", queries, [&](size_t i) {
+        return table.findClosest(targets[i % targets.size()], out.data(), out.size());
+    });
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t queries = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    if (queries == 0) {
+        std::fprintf(stderr, "usage: %s [queries]\n", argv[0]);
+        return 1;
+    }
+
+    std::mt19937 rng(42);
+    NodeId local_id = NodeId::random();
+
+    std::vector<NodeId> targets;
+    for (int i = 0; i < 1024; ++i) {
+        targets.push_back(NodeId::random());
+    }
+
+    {
+        RoutingTable table(local_id);
+        LegacyTable legacy(local_id);
+        for (int i = 0; i < 100000; ++i) {
+            DhtNode node(NodeId::random(), randomIp(rng), static_cast<uint16_t>(rng() % 60000 + 1024));
+            if (table.addNode(node)) {
+                legacy.addNode(node);
+            }
+        }
+        run("typical", table, legacy, targets, queries);
+    }
+
+    {
+        RoutingTable table(local_id);
+        LegacyTable legacy(local_id);
+        for (size_t bucket = 0; bucket < RoutingTable::s_kBucketCount; ++bucket) {
+            for (size_t i = 0; i < RoutingTable::s_kBucketSize; ++i) {
+                DhtNode node(idInBucket(local_id, bucket, rng), randomIp(rng),
+                             static_cast<uint16_t>(rng() % 60000 + 1024));
+                if (table.addNode(node)) {
+                    legacy.addNode(node);
+                }
+            }
+        }
+        run("full", table, legacy, targets, queries);
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file bench_sha1.cpp
+ * @brief SHA1 各后端吞吐微基准
+ *
+ * 用法: bench_sha1 [总数据量 MiB，默认 256] [分片大小 KiB，默认 256]
+ *
+ * 输出每个可用后端的单流吞吐（GB/s），以及多缓冲模式对等长分片的批量吞吐
+ */
+
+#include <magnet/utils/sha1.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace magnet::utils;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 防止编译器把结果优化掉
+volatile uint8_t g_sink = 0;
+
+double gigabytesPerSecond(size_t bytes, Clock::duration elapsed) {
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    return seconds > 0 ? static_cast<double>(bytes) / seconds / 1e9 : 0;
+}
+
+// 单流：逐个分片调用 sha1()，取三次中最好的一次
+double benchSingle(const std::vector<std::vector<uint8_t>>& pieces, size_t total) {
+    double best = 0;
+    for (int round = 0; round < 3; ++round) {
+        auto start = Clock::now();
+        for (const auto& piece : pieces) {
+            g_sink = static_cast<uint8_t>(g_sink ^ sha1(piece)[0]);
+        }
+        best = std::max(best, gigabytesPerSecond(total, Clock::now() - start));
+    }
+    return best;
+}
+
+// 批量：一次交给 sha1Many()，与 PieceManager::verifyAll 的用法一致
+double benchMany(const std::vector<std::vector<uint8_t>>& pieces, size_t piece_size, size_t total) {
+    std::vector<const uint8_t*> pointers;
+    for (const auto& piece : pieces) {
+        pointers.push_back(piece.data());
+    }
+    std::vector<SHA1::Digest> digests(pieces.size());
+
+    double best = 0;
+    for (int round = 0; round < 3; ++round) {
+        auto start = Clock::now();
+        sha1Many(pointers.data(), piece_size, digests.data(), digests.size());
+        best = std::max(best, gigabytesPerSecond(total, Clock::now() - start));
+        g_sink = static_cast<uint8_t>(g_sink ^ digests[0][0]);
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t total_mib = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+    size_t piece_kib = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 256;
+    if (total_mib == 0 || piece_kib == 0) {
+        std::fprintf(stderr, "usage: %s [total MiB] [piece KiB]\n", argv[0]);
+        return 1;
+    }
+
+    size_t piece_size = piece_kib * 1024;
+    size_t piece_count = std::max<size_t>(1, total_mib * 1024 / piece_kib);
+    size_t total = piece_size * piece_count;
+
+    std::vector<std::vector<uint8_t>> pieces(piece_count, std::vector<uint8_t>(piece_size));
+    uint32_t x = 0x12345678;
+    for (auto& piece : pieces) {
+        for (auto& byte : piece) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            byte = static_cast<uint8_t>(x);
+        }
+    }
+
+    std::printf("SHA1 benchmark: %zu pieces x %zu KiB = %zu MiB\n",
+                piece_count, piece_kib, total / (1024 * 1024));
+    std::printf("default backend: %s\n\n", sha1BackendName(sha1Backend()));
+
+    SHA1Backend saved = sha1Backend();
+    const SHA1Backend backends[] = {
+        SHA1Backend::Scalar, SHA1Backend::X86ShaNi, SHA1Backend::ArmCrypto
+    };
+
+    std::printf("%-24s %10s\n", "backend", "GB/s");
+    for (auto backend : backends) {
+        if (!setSHA1Backend(backend)) {
+            std::printf("%-24s %10s\n", sha1BackendName(backend), "n/a");
+            continue;
+        }
+        std::printf("%-24s %10.3f\n", sha1BackendName(backend), benchSingle(pieces, total));
+    }
+    setSHA1Backend(saved);
+
+    size_t lanes = sha1MultiBufferLanes();
+    bool multi_buffer = sha1MultiBufferEnabled();
+    if (setSHA1MultiBuffer(true)) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "multi-buffer x%zu", lanes);
+        std::printf("%-24s %10.3f\n", name, benchMany(pieces, piece_size, total));
+        setSHA1MultiBuffer(multi_buffer);
+    } else {
+        std::printf("%-24s %10s\n", "multi-buffer", "n/a");
+    }
+
+    return 0;
+}
@@ -3,10 +3,18 @@
 #include "../protocols/magnet_uri_parser.h"
 #include "../protocols/dht_client.h"
 #include "../protocols/peer_manager.h"
+#include "../protocols/peer_acceptor.h"
 #include "../protocols/bt_message.h"
 #include "../protocols/metadata_fetcher.h"
 #include "../protocols/tracker_client.h"
+#include "../protocols/block_scheduler.h"
 #include "../storage/file_manager.h"
+#include "../storage/piece_picker.h"
+#include "../storage/hash_pool.h"
+#include "../storage/disk_io_engine.h"
+#include "../storage/read_cache.h"
+#include "../utils/sha1.h"
+#include "../utils/buffer_pool.h"
 
 #include <asio.hpp>
 #include <functional>
@@ -14,7 +22,9 @@
 #include <atomic>
 #include <mutex>
 #include <vector>
+#include <deque>
 #include <map>
+#include <set>
 #include <chrono>
 
 namespace magnet::application {
@@ -29,6 +39,7 @@ enum class DownloadState {
     Downloading,        // 正在下载
     Paused,             // 已暂停
     Verifying,          // 验证中
+    Seeding,            // 下载完成，继续做种
     Completed,          // 完成
     Failed,             // 失败
     Stopped             // 已停止
@@ -44,6 +55,7 @@ inline const char* downloadStateToString(DownloadState state) {
         case DownloadState::Downloading: return "Downloading";
         case DownloadState::Paused: return "Paused";
         case DownloadState::Verifying: return "Verifying";
+        case DownloadState::Seeding: return "Seeding";
         case DownloadState::Completed: return "Completed";
         case DownloadState::Failed: return "Failed";
         case DownloadState::Stopped: return "Stopped";
@@ -64,14 +76,58 @@ struct DownloadConfig {
     std::string save_path;              // 保存路径
     
     size_t max_connections{200};        // 最大连接数（大幅增加以提高速度）
-    size_t max_download_speed{0};       // 最大下载速度 (0=无限制)
-    size_t max_upload_speed{0};         // 最大上传速度
+    
+    // 限速（令牌桶，分三级：进程 → 种子 → Peer；0 = 该级不限速）
+    size_t max_download_speed{0};       // 本种子最大下载速度 (bytes/s, 0=无限制)
+    size_t max_upload_speed{0};         // 本种子最大上传速度 (bytes/s, 0=无限制)
+    size_t max_peer_download_speed{0};  // 单个 Peer 最大下载速度
+    size_t max_peer_upload_speed{0};    // 单个 Peer 最大上传速度
+    std::shared_ptr<network::RateLimiter> global_download_limiter;  // 多个任务共享的进程级限速器（可为空）
+    std::shared_ptr<network::RateLimiter> global_upload_limiter;
+    
+    // 做种：开启后下载完成时继续上传，直到分享率或做种时间达到上限
+    // （先到者为准；0 表示不限该项，两项都为 0 时一直做种到 stop()）
+    bool enable_seeding{false};                     // 默认下载完成即结束
+    double seed_ratio_limit{1.0};                   // 上传量 / 种子大小
+    std::chrono::seconds seed_time_limit{1800};     // 做种时长
+    size_t read_cache_size{8 * 1024 * 1024};        // 上传读缓存上限（字节）
+    
+    // 入站连接：监听端口同时通告给 Tracker，对方连入后按 info_hash 交给 PeerManager
+    bool accept_incoming{true};         // 是否监听入站 Peer 连接
+    uint16_t listen_port{6881};         // TCP 监听端口（0 = 系统随机分配）
+    std::shared_ptr<protocols::PeerAcceptor> global_peer_acceptor;  // 多个任务共享的已在监听的接受器
+                                                                     // （可为空：任务自己监听 listen_port）
     
     bool verify_on_complete{true};      // 完成后验证
     bool auto_start{true};              // 自动开始
     
+    bool enable_dht{true};              // 是否通过 DHT 查找 Peer（私有种子应关闭）
+    
+    // DHT 状态文件：保存节点 ID 和路由表，下次启动时热启动（空 = 每次从引导节点加入）
+    std::string dht_state_file;
+    
     std::chrono::seconds metadata_timeout{300}; // 元数据获取超时 (5分钟)
     std::chrono::seconds peer_search_interval{15}; // Peer 搜索间隔（缩短以更快发现新 peers）
+    
+    // 块到达即写盘，内存只缓存乱序到达、尚未计入哈希的块
+    size_t block_cache_size{16 * 1024 * 1024};  // 乱序块缓存上限（字节），超出的块校验时从磁盘读回
+    
+    // Endgame：所有剩余块都已请求后，向其他 Peer 重复请求，先到先得
+    bool enable_endgame{true};          // 是否启用 endgame 模式
+    size_t endgame_max_blocks{256};     // 未完成块数不超过此值时才进入 endgame
+    size_t endgame_max_duplicates{3};   // endgame 时同一个块最多同时向几个 Peer 请求
+    
+    // 分片校验在独立的哈希线程池上进行，不占用网络线程
+    size_t hash_threads{0};             // 哈希线程数（0 = CPU 核心数的一半）
+    size_t max_hash_jobs{16};           // 同时排队/校验的分片上限，超过后暂停开始新分片
+    
+    // 块写盘交给异步磁盘引擎（io_uring 或线程池），完成后回到 io_context 线程
+    bool async_disk_io{true};           // false = 在网络线程上同步写盘
+    storage::DiskIoBackend disk_io_backend{storage::DiskIoBackend::Auto};
+    size_t disk_io_threads{2};          // 线程池后端的工作线程数
+    size_t disk_write_buffers{256};     // 预注册的 16KB 写缓冲数量（0 = 不使用固定缓冲）
+    bool memory_map_storage{false};     // 以内存映射方式访问下载文件（校验时零拷贝）
+    storage::PreallocateMode preallocate_mode{storage::PreallocateMode::Sparse}; // 文件空间预分配方式
 };
 
 // ============================================================================
@@ -90,6 +146,7 @@ struct DownloadProgress {
     size_t total_pieces{0};         // 总分片数
     size_t completed_pieces{0};     // 已完成分片数
     size_t pending_pieces{0};       // 正在下载的分片数
+    size_t verifying_pieces{0};     // 等待或正在校验的分片数
     
     double download_speed{0};       // 下载速度 (bytes/s)
     double upload_speed{0};         // 上传速度 (bytes/s)
@@ -176,13 +233,27 @@ struct PieceInfo {
     size_t size{0};
     size_t downloaded{0};
     std::vector<bool> blocks;           // 块下载状态
-    std::vector<uint8_t> data;          // 分片数据
-    std::chrono::steady_clock::time_point request_time;  // 请求时间（用于超时检测）
+    std::vector<bool> requested;        // 块请求状态（已发出、尚未收到）
+    
+    // 增量哈希：块直接写盘，按顺序到达的块立即计入 SHA1
+    std::unique_ptr<utils::SHA1> hasher;                     // 下载中才分配
+    size_t hashed_bytes{0};                                  // 已计入哈希的前缀长度
+    std::vector<utils::BufferHandle> cached_blocks;          // 乱序块缓存（按块序号，空句柄 = 未缓存）
+    size_t pending_writes{0};                                // 已提交、尚未落盘的块写入
     
     bool isComplete() const {
         return downloaded >= size;
     }
     
+    bool hasUnrequestedBlocks() const {
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            if (!blocks[i] && !requested[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
     double progress() const {
         return size > 0 ? static_cast<double>(downloaded) / size : 0;
     }
@@ -233,7 +304,8 @@ using MetadataReceivedCallback = std::function<void(const TorrentMetadata& metad
  * controller->start(config);
  * @endcode
  */
-class DownloadController : public std::enable_shared_from_this<DownloadController> {
+class DownloadController : public std::enable_shared_from_this<DownloadController>,
+                           public storage::DiskWriteSink {
 public:
     // 常量
     static constexpr size_t kBlockSize = 16384;  // 16KB 块大小
@@ -307,6 +379,11 @@ public:
      */
     const DownloadConfig& config() const { return config_; }
     
+    /**
+     * @brief 获取实际监听的入站端口（未监听时为 0）
+     */
+    uint16_t listenPort() const { return peer_acceptor_ ? peer_acceptor_->localPort() : 0; }
+    
     // ========================================================================
     // 回调设置
     // ========================================================================
@@ -348,6 +425,21 @@ private:
      */
     void findPeers();
     
+    /**
+     * @brief 开始监听入站 Peer 连接（有共享接受器时只向它注册本种子）
+     */
+    void startListening();
+    
+    /**
+     * @brief 停止接受入站连接：自己的接受器停止监听，共享的接受器只注销本种子
+     */
+    void stopListening();
+    
+    /**
+     * @brief 创建 PeerManager 并设置回调（已创建则直接返回）
+     */
+    void ensurePeerManager();
+    
     /**
      * @brief Peer 发现回调
      */
@@ -356,14 +448,30 @@ private:
     /**
      * @brief 收到数据块回调
      */
-    void onPieceReceived(uint32_t piece_index, uint32_t begin, 
-                         const std::vector<uint8_t>& data);
+    void onPieceReceived(const network::TcpEndpoint& endpoint,
+                         uint32_t piece_index, uint32_t begin, 
+                         network::ByteSpan data);
     
     /**
      * @brief Peer 状态变化回调
      */
     void onPeerStatusChanged(const network::TcpEndpoint& endpoint, bool connected);
     
+    /**
+     * @brief 收到 Peer 位图回调，更新分片可用度
+     */
+    void onPeerBitfield(const network::TcpEndpoint& endpoint, const std::vector<bool>& bitfield);
+    
+    /**
+     * @brief 收到 Peer Have 回调，更新分片可用度
+     */
+    void onPeerHave(const network::TcpEndpoint& endpoint, uint32_t piece_index);
+    
+    /**
+     * @brief Peer choke 状态变化回调
+     */
+    void onPeerChoke(const network::TcpEndpoint& endpoint, bool choked);
+    
     /**
      * @brief 初始化元数据获取器
      */
@@ -386,15 +494,79 @@ private:
     void initializePieces();
     
     /**
-     * @brief 选择下一个要下载的分片
+     * @brief 为指定 Peer 选择下一个要下载的分片（稀有优先）
+     * @param peer 只选择该 Peer 拥有的分片
      * @return 分片索引，-1 表示没有可下载的
      */
-    int32_t selectNextPiece();
+    int32_t selectNextPiece(const network::TcpEndpoint& peer);
+    
+    /**
+     * @brief 填满指定 Peer 的请求管道
+     * 
+     * 优先补齐已开始的分片，再按稀有优先开始新分片（调用时已持有 pieces_mutex_）
+     * @return 本次发出的块请求数
+     */
+    size_t fillPeerPipeline(const network::TcpEndpoint& peer);
+    
+    /**
+     * @brief 向 Peer 请求分片中尚未请求的块
+     * @param slots 可用槽位，发出请求后递减
+     * @param ok 发送失败（Peer 断开或 choke）时置为 false
+     * @return 本次发出的块请求数
+     */
+    size_t requestBlocksOf(const network::TcpEndpoint& peer, PieceInfo& piece,
+                           size_t& slots, bool& ok);
     
     /**
-     * @brief 请求分片
+     * @brief Endgame：向 Peer 重复请求其他 Peer 上未完成的块
+     * 
+     * 仅当所有剩余块都已请求、且未完成块数不超过阈值时生效（调用时已持有 pieces_mutex_）
+     * @return 本次发出的重复请求数
      */
-    void requestPiece(uint32_t piece_index);
+    size_t requestEndgameBlocks(const network::TcpEndpoint& peer, size_t& slots);
+    
+    /**
+     * @brief 推进分片的哈希游标，计入缓存中已连续的块（调用时已持有 pieces_mutex_）
+     */
+    void advanceHashCursor(PieceInfo& piece);
+    
+    /**
+     * @brief 把已下载完的分片交给 HashPool 校验（调用时已持有 pieces_mutex_）
+     * 
+     * 哈希状态和乱序块缓存随作业移交给工作线程，剩余部分在工作线程上从磁盘读回；
+     * 线程池已满时分片进入 hash_backlog_，等有作业完成后再提交
+     */
+    void submitPieceHash(PieceInfo& piece);
+    
+    /**
+     * @brief 在 hash_backlog_ 中的分片，尽量提交给 HashPool（调用时已持有 pieces_mutex_）
+     */
+    void drainHashBacklog();
+    
+    /**
+     * @brief 释放分片的哈希状态和块缓存（调用时已持有 pieces_mutex_）
+     */
+    void releasePieceBuffers(PieceInfo& piece);
+    
+    /**
+     * @brief 释放未完成的块请求，使其可以重新分配（调用时已持有 pieces_mutex_）
+     */
+    void releaseBlocks(const std::vector<protocols::BlockInfo>& blocks);
+    
+    /**
+     * @brief 作废分片已收到的数据，整片重新下载（调用时已持有 pieces_mutex_）
+     * 
+     * 仍在各 Peer 管道上的块一并撤回并发送 CANCEL；分片保持 Pending
+     * 并放回 partial_pieces_，优先重新请求
+     */
+    void resetPiece(PieceInfo& piece);
+    
+    /**
+     * @brief 切换分片状态，同步维护状态计数和 PiecePicker
+     * 
+     * 所有分片状态变化都应经过这里（调用时已持有 pieces_mutex_）
+     */
+    void setPieceState(PieceInfo& piece, PieceState new_state);
     
     /**
      * @brief 请求更多数据块
@@ -402,15 +574,27 @@ private:
     void requestMoreBlocks();
     
     /**
-     * @brief 重置超时的 pending pieces
-     * 将长时间没有响应的 pending pieces 重置为 missing 状态
+     * @brief 检查超时的块请求
+     * 超时按块计算，只重新分配超时的块，不影响同一分片的其他块
      */
-    void resetTimedOutPieces();
+    void checkBlockTimeouts();
     
     /**
-     * @brief 验证分片
+     * @brief 分片哈希完成（在 io_context 线程上执行），比较期望值并更新状态
      */
-    bool verifyPiece(uint32_t piece_index);
+    void onPieceHashed(uint32_t piece_index, const storage::HashResult& result);
+    
+    /**
+     * @brief 异步块写入完成（在 io_context 线程上执行）
+     * 
+     * 分片的所有块都落盘后才提交校验；写入失败则整个分片重新下载
+     */
+    void onBlockWritten(uint32_t piece_index, bool success);
+    
+    /**
+     * @brief DiskWriteSink 回调，标签为分片索引
+     */
+    void onDiskWrite(uint64_t tag, bool success) override;
     
     /**
      * @brief 更新进度
@@ -422,6 +606,26 @@ private:
      */
     void checkCompletion();
     
+    /**
+     * @brief Peer 请求数据：安排一次上传处理（同一轮事件内的请求合并处理）
+     */
+    void onUploadRequest();
+    
+    /**
+     * @brief 处理各 Peer 上传队列中的请求：从读缓存取块并发送，受 max_upload_speed 限制
+     */
+    void serveUploads();
+    
+    /**
+     * @brief 做种是否已达到分享率或时间上限
+     */
+    bool seedingLimitReached() const;
+    
+    /**
+     * @brief 结束做种（或不做种时结束下载）：停止组件并进入 Completed
+     */
+    void finishSeeding();
+    
     /**
      * @brief 设置状态并通知
      */
@@ -447,6 +651,11 @@ private:
      */
     void startDownloadStallTimer();
     
+    /**
+     * @brief 启动块请求超时检测定时器
+     */
+    void startBlockTimeoutTimer();
+    
     /**
      * @brief 初始化文件存储
      */
@@ -479,13 +688,27 @@ private:
     mutable std::mutex pieces_mutex_;
     std::vector<PieceInfo> pieces_;
     std::vector<bool> bitfield_;
+    std::unique_ptr<storage::PiecePicker> piece_picker_;  // 元数据到达后创建
+    size_t pending_count_{0};    // Pending 状态分片数
+    size_t verified_count_{0};   // Verified 状态分片数
+    std::set<uint32_t> partial_pieces_;  // 还有块未请求的 Pending 分片
+    bool endgame_{false};                // 是否处于 endgame 阶段
+    size_t piece_length_{0};             // 分片大小（元数据副本，避免持锁拷贝元数据）
+    size_t cached_bytes_{0};             // 乱序块缓存总字节数
+    protocols::BlockScheduler block_scheduler_;  // 每个 Peer 的请求管道
+    std::unique_ptr<storage::HashPool> hash_pool_;  // 分片校验线程池（元数据到达后创建）
+    std::deque<uint32_t> hash_backlog_;             // 线程池已满时等待提交的分片
     
     // 组件
     std::shared_ptr<protocols::DhtClient> dht_client_;
     std::shared_ptr<protocols::PeerManager> peer_manager_;
+    std::shared_ptr<protocols::PeerAcceptor> peer_acceptor_;   // 入站连接（监听失败时为空）
+    bool owns_peer_acceptor_{false};                           // false = 来自 global_peer_acceptor
     std::shared_ptr<protocols::MetadataFetcher> metadata_fetcher_;
     std::shared_ptr<protocols::TrackerClient> tracker_client_;
     std::unique_ptr<storage::FileManager> file_manager_;
+    std::unique_ptr<storage::DiskIoEngine> disk_io_;  // 必须先于 file_manager_ 析构
+    std::unique_ptr<storage::ReadCache> read_cache_;  // 上传读缓存，必须先于 file_manager_ 析构
     std::string my_peer_id_;
     
     // Tracker URLs
@@ -495,16 +718,28 @@ private:
     mutable std::mutex progress_mutex_;
     DownloadProgress current_progress_;
     std::chrono::steady_clock::time_point start_time_;
+    bool dht_peer_found_{false};  // 是否已记录 DHT 首个 Peer 的耗时（io_context 线程）
     std::chrono::steady_clock::time_point last_progress_update_;
     std::chrono::steady_clock::time_point last_download_progress_;  // 最后一次有实际下载进度的时间
     size_t last_downloaded_size_{0};
     size_t stall_check_size_{0};  // 用于检测停滞的下载大小
+    size_t last_uploaded_size_{0};
+    std::chrono::steady_clock::time_point seeding_start_;
+    
+    // 上传
+    bool upload_scheduled_{false};                   // 已安排 serveUploads（定时器或 post）
+    
+    // 种子级限速器（速率为 0 时不限速，只做统计）
+    std::shared_ptr<network::RateLimiter> download_limiter_;
+    std::shared_ptr<network::RateLimiter> upload_limiter_;
     
     // 定时器
     asio::steady_timer progress_timer_;
     asio::steady_timer peer_search_timer_;
     asio::steady_timer metadata_timeout_timer_;
     asio::steady_timer download_stall_timer_;  // 下载停滞检测定时器
+    asio::steady_timer block_timeout_timer_;   // 块请求超时检测定时器
+    asio::steady_timer upload_timer_;          // 上传限速/积压时的重试定时器
     
     // 回调
     DownloadStateCallback state_callback_;
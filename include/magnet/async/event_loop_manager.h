@@ -169,8 +169,12 @@ void EventLoopManager::post_to_least_loaded(Handler&& handler) {
     // 获取原始指针用于回调（EventLoopManager生命周期保证安全）
     ThreadContext* context_raw = context_ptr.get();
     
+    // 包装后沿用任务自带的分配器（asio::bind_allocator），调用方可以自行提供处理器内存
+    auto allocator = asio::get_associated_allocator(handler);
+    
     // 投递任务，执行完成后减少计数
-    asio::post(*context_ptr->io_context, [handler = std::forward<Handler>(handler), context_raw]() {
+    asio::post(*context_ptr->io_context, asio::bind_allocator(allocator,
+        [handler = std::forward<Handler>(handler), context_raw]() mutable {
         // 执行实际任务
         try {
             handler();
@@ -181,7 +185,7 @@ void EventLoopManager::post_to_least_loaded(Handler&& handler) {
         // 减少任务计数，增加处理计数
         context_raw->task_count.fetch_sub(1, std::memory_order_relaxed);
         context_raw->total_handled.fetch_add(1, std::memory_order_relaxed);
-    });
+    }));
 }
 
 } // namespace magnet::async
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <asio.hpp>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace magnet::network {
+
+// ============================================================================
+// 配置与统计
+// ============================================================================
+
+struct DnsResolverConfig {
+    std::chrono::seconds ttl{300};          // 解析成功的缓存时长
+    std::chrono::seconds negative_ttl{30};  // 解析失败的缓存时长（避免反复查询坏域名）
+    size_t max_entries{256};                // 缓存条目上限
+};
+
+struct DnsResolverStatistics {
+    size_t hits{0};             // 缓存命中
+    size_t lookups{0};          // 实际发起的系统解析次数
+    size_t coalesced{0};        // 合并到进行中解析的请求数
+    size_t failures{0};         // 解析失败次数
+    size_t cached_entries{0};   // 当前缓存条目数
+};
+
+// ============================================================================
+// DnsResolver 类
+// ============================================================================
+
+/**
+ * @class DnsResolver
+ * @brief 异步 DNS 解析器（带 TTL 缓存）
+ *
+ * 系统解析（getaddrinfo）可能阻塞数秒，不能在 io_context 线程上同步执行。
+ * DnsResolver 用 asio 的异步解析在后台线程完成查询，结果按 TTL 缓存；
+ * 同一域名的并发请求合并为一次查询。
+ *
+ * 同一 io_context 上的 TcpClient/UdpClient 通过 shared() 共用一个实例，
+ * Tracker 主机名和 DHT 引导节点只需解析一次。
+ *
+ * 线程安全：resolve() 可以跨线程调用；回调总是异步地在 io_context 线程中执行
+ *
+ * 使用示例：
+ * @code
+ * auto resolver = DnsResolver::shared(io_context);
+ * resolver->resolve("router.bittorrent.com", [](const asio::error_code& ec,
+ *                                              const DnsResolver::Addresses& addresses) {
+ *     if (!ec) { ... }
+ * });
+ * @endcode
+ */
+class DnsResolver : public std::enable_shared_from_this<DnsResolver> {
+public:
+    using Addresses = std::vector<asio::ip::address>;
+    using ResolveCallback = std::function<void(const asio::error_code& ec,
+                                               const Addresses& addresses)>;
+
+    /**
+     * @brief 获取 io_context 上共用的解析器（不存在时创建）
+     */
+    static std::shared_ptr<DnsResolver> shared(asio::io_context& io_context);
+
+    explicit DnsResolver(asio::io_context& io_context, DnsResolverConfig config = {});
+
+    DnsResolver(const DnsResolver&) = delete;
+    DnsResolver& operator=(const DnsResolver&) = delete;
+
+    /**
+     * @brief 异步解析主机名
+     * @param host 主机名或 IP 字面量（字面量直接返回，不查询也不缓存）
+     * @param callback 完成回调，地址按系统返回顺序排列且已去重
+     */
+    void resolve(const std::string& host, ResolveCallback callback);
+
+    /**
+     * @brief 清空缓存（进行中的解析不受影响）
+     */
+    void clear();
+
+    DnsResolverStatistics getStatistics() const;
+
+private:
+    struct CacheEntry {
+        asio::error_code error;
+        Addresses addresses;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    struct Lookup {
+        std::shared_ptr<asio::ip::tcp::resolver> resolver;
+        std::vector<ResolveCallback> callbacks;
+    };
+
+    /** @brief 系统解析完成：写入缓存并通知所有等待者 */
+    void handleResolve(const std::string& host, const asio::error_code& ec,
+                       const asio::ip::tcp::resolver::results_type& results);
+
+    /** @brief 写入缓存，超出上限时先丢弃过期条目，再丢弃最早过期的（调用时已持有 mutex_） */
+    void store(const std::string& host, CacheEntry entry);
+
+    asio::io_context& io_context_;
+    DnsResolverConfig config_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, CacheEntry> cache_;
+    std::unordered_map<std::string, Lookup> lookups_;
+    DnsResolverStatistics statistics_;
+};
+
+/**
+ * @brief 按 RFC 8305 排列连接候选地址
+ *
+ * IPv6 与 IPv4 交替排列（从 IPv6 开始），同一地址族内保持原顺序，
+ * 一种地址族不可达时另一种很快就能被尝试到
+ */
+DnsResolver::Addresses interleaveAddressFamilies(const DnsResolver::Addresses& addresses);
+
+} // namespace magnet::network
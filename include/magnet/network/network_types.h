@@ -45,6 +45,41 @@ struct Endpoint {
 using UdpEndpoint = Endpoint;
 using TcpEndpoint = Endpoint;
 
+// ============================================================================
+// 字节视图
+// ============================================================================
+
+/**
+ * @brief 只读字节视图（指针 + 长度，不持有数据）
+ *
+ * 用于把接收缓冲区中的数据直接交给上层，避免中间拷贝。
+ * 视图只在底层缓冲区有效期内可用，需要保留数据时调用 toVector()。
+ */
+class ByteSpan {
+public:
+    ByteSpan() = default;
+
+    ByteSpan(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    ByteSpan(const std::vector<uint8_t>& data) : data_(data.data()), size_(data.size()) {}
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    const uint8_t* begin() const { return data_; }
+    const uint8_t* end() const { return data_ + size_; }
+
+    /** @brief 拷贝为独立的字节数组 */
+    std::vector<uint8_t> toVector() const {
+        return std::vector<uint8_t>(begin(), end());
+    }
+
+private:
+    const uint8_t* data_{nullptr};
+    size_t size_{0};
+};
+
 // ============================================================================
 // UDP 消息
 // ============================================================================
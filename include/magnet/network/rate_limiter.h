@@ -0,0 +1,171 @@
+#pragma once
+
+#include <asio.hpp>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace magnet::network {
+
+// ============================================================================
+// 统计信息
+// ============================================================================
+
+struct RateLimiterStatistics {
+    size_t bytes_consumed{0};       // 计入本级的字节数
+    size_t waits{0};                // 因令牌不足而等待的次数
+    std::chrono::steady_clock::time_point first_consume;    // 第一次 consume 的时间
+    std::chrono::steady_clock::time_point last_consume;     // 最近一次 consume 的时间
+    size_t last_consume_bytes{0};   // 最近一次 consume 的字节数
+    
+    /**
+     * @brief 本级实际放行的速率（bytes/s）
+     *
+     * 按第一次到最后一次 consume 之间的窗口计算，最后一次的字节还没有
+     * 被时间“付清”，不计入。窗口之外的空闲（连接建立、调度延迟）不影响结果
+     */
+    double activeRate() const {
+        double window = std::chrono::duration<double>(last_consume - first_consume).count();
+        return window > 0 ? static_cast<double>(bytes_consumed - last_consume_bytes) / window : 0;
+    }
+};
+
+// ============================================================================
+// RateLimiter 类
+// ============================================================================
+
+/**
+ * @class RateLimiter
+ * @brief 令牌桶限速器（可分级）
+ *
+ * 令牌按速率持续补充。使用方先确认 ready()（否则 wait() 等到可用），
+ * 再传输不超过 quantum() 的数据，并用 consume() 扣除实际字节数。
+ * 令牌允许扣成负数，欠下的量由之后的等待补回，所以长期速率是精确的，
+ * 单次超出最多一个 quantum。
+ *
+ * 限速器可以挂在父限速器下（全局 → 种子 → Peer）：ready() 要求整条链
+ * 都有令牌，consume() 从整条链扣除。速率为 0 的层级不限速，只做统计。
+ *
+ * 等待用 asio 定时器按令牌缺口计算唤醒时间，不会忙等。
+ *
+ * 线程安全：ready()/consume()/quantum() 可以跨线程调用；wait()/setRate()/cancel()
+ * 操作定时器，应在 io_context 线程中调用，回调也在 io_context 线程中执行
+ *
+ * 使用示例：
+ * @code
+ * auto global = std::make_shared<RateLimiter>(io_context, 10 * 1024 * 1024);
+ * auto torrent = std::make_shared<RateLimiter>(io_context, 2 * 1024 * 1024, global);
+ * tcp_client->setRateLimiters(torrent, nullptr);
+ * @endcode
+ */
+class RateLimiter : public std::enable_shared_from_this<RateLimiter> {
+public:
+    /** @brief 令牌最多积累的时长（空闲后允许的突发量） */
+    static constexpr std::chrono::milliseconds kBurstWindow{100};
+
+    /** @brief 每次传输的建议粒度对应的时长 */
+    static constexpr std::chrono::milliseconds kQuantumWindow{10};
+
+    /** @brief 传输粒度的上下限 */
+    static constexpr size_t kMinQuantum = 2048;
+    static constexpr size_t kMaxQuantum = 65536;
+
+    using WaitCallback = std::function<void()>;
+
+    /**
+     * @brief 构造函数
+     * @param io_context 事件循环
+     * @param bytes_per_second 速率（0 = 本级不限速）
+     * @param parent 上级限速器（可为空）
+     */
+    explicit RateLimiter(asio::io_context& io_context,
+                         size_t bytes_per_second = 0,
+                         std::shared_ptr<RateLimiter> parent = nullptr);
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    /**
+     * @brief 修改速率，已在等待的使用方（包括各级子限速器上的）按新速率重新计算唤醒时间
+     */
+    void setRate(size_t bytes_per_second);
+
+    /** @brief 本级速率（0 = 不限速） */
+    size_t rate() const;
+
+    /** @brief 上级限速器 */
+    const std::shared_ptr<RateLimiter>& parent() const { return parent_; }
+
+    /**
+     * @brief 整条链是否都有令牌（可以开始一次传输）
+     */
+    bool ready();
+
+    /**
+     * @brief 单次传输的建议上限（整条链中最小的一级；全不限速时为 SIZE_MAX）
+     */
+    size_t quantum() const;
+
+    /**
+     * @brief 扣除已传输（或即将传输）的字节数，整条链都扣
+     */
+    void consume(size_t bytes);
+
+    /**
+     * @brief 等到 ready() 时回调
+     *
+     * 回调总是异步执行（即使当前已有令牌）；等待者按先后顺序唤醒
+     */
+    void wait(WaitCallback callback);
+
+    /**
+     * @brief 丢弃所有等待者（回调不会再执行）
+     */
+    void cancel();
+
+    RateLimiterStatistics getStatistics() const;
+
+private:
+    /** @brief 按流逝时间补充本级令牌（调用时已持有 mutex_） */
+    void refill(std::chrono::steady_clock::time_point now);
+
+    /** @brief 本级到有令牌还需的时间（0 = 已有令牌） */
+    std::chrono::nanoseconds levelDelay(std::chrono::steady_clock::time_point now);
+
+    /** @brief 整条链到有令牌还需的时间 */
+    std::chrono::nanoseconds chainDelay();
+
+    /** @brief 唤醒可以继续的等待者，还有等待者时重新设置定时器 */
+    void wakeWaiters();
+
+    /** @brief 按令牌缺口设置定时器 */
+    void armTimer(std::chrono::nanoseconds delay);
+    
+    /** @brief 有等待者时立即重新计算唤醒时间（上级或本级速率变化后） */
+    void rescheduleWaiters();
+    
+    /** @brief 在所有上级登记自己，上级改速率时通知本级的等待者 */
+    void watchParents();
+
+    /** @brief 某一级速率对应的传输粒度 */
+    static size_t quantumForRate(size_t bytes_per_second);
+
+    std::shared_ptr<RateLimiter> parent_;
+    asio::steady_timer timer_;
+
+    mutable std::mutex mutex_;
+    size_t rate_{0};
+    double tokens_{0};                              // 可为负（欠账）
+    std::chrono::steady_clock::time_point last_refill_;
+    std::deque<WaitCallback> waiters_;
+    bool timer_armed_{false};
+    bool watching_parents_{false};
+    std::vector<std::weak_ptr<RateLimiter>> watchers_;     // 曾经等待过的下级限速器
+    RateLimiterStatistics statistics_;
+};
+
+} // namespace magnet::network
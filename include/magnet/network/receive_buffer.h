@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace magnet::network {
+
+// ============================================================================
+// ReceiveBuffer 类
+// ============================================================================
+
+/**
+ * @class ReceiveBuffer
+ * @brief 带读写游标的可增长接收缓冲区
+ *
+ * 已接收未处理的数据始终位于 [data(), data() + size()) 的连续内存中，
+ * 解析器可以直接在缓冲区内解码消息，处理完后 consume() 只移动读游标。
+ * 只有尾部空间不足时才把未处理的数据（通常不足一条消息）搬到开头，
+ * 仍不够再按倍数扩容，因此每个字节的搬移次数是均摊常数。
+ *
+ * 读取方可以直接写入 prepare() 返回的空间，再 commit() 实际写入的长度，
+ * 省去中间拷贝。
+ *
+ * 线程安全：非线程安全，应在单个线程（io_context）上使用
+ *
+ * 使用示例：
+ * @code
+ * ReceiveBuffer buffer;
+ * uint8_t* out = buffer.prepare(4096);
+ * size_t n = ::recv(fd, out, buffer.writable(), 0);
+ * buffer.commit(n);
+ * while (buffer.size() >= 4) {
+ *     // 在 buffer.data() 上解析一条消息 ...
+ *     buffer.consume(message_length);
+ * }
+ * @endcode
+ */
+class ReceiveBuffer {
+public:
+    /**
+     * @param initial_capacity 初始容量（字节）
+     */
+    explicit ReceiveBuffer(size_t initial_capacity = 32 * 1024);
+
+    ReceiveBuffer(const ReceiveBuffer&) = delete;
+    ReceiveBuffer& operator=(const ReceiveBuffer&) = delete;
+    ReceiveBuffer(ReceiveBuffer&&) noexcept = default;
+    ReceiveBuffer& operator=(ReceiveBuffer&&) noexcept = default;
+
+    /** @brief 未处理数据的起始地址 */
+    const uint8_t* data() const { return buffer_.get() + read_pos_; }
+
+    /** @brief 未处理数据的长度 */
+    size_t size() const { return write_pos_ - read_pos_; }
+
+    bool empty() const { return read_pos_ == write_pos_; }
+
+    /** @brief 当前容量 */
+    size_t capacity() const { return capacity_; }
+
+    /** @brief 尾部可直接写入的空间 */
+    size_t writable() const { return capacity_ - write_pos_; }
+
+    /**
+     * @brief 保证尾部至少有 min_space 字节可写（必要时搬移或扩容）
+     * @return 写入位置，有效长度为 writable()
+     */
+    uint8_t* prepare(size_t min_space);
+
+    /** @brief 确认写入了 length 字节（length <= writable()） */
+    void commit(size_t length);
+
+    /** @brief 丢弃开头 length 字节已处理的数据（length <= size()） */
+    void consume(size_t length);
+
+    /** @brief 追加一段数据（prepare + memcpy + commit） */
+    void append(const uint8_t* data, size_t length);
+
+    /** @brief 清空数据，保留容量 */
+    void clear();
+
+private:
+    std::unique_ptr<uint8_t[]> buffer_;
+    size_t capacity_{0};
+    size_t read_pos_{0};
+    size_t write_pos_{0};
+};
+
+} // namespace magnet::network
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "network_types.h"
+#include "receive_buffer.h"
+#include "rate_limiter.h"
+#include "dns_resolver.h"
+#include "../utils/buffer_pool.h"
 #include <asio.hpp>
 #include <functional>
 #include <memory>
@@ -48,6 +52,7 @@ struct TcpStatistics {
     size_t connect_attempts{0};     // 连接尝试次数
     size_t connect_failures{0};     // 连接失败次数
     size_t send_errors{0};          // 发送错误次数
+    size_t write_calls{0};          // 合并后的写操作次数（每次一个 async_write）
     size_t receive_errors{0};       // 接收错误次数
     
     std::chrono::steady_clock::time_point connect_time;  // 连接建立时间
@@ -63,6 +68,7 @@ struct TcpStatistics {
         connect_attempts = 0;
         connect_failures = 0;
         send_errors = 0;
+        write_calls = 0;
         receive_errors = 0;
     }
     
@@ -90,6 +96,8 @@ struct TcpStatistics {
  * 
  * 特性：
  * - 异步连接、发送、接收
+ * - 发送队列：同一时刻只有一个写操作，排队的消息合并为一次 writev
+ * - 可选的读/写限速（RateLimiter，令牌不足时挂起读写，不忙等）
  * - 连接状态管理
  * - 自动断线检测
  * - 统计信息收集
@@ -113,9 +121,26 @@ struct TcpStatistics {
  * 
  * io_context.run();
  * @endcode
+ * 
+ * 高吞吐场景可以让 TcpClient 直接读入调用方的 ReceiveBuffer，
+ * 回调只通知新增的字节数，数据原地留在缓冲区中供解析：
+ * @code
+ * tcp->startReceive(buffer, [&buffer](const asio::error_code& ec, size_t bytes) {
+ *     // 在 buffer.data() 上解析完整消息，然后 buffer.consume(...)
+ * });
+ * @endcode
  */
 class TcpClient : public std::enable_shared_from_this<TcpClient> {
 public:
+    /** @brief 单次读取的缓冲区大小（256KB，提高吞吐量；也是外部缓冲区的建议容量） */
+    static constexpr size_t kReceiveBufferSize = 262144;
+    
+    /** @brief 缓冲区模式下每次读取前至少保证的可写空间 */
+    static constexpr size_t kMinReadSpace = 16384;
+    
+    /** @brief 连接竞速中相邻两次尝试的间隔（RFC 8305 Connection Attempt Delay） */
+    static constexpr std::chrono::milliseconds kConnectionAttemptDelay{250};
+    
     // ========================================================================
     // 类型定义
     // ========================================================================
@@ -130,6 +155,21 @@ public:
     using ReceiveCallback = std::function<void(const asio::error_code& ec, 
                                                const std::vector<uint8_t>& data)>;
     
+    /**
+     * @brief 接收到缓冲区回调
+     * 
+     * bytes 为本次追加到 ReceiveBuffer 的字节数；出错时为 0
+     */
+    using BufferReceiveCallback = std::function<void(const asio::error_code& ec, size_t bytes)>;
+    
+    /**
+     * @brief 发送队列水位回调
+     * 
+     * above = true：排队字节数达到高水位，调用方应暂停产生新数据；
+     * above = false：已回落到低水位（高水位的一半），可以继续发送
+     */
+    using WatermarkCallback = std::function<void(bool above)>;
+    
     /** @brief 连接断开回调 */
     using DisconnectCallback = std::function<void(const asio::error_code& ec)>;
 
@@ -143,6 +183,15 @@ public:
      */
     explicit TcpClient(asio::io_context& io_context);
     
+    /**
+     * @brief 接管已建立的连接（TcpListener 接受的入站连接）
+     * @param io_context 事件循环
+     * @param socket 已连接的 socket
+     * 
+     * 构造后即处于 Connected 状态，可以直接 startReceive()/send()
+     */
+    TcpClient(asio::io_context& io_context, asio::ip::tcp::socket socket);
+    
     /**
      * @brief 析构函数
      * 
@@ -168,8 +217,10 @@ public:
      * 
      * 特性：
      * - 异步执行，不阻塞调用线程
-     * - 支持域名解析
-     * - 可选超时设置
+     * - 支持域名解析（异步，经 DnsResolver 缓存）
+     * - 域名解析出多个地址时按 RFC 8305 竞速：IPv6/IPv4 交替，
+     *   每 kConnectionAttemptDelay 发起下一个尝试，第一个成功的连接胜出
+     * - 可选超时设置（覆盖解析和全部尝试，超时回调 timed_out）
      * 
      * 注意：
      * - 只能在 Disconnected 状态下调用
@@ -207,20 +258,58 @@ public:
     
     /**
      * @brief 异步发送数据
-     * @param data 要发送的数据
+     * @param data 要发送的数据（移入发送队列，不拷贝）
      * @param callback 发送完成回调（可选）
      * 
      * 特性：
      * - 异步执行，不阻塞
-     * - data 会被拷贝，调用后可立即释放
+     * - 消息进入发送队列，在 io_context 线程上合并写出：同一轮事件中
+     *   排队的多条消息只产生一次 async_write（writev）
+     * - 同一时刻只有一个写操作，不会交错
      * - 保证数据完整发送（使用 async_write）
      * 
      * 注意：
      * - 只能在 Connected 状态下调用
-     * - 多次调用会按顺序发送
+     * - 多次调用会按顺序发送，回调也按顺序执行
+     * - 连接关闭时仍在队列中的消息以错误码回调
+     */
+    void send(std::vector<uint8_t>&& data, SendCallback callback = nullptr);
+    
+    /**
+     * @brief 异步发送池化缓冲（只持有引用，不拷贝）
+     */
+    void send(utils::BufferHandle buffer, SendCallback callback = nullptr);
+    
+    /**
+     * @brief 异步发送数据（拷贝 data）
      */
     void send(const std::vector<uint8_t>& data, SendCallback callback = nullptr);
     
+    /**
+     * @brief 设置发送队列高水位
+     * @param high_watermark 排队字节数阈值（0 = 关闭）
+     * @param callback 越过高水位 / 回落到低水位时调用
+     * 
+     * 越过高水位的回调在 send() 的调用线程中执行，
+     * 回落的回调在 io_context 线程中执行
+     */
+    void setSendWatermark(size_t high_watermark, WatermarkCallback callback);
+    
+    /**
+     * @brief 发送队列中尚未写完的字节数（包括正在写的批次）
+     */
+    size_t pendingSendBytes() const;
+    
+    /**
+     * @brief 设置读写限速器（nullptr = 不限速）
+     * @param read_limiter 接收限速：令牌不足时暂停读取，每次最多读一个 quantum
+     * @param write_limiter 发送限速：令牌不足时暂停写出，每批最多合并约一个 quantum
+     * 
+     * 应在 io_context 线程中调用；通常在连接建立后、开始收发前设置
+     */
+    void setRateLimiters(std::shared_ptr<RateLimiter> read_limiter,
+                         std::shared_ptr<RateLimiter> write_limiter);
+    
     /**
      * @brief 开始接收数据
      * @param callback 每次收到数据时调用
@@ -235,6 +324,21 @@ public:
      */
     void startReceive(ReceiveCallback callback);
     
+    /**
+     * @brief 开始接收数据，直接读入调用方的缓冲区
+     * @param buffer 接收缓冲区（由调用方持有）
+     * @param callback 每次有新数据追加到 buffer 后调用
+     * 
+     * 每次读取前通过 buffer.prepare() 取得写入位置，socket 数据直接写入，
+     * 读完 commit()，中间没有任何拷贝。
+     * 
+     * 注意：
+     * - buffer 必须在 stopReceive()/close() 之前保持有效
+     * - 读取进行中不要从其他路径向 buffer 追加数据（prepare 可能搬移内存）
+     * - 重复调用会替换之前的缓冲区和回调
+     */
+    void startReceive(ReceiveBuffer& buffer, BufferReceiveCallback callback);
+    
     /**
      * @brief 停止接收数据
      * 
@@ -285,10 +389,35 @@ private:
     // 内部方法
     // ========================================================================
     
+    struct ConnectRace;
+    
+    /**
+     * @brief 按候选地址发起连接竞速
+     */
+    void startRace(const std::shared_ptr<ConnectRace>& race,
+                   const std::vector<asio::ip::address>& addresses);
+    
+    /**
+     * @brief 用新 socket 尝试下一个候选地址，并安排错开的后续尝试
+     */
+    void startAttempt(const std::shared_ptr<ConnectRace>& race);
+    
+    /**
+     * @brief 处理单次连接尝试的结果（第一个成功的胜出）
+     */
+    void handleAttempt(const std::shared_ptr<ConnectRace>& race,
+                       const std::shared_ptr<asio::ip::tcp::socket>& socket,
+                       const asio::error_code& ec);
+    
     /**
-     * @brief 执行连接操作
+     * @brief 中止竞速：关闭所有尝试中的 socket
      */
-    void doConnect(const asio::ip::tcp::endpoint& endpoint, ConnectCallback callback);
+    void abortRace(const std::shared_ptr<ConnectRace>& race, const asio::error_code& ec);
+    
+    /**
+     * @brief 竞速结束，交给 handleConnect（已被 close() 放弃的竞速只回调）
+     */
+    void finishRace(const std::shared_ptr<ConnectRace>& race, const asio::error_code& ec);
     
     /**
      * @brief 执行接收操作
@@ -305,26 +434,32 @@ private:
      */
     void handleReceive(const asio::error_code& ec, size_t bytes_received);
     
+    struct PendingSend;
+    
     /**
-     * @brief 处理发送结果
+     * @brief 消息入队，必要时安排写操作
      */
-    void handleSend(const asio::error_code& ec, size_t bytes_sent, 
-                    std::shared_ptr<std::vector<uint8_t>> buffer, SendCallback callback);
+    void enqueue(PendingSend&& pending);
     
     /**
-     * @brief 处理断线
+     * @brief 从发送队列取出一批消息，合并为一次 async_write
      */
-    void handleDisconnect(const asio::error_code& ec);
+    void doWrite();
     
     /**
-     * @brief 解析端点地址
+     * @brief 处理写操作结果
      */
-    asio::ip::tcp::endpoint resolveEndpoint(const TcpEndpoint& endpoint);
+    void handleWrite(const asio::error_code& ec, size_t bytes_sent);
+    
+    /**
+     * @brief 处理断线
+     */
+    void handleDisconnect(const asio::error_code& ec);
     
     /**
      * @brief 更新发送统计
      */
-    void updateSendStats(size_t bytes, bool success);
+    void updateSendStats(size_t bytes, size_t messages, bool success);
     
     /**
      * @brief 更新接收统计
@@ -341,17 +476,51 @@ private:
     asio::ip::tcp::socket socket_;
     asio::steady_timer connect_timer_;
     
+    // 进行中的连接（解析 + 竞速），close() 时放弃
+    std::shared_ptr<ConnectRace> race_;
+    
     std::atomic<TcpConnectionState> state_{TcpConnectionState::Disconnected};
     std::atomic<bool> receiving_{false};
     
     TcpEndpoint remote_endpoint_;
     
-    // 接收缓冲区
-    static constexpr size_t kReceiveBufferSize = 262144;  // 256KB - 增大以提高吞吐量
+    // 接收缓冲区（仅 vector 回调模式使用，首次 startReceive 时分配）
     std::vector<uint8_t> receive_buffer_;
     
+    // 调用方持有的接收缓冲区（缓冲区模式）
+    ReceiveBuffer* external_buffer_{nullptr};
+    
+    // 每次 startReceive/stopReceive/close 递增，使等待令牌的旧读取失效
+    uint64_t receive_generation_{0};
+    
+    // 限速
+    std::shared_ptr<RateLimiter> read_limiter_;
+    std::shared_ptr<RateLimiter> write_limiter_;
+    
+    // 发送队列
+    struct PendingSend {
+        std::vector<uint8_t> data;          // 二者择一：普通字节数组或池化缓冲
+        utils::BufferHandle buffer;
+        SendCallback callback;
+        
+        asio::const_buffer bytes() const {
+            return buffer ? asio::buffer(buffer.data(), buffer.size()) : asio::buffer(data);
+        }
+    };
+    static constexpr size_t kMaxWriteBatch = 64;    // 每次写操作最多合并的消息数（与 writev 单次上限一致）
+    mutable std::mutex send_mutex_;
+    std::vector<PendingSend> send_queue_;
+    std::vector<PendingSend> write_batch_;          // 正在写的批次（写完前保持有效）
+    std::vector<asio::const_buffer> write_buffers_; // write_batch_ 对应的缓冲序列
+    bool write_scheduled_{false};                   // 已安排写操作（投递中或进行中）
+    size_t pending_send_bytes_{0};
+    size_t high_watermark_{0};
+    bool above_watermark_{false};
+    WatermarkCallback watermark_callback_;
+    
     // 回调
     ReceiveCallback receive_callback_;
+    BufferReceiveCallback buffer_callback_;
     DisconnectCallback disconnect_callback_;
     
     // 统计信息
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "network_types.h"
+#include "tcp_client.h"
+#include <asio.hpp>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+
+namespace magnet::network {
+
+// ============================================================================
+// 统计信息
+// ============================================================================
+
+struct TcpListenerStatistics {
+    size_t accepted{0};             // 接受的连接数
+    size_t accept_errors{0};        // accept 失败次数
+};
+
+// ============================================================================
+// TcpListener 类
+// ============================================================================
+
+/**
+ * @class TcpListener
+ * @brief 异步 TCP 监听器
+ *
+ * 在指定端口上接受入站连接，每个连接包装成已连接的 TcpClient 交给回调。
+ * 优先以双栈 IPv6 套接字监听（IPv4 与 IPv6 Peer 共用一个端口），
+ * 系统不支持 IPv6 时退回纯 IPv4。
+ * 监听器只负责 accept，连接的协议处理（握手、路由、连接数限制）由上层完成。
+ *
+ * accept 出错（如文件描述符耗尽）时不会忙等重试，而是延迟一段时间再继续。
+ *
+ * 使用示例：
+ * @code
+ * auto listener = std::make_shared<TcpListener>(io_context);
+ * listener->listen(6881, [](std::shared_ptr<TcpClient> client) {
+ *     client->startReceive(...);
+ * });
+ * @endcode
+ */
+class TcpListener : public std::enable_shared_from_this<TcpListener> {
+public:
+    /** @brief accept 出错后的重试间隔 */
+    static constexpr std::chrono::milliseconds kAcceptRetryDelay{500};
+
+    /** @brief 新连接回调（client 已处于 Connected 状态） */
+    using AcceptCallback = std::function<void(std::shared_ptr<TcpClient> client)>;
+
+    /**
+     * @brief 构造函数
+     * @param io_context 事件循环
+     */
+    explicit TcpListener(asio::io_context& io_context);
+
+    /**
+     * @brief 析构函数（关闭监听）
+     */
+    ~TcpListener();
+
+    // 禁止拷贝
+    TcpListener(const TcpListener&) = delete;
+    TcpListener& operator=(const TcpListener&) = delete;
+
+    /**
+     * @brief 开始监听
+     * @param port 本地端口（0 = 系统随机分配）
+     * @param callback 每接受一个连接调用一次（io_context 线程）
+     * @return 绑定失败（端口被占用等）时返回 false
+     */
+    bool listen(uint16_t port, AcceptCallback callback);
+
+    /**
+     * @brief 停止监听（已接受的连接不受影响）
+     */
+    void close();
+
+    /**
+     * @brief 是否正在监听
+     */
+    bool isListening() const { return listening_.load(); }
+
+    /**
+     * @brief 是否以双栈套接字监听（同时接受 IPv4 和 IPv6 连接）
+     */
+    bool isDualStack() const { return dual_stack_; }
+
+    /**
+     * @brief 实际监听的端口（listen(0) 后查询系统分配的端口）
+     */
+    uint16_t localPort() const;
+
+    /**
+     * @brief 获取统计信息
+     */
+    TcpListenerStatistics getStatistics() const;
+
+private:
+    /** @brief 按协议打开、绑定并监听，失败时关闭 acceptor 并返回 false */
+    bool open(const asio::ip::tcp& protocol, uint16_t port, asio::error_code& ec);
+
+    /** @brief 发起下一次 accept */
+    void doAccept();
+
+    /** @brief 处理 accept 结果 */
+    void handleAccept(const asio::error_code& ec, asio::ip::tcp::socket socket);
+
+private:
+    asio::io_context& io_context_;
+    asio::ip::tcp::acceptor acceptor_;
+    asio::steady_timer retry_timer_;
+
+    std::atomic<bool> listening_{false};
+    uint16_t local_port_{0};
+    bool dual_stack_{false};
+
+    AcceptCallback accept_callback_;
+
+    mutable std::mutex stats_mutex_;
+    TcpListenerStatistics statistics_;
+};
+
+} // namespace magnet::network
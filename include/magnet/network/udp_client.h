@@ -9,6 +9,17 @@
 #include <array>
 
 namespace magnet::network {
+
+/*
+* @brief 批量接收模式下的一个数据报
+* data 指向 UdpClient 内部的接收区，只在回调期间有效，需要保留时调用 toVector()
+* remote 为二进制端点（双栈 socket 上的 IPv4 对端已还原为 IPv4），不做字符串格式化
+*/
+struct UdpDatagram {
+    ByteSpan data;
+    asio::ip::udp::endpoint remote;
+};
+
 /*
 * @brief UDP 客户端
 提供异步的UDP通信功能
@@ -28,6 +39,20 @@ class UdpClient: public std::enable_shared_from_this<UdpClient> {
         
         using SendCallback = std::function<void(const asio::error_code&ec, size_t bytes_sent)>;
 
+        /*
+            datagram 批量接收到的数据报（零拷贝视图 + 二进制端点）
+        */
+        using DatagramCallback = std::function<void(const UdpDatagram& datagram)>;
+
+        static constexpr size_t kBatchSize = 32;            // 每次 recvmmsg/sendmmsg 的数据报数
+        static constexpr size_t kMaxDatagramSize = 4096;    // 批量接收区每个槽位的大小（更大的数据报被丢弃）
+        static constexpr size_t kMaxQueuedDatagrams = 4096; // 发送队列上限（超出时丢弃并计为发送错误）
+
+        /*
+        * @brief 构造并绑定本地端口
+        * 优先打开双栈 socket（[::]:port），IPv4 对端的地址在回调中
+        * 还原为普通 IPv4 字符串；系统不支持 IPv6 时使用 IPv4 socket
+        */
         explicit UdpClient(asio::io_context& io_context, uint16_t local_port = 0);
 
         ~UdpClient();
@@ -46,8 +71,9 @@ class UdpClient: public std::enable_shared_from_this<UdpClient> {
         * 特性：
         * - 异步发送，不阻塞调用线程
         * - 线程安全，可以从任何线程调用
-        * - 支持域名解析（如果 endpoint.ip 是域名）
+        * - 支持域名解析（如果 endpoint.ip 是域名，异步解析并缓存）
         * - 自动更新统计信息
+        * - 不需要回调时进入发送队列，由 sendmmsg 批量发出（Linux）
         * 注意：
         * - 如果 socket 未打开，会自动打开
         * - 回调在 io_context 线程中执行
@@ -69,6 +95,18 @@ class UdpClient: public std::enable_shared_from_this<UdpClient> {
         */
         void startReceive(ReceiveCallback callback);
 
+        /*
+        * @brief 以批量模式开始接收
+        * @param callback 每个数据报调用一次（在同一批次内连续调用）
+        * @throw std::runtime_error 如果已经在接收中
+        * 特性：
+        * - Linux 上 socket 可读后用 recvmmsg 一次取出最多 kBatchSize 个数据报，
+        *   数据直接留在预分配的接收区中，不为每个数据报分配内存或格式化地址
+        * - 其他平台退回逐个 async_receive_from，回调形式相同
+        * - 统计信息按批次更新
+        */
+        void startReceiveBatch(DatagramCallback callback);
+
         /*
         * @brief 停止接收 UDP 数据包
         * 特性：
@@ -101,6 +139,12 @@ class UdpClient: public std::enable_shared_from_this<UdpClient> {
 
         bool isReceiving() const;
 
+        /*
+        * @brief 是否为双栈 socket（IPv6 socket 同时收发 IPv4，IPV6_V6ONLY 关闭）
+        * 系统不支持 IPv6 时退回纯 IPv4 socket，返回 false
+        */
+        bool isDualStack() const { return dual_stack_; }
+
         struct Statistics {
             size_t bytes_sent{0};           // 发送的总字节数
             size_t bytes_received{0};       // 接收的总字节数
@@ -164,16 +208,48 @@ private:
          */
         void updateReceiveStats(size_t bytes, bool success);
         /**
-         * @brief 解析端点地址
-         * @param endpoint 端点信息（可能包含域名）
-         * @return asio 端点对象
+         * @brief 一次性累加一个批次的统计（只加锁一次）
+         */
+        void addStatistics(const Statistics& delta);
+        /**
+         * @brief 把目标地址转换为本 socket 可发送的形式
+         * @return false 表示地址族不受支持（IPv4 socket 上的 IPv6 目标）
+         * 
+         * 双栈 socket 上的 IPv4 目标转换为 v4-mapped 地址
+         */
+        bool mapDestination(asio::ip::udp::endpoint& target) const;
+        /**
+         * @brief 数据报进入发送队列，必要时安排一次批量发送
+         * @return false 表示当前平台不支持批量发送，调用方应逐个发送
+         */
+        bool enqueue(const asio::ip::udp::endpoint& target, const uint8_t* data, size_t size);
+        /**
+         * @brief 用 sendmmsg 发出队列中的数据报，socket 不可写时等待后继续
+         */
+        void flushQueue();
+        /**
+         * @brief 批量模式：等待 socket 可读
+         */
+        void doReceiveBatch();
+        /**
+         * @brief 批量模式：socket 可读后用 recvmmsg 取出数据报并逐个回调
+         */
+        void handleReadable(const asio::error_code& ec);
+        /**
+         * @brief 向已解析的地址发送数据
+         * @param target 目标 asio 端点
+         * @param data 要发送的数据（异步操作期间保持有效）
+         * @param callback 发送完成回调
          * 
-         * 内部方法，支持：
-         * - IPv4 地址
-         * - IPv6 地址
-         * - 域名（会进行 DNS 解析）
+         * 内部方法。域名由 send() 经 DnsResolver 异步解析后再调用，
+         * 不会在 io_context 线程上同步查询 DNS。双栈 socket 上的 IPv4
+         * 目标会转换为 v4-mapped 地址
          */
-        asio::ip::udp::endpoint resolveEndpoint(const UdpEndpoint& endpoint);
+        void doSend(const asio::ip::udp::endpoint& target,
+                    std::shared_ptr<std::vector<uint8_t>> data,
+                    SendCallback callback);
+
+        struct BatchState;                          // recvmmsg/sendmmsg 的预分配消息头与数据区
 
 private:
         asio::io_context& io_context_;              // io_context 引用
@@ -182,6 +258,10 @@ private:
         ReceiveCallback receive_callback_;          // 接收回调函数
         std::array<uint8_t, 65536> receive_buffer_; // 接收缓冲区（64KB，足够大多数 UDP 包）
         asio::ip::udp::endpoint remote_endpoint_;   // 远程端点（接收时用于存储发送方
+        bool dual_stack_{false};                    // 是否为双栈 socket
+        DatagramCallback datagram_callback_;        // 批量模式回调（非空表示批量模式）
+        std::unique_ptr<BatchState> batch_;         // 首次批量收发时分配
+        std::mutex send_mutex_;                     // 保护发送队列
 
         mutable std::mutex stats_mutex_;            // 统计信息互斥锁
         Statistics statistics_;                     // 统计信息
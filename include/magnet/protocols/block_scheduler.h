@@ -0,0 +1,224 @@
+#pragma once
+
+#include "bt_message.h"
+#include "../network/network_types.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace magnet::protocols {
+
+// ============================================================================
+// 配置参数
+// ============================================================================
+
+/**
+ * @struct BlockSchedulerConfig
+ * @brief BlockScheduler 配置参数
+ */
+struct BlockSchedulerConfig {
+    size_t initial_queue_depth{8};      // 还没有测速样本时的管道深度
+    size_t min_queue_depth{2};          // 最小管道深度
+    size_t max_queue_depth{128};        // 最大管道深度（与 max_requests_per_peer 对齐）
+    size_t queue_headroom{2};           // BDP 之外额外保留的请求数，吸收抖动
+
+    std::chrono::milliseconds initial_block_timeout{15000}; // 还没有延迟样本时的块超时
+    std::chrono::milliseconds min_block_timeout{3000};    // 单个块最短超时
+    std::chrono::milliseconds max_block_timeout{30000};   // 单个块最长超时
+    double timeout_latency_factor{3.0};                   // 超时 = 平滑请求延迟 × 系数
+
+    std::chrono::milliseconds rate_sample_interval{1000}; // 速度采样窗口
+    std::chrono::milliseconds min_rtt_window{10000};      // 最小 RTT 窗口（过期后重新测量）
+};
+
+// ============================================================================
+// BlockScheduler 类
+// ============================================================================
+
+/**
+ * @class BlockScheduler
+ * @brief 块级请求调度的记账部分：每个 Peer 的请求管道
+ *
+ * 为每个 Peer 维护：
+ * - 已发出但未收到的块（带发送时间），超时按块而不是按分片计算
+ * - 下载速度（EWMA）和最小请求延迟（近似 RTT）
+ * - 目标管道深度 ≈ 带宽时延积 / 块大小 + 余量
+ *
+ * 只做记账，不发送任何消息；由 DownloadController 决定发什么、发给谁。
+ *
+ * 线程安全：不加锁，由调用方在自己的锁内使用
+ *
+ * 使用示例：
+ * @code
+ * BlockScheduler scheduler;
+ * scheduler.addPeer(ep);
+ * scheduler.setPeerChoked(ep, false);
+ *
+ * while (scheduler.freeSlots(ep) > 0) {
+ *     scheduler.onBlockRequested(ep, block, now);
+ * }
+ *
+ * scheduler.onBlockReceived(ep, block, now);
+ * for (auto& expired : scheduler.collectTimedOut(now)) {
+ *     // 重新分配 expired.block
+ * }
+ * @endcode
+ */
+class BlockScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /** @brief 超时的块 */
+    struct TimedOutBlock {
+        network::TcpEndpoint peer;
+        BlockInfo block;
+    };
+
+    /** @brief 未完成的块及其同时发出的请求数（endgame 时可能 > 1） */
+    struct OutstandingBlock {
+        BlockInfo block;
+        size_t requests{0};
+    };
+
+    explicit BlockScheduler(BlockSchedulerConfig config = {});
+
+    // ========================================================================
+    // Peer 管理
+    // ========================================================================
+
+    /**
+     * @brief 添加 Peer（初始为被对方 choke）
+     */
+    void addPeer(const network::TcpEndpoint& peer);
+
+    /**
+     * @brief 移除 Peer
+     * @return 该 Peer 上尚未完成的块，需要重新分配
+     */
+    std::vector<BlockInfo> removePeer(const network::TcpEndpoint& peer);
+
+    /**
+     * @brief 更新对方的 choke 状态
+     * @return 被 choke 时返回该 Peer 上尚未完成的块（对方会丢弃这些请求）
+     */
+    std::vector<BlockInfo> setPeerChoked(const network::TcpEndpoint& peer, bool choked);
+
+    /** @brief 是否已记录该 Peer */
+    bool hasPeer(const network::TcpEndpoint& peer) const;
+
+    /** @brief 所有可以发送请求的 Peer（未被 choke 且有空闲槽位） */
+    std::vector<network::TcpEndpoint> requestablePeers() const;
+
+    // ========================================================================
+    // 请求记账
+    // ========================================================================
+
+    /**
+     * @brief 记录已向 Peer 发出一个块请求
+     */
+    void onBlockRequested(const network::TcpEndpoint& peer, const BlockInfo& block,
+                          Clock::time_point now);
+
+    /**
+     * @brief 记录收到一个块，更新速度和延迟估计
+     * @return true 如果该块确实是向这个 Peer 请求的（分片、偏移和长度都一致）
+     *
+     * 长度不符的块不计入，对应的请求保留在管道中，到期后按超时重新分配
+     */
+    bool onBlockReceived(const network::TcpEndpoint& peer, const BlockInfo& block,
+                         Clock::time_point now);
+
+    /**
+     * @brief 从所有 Peer 的管道中移除某个块
+     * @return 仍持有该块请求的 Peer 列表
+     */
+    std::vector<network::TcpEndpoint> releaseBlock(uint32_t piece_index, uint32_t begin);
+
+    /**
+     * @brief 收集并移除所有已超时的块
+     *
+     * 超时的 Peer 会被降速（速度估计减半），管道深度随之缩小
+     */
+    std::vector<TimedOutBlock> collectTimedOut(Clock::time_point now);
+
+    // ========================================================================
+    // 查询
+    // ========================================================================
+
+    /** @brief 空闲槽位数 = 目标深度 - 已发出请求数（被 choke 时为 0） */
+    size_t freeSlots(const network::TcpEndpoint& peer) const;
+
+    /** @brief 目标管道深度 */
+    size_t queueDepth(const network::TcpEndpoint& peer) const;
+
+    /** @brief 已发出未完成的请求数 */
+    size_t outstanding(const network::TcpEndpoint& peer) const;
+
+    /** @brief 当前块超时时间 */
+    std::chrono::milliseconds blockTimeout(const network::TcpEndpoint& peer) const;
+
+    /** @brief 估计下载速度（字节/秒） */
+    double downloadRate(const network::TcpEndpoint& peer) const;
+
+    /** @brief 是否有任何 Peer 持有该块的请求 */
+    bool isRequested(uint32_t piece_index, uint32_t begin) const;
+
+    /** @brief 是否已向指定 Peer 请求过该块 */
+    bool isRequestedFrom(const network::TcpEndpoint& peer, uint32_t piece_index, uint32_t begin) const;
+
+    /**
+     * @brief 所有未完成的块（去重），按请求数从少到多排序
+     *
+     * 开销与未完成请求总数成正比，用于 endgame 阶段
+     */
+    std::vector<OutstandingBlock> outstandingBlocks() const;
+
+    /** @brief 所有 Peer 上的未完成请求总数 */
+    size_t totalOutstanding() const { return total_outstanding_; }
+
+    /** @brief Peer 数量 */
+    size_t peerCount() const { return peers_.size(); }
+
+private:
+    struct Outstanding {
+        BlockInfo block;
+        Clock::time_point sent_time;
+    };
+
+    struct PeerPipeline {
+        network::TcpEndpoint endpoint;
+        bool choked{true};
+        std::vector<Outstanding> outstanding;
+
+        // 速度估计
+        double rate{0};                     // 字节/秒（EWMA）
+        bool has_rate{false};
+        size_t window_bytes{0};
+        Clock::time_point window_start;
+
+        // 延迟估计
+        std::chrono::microseconds min_rtt{0};         // 当前生效的最小延迟
+        std::chrono::microseconds window_min_rtt{0};  // 本窗口内的最小延迟
+        Clock::time_point rtt_window_start;
+        std::chrono::microseconds srtt{0};            // 平滑请求延迟（含排队）
+        bool has_rtt{false};
+    };
+
+    PeerPipeline* find(const network::TcpEndpoint& peer);
+    const PeerPipeline* find(const network::TcpEndpoint& peer) const;
+    size_t targetDepth(const PeerPipeline& pipeline) const;
+    std::chrono::milliseconds timeoutFor(const PeerPipeline& pipeline) const;
+    std::vector<BlockInfo> drain(PeerPipeline& pipeline);
+    void updateEstimates(PeerPipeline& pipeline, size_t bytes,
+                         std::chrono::microseconds latency, Clock::time_point now);
+
+private:
+    BlockSchedulerConfig config_;
+    std::unordered_map<std::string, PeerPipeline> peers_;  // key: "ip:port"
+    size_t total_outstanding_{0};
+};
+
+} // namespace magnet::protocols
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "magnet_types.h"
+#include "../network/network_types.h"
+#include "../utils/buffer_pool.h"
 
 #include <array>
 #include <vector>
@@ -172,6 +174,26 @@ struct PieceBlock {
     }
 };
 
+/**
+ * @struct PieceBlockView
+ * @brief 数据块视图（数据仍在接收缓冲区中，不持有）
+ * 
+ * 只在回调期间有效；需要保留时调用 toPieceBlock() 拷贝
+ */
+struct PieceBlockView {
+    uint32_t piece_index{0};        // 分片索引
+    uint32_t begin{0};              // 块偏移
+    network::ByteSpan data;         // 指向接收缓冲区的数据
+    
+    BlockInfo toBlockInfo() const {
+        return BlockInfo{piece_index, begin, static_cast<uint32_t>(data.size())};
+    }
+    
+    PieceBlock toPieceBlock() const {
+        return PieceBlock{piece_index, begin, data.toVector()};
+    }
+};
+
 // ============================================================================
 // BtMessage 类
 // ============================================================================
@@ -248,6 +270,11 @@ public:
      */
     static BtMessage createPiece(const PieceBlock& block);
     
+    /**
+     * @brief 创建 Piece 消息（数据在池化缓冲中，只持有引用）
+     */
+    static BtMessage createPiece(uint32_t piece_index, uint32_t begin, utils::BufferHandle block);
+    
     /**
      * @brief 创建 Cancel 消息
      * @param block 要取消的块信息
@@ -276,10 +303,29 @@ public:
      */
     std::vector<uint8_t> encode() const;
     
+    /**
+     * @brief 编码到池化缓冲（发送路径使用，不经过堆分配）
+     */
+    utils::BufferHandle encodePooled() const;
+    
+    /**
+     * @brief 编码后的总长度（含 4 字节 length 字段）
+     */
+    size_t encodedSize() const;
+    
+    /**
+     * @brief 编码到 out（至少 encodedSize() 字节）
+     */
+    void encodeInto(uint8_t* out) const;
+    
     /**
      * @brief 从字节数组解码
      * @param data 数据（必须包含完整消息）
      * @return 解码后的消息，失败返回 nullopt
+     * 
+     * Piece 消息的数据不拷贝：data() 直接指向输入缓冲区，
+     * 只在输入缓冲区有效（未被 consume/覆盖）期间可用。
+     * 需要保留数据时使用 toPieceBlock() 拷贝一份。
      */
     static std::optional<BtMessage> decode(const std::vector<uint8_t>& data);
     static std::optional<BtMessage> decode(const uint8_t* data, size_t len);
@@ -331,8 +377,16 @@ public:
     /** @brief 获取端口（Port） */
     uint16_t port() const { return port_; }
     
-    /** @brief 获取数据（Piece） */
-    const std::vector<uint8_t>& data() const { return data_; }
+    /** @brief 获取数据（Piece；解码得到的消息指向输入缓冲区） */
+    network::ByteSpan data() const {
+        if (borrowed_data_.data()) {
+            return borrowed_data_;
+        }
+        if (pooled_data_) {
+            return network::ByteSpan(pooled_data_.data(), pooled_data_.size());
+        }
+        return network::ByteSpan(data_);
+    }
     
     /** @brief 获取位图（Bitfield） */
     const std::vector<bool>& bitfield() const { return bitfield_; }
@@ -355,10 +409,17 @@ public:
     }
     
     /**
-     * @brief 转换为 PieceBlock（Piece）
+     * @brief 转换为 PieceBlock（Piece，拷贝数据）
      */
     PieceBlock toPieceBlock() const {
-        return PieceBlock{piece_index_, begin_, data_};
+        return PieceBlock{piece_index_, begin_, data().toVector()};
+    }
+    
+    /**
+     * @brief 转换为 PieceBlockView（Piece，不拷贝数据）
+     */
+    PieceBlockView toPieceBlockView() const {
+        return PieceBlockView{piece_index_, begin_, data()};
     }
 
 private:
@@ -374,8 +435,10 @@ private:
     // Port
     uint16_t port_{0};
     
-    // Piece
+    // Piece（createPiece 持有数据或池化缓冲；decode 只记录输入缓冲区中的位置）
     std::vector<uint8_t> data_;
+    utils::BufferHandle pooled_data_;
+    network::ByteSpan borrowed_data_;
     
     // Bitfield
     std::vector<bool> bitfield_;
@@ -409,6 +472,24 @@ inline void writeUint16BE(std::vector<uint8_t>& buffer, uint16_t value) {
     buffer.push_back(static_cast<uint8_t>(value & 0xFF));
 }
 
+/**
+ * @brief 写入 32 位大端整数到 out
+ */
+inline void storeUint32BE(uint8_t* out, uint32_t value) {
+    out[0] = static_cast<uint8_t>((value >> 24) & 0xFF);
+    out[1] = static_cast<uint8_t>((value >> 16) & 0xFF);
+    out[2] = static_cast<uint8_t>((value >> 8) & 0xFF);
+    out[3] = static_cast<uint8_t>(value & 0xFF);
+}
+
+/**
+ * @brief 写入 16 位大端整数到 out
+ */
+inline void storeUint16BE(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>((value >> 8) & 0xFF);
+    out[1] = static_cast<uint8_t>(value & 0xFF);
+}
+
 /**
  * @brief 读取 32 位大端整数
  */
@@ -110,36 +110,60 @@ namespace magnet::protocols {
         }
     };
 
+    /*
+    * @brief 紧凑地址格式（BEP 23 / BEP 32）
+    * IPv4: 4 字节地址 + 2 字节端口；IPv6: 16 字节地址 + 2 字节端口（网络字节序）
+    */
+
+    constexpr size_t s_kCompactAddressSize = 6;
+    constexpr size_t s_kCompactAddress6Size = 18;
+
+    /*
+    * @brief 把 IP 字符串和端口编码为紧凑格式，IP 无效时返回空字符串
+    */
+    std::string encodeCompactAddress(const std::string& ip, uint16_t port);
+
+    /*
+    * @brief 解析 6 字节或 18 字节的紧凑地址，长度不符时返回 nullopt
+    */
+    std::optional<network::Endpoint> decodeCompactAddress(const uint8_t* data, size_t len);
+
+    /*
+    * @brief IP 字符串是否为 IPv6 地址
+    */
+    bool isIpv6Address(const std::string& ip);
+
     /*
     * @struct CompactNodeInfo
     * @brief DHT 协议中的紧凑节点格式
-    * 格式： 20字节 nodeId + 4字节 IPV4 + 2 字节端口（网络字节序）
+    * 格式： 20字节 nodeId + 紧凑地址（IPv4 共 26 字节，BEP 32 的 IPv6 共 38 字节）
     */
 
     struct CompactNodeInfo{
-        static constexpr size_t s_kCompactNodeSize = 26;
+        static constexpr size_t s_kCompactNodeSize = 20 + s_kCompactAddressSize;
+        static constexpr size_t s_kCompactNode6Size = 20 + s_kCompactAddress6Size;
 
         NodeId id_;
-        uint32_t ip_;
-        uint16_t port_;
+        std::string ip_;
+        uint16_t port_;     // 主机字节序
 
         /*
-        * @brief 从字节数组解析
+        * @brief 从字节数组解析（len 为 26 按 IPv4，为 38 按 IPv6）
         */
 
         static std::optional<CompactNodeInfo> fromBytes(const uint8_t* data, size_t len);
 
         /*
-        * @brief 从字符串解析多个节点
+        * @brief 从字符串解析多个节点（"nodes" 为 IPv4，"nodes6" 为 IPv6）
         */
 
-        static std::vector<CompactNodeInfo> parseNodes(const std::string& data);
+        static std::vector<CompactNodeInfo> parseNodes(const std::string& data, bool ipv6 = false);
 
         /*
-        * 转换字节数组
+        * 转换为紧凑格式，IP 无效时返回空字符串
         */
 
-        std::array<uint8_t, s_kCompactNodeSize> toBytes() const;
+        std::string toBytes() const;
 
         /*
         *   @brief 转换为DhtNode
@@ -153,33 +177,32 @@ namespace magnet::protocols {
      * @struct CompactPeerInfo
      * @brief DHT 协议中的紧凑 Peer 格式
      * 
-     * 格式：4 字节 IPv4 + 2 字节端口（网络字节序）
+     * 格式：4 字节 IPv4（或 16 字节 IPv6）+ 2 字节端口（网络字节序）
      */
     struct CompactPeerInfo {
-        static constexpr size_t s_kCompactPeerSize = 6;  // 4 + 2
+        static constexpr size_t s_kCompactPeerSize = s_kCompactAddressSize;
+        static constexpr size_t s_kCompactPeer6Size = s_kCompactAddress6Size;
         
-        uint32_t ip;    // 网络字节序
-        uint16_t port;  // 网络字节序
+        std::string ip;
+        uint16_t port;  // 主机字节序
         
         /**
-         * @brief 从字节数组解析
+         * @brief 从字节数组解析（len 为 6 按 IPv4，为 18 按 IPv6）
          */
         static std::optional<CompactPeerInfo> fromBytes(const uint8_t* data, size_t len) {
-            if (len < s_kCompactPeerSize) return std::nullopt;
-            
-            CompactPeerInfo info;
-            std::memcpy(&info.ip, data, 4);
-            std::memcpy(&info.port, data + 4, 2);
-            return info;
+            auto endpoint = decodeCompactAddress(data, len);
+            if (!endpoint) return std::nullopt;
+            return CompactPeerInfo{endpoint->ip, endpoint->port};
         }
         
         /**
-         * @brief 从字符串解析多个 Peer
+         * @brief 从字符串解析多个 Peer（tracker 的 "peers" 为 IPv4，"peers6" 为 IPv6）
          */
-        static std::vector<CompactPeerInfo> parsePeers(const std::string& data) {
+        static std::vector<CompactPeerInfo> parsePeers(const std::string& data, bool ipv6 = false) {
+            size_t stride = ipv6 ? s_kCompactPeer6Size : s_kCompactPeerSize;
             std::vector<CompactPeerInfo> peers;
-            for (size_t i = 0; i + s_kCompactPeerSize <= data.size(); i += s_kCompactPeerSize) {
-                auto peer = fromBytes(reinterpret_cast<const uint8_t*>(data.data() + i), s_kCompactPeerSize);
+            for (size_t i = 0; i + stride <= data.size(); i += stride) {
+                auto peer = fromBytes(reinterpret_cast<const uint8_t*>(data.data() + i), stride);
                 if (peer) {
                     peers.push_back(*peer);
                 }
@@ -190,22 +213,15 @@ namespace magnet::protocols {
         /**
          * @brief 获取 IP 字符串
          */
-        std::string ipString() const {
-            uint32_t host_ip = ntohl(ip);
-            char ip_str[16];
-            snprintf(ip_str, sizeof(ip_str), "%u.%u.%u.%u",
-                (host_ip >> 24) & 0xFF,
-                (host_ip >> 16) & 0xFF,
-                (host_ip >> 8) & 0xFF,
-                host_ip & 0xFF);
-            return ip_str;
+        const std::string& ipString() const {
+            return ip;
         }
         
         /**
          * @brief 获取端口（主机字节序）
          */
         uint16_t hostPort() const {
-            return ntohs(port);
+            return port;
         }
     };
 
@@ -2,6 +2,8 @@
 
 #include "dht_message.h"
 #include "routing_table.h"
+#include "dht_state.h"
+#include "lookup_shortlist.h"
 #include "query_manager.h"
 #include "dch_types.h"
 #include "magnet_types.h"
@@ -11,11 +13,11 @@
 #include <functional>
 #include <memory>
 #include <map>
-#include <set>
 #include <mutex>
 #include <atomic>
 #include <chrono>
 #include <algorithm>
+#include <optional>
 
 namespace magnet::protocols {
 
@@ -54,7 +56,10 @@ struct DhtClientConfig {
     std::chrono::seconds refresh_interval{900};   // 路由表刷新间隔（15分钟）
     std::chrono::seconds announce_interval{1800}; // 重新宣告间隔（30分钟）
     
-    size_t max_lookup_rounds{20};            // 最大查找轮次
+    // 查找：始终保持 alpha 个查询在途；超过慢节点阈值（按节点 RTT 估计）未响应的
+    // 查询不再占用名额，提前补发，在途总数不超过 max_lookup_outstanding
+    size_t max_lookup_outstanding{6};        // 单次查找在途查询上限（含慢节点）
+    size_t max_lookup_queries{100};          // 单次查找最多发出的查询数
     
     // Bootstrap 节点
     std::vector<std::pair<std::string, uint16_t>> bootstrap_nodes{
@@ -63,6 +68,14 @@ struct DhtClientConfig {
         {"router.utorrent.com", 6881}
     };
     
+    // 状态持久化：节点 ID、路由表好节点和 Token 密钥（空 = 不保存）
+    // 停止时和每隔 state_save_interval 保存；启动时先 ping 保存的节点热启动，
+    // 响应的节点不足 min_warm_start_nodes 时才回退到引导节点。
+    // 文件已被另一个实例锁定时使用新的节点 ID，且不保存
+    std::string state_file;
+    std::chrono::seconds state_save_interval{300};
+    size_t min_warm_start_nodes{8};
+    
     // QueryManager 配置
     QueryManagerConfig query_config{};
 };
@@ -84,7 +97,10 @@ struct DhtClientStatistics {
     
     // 状态
     bool bootstrapped{false};        // 是否已加入网络
-    size_t node_count{0};            // 当前路由表节点数
+    bool warm_started{false};        // 是否通过保存的节点热启动
+    std::chrono::milliseconds bootstrap_time{0};  // bootstrap() 到加入网络的耗时
+    size_t node_count{0};            // 当前路由表节点数（IPv4 + IPv6）
+    size_t ipv6_node_count{0};       // 其中 IPv6 路由表的节点数
     
     void reset() {
         lookups_started = 0;
@@ -103,16 +119,22 @@ struct DhtClientStatistics {
 /**
  * @brief 迭代查找状态
  * 
- * 管理一次 findPeers 或 findNode 操作的状态
+ * 管理一次 findPeers 操作的状态；候选节点和查询调度由 LookupShortlist 负责
  */
 struct LookupState {
+    LookupState(const InfoHash& hash, const DhtClientConfig& config)
+        : target(hash)
+        , target_id(NodeId::fromInfoHash(hash))
+        , shortlist(target_id, config.k, config.alpha, config.max_lookup_outstanding)
+        , max_queries(config.max_lookup_queries)
+    {}
+    
     std::string id;                           // 查找 ID
     InfoHash target;                          // 查找目标
     NodeId target_id;                         // 目标转换为 NodeId
     
-    std::set<NodeId> queried;                 // 已查询的节点
-    std::set<NodeId> pending;                 // 正在查询中的节点
-    std::map<NodeId, DhtNode> candidates;     // 候选节点（按 NodeId 存储）
+    LookupShortlist shortlist;                // 候选节点（有界、按距离排序）
+    std::unique_ptr<asio::steady_timer> slow_timer;  // 最早的慢节点判定时间
     
     std::vector<PeerInfo> found_peers;        // 找到的 Peers
     std::string token;                        // 用于 announce 的 token
@@ -120,70 +142,11 @@ struct LookupState {
     PeerCallback on_peer;                     // Peer 回调
     LookupCompleteCallback on_complete;       // 完成回调
     
-    size_t alpha;                             // 并发数
-    size_t max_rounds;                        // 最大轮次
-    size_t current_round{0};                  // 当前轮次
+    size_t max_queries;                       // 最多发出的查询数
     bool completed{false};                    // 是否完成
     
     std::chrono::steady_clock::time_point start_time;  // 开始时间
     
-    /**
-     * @brief 检查是否应该继续查找
-     */
-    bool shouldContinue() const {
-        if (completed) return false;
-        if (current_round >= max_rounds) return false;
-        
-        // 如果还有待查询的候选节点，继续
-        for (const auto& [node_id, node] : candidates) {
-            if (queried.find(node_id) == queried.end() && 
-                pending.find(node_id) == pending.end()) {
-                return true;
-            }
-        }
-        return false;
-    }
-    
-    /**
-     * @brief 获取下一批要查询的节点（按距离排序）
-     */
-    std::vector<DhtNode> getNextNodes(size_t count) {
-        // 收集所有未查询的候选节点
-        std::vector<DhtNode> unqueried;
-        for (const auto& [node_id, node] : candidates) {
-            if (queried.find(node_id) == queried.end() && 
-                pending.find(node_id) == pending.end()) {
-                unqueried.push_back(node);
-            }
-        }
-        
-        // 按到目标的距离排序（最近的在前）
-        std::sort(unqueried.begin(), unqueried.end(), 
-            [this](const DhtNode& a, const DhtNode& b) {
-                return target_id.compareDistance(a.id_, b.id_) < 0;
-            });
-        
-        // 返回最近的 count 个
-        std::vector<DhtNode> result;
-        for (size_t i = 0; i < std::min(count, unqueried.size()); ++i) {
-            result.push_back(unqueried[i]);
-        }
-        
-        return result;
-    }
-    
-    /**
-     * @brief 添加新发现的节点
-     */
-    void addNodes(const std::vector<DhtNode>& nodes) {
-        for (const auto& node : nodes) {
-            // 不添加自己或已查询的节点
-            if (queried.find(node.id_) == queried.end()) {
-                candidates[node.id_] = node;
-            }
-        }
-    }
-    
     /**
      * @brief 记录找到的 Peer
      */
@@ -301,10 +264,17 @@ public:
      * @brief 加入 DHT 网络
      * @param callback 完成回调
      * 
-     * 向 Bootstrap 节点发送 find_node 查询，填充路由表
+     * 有保存的状态时先并发 ping 保存的节点，足够多的节点响应即完成；
+     * 否则（或热启动失败时）向 Bootstrap 节点发送 find_node 查询，填充路由表
      */
     void bootstrap(BootstrapCallback callback = nullptr);
     
+    /**
+     * @brief 立即保存 DHT 状态（未配置 state_file 或文件被其他实例锁定时无操作）
+     * @return 是否成功写入
+     */
+    bool saveState() const;
+    
     /**
      * @brief 查找拥有指定文件的 Peer
      * @param info_hash 文件的 InfoHash
@@ -312,10 +282,10 @@ public:
      * @param on_complete 查找完成时调用
      * 
      * 使用迭代查找算法查找 Peer：
-     * 1. 从路由表获取最近的 K 个节点
-     * 2. 并发向 α 个节点发送 get_peers
-     * 3. 收到响应后，继续向更近的节点查询
-     * 4. 直到收敛或达到最大轮次
+     * 1. 从路由表获取离目标最近的节点作为候选
+     * 2. 始终保持 α 个 get_peers 在途，一个响应到达立即向下一个最近的候选补发
+     * 3. 响应中更近的节点加入候选，慢节点提前由下一个候选顶替
+     * 4. 直到最近的 K 个候选都已响应或达到查询上限
      */
     void findPeers(const InfoHash& info_hash,
                    PeerCallback on_peer,
@@ -341,9 +311,9 @@ public:
     const NodeId& localId() const { return my_id_; }
     
     /**
-     * @brief 获取路由表节点数
+     * @brief 获取路由表节点数（IPv4 与 IPv6 两张路由表之和）
      */
-    size_t nodeCount() const { return routing_table_.nodeCount(); }
+    size_t nodeCount() const { return routing_table_.nodeCount() + routing_table6_.nodeCount(); }
     
     /**
      * @brief 检查是否已 Bootstrap
@@ -355,6 +325,11 @@ public:
      */
     DhtClientStatistics getStatistics() const;
     
+    /**
+     * @brief 获取查询统计信息（延迟/超时直方图、RTT 估计）
+     */
+    QueryManagerStatistics getQueryStatistics() const;
+    
     /**
      * @brief 重置统计信息
      */
@@ -371,9 +346,9 @@ private:
     // ========================================================================
     
     /**
-     * @brief 处理收到的 UDP 消息
+     * @brief 处理收到的 UDP 数据报（直接解析接收区，只有查询才格式化来源地址）
      */
-    void onReceive(const network::UdpMessage& message);
+    void onReceive(const network::UdpDatagram& datagram);
     
     /**
      * @brief 处理查询消息
@@ -411,10 +386,21 @@ private:
                      LookupCompleteCallback on_complete);
     
     /**
-     * @brief 继续查找
+     * @brief 继续查找：补发查询到并发上限，收敛时完成查找
      */
     void continueLookup(const std::string& lookup_id);
     
+    /**
+     * @brief 在最早的慢节点判定时间唤醒查找
+     * @note 调用前必须持有 lookups_mutex_
+     */
+    void scheduleSlowCheck(const std::string& lookup_id, LookupState& state);
+    
+    /**
+     * @brief 查询多久未响应视为慢节点（节点 RTT 估计的倍数，有上下限）
+     */
+    std::chrono::milliseconds slowThreshold(const DhtNode& node) const;
+    
     /**
      * @brief 完成查找
      */
@@ -427,10 +413,34 @@ private:
                               const DhtNode& responder,
                               const DhtMessage& response);
     
+    // ========================================================================
+    // 加入网络
+    // ========================================================================
+    
+    /**
+     * @brief 并发 ping 保存的节点，响应足够多时完成，否则回退到引导节点
+     */
+    void warmStart(std::vector<DhtNode> nodes, BootstrapCallback callback);
+    
+    /**
+     * @brief 向引导节点发送 find_node（查找自己）
+     */
+    void bootstrapFromRouters(BootstrapCallback callback);
+    
+    /**
+     * @brief 记录加入网络（统计耗时并回调）
+     */
+    void finishBootstrap(bool success, bool warm, BootstrapCallback callback);
+    
     // ========================================================================
     // 维护任务
     // ========================================================================
     
+    /**
+     * @brief 调度定期保存状态
+     */
+    void scheduleStateSave();
+    
     /**
      * @brief 调度路由表刷新
      */
@@ -455,6 +465,40 @@ private:
      */
     bool verifyToken(const network::UdpEndpoint& node, const std::string& token);
     
+    // ========================================================================
+    // 路由表（BEP 32：IPv4 与 IPv6 各一张）
+    // ========================================================================
+    
+    /**
+     * @brief 节点地址所属的路由表
+     */
+    RoutingTable& routingTableFor(const std::string& ip);
+    
+    /**
+     * @brief 按地址族把节点加入对应的路由表
+     */
+    void addNode(const DhtNode& node);
+    
+    /**
+     * @brief 从选定地址族的路由表中各取 count 个离 target 最近的节点
+     */
+    std::vector<DhtNode> findClosest(const NodeId& target, size_t count,
+                                     bool ipv4 = true, bool ipv6 = true) const;
+    
+    /**
+     * @brief 把离 target 最近的节点写入 find_node/get_peers 响应
+     * 
+     * 有 "want" 时按 want 选择地址族，否则按查询到达的地址族；
+     * 节点先取到栈上，再直接拷贝紧凑格式，不分配 DhtNode
+     */
+    void appendClosestNodes(DhtMessage& response, const DhtMessage& query,
+                            const network::UdpEndpoint& sender, const NodeId& target) const;
+    
+    /**
+     * @brief 为 find_node/get_peers 查询设置 "want"（双栈时两种都要）
+     */
+    void applyWant(DhtMessage& query) const;
+    
     // ========================================================================
     // 工具方法
     // ========================================================================
@@ -473,13 +517,20 @@ private:
     asio::io_context& io_context_;
     DhtClientConfig config_;
     
+    // 状态文件锁：没拿到时（另一个实例在用）不读写状态文件
+    DhtStateLock state_lock_;
+    
+    // 启动时读取的状态（热启动后清空；必须在 my_id_ 之前初始化）
+    std::optional<DhtState> saved_state_;
+    
     // 本地 ID
     NodeId my_id_;
     
     // 子模块
     std::shared_ptr<network::UdpClient> udp_client_;
     std::shared_ptr<QueryManager> query_manager_;
-    RoutingTable routing_table_;
+    RoutingTable routing_table_;                  // IPv4 节点
+    RoutingTable routing_table6_;                 // IPv6 节点（BEP 32）
     
     // 活动的查找
     std::map<std::string, LookupState> active_lookups_;
@@ -496,6 +547,8 @@ private:
     
     // 定时器
     asio::steady_timer refresh_timer_;
+    asio::steady_timer state_timer_;
+    std::chrono::steady_clock::time_point bootstrap_start_;
     
     // 状态
     std::atomic<bool> running_{false};
@@ -43,6 +43,10 @@ namespace krpc {
     constexpr const char* kPort = "port";            // 端口
     constexpr const char* kImpliedPort = "implied_port";  // 隐含端口
     constexpr const char* kNodes = "nodes";          // 紧凑节点列表
+    constexpr const char* kNodes6 = "nodes6";        // IPv6 紧凑节点列表（BEP 32）
+    constexpr const char* kWant = "want";            // 希望返回的节点地址族（BEP 32）
+    constexpr const char* kWantN4 = "n4";
+    constexpr const char* kWantN6 = "n6";
     constexpr const char* kValues = "values";        // Peer 列表
 } // namespace krpc
 
@@ -184,6 +188,8 @@ public:
     
     /**
      * @brief 创建 find_node 响应
+     * 
+     * 节点按地址族分别编码到 "nodes" 和 "nodes6"
      */
     static DhtMessage createFindNodeResponse(const std::string& transaction_id,
                                               const NodeId& my_id,
@@ -212,6 +218,14 @@ public:
                                    DhtErrorCode code,
                                    const std::string& message);
     
+    /**
+     * @brief 向响应追加一个紧凑节点（ID + 紧凑地址）
+     * 
+     * 按地址长度写入 "nodes"（6 字节）或 "nodes6"（18 字节），其他长度忽略；
+     * 回复查询时直接从路由表记录拷贝，不经过 DhtNode
+     */
+    void appendCompactNode(const NodeId& id, const uint8_t* address, size_t address_size);
+    
     // ========================================================================
     // 解析方法
     // ========================================================================
@@ -230,6 +244,14 @@ public:
      */
     static std::optional<DhtMessage> parse(const std::vector<uint8_t>& data);
     
+    /**
+     * @brief 从字节视图解析消息（批量接收时直接解析接收区中的数据）
+     * @param data 原始字节数据起始地址
+     * @param size 数据长度
+     * @return 解析后的消息，失败返回 nullopt
+     */
+    static std::optional<DhtMessage> parse(const uint8_t* data, size_t size);
+    
     // ========================================================================
     // 编码方法
     // ========================================================================
@@ -283,19 +305,36 @@ public:
     /** @brief 是否使用 implied port */
     bool impliedPort() const { return implied_port_; }
     
+    /**
+     * @brief 设置 find_node/get_peers 查询的 "want"（BEP 32）
+     * 
+     * 双栈节点请求两种地址族的节点；都为 false 时不发送 want，
+     * 对方按查询到达的地址族返回
+     */
+    void setWant(bool ipv4, bool ipv6);
+    
+    /** @brief 查询是否带有 "want" */
+    bool hasWant() const { return want_n4_ || want_n6_; }
+    
+    /** @brief 查询方是否需要 IPv4 节点（"want" 含 n4） */
+    bool wantsIpv4() const { return want_n4_; }
+    
+    /** @brief 查询方是否需要 IPv6 节点（"want" 含 n6） */
+    bool wantsIpv6() const { return want_n6_; }
+    
     // ========================================================================
     // 响应数据提取
     // ========================================================================
     
     /**
      * @brief 获取响应中的节点列表
-     * @return 节点列表（从 "nodes" 紧凑格式解析）
+     * @return 节点列表（从 "nodes" 和 "nodes6" 紧凑格式解析）
      */
     std::vector<DhtNode> getNodes() const;
     
     /**
      * @brief 获取响应中的 Peer 列表
-     * @return Peer 列表（从 "values" 紧凑格式解析）
+     * @return Peer 列表（从 "values" 紧凑格式解析，6 字节为 IPv4，18 字节为 IPv6）
      */
     std::vector<PeerInfo> getPeers() const;
     
@@ -307,7 +346,7 @@ public:
     /**
      * @brief 是否包含节点列表
      */
-    bool hasNodes() const { return !nodes_data_.empty(); }
+    bool hasNodes() const { return !nodes_data_.empty() || !nodes6_data_.empty(); }
     
     /**
      * @brief 获取错误信息
@@ -339,16 +378,19 @@ private:
     std::string token_;             // "a.token" 或 "r.token"
     uint16_t port_ = 0;             // "a.port" - announce_peer 的端口
     bool implied_port_ = false;     // "a.implied_port"
+    bool want_n4_ = false;          // "a.want" 含 "n4"
+    bool want_n6_ = false;          // "a.want" 含 "n6"
     
     // 响应数据（原始格式，延迟解析）
-    std::string nodes_data_;        // "r.nodes" - 紧凑节点数据
+    std::string nodes_data_;        // "r.nodes" - 紧凑节点数据（IPv4）
+    std::string nodes6_data_;       // "r.nodes6" - 紧凑节点数据（IPv6）
     std::vector<std::string> peers_data_;  // "r.values" - 紧凑 Peer 数据列表
     
     // 错误信息
     DhtError error_;
     
     // 辅助方法
-    static std::string nodesToCompact(const std::vector<DhtNode>& nodes);
+    void setNodes(const std::vector<DhtNode>& nodes);
     static std::vector<std::string> peersToCompact(const std::vector<PeerInfo>& peers);
 };
 
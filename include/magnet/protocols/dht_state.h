@@ -0,0 +1,95 @@
+#pragma once
+
+#include "dch_types.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace magnet::protocols {
+
+// ============================================================================
+// DhtState - 可持久化的 DHT 状态
+// ============================================================================
+
+/**
+ * @struct DhtState
+ * @brief DhtClient 重启后需要恢复的状态
+ *
+ * 保存节点 ID、路由表中的好节点和 Token 密钥。下次启动时沿用同一个
+ * 节点 ID（其他节点路由表里的我们仍然有效），并直接 ping 保存的节点
+ * 热启动，不必每次都从引导节点重新加入网络。
+ *
+ * 文件格式为 Bencode 字典：
+ * - "id":           20 字节节点 ID
+ * - "nodes":        IPv4 节点，紧凑格式（每个 26 字节）
+ * - "nodes6":       IPv6 节点，紧凑格式（每个 38 字节，BEP 32）
+ * - "secret":       当前 Token 密钥
+ * - "prev-secret":  上一个 Token 密钥
+ */
+struct DhtState {
+    NodeId node_id;
+    std::vector<DhtNode> nodes;             // IPv4 与 IPv6 节点
+    std::string token_secret;
+    std::string prev_token_secret;
+
+    /**
+     * @brief 编码为 Bencode 字符串（地址无效的节点被跳过）
+     */
+    std::string encode() const;
+
+    /**
+     * @brief 从 Bencode 字符串解析，格式不符（缺少或错误的 id）时返回 nullopt
+     */
+    static std::optional<DhtState> decode(std::string_view data);
+
+    /**
+     * @brief 写入文件（先写同目录下的唯一临时文件再重命名，中途崩溃不会留下半个文件）
+     * @return 是否成功
+     *
+     * 文件含令牌密钥，只允许所有者读写（0600），写入内容前就收紧权限。
+     * 临时文件名由 mkstemp 生成，多个进程同时保存也不会互相截断对方的临时文件
+     */
+    bool save(const std::string& path) const;
+
+    /**
+     * @brief 从文件读取，文件不存在或损坏时返回 nullopt
+     */
+    static std::optional<DhtState> load(const std::string& path);
+};
+
+// ============================================================================
+// DhtStateLock - 状态文件的独占咨询锁
+// ============================================================================
+
+/**
+ * @class DhtStateLock
+ * @brief 锁住 path + ".lock"，同一时间只有一个实例使用某个状态文件
+ *
+ * 默认状态文件按用户共享（$XDG_STATE_HOME/magnetdownload/dht_state）。
+ * 拿不到锁的实例应改用新的随机节点 ID 且不读写状态文件，否则两个实例
+ * 会以同一个节点 ID 出现在网络上，并互相覆盖对方保存的路由表。
+ * 锁随析构或进程退出释放；锁文件本身保留（删除它会和加锁竞争）。
+ */
+class DhtStateLock {
+public:
+    /**
+     * @brief 尝试加锁（不阻塞），路径为空时不加锁
+     */
+    explicit DhtStateLock(const std::string& state_path);
+    ~DhtStateLock();
+
+    DhtStateLock(const DhtStateLock&) = delete;
+    DhtStateLock& operator=(const DhtStateLock&) = delete;
+
+    /**
+     * @brief 是否持有锁
+     */
+    bool owned() const { return fd_ >= 0; }
+
+private:
+    int fd_{-1};
+};
+
+} // namespace magnet::protocols
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "dch_types.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace magnet::protocols {
+
+// ============================================================================
+// LookupShortlist - 迭代查找的候选列表
+// ============================================================================
+
+/**
+ * @class LookupShortlist
+ * @brief 迭代查找的有界候选列表（Kademlia shortlist）
+ *
+ * 候选节点按到目标的 XOR 距离有序存放在一个 vector 中，最多 capacity 个
+ * （默认 3k）；比最远的候选还远的节点直接丢弃，所以每次响应的处理代价只与
+ * 新节点数有关，与已发现的节点总数无关。
+ *
+ * 并发控制：
+ * - 始终保持 alpha 个查询在途，一个查询完成立即补发下一个，不等整轮
+ * - 查询超过自己的慢节点阈值（由调用方按该节点的 RTT 估计给出）仍未响应时
+ *   标记为慢节点，不再占用 alpha 名额，提前向下一个候选补发；
+ *   在途查询（含慢节点）总数不超过 max_outstanding
+ *
+ * 终止条件：距离最近的 k 个候选（跳过失败和慢节点）都已响应，
+ * 或者已没有可以查询也没有在途的候选
+ *
+ * 线程安全：无，由调用方加锁
+ */
+class LookupShortlist {
+public:
+    enum class Status : uint8_t {
+        Fresh,       // 未查询
+        InFlight,    // 查询中
+        Slow,        // 查询中，已超过慢节点阈值
+        Responded,   // 已响应
+        Failed       // 查询失败
+    };
+
+    struct Entry {
+        DhtNode node;
+        NodeId distance;                                  // node.id_ XOR target
+        Status status{Status::Fresh};
+        std::chrono::steady_clock::time_point deadline;   // 查询中：判为慢节点的时间
+    };
+
+    /**
+     * @brief 节点的慢节点阈值（从发出查询算起）
+     */
+    using SlowThreshold = std::function<std::chrono::milliseconds(const DhtNode& node)>;
+
+    /**
+     * @param target 查找目标
+     * @param k 需要响应的最近节点数
+     * @param alpha 并发查询数
+     * @param max_outstanding 在途查询上限（含慢节点，至少为 alpha）
+     * @param capacity 候选上限（0 = 3k）
+     */
+    LookupShortlist(const NodeId& target, size_t k, size_t alpha,
+                    size_t max_outstanding, size_t capacity = 0);
+
+    /**
+     * @brief 加入候选节点
+     * @return true 如果节点被加入（重复的、太远的节点返回 false）
+     *
+     * 列表已满时挤掉最远的候选；被挤掉的在途查询不再计入并发数，其响应会被忽略
+     */
+    bool add(const DhtNode& node);
+
+    /**
+     * @brief 取出下一个要查询的节点并标记为查询中
+     * @return 最近 k 个有效候选中的下一个未查询节点；并发已满或没有时返回 nullopt
+     */
+    std::optional<DhtNode> next(std::chrono::steady_clock::time_point now,
+                                const SlowThreshold& threshold);
+
+    /**
+     * @brief 标记节点已响应
+     * @return 是否是列表中在途的节点
+     */
+    bool markResponded(const NodeId& id);
+
+    /**
+     * @brief 标记节点查询失败
+     */
+    bool markFailed(const NodeId& id);
+
+    /**
+     * @brief 把超过阈值的在途查询标记为慢节点
+     * @return 新标记的慢节点数
+     */
+    size_t markSlow(std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief 最早的慢节点判定时间（没有查询中的节点时返回 nullopt）
+     */
+    std::optional<std::chrono::steady_clock::time_point> nextDeadline() const;
+
+    /**
+     * @brief 查找是否已经收敛
+     */
+    bool finished() const;
+
+    const NodeId& target() const { return target_; }
+    const std::vector<Entry>& entries() const { return entries_; }
+
+    size_t inFlight() const { return in_flight_; }
+    size_t slow() const { return slow_; }
+    size_t queried() const { return queried_; }
+    size_t responded() const { return responded_; }
+
+private:
+    /**
+     * @brief 按距离二分查找（XOR 距离与节点一一对应，可以用来判重）
+     */
+    std::vector<Entry>::iterator find(const NodeId& id);
+
+    /**
+     * @brief 离开查询中/慢节点状态时更新计数
+     */
+    void release(const Entry& entry);
+
+    NodeId target_;
+    size_t k_;
+    size_t alpha_;
+    size_t max_outstanding_;
+    size_t capacity_;
+
+    std::vector<Entry> entries_;    // 按 distance 升序
+
+    size_t in_flight_{0};           // 查询中（不含慢节点）
+    size_t slow_{0};                // 慢节点
+    size_t queried_{0};             // 已发出的查询数
+    size_t responded_{0};           // 已响应数
+};
+
+} // namespace magnet::protocols
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "magnet_types.h"
+#include "../network/tcp_listener.h"
+#include "../network/receive_buffer.h"
+
+#include <asio.hpp>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <chrono>
+
+namespace magnet::protocols {
+
+class PeerManager;
+
+// ============================================================================
+// 配置参数
+// ============================================================================
+
+/**
+ * @struct PeerAcceptorConfig
+ * @brief 入站连接接受器配置
+ */
+struct PeerAcceptorConfig {
+    size_t max_handshaking{64};                     // 同时等待握手的入站连接上限
+    std::chrono::seconds handshake_timeout{10};     // 对方发出握手的最长等待时间
+};
+
+// ============================================================================
+// 统计信息
+// ============================================================================
+
+struct PeerAcceptorStatistics {
+    size_t accepted{0};             // 接受的 TCP 连接数
+    size_t routed{0};               // 已交给 PeerManager 的连接数
+    size_t rejected_busy{0};        // 等待握手的连接过多而直接关闭的连接数
+    size_t rejected_unknown{0};     // info_hash 不属于任何已注册种子的连接数
+    size_t rejected_limit{0};       // PeerManager 拒绝（连接数上限、重复连接）的连接数
+    size_t handshake_failures{0};   // 握手无效、超时或中途断开的连接数
+};
+
+// ============================================================================
+// PeerAcceptor 类
+// ============================================================================
+
+/**
+ * @class PeerAcceptor
+ * @brief 入站 Peer 连接的接受和路由
+ *
+ * 在监听端口上接受连接后先读取对方的握手：握手中的 info_hash 决定连接属于
+ * 哪个种子，再交给对应 PeerManager 的 acceptPeer()，由它检查连接数上限并
+ * 创建入站模式的 PeerConnection。握手之后已经读到的数据一并转交，不会丢失。
+ *
+ * 等待握手的连接数和等待时间都有上限，避免半开连接占满文件描述符。
+ *
+ * 一个进程只需一个接受器：多个下载任务通过 DownloadConfig::global_peer_acceptor
+ * 共享同一个监听端口，各自注册自己的 info_hash。
+ *
+ * 使用示例：
+ * @code
+ * auto acceptor = std::make_shared<PeerAcceptor>(io_context);
+ * acceptor->listen(6881);
+ * acceptor->registerTorrent(info_hash, peer_manager);
+ * @endcode
+ */
+class PeerAcceptor : public std::enable_shared_from_this<PeerAcceptor> {
+public:
+    /**
+     * @brief 构造函数
+     * @param io_context 事件循环
+     * @param config 配置参数
+     */
+    explicit PeerAcceptor(asio::io_context& io_context, PeerAcceptorConfig config = {});
+
+    /**
+     * @brief 析构函数
+     */
+    ~PeerAcceptor();
+
+    // 禁止拷贝
+    PeerAcceptor(const PeerAcceptor&) = delete;
+    PeerAcceptor& operator=(const PeerAcceptor&) = delete;
+
+    /**
+     * @brief 开始监听
+     * @param port TCP 端口（0 = 系统随机分配）
+     * @return 绑定失败时返回 false
+     */
+    bool listen(uint16_t port);
+
+    /**
+     * @brief 停止监听并关闭所有仍在等待握手的连接
+     */
+    void stop();
+
+    /**
+     * @brief 实际监听的端口
+     */
+    uint16_t localPort() const;
+
+    /**
+     * @brief 注册种子：info_hash 匹配的入站连接交给 manager
+     *
+     * 只保存弱引用，PeerManager 销毁后自动失效
+     */
+    void registerTorrent(const InfoHash& info_hash, std::weak_ptr<PeerManager> manager);
+
+    /**
+     * @brief 注销种子
+     */
+    void unregisterTorrent(const InfoHash& info_hash);
+
+    /**
+     * @brief 获取统计信息
+     */
+    PeerAcceptorStatistics getStatistics() const;
+
+private:
+    /**
+     * @brief 等待握手的入站连接
+     */
+    struct PendingHandshake {
+        std::shared_ptr<network::TcpClient> client;
+        network::ReceiveBuffer buffer{network::TcpClient::kMinReadSpace};
+        asio::steady_timer timer;
+
+        explicit PendingHandshake(asio::io_context& io_context) : timer(io_context) {}
+    };
+
+    /** @brief 新连接：开始读取握手 */
+    void onAccepted(std::shared_ptr<network::TcpClient> client);
+
+    /** @brief 收到数据：握手完整后转交 */
+    void onHandshakeData(network::TcpClient* key, const asio::error_code& ec);
+
+    /** @brief 按 info_hash 路由到 PeerManager */
+    void route(std::shared_ptr<PendingHandshake> pending);
+
+    /** @brief 放弃等待握手的连接 */
+    void drop(network::TcpClient* key);
+
+private:
+    asio::io_context& io_context_;
+    PeerAcceptorConfig config_;
+    std::shared_ptr<network::TcpListener> listener_;
+
+    mutable std::mutex mutex_;
+    std::map<InfoHash, std::weak_ptr<PeerManager>> torrents_;
+    std::map<network::TcpClient*, std::shared_ptr<PendingHandshake>> pending_;
+    PeerAcceptorStatistics statistics_;
+};
+
+} // namespace magnet::protocols
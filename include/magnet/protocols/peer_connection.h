@@ -3,6 +3,7 @@
 #include "bt_message.h"
 #include "magnet_types.h"
 #include "../network/tcp_client.h"
+#include "../network/receive_buffer.h"
 
 #include <asio.hpp>
 #include <functional>
@@ -151,8 +152,19 @@ using PeerStateCallback = std::function<void(PeerConnectionState state)>;
 /** @brief 收到消息回调 */
 using PeerMessageCallback = std::function<void(const BtMessage& message)>;
 
-/** @brief 收到数据块回调 */
-using PeerPieceCallback = std::function<void(const PieceBlock& block)>;
+/**
+ * @brief 收到数据块回调
+ * 
+ * block.data 指向接收缓冲区，只在回调期间有效；需要保留时自行拷贝
+ */
+using PeerPieceCallback = std::function<void(const PieceBlockView& block)>;
+
+/**
+ * @brief 收到数据请求回调
+ * 
+ * 请求已进入该连接的上传队列，上层通过 popIncomingRequest() 取出并发送
+ */
+using PeerRequestCallback = std::function<void(const BlockInfo& block)>;
 
 /** @brief 错误回调 */
 using PeerErrorCallback = std::function<void(const std::string& error)>;
@@ -188,8 +200,8 @@ using MetadataMessageCallback = std::function<void(const MetadataMessage& messag
  * @code
  * auto peer = std::make_shared<PeerConnection>(io_context, info_hash, "-MT0001-xxxx");
  * 
- * peer->setPieceCallback([](const PieceBlock& block) {
- *     // 处理收到的数据块
+ * peer->setPieceCallback([](const PieceBlockView& block) {
+ *     // 处理收到的数据块（block.data 只在回调期间有效）
  * });
  * 
  * peer->connect({"192.168.1.100", 6881}, [peer](bool success) {
@@ -201,6 +213,12 @@ using MetadataMessageCallback = std::function<void(const MetadataMessage& messag
  */
 class PeerConnection : public std::enable_shared_from_this<PeerConnection> {
 public:
+    /** @brief 上传队列中最多保留的请求数，超出的请求直接丢弃 */
+    static constexpr size_t kMaxIncomingRequests = 256;
+    
+    /** @brief 接受的最大请求长度（主流客户端都按 16KB 请求） */
+    static constexpr uint32_t kMaxRequestLength = 128 * 1024;
+    
     // ========================================================================
     // 构造和析构
     // ========================================================================
@@ -236,6 +254,20 @@ public:
     void connect(const network::TcpEndpoint& endpoint, 
                  PeerConnectCallback callback = nullptr);
     
+    /**
+     * @brief 接管入站连接（对方先发握手）
+     * @param client 已连接的 TcpClient（由 TcpListener 接受）
+     * @param received 已从该连接读到的数据（至少包含对方的完整握手）
+     * @param callback 握手完成回调（成功/失败）
+     * 
+     * 与 connect() 相反，入站连接由对方先发握手：received 中的握手照常校验
+     * info_hash，通过后回复我方握手，之后的消息处理与主动连接完全相同。
+     * 调用前 client 上不能有进行中的读取。
+     */
+    void accept(std::shared_ptr<network::TcpClient> client,
+                network::ByteSpan received,
+                PeerConnectCallback callback = nullptr);
+    
     /**
      * @brief 断开连接
      */
@@ -287,6 +319,11 @@ public:
      */
     void sendPiece(const PieceBlock& block);
     
+    /**
+     * @brief 发送池化缓冲中的数据块（消息头单独编码，块数据不拷贝）
+     */
+    void sendPiece(uint32_t piece_index, uint32_t begin, utils::BufferHandle data);
+    
     /**
      * @brief 发送 KeepAlive 消息
      */
@@ -302,6 +339,9 @@ public:
     /** @brief 是否已连接 */
     bool isConnected() const { return state_.load() == PeerConnectionState::Connected; }
     
+    /** @brief 是否为对方发起的入站连接 */
+    bool isIncoming() const { return incoming_; }
+    
     /** @brief 获取 Peer 状态 */
     PeerState peerState() const;
     
@@ -320,6 +360,30 @@ public:
     /** @brief 获取统计信息 */
     PeerStatistics getStatistics() const;
     
+    /**
+     * @brief 设置下载/上传限速器（nullptr = 不限速）
+     * 
+     * 应在 connect()/accept() 之前调用，连接建立时交给底层 TcpClient
+     */
+    void setRateLimiters(std::shared_ptr<network::RateLimiter> download,
+                         std::shared_ptr<network::RateLimiter> upload);
+    
+    // ========================================================================
+    // 上传队列
+    // ========================================================================
+    
+    /**
+     * @brief 取出最早的待上传请求
+     * @return false 如果队列为空
+     */
+    bool popIncomingRequest(BlockInfo& block);
+    
+    /** @brief 待上传的请求数 */
+    size_t incomingRequestCount() const;
+    
+    /** @brief 发送队列中尚未写出的字节数（上传调度据此避免给慢速 Peer 堆积数据） */
+    size_t pendingSendBytes() const;
+    
     // ========================================================================
     // 回调设置
     // ========================================================================
@@ -336,6 +400,9 @@ public:
     /** @brief 设置错误回调 */
     void setErrorCallback(PeerErrorCallback callback);
     
+    /** @brief 设置数据请求回调 */
+    void setRequestCallback(PeerRequestCallback callback);
+    
     /** @brief 设置扩展握手回调 */
     void setExtensionHandshakeCallback(ExtensionHandshakeCallback callback);
     
@@ -357,6 +424,14 @@ public:
      */
     bool supportsExtension() const { return supports_extension_; }
     
+    /**
+     * @brief 喂入原始字节（握手 + 消息流）并解析
+     * 
+     * 用于回放录制的数据流（基准、测试）。连接建立后 TcpClient 直接读入
+     * 内部接收缓冲区，不经过此处；已连接时不要调用，以免与进行中的读取冲突。
+     */
+    void feed(const uint8_t* data, size_t size);
+    
     /**
      * @brief 获取对方的 ut_metadata 扩展 ID
      */
@@ -376,8 +451,11 @@ private:
     /** @brief TCP 连接完成处理 */
     void onConnected(const asio::error_code& ec);
     
-    /** @brief 收到数据处理 */
-    void onReceive(const asio::error_code& ec, const std::vector<uint8_t>& data);
+    /** @brief 收到数据处理（TcpClient 已直接写入 receive_buffer_） */
+    void onReceive(const asio::error_code& ec, size_t bytes);
+    
+    /** @brief 解析接收缓冲区中的握手和消息 */
+    void processReceiveBuffer();
     
     /** @brief TCP 断线处理 */
     void onDisconnect(const asio::error_code& ec);
@@ -421,12 +499,18 @@ private:
     std::vector<bool> peer_bitfield_;
     mutable std::mutex bitfield_mutex_;
     
-    // 接收缓冲区
-    std::vector<uint8_t> receive_buffer_;
+    // 接收缓冲区（读写游标，消息在缓冲区内原地解析）
+    network::ReceiveBuffer receive_buffer_{network::TcpClient::kReceiveBufferSize};
     bool handshake_received_{false};
+    bool incoming_{false};              // 入站连接：对方先发握手，我方收到后再回复
     
     // 待处理请求
-    std::deque<BlockInfo> pending_requests_;
+    std::vector<BlockInfo> pending_requests_;   // 流水线深度有限，vector 复用容量
+    std::deque<BlockInfo> incoming_requests_;   // 对方的请求（上传队列，先进先出）
+    
+    // 限速
+    std::shared_ptr<network::RateLimiter> download_limiter_;
+    std::shared_ptr<network::RateLimiter> upload_limiter_;
     mutable std::mutex requests_mutex_;
     
     // 统计
@@ -438,6 +522,7 @@ private:
     PeerStateCallback state_callback_;
     PeerMessageCallback message_callback_;
     PeerPieceCallback piece_callback_;
+    PeerRequestCallback request_callback_;
     PeerErrorCallback error_callback_;
     ExtensionHandshakeCallback extension_handshake_callback_;
     MetadataMessageCallback metadata_message_callback_;
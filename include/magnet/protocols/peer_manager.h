@@ -40,6 +40,14 @@ struct PeerManagerConfig {
     std::chrono::seconds peer_evaluation_interval{5};   // Peer 评估间隔（更频繁）
     std::chrono::seconds optimistic_unchoke_interval{20}; // 乐观解阻塞间隔
     size_t unchoke_slots{8};            // 解阻塞槽位数（增加）
+    
+    size_t max_upload_backlog{256 * 1024};  // 发送队列积压超过该字节数的 Peer 暂不取新的上传请求
+    
+    // 限速：每个连接各有一个 Peer 级限速器，挂在这里的种子级限速器之下（为空则不限速）
+    std::shared_ptr<network::RateLimiter> download_limiter;
+    std::shared_ptr<network::RateLimiter> upload_limiter;
+    size_t max_peer_download_speed{0};  // 单个 Peer 的下载速度上限 (bytes/s, 0=无限制)
+    size_t max_peer_upload_speed{0};    // 单个 Peer 的上传速度上限 (bytes/s, 0=无限制)
 };
 
 // ============================================================================
@@ -58,6 +66,7 @@ struct PeerEntry {
     bool is_connecting{false};
     bool is_connected{false};
     bool is_seed{false};        // 是否是做种者（拥有所有分片）
+    bool is_incoming{false};    // 对方主动连入（端口是对方的临时端口，断开后不重连）
     
     // 评分（用于选择策略）
     int score{0};
@@ -93,6 +102,9 @@ struct PeerManagerStatistics {
     size_t total_bytes_uploaded{0};     // 总上传字节数
     size_t total_pieces_received{0};    // 总接收分片数
     
+    size_t incoming_accepted{0};        // 接受的入站连接数
+    size_t incoming_rejected{0};        // 因连接数上限或重复而拒绝的入站连接数
+    
     void reset() {
         total_peers_known = 0;
         peers_connecting = 0;
@@ -101,6 +113,8 @@ struct PeerManagerStatistics {
         total_bytes_downloaded = 0;
         total_bytes_uploaded = 0;
         total_pieces_received = 0;
+        incoming_accepted = 0;
+        incoming_rejected = 0;
     }
 };
 
@@ -108,11 +122,16 @@ struct PeerManagerStatistics {
 // 回调类型
 // ============================================================================
 
-/** @brief 收到数据块回调 */
+/**
+ * @brief 收到数据块回调
+ * 
+ * data 指向 Peer 的接收缓冲区，只在回调期间有效
+ */
 using PieceReceivedCallback = std::function<void(
+    const network::TcpEndpoint& endpoint,
     uint32_t piece_index, 
     uint32_t begin, 
-    const std::vector<uint8_t>& data)>;
+    network::ByteSpan data)>;
 
 /** @brief Peer 连接状态变化回调 */
 using PeerStatusCallback = std::function<void(
@@ -125,6 +144,35 @@ using NeedMorePeersCallback = std::function<void()>;
 /** @brief 新 Peer 连接成功回调 */
 using NewPeerCallback = std::function<void(std::shared_ptr<PeerConnection> peer)>;
 
+/** @brief 收到 Peer 位图回调（Bitfield 消息） */
+using PeerBitfieldCallback = std::function<void(
+    const network::TcpEndpoint& endpoint,
+    const std::vector<bool>& bitfield)>;
+
+/** @brief Peer 拥有新分片回调（Have 消息） */
+using PeerHaveCallback = std::function<void(
+    const network::TcpEndpoint& endpoint,
+    uint32_t piece_index)>;
+
+/** @brief Peer choke 状态变化回调（Choke / Unchoke 消息） */
+using PeerChokeCallback = std::function<void(
+    const network::TcpEndpoint& endpoint,
+    bool choked)>;
+
+/** @brief Peer 请求数据回调（请求已进入该 Peer 的上传队列） */
+using UploadRequestCallback = std::function<void(
+    const network::TcpEndpoint& endpoint,
+    const BlockInfo& block)>;
+
+/**
+ * @struct UploadRequest
+ * @brief 待上传的数据块请求
+ */
+struct UploadRequest {
+    network::TcpEndpoint endpoint;
+    BlockInfo block;
+};
+
 // ============================================================================
 // PeerManager 类
 // ============================================================================
@@ -143,7 +191,7 @@ using NewPeerCallback = std::function<void(std::shared_ptr<PeerConnection> peer)
  * @code
  * auto pm = std::make_shared<PeerManager>(io_context, info_hash, "-MT0001-xxxx");
  * 
- * pm->setPieceCallback([](uint32_t piece, uint32_t begin, const auto& data) {
+ * pm->setPieceCallback([](const auto& ep, uint32_t piece, uint32_t begin, const auto& data) {
  *     // 保存数据...
  * });
  * 
@@ -225,6 +273,17 @@ public:
      */
     void removePeer(const network::TcpEndpoint& endpoint);
     
+    /**
+     * @brief 接受入站连接
+     * @param client 已连接的 TcpClient（对方的握手已读到 received 中）
+     * @param received 已读到的数据，从对方的握手开始
+     * @return false 表示未运行、已达连接数上限或该 Peer 已在连接中，调用方应关闭连接
+     * 
+     * 入站连接与主动连接共用 max_connections 上限，握手成功后同样经过
+     * onPeerConnected 通知上层。
+     */
+    bool acceptPeer(std::shared_ptr<network::TcpClient> client, network::ByteSpan received);
+    
     // ========================================================================
     // 数据传输
     // ========================================================================
@@ -236,12 +295,27 @@ public:
      */
     bool requestBlock(const BlockInfo& block);
     
+    /**
+     * @brief 向指定 Peer 请求数据块
+     * @param endpoint Peer 地址
+     * @param block 块信息
+     * @return true 如果该 Peer 已连接且未 choke 我们，请求已发送
+     */
+    bool requestBlockFrom(const network::TcpEndpoint& endpoint, const BlockInfo& block);
+    
     /**
      * @brief 取消数据块请求
      * @param block 块信息
      */
     void cancelBlock(const BlockInfo& block);
     
+    /**
+     * @brief 向指定 Peer 取消数据块请求
+     * @param endpoint Peer 地址
+     * @param block 块信息
+     */
+    void cancelBlockFrom(const network::TcpEndpoint& endpoint, const BlockInfo& block);
+    
     /**
      * @brief 广播 Have 消息
      * @param piece_index 分片索引
@@ -254,6 +328,36 @@ public:
      */
     void updateBitfield(const std::vector<bool>& bitfield);
     
+    // ========================================================================
+    // 上传
+    // ========================================================================
+    
+    /**
+     * @brief 从各 Peer 的上传队列中取出请求
+     * @param max_requests 最多取出的请求数
+     * @return 请求列表
+     * 
+     * 各 Peer 轮流取一个，接着上次停下的位置继续，发送队列积压过多的 Peer 本轮跳过
+     */
+    std::vector<UploadRequest> takeUploadRequests(size_t max_requests);
+    
+    /**
+     * @brief 向指定 Peer 发送数据块
+     * @return true 如果该 Peer 仍然连接，数据已进入发送队列
+     */
+    bool sendBlock(const network::TcpEndpoint& endpoint, uint32_t piece_index, uint32_t begin,
+                   utils::BufferHandle data);
+    
+    /**
+     * @brief 进入/退出做种模式
+     * 
+     * 做种时不再对 Peer 表示 Interested，并断开同为做种者的 Peer（双方都不需要对方的数据）
+     */
+    void setSeeding(bool seeding);
+    
+    /** @brief 是否处于做种模式 */
+    bool isSeeding() const { return seeding_.load(); }
+    
     // ========================================================================
     // 查询
     // ========================================================================
@@ -271,6 +375,14 @@ public:
      */
     std::vector<network::TcpEndpoint> getConnectedPeers() const;
     
+    /**
+     * @brief 获取所有已连接 Peer 的位图
+     * @return (Peer 地址, 位图) 列表
+     * 
+     * 用于元数据到达后初始化分片可用度
+     */
+    std::vector<std::pair<network::TcpEndpoint, std::vector<bool>>> getPeerBitfields() const;
+    
     /**
      * @brief 获取已连接 Peer 数量
      */
@@ -296,6 +408,18 @@ public:
     
     /** @brief 设置新 Peer 连接成功回调 */
     void setNewPeerCallback(NewPeerCallback callback);
+    
+    /** @brief 设置 Peer 位图回调 */
+    void setBitfieldCallback(PeerBitfieldCallback callback);
+    
+    /** @brief 设置 Peer Have 回调 */
+    void setHaveCallback(PeerHaveCallback callback);
+    
+    /** @brief 设置 Peer choke 状态变化回调 */
+    void setChokeCallback(PeerChokeCallback callback);
+    
+    /** @brief 设置 Peer 请求数据回调 */
+    void setUploadRequestCallback(UploadRequestCallback callback);
 
 private:
     // ========================================================================
@@ -307,6 +431,17 @@ private:
      */
     void connectToPeer(const network::TcpEndpoint& endpoint);
     
+    /**
+     * @brief 为新建的 PeerConnection 设置状态、消息、数据块回调
+     */
+    void attachCallbacks(const std::shared_ptr<PeerConnection>& conn,
+                         const network::TcpEndpoint& endpoint);
+    
+    /**
+     * @brief 为新建的 PeerConnection 创建 Peer 级限速器（挂在种子级限速器之下）
+     */
+    void applyRateLimits(const std::shared_ptr<PeerConnection>& conn);
+    
     /**
      * @brief Peer 连接成功处理
      */
@@ -320,7 +455,7 @@ private:
     /**
      * @brief 收到数据块处理
      */
-    void onPieceReceived(const network::TcpEndpoint& endpoint, const PieceBlock& block);
+    void onPieceReceived(const network::TcpEndpoint& endpoint, const PieceBlockView& block);
     
     /**
      * @brief 收到消息处理
@@ -364,6 +499,7 @@ private:
     PeerManagerConfig config_;
     
     std::atomic<bool> running_{false};
+    std::atomic<bool> seeding_{false};
     
     // Peer 管理
     mutable std::mutex peers_mutex_;
@@ -371,6 +507,7 @@ private:
     std::set<std::string> pending_peers_;     // 等待连接的 Peer
     std::set<std::string> connecting_peers_;  // 连接中的 Peer
     std::set<std::string> connected_peers_;   // 已连接的 Peer
+    std::string upload_cursor_;               // 上次取上传请求的最后一个 Peer（轮转起点）
     
     // 本地位图
     mutable std::mutex bitfield_mutex_;
@@ -389,11 +526,28 @@ private:
     PeerStatusCallback peer_status_callback_;
     NeedMorePeersCallback need_more_peers_callback_;
     NewPeerCallback new_peer_callback_;
+    PeerBitfieldCallback bitfield_callback_;
+    PeerHaveCallback have_callback_;
+    PeerChokeCallback choke_callback_;
+    UploadRequestCallback upload_request_callback_;
     
     // 辅助方法
     static std::string endpointToKey(const network::TcpEndpoint& ep) {
         return ep.ip + ":" + std::to_string(ep.port);
     }
+    
+    /**
+     * @brief 每块都会调用的查找路径用：复用线程局部字符串，避免每次分配
+     * 
+     * 返回的引用在同一线程下一次调用前有效，只用于立即查找
+     */
+    static const std::string& lookupKey(const network::TcpEndpoint& ep) {
+        thread_local std::string key;
+        key.assign(ep.ip);
+        key.push_back(':');
+        key.append(std::to_string(ep.port));
+        return key;
+    }
 };
 
 } // namespace magnet::protocols
@@ -8,9 +8,14 @@
 #include <asio.hpp>
 #include <functional>
 #include <memory>
-#include <map>
+#include <optional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
 #include <mutex>
 #include <chrono>
+#include <algorithm>
+#include <array>
 #include <atomic>
 
 namespace magnet::protocols {
@@ -60,16 +65,82 @@ using QueryCallback = std::function<void(QueryResult)>;
 // ============================================================================
 
 struct QueryManagerConfig {
-    std::chrono::milliseconds default_timeout{2000};   // 默认超时 2 秒
+    std::chrono::milliseconds default_timeout{2000};   // 默认超时 2 秒（自适应时：没有 RTT 样本时的初始超时）
     int default_max_retries{2};                         // 默认重试 2 次
-    std::chrono::milliseconds check_interval{500};     // 检查间隔 500ms
-    size_t max_pending_queries{1000};                  // 最大待处理数
+    size_t max_pending_queries{1000};                  // 最大待处理数（不超过 65535）
+    size_t max_rtt_entries{4096};                      // 按节点保存的 RTT 估计数上限
+    
+    // 自适应超时（sendQuery 未指定超时时生效，参考 RFC 6298）：
+    // 超时取节点的 RTO = SRTT + 4 × RTTVAR，没有该节点的样本时用全局 RTO，
+    // 限制在 [min_timeout, max_timeout]；每次重试超时翻倍，
+    // 从首次发送算起总时长不超过 max_query_time，剩余时间不够时不再重试
+    bool adaptive_timeout{true};
+    std::chrono::milliseconds min_timeout{250};
+    std::chrono::milliseconds max_timeout{8000};
+    std::chrono::milliseconds max_query_time{15000};
 };
 
 // ============================================================================
 // QueryManager 统计信息
 // ============================================================================
 
+/**
+ * @brief 延迟直方图（毫秒）
+ * 
+ * 第 i 个桶统计 [25 × 2^(i-1), 25 × 2^i) 的样本（第 0 个桶从 0 开始），
+ * 最后一个桶统计 ≥ 6400ms 的样本
+ */
+struct LatencyHistogram {
+    static constexpr size_t kBuckets = 10;
+    static constexpr int64_t kFirstBoundMs = 25;
+    
+    std::array<size_t, kBuckets> counts{};
+    
+    /**
+     * @brief 桶的上界（最后一个桶返回它的下界）
+     */
+    static std::chrono::milliseconds bound(size_t bucket) {
+        return std::chrono::milliseconds(kFirstBoundMs << std::min(bucket, kBuckets - 2));
+    }
+    
+    void record(std::chrono::milliseconds latency) {
+        size_t bucket = 0;
+        while (bucket + 1 < kBuckets && latency >= bound(bucket)) {
+            bucket++;
+        }
+        counts[bucket]++;
+    }
+    
+    size_t total() const {
+        size_t sum = 0;
+        for (size_t count : counts) {
+            sum += count;
+        }
+        return sum;
+    }
+    
+    /**
+     * @brief 百分位数（返回所在桶的上界，p 取 0~1）
+     */
+    std::chrono::milliseconds percentile(double p) const {
+        size_t sum = total();
+        if (sum == 0) {
+            return std::chrono::milliseconds{0};
+        }
+        size_t rank = static_cast<size_t>(p * static_cast<double>(sum - 1));
+        size_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += counts[i];
+            if (seen > rank) {
+                return bound(i);
+            }
+        }
+        return bound(kBuckets - 1);
+    }
+    
+    void reset() { counts.fill(0); }
+};
+
 struct QueryManagerStatistics {
     size_t queries_sent{0};         // 发送的查询数
     size_t queries_succeeded{0};    // 成功的查询数
@@ -80,6 +151,12 @@ struct QueryManagerStatistics {
     
     double total_latency_ms{0};     // 总延迟（用于计算平均值）
     
+    LatencyHistogram latency_histogram;   // 响应延迟（从首次发送算起，含重试）
+    LatencyHistogram timeout_histogram;   // 每次发送（含重试）采用的超时
+    
+    double smoothed_rtt_ms{0};      // 全局 SRTT（0 = 还没有样本）
+    double rtt_variance_ms{0};      // 全局 RTTVAR
+    
     /**
      * @brief 获取平均延迟（毫秒）
      */
@@ -105,6 +182,8 @@ struct QueryManagerStatistics {
         queries_timeout = 0;
         retries_total = 0;
         total_latency_ms = 0;
+        latency_histogram.reset();
+        timeout_histogram.reset();
     }
 };
 
@@ -119,6 +198,11 @@ struct QueryManagerStatistics {
  * 管理 DHT 查询的生命周期，包括：
  * - 请求-响应匹配（通过 transaction_id）
  * - 超时检测和重试
+ * 
+ * 待处理查询放在固定数量的槽位中，事务 ID 由 QueryManager 分配（槽位下标 +
+ * generation），响应按下标直接定位，不查表。每个查询的截止时间放入最小堆，
+ * 定时器总是设在堆顶的截止时间上：超时按各自的 timeout 精确触发，
+ * 不再周期性扫描全部查询。查询只编码一次，重试时原样重发。
  * - 并发查询管理
  * - 统计信息收集
  * 
@@ -166,15 +250,16 @@ public:
     /**
      * @brief 发送查询
      * @param target 目标节点
-     * @param message 要发送的消息
+     * @param message 要发送的消息（事务 ID 由 QueryManager 重新分配）
      * @param callback 结果回调
-     * @param timeout 超时时间（0 表示使用默认值）
+     * @param timeout 超时时间（0 表示使用默认值；开启 adaptive_timeout 时按 RTO 自适应）
      * @param max_retries 最大重试次数（-1 表示使用默认值）
      * 
      * 回调会在以下情况被调用：
      * - 收到响应：callback(Result::ok(response))
      * - 超时：callback(Result::err(QueryError::Timeout))
      * - 发送失败：callback(Result::err(QueryError::SendFailed))
+     * - 槽位已满：callback(Result::err(QueryError::QueueFull))
      */
     void sendQuery(const DhtNode& target,
                    DhtMessage message,
@@ -210,7 +295,7 @@ public:
     /**
      * @brief 启动查询管理器
      * 
-     * 启动超时检查定时器
+     * 之后才接受查询
      */
     void start();
     
@@ -235,6 +320,22 @@ public:
      */
     size_t pendingCount() const;
     
+    /**
+     * @brief 节点的 RTT 估计
+     * 
+     * 按节点地址记录的平滑 RTT（RFC 6298 SRTT，只用未重传查询的样本）；
+     * 没有该节点的样本时返回所有节点的平滑 RTT，还没有任何样本时返回 default_timeout / 4
+     */
+    std::chrono::milliseconds rttEstimate(const DhtNode& node) const;
+    
+    /**
+     * @brief 新查询的超时
+     * 
+     * 开启 adaptive_timeout 时为节点的 RTO（没有该节点的样本时用全局 RTO，
+     * 都没有时用 default_timeout），限制在 [min_timeout, max_timeout]；否则为 default_timeout
+     */
+    std::chrono::milliseconds queryTimeout(const DhtNode& node) const;
+    
     /**
      * @brief 获取统计信息
      */
@@ -251,34 +352,34 @@ private:
     // ========================================================================
     
     /**
-     * @brief 待处理查询
+     * @brief 待处理查询（槽位，按事务 ID 中的下标直接访问）
      */
     struct PendingQuery {
-        std::string transaction_id;
         DhtNode target;
-        DhtMessage message;
+        network::UdpEndpoint endpoint;
+        std::vector<uint8_t> payload;       // 编码好的查询，重试时原样重发
         QueryCallback callback;
         
+        std::chrono::steady_clock::time_point first_sent_time;
         std::chrono::steady_clock::time_point sent_time;
+        std::chrono::steady_clock::time_point deadline;
         int retry_count{0};
-        int max_retries;
-        std::chrono::milliseconds timeout;
+        int max_retries{0};
+        std::chrono::milliseconds timeout{0};
+        bool adaptive{false};               // 超时来自 RTO：重试时退避并受 max_query_time 限制
         
-        /**
-         * @brief 检查是否已超时
-         */
-        bool isExpired() const {
-            auto now = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - sent_time);
-            return elapsed >= timeout;
-        }
+        uint16_t generation{0};             // 槽位每次复用加一，识别过期的事务 ID
+        bool active{false};
+    };
+    
+    /**
+     * @brief 超时堆中的一项（查询完成后留在堆中，弹出时按 generation/deadline 识别并丢弃）
+     */
+    struct Deadline {
+        std::chrono::steady_clock::time_point when;
+        uint32_t tid;
         
-        /**
-         * @brief 检查是否还能重试
-         */
-        bool canRetry() const {
-            return retry_count < max_retries;
-        }
+        bool operator>(const Deadline& other) const { return when > other.when; }
     };
     
     // ========================================================================
@@ -286,39 +387,87 @@ private:
     // ========================================================================
     
     /**
-     * @brief 调度下一次超时检查
+     * @brief 事务 ID 编解码：4 字节 = 槽位下标（高 16 位）+ generation（低 16 位）
      */
-    void scheduleTimeoutCheck();
+    static std::string encodeTransactionId(uint32_t tid);
+    static std::optional<uint32_t> decodeTransactionId(const std::string& tid);
     
     /**
-     * @brief 检查超时的查询
+     * @brief 按事务 ID 查找进行中的查询，不存在返回 nullptr
+     * @note 调用前必须持有锁
      */
-    void checkTimeouts();
+    PendingQuery* findLocked(uint32_t tid);
+    
+    /**
+     * @brief 释放槽位（清空回调和负载）
+     * @note 调用前必须持有锁
+     */
+    void releaseLocked(uint32_t tid);
+    
+    /**
+     * @brief 把定时器设到堆顶的截止时间（已是该时间则不动）
+     * @note 调用前必须持有锁
+     */
+    void armTimerLocked();
+    
+    /**
+     * @brief 处理到期的查询：重试或以 Timeout 失败
+     */
+    void processExpired();
     
     /**
      * @brief 执行发送
      */
-    void doSend(PendingQuery& query);
+    void doSend(const PendingQuery& query);
+    
+    /**
+     * @brief 平滑 RTT 估计（RFC 6298）
+     */
+    struct RttEstimate {
+        double srtt{0};     // 0 = 无样本
+        double rttvar{0};
+        
+        void update(double sample);
+        std::chrono::milliseconds rto() const;
+    };
+    
+    /**
+     * @brief 记录一个 RTT 样本
+     * @note 调用前必须持有锁
+     */
+    void updateRttLocked(const DhtNode& target, std::chrono::milliseconds sample);
     
     /**
-     * @brief 完成查询（成功或失败）
-     * @param tid 事务 ID
-     * @param result 结果
+     * @brief 新查询的超时
      * @note 调用前必须持有锁
      */
-    void completeQueryLocked(const std::string& tid, QueryResult result);
+    std::chrono::milliseconds queryTimeoutLocked(const DhtNode& target) const;
+    
+    /**
+     * @brief 到期的查询下一次重试的超时，不再重试时返回 nullopt
+     */
+    std::optional<std::chrono::milliseconds> retryTimeout(
+        const PendingQuery& query, std::chrono::steady_clock::time_point now) const;
 
 private:
     asio::io_context& io_context_;
     std::shared_ptr<network::UdpClient> udp_client_;
     QueryManagerConfig config_;
     
-    // 待处理查询
-    std::map<std::string, PendingQuery> pending_queries_;
+    // 待处理查询（受 mutex_ 保护）
+    std::vector<PendingQuery> slots_;               // max_pending_queries 个槽位
+    std::vector<uint16_t> free_slots_;
+    size_t pending_count_{0};
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> deadlines_;
     mutable std::mutex mutex_;
     
-    // 超时检查定时器
+    // RTT 估计（毫秒，受 mutex_ 保护）
+    std::unordered_map<std::string, RttEstimate> node_rtt_;   // "ip:port" -> 估计
+    RttEstimate rtt_;                                         // 所有节点
+    
+    // 超时定时器（设在最早的截止时间）
     asio::steady_timer timeout_timer_;
+    std::chrono::steady_clock::time_point timer_expiry_{std::chrono::steady_clock::time_point::max()};
     std::atomic<bool> running_{false};
     
     // 统计信息
@@ -327,4 +476,3 @@ private:
 };
 
 } // namespace magnet::protocols
-
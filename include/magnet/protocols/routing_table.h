@@ -2,6 +2,7 @@
 #include <cstddef>
 #include "dch_types.h"
 
+#include <array>
 #include <chrono>
 #include <mutex>
 
@@ -15,6 +16,44 @@ namespace magnet::protocols {
         static constexpr size_t s_kBucketSize = 8;
         static constexpr size_t s_kBucketCount = 160;
 
+        /*
+        * @brief 路由表中的节点记录（定长 POD，不持有堆内存）
+        * 地址按紧凑格式保存（IPv4 6 字节 / IPv6 18 字节，含端口，网络字节序），
+        * 回复 find_node/get_peers 时可以直接拷贝，需要字符串时调用 toDhtNode()
+        */
+        struct NodeRecord
+        {
+            NodeId id;
+            std::array<uint8_t, s_kCompactAddress6Size> address{};
+            uint8_t address_size = 0;       // s_kCompactAddressSize 或 s_kCompactAddress6Size
+            uint8_t failed_queries = 0;
+            std::chrono::steady_clock::time_point last_seen;
+
+            bool isGood() const {
+                auto elapsed = std::chrono::duration_cast<std::chrono::minutes>(
+                    std::chrono::steady_clock::now() - last_seen);
+                return elapsed.count() < 15 && failed_queries == 0;
+            }
+
+            bool isQuestionable() const {
+                auto elapsed = std::chrono::duration_cast<std::chrono::minutes>(
+                    std::chrono::steady_clock::now() - last_seen);
+                return elapsed.count() >= 15 && failed_queries < 3;
+            }
+
+            bool isBad() const {
+                return failed_queries >= 3;
+            }
+
+            uint16_t port() const {
+                size_t offset = address_size - 2u;
+                return static_cast<uint16_t>((address[offset] << 8) | address[offset + 1]);
+            }
+
+            // 转换为带字符串地址的 DhtNode（保留状态）
+            DhtNode toDhtNode() const;
+        };
+
         explicit RoutingTable(const NodeId& local_id);
 
         /*
@@ -25,6 +64,7 @@ namespace magnet::protocols {
         * 已存在的节点会更新信息并移动到桶的末尾（LRU）
         * 桶未满的时候直接添加
         * 桶已满的时候，如果有坏节点则替换，否则丢弃新的节点
+        * 地址无法解析为 IPv4/IPv6 的节点不添加
         */
         bool addNode(const DhtNode& node);
 
@@ -33,11 +73,29 @@ namespace magnet::protocols {
         * @param target 目标id
         * @param count 返回最大节点数 default 8
         * @return  按距离排序的节点列表 小在前
-        * 
+        *
         */
 
         std::vector<DhtNode> findCloset(const NodeId& target, size_t count = s_kBucketSize) const;
 
+        /*
+        * @brief 查找最近的节点（不分配内存）
+        * @param target 目标id
+        * @param out 输出缓冲区，至少 count 个
+        * @param count 返回最大节点数
+        * @return 写入 out 的节点数，按距离排序 小在前
+        *
+        * 从目标所在的桶向外逐组收集候选（目标桶 → 所有更低的桶 → 更高的桶逐个），
+        * 凑够 count 个后停止，再用 nth_element + 部分排序取前 count 个；
+        * 候选只记录指针，存放在栈上
+        */
+        size_t findClosest(const NodeId& target, NodeRecord* out, size_t count) const;
+
+        /*
+        * @brief 导出所有好节点（用于保存 DHT 状态），按桶从远到近
+        */
+        std::vector<DhtNode> getGoodNodes() const;
+
         // 标记响应成功的节点
 
         void markNodeResponded(const NodeId& id);
@@ -65,26 +123,36 @@ namespace magnet::protocols {
             size_t bad_nodes = 0;
             size_t non_empty_buckets = 0;
         };
-        
-        
+
+
         Statistics getStatistics() const;
 
     private:
-        
+
+        // 桶内节点连续存放，nodes[0, size) 有效，按最近活跃排序（LRU，最新在末尾）
         struct Bucket
         {
             /* data */
-            std::vector<DhtNode> nodes;
+            std::array<NodeRecord, s_kBucketSize> nodes;
+            size_t size = 0;
             std::chrono::steady_clock::time_point last_changed;
             Bucket() : last_changed(std::chrono::steady_clock::now()) {}
+
+            NodeRecord* begin() { return nodes.data(); }
+            NodeRecord* end() { return nodes.data() + size; }
+            const NodeRecord* begin() const { return nodes.data(); }
+            const NodeRecord* end() const { return nodes.data() + size; }
         };
-        
+
         size_t getBucketIndex(const NodeId& node_id) const;
 
+        // 在桶中查找节点，不存在返回 nullptr（调用时已持有 mutex_）
+        NodeRecord* findNode(const NodeId& id);
+
         NodeId local_id_;
         std::array<Bucket, s_kBucketCount> buckets_;
-        
+
         mutable std::mutex mutex_;
 
     };
-};
\ No newline at end of file
+};
@@ -112,7 +112,11 @@ private:
                              uint64_t left);
     
     TrackerResponse parseHttpResponse(const std::vector<uint8_t>& data);
-    TrackerResponse parseCompactPeers(const std::string& peers_data);
+    /**
+     * @brief 解析紧凑 Peer 列表（"peers" 每 6 字节，BEP 7 的 "peers6" 每 18 字节）
+     */
+    static std::vector<network::TcpEndpoint> parseCompactPeers(const std::string& peers_data,
+                                                               bool ipv6 = false);
     
     static std::string urlEncode(const std::string& str);
 
@@ -0,0 +1,268 @@
+#pragma once
+
+#include "../async/event_loop_manager.h"
+#include "../utils/buffer_pool.h"
+#include "file_manager.h"
+
+#include <asio.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace magnet::storage {
+
+// ============================================================================
+// 配置与统计
+// ============================================================================
+
+/**
+ * @enum DiskIoBackend
+ * @brief 磁盘 I/O 后端
+ */
+enum class DiskIoBackend {
+    Auto,           // io_uring 可用时使用，否则线程池
+    IoUring,        // Linux io_uring（不可用时退回线程池）
+    ThreadPool      // 工作线程上同步 pread/pwrite
+};
+
+/** @brief 后端名称，用于日志 */
+const char* diskIoBackendName(DiskIoBackend backend);
+
+/**
+ * @struct DiskIoConfig
+ * @brief DiskIoEngine 配置参数
+ */
+struct DiskIoConfig {
+    DiskIoBackend backend{DiskIoBackend::Auto};
+    unsigned queue_depth{256};              // io_uring 提交队列深度
+    size_t thread_count{2};                 // 线程池后端的工作线程数
+    size_t registered_buffers{0};           // 预分配的固定缓冲数量（0 = 不使用）
+    size_t registered_buffer_size{16384};   // 每个固定缓冲的大小
+};
+
+/**
+ * @struct DiskIoStatistics
+ * @brief DiskIoEngine 运行统计
+ */
+struct DiskIoStatistics {
+    uint64_t submitted{0};          // 已提交请求数
+    uint64_t completed{0};          // 已完成请求数（含失败）
+    uint64_t failed{0};             // 失败请求数
+    uint64_t bytes_written{0};
+    uint64_t bytes_read{0};
+    uint64_t batches{0};            // io_uring_enter 提交次数
+    uint64_t max_batch{0};          // 单次提交的最大 SQE 数
+    size_t in_flight{0};            // 尚未完成的请求数
+};
+
+// ============================================================================
+// DiskBuffer
+// ============================================================================
+
+/**
+ * @class DiskBuffer
+ * @brief 从 DiskIoEngine 借出的固定缓冲
+ *
+ * io_uring 后端下这些缓冲通过 IORING_REGISTER_BUFFERS 预先注册，
+ * 写入时使用 IORING_OP_WRITE_FIXED，内核不必每次映射用户页。
+ * 析构时归还缓冲池；只能移动
+ */
+class DiskBuffer {
+public:
+    DiskBuffer() = default;
+    ~DiskBuffer();
+
+    DiskBuffer(DiskBuffer&& other) noexcept;
+    DiskBuffer& operator=(DiskBuffer&& other) noexcept;
+    DiskBuffer(const DiskBuffer&) = delete;
+    DiskBuffer& operator=(const DiskBuffer&) = delete;
+
+    bool valid() const { return pool_ != nullptr; }
+    uint8_t* data() const;
+    size_t size() const;
+
+private:
+    friend class DiskIoEngine;
+    struct Pool;
+
+    DiskBuffer(std::shared_ptr<Pool> pool, size_t index);
+    void release();
+
+    std::shared_ptr<Pool> pool_;
+    size_t index_{0};
+};
+
+// ============================================================================
+// DiskWriteSink
+// ============================================================================
+
+/**
+ * @class DiskWriteSink
+ * @brief 写入完成的长期接收者
+ *
+ * 每块一个 WriteCallback 要为闭包分配内存；块写入热路径改为提交接收者的
+ * weak_ptr 和一个整数标签，完成时在 io_context 线程上调用 onDiskWrite。
+ * 接收者已销毁时通知被丢弃
+ */
+class DiskWriteSink {
+public:
+    virtual ~DiskWriteSink() = default;
+
+    /** @brief 写入完成，tag 为提交时传入的标签 */
+    virtual void onDiskWrite(uint64_t tag, bool success) = 0;
+};
+
+// ============================================================================
+// DiskIoEngine 类
+// ============================================================================
+
+/**
+ * @class DiskIoEngine
+ * @brief FileManager 之上的异步磁盘读写引擎
+ *
+ * - io_uring 后端：单个提交线程收集排队的请求，按文件拆成 SQE 后批量提交，
+ *   等待完成期间到达的请求会并入下一批；短读/短写自动续传
+ * - 线程池后端：请求投递到 async::EventLoopManager 工作线程，同步调用 FileManager
+ * - 两种后端的完成回调都通过 asio::post 投递回构造时传入的 io_context，
+ *   网络线程不会被磁盘延迟阻塞
+ *
+ * io_uring 通过原始系统调用使用，不依赖 liburing；内核不支持或被禁用时自动退回线程池。
+ *
+ * 线程安全：所有公开方法均可跨线程调用。FileManager 必须比引擎活得更久
+ *
+ * 使用示例：
+ * @code
+ * DiskIoEngine engine(io_context, file_manager);
+ * engine.asyncWrite(offset, std::move(block), [](bool ok) {
+ *     // 在 io_context 线程上执行
+ * });
+ * @endcode
+ */
+class DiskIoEngine {
+public:
+    /** @brief 写入完成回调，在 io_context 线程上执行 */
+    using WriteCallback = std::function<void(bool success)>;
+
+    /** @brief 读取完成回调，在 io_context 线程上执行 */
+    using ReadCallback = std::function<void(bool success, std::vector<uint8_t> data)>;
+
+    /** @brief 读入池化缓冲的完成回调，失败时句柄为空 */
+    using BufferReadCallback = std::function<void(bool success, utils::BufferHandle data)>;
+
+    /**
+     * @brief 构造函数，立即启动后端线程
+     */
+    DiskIoEngine(asio::io_context& io_context, FileManager& files, DiskIoConfig config = {});
+
+    /**
+     * @brief 析构函数，等待已提交的请求全部完成
+     */
+    ~DiskIoEngine();
+
+    DiskIoEngine(const DiskIoEngine&) = delete;
+    DiskIoEngine& operator=(const DiskIoEngine&) = delete;
+
+    /**
+     * @brief 停止引擎
+     *
+     * 已提交的请求会执行完毕并投递回调；之后提交的请求直接以失败回调
+     */
+    void stop();
+
+    /** @brief 实际使用的后端（Auto 已解析） */
+    DiskIoBackend backend() const { return backend_; }
+
+    /** @brief 固定缓冲是否已注册到内核 */
+    bool buffersRegistered() const { return buffers_registered_; }
+
+    /**
+     * @brief 异步写入，数据所有权移交引擎
+     */
+    void asyncWrite(size_t offset, std::vector<uint8_t> data, WriteCallback callback);
+
+    /**
+     * @brief 从固定缓冲异步写入前 length 字节，完成后缓冲自动归还
+     */
+    void asyncWrite(size_t offset, DiskBuffer buffer, size_t length, WriteCallback callback);
+
+    /**
+     * @brief 从池化缓冲异步写入，完成后释放引用
+     */
+    void asyncWrite(size_t offset, utils::BufferHandle buffer, WriteCallback callback);
+
+    /**
+     * @brief 从固定缓冲异步写入，完成后通知 sink（提交和完成都不分配内存）
+     */
+    void asyncWrite(size_t offset, DiskBuffer buffer, size_t length,
+                    std::weak_ptr<DiskWriteSink> sink, uint64_t tag);
+
+    /**
+     * @brief 从池化缓冲异步写入，完成后通知 sink（提交和完成都不分配内存）
+     */
+    void asyncWrite(size_t offset, utils::BufferHandle buffer,
+                    std::weak_ptr<DiskWriteSink> sink, uint64_t tag);
+
+    /**
+     * @brief 异步读取 length 字节
+     */
+    void asyncRead(size_t offset, size_t length, ReadCallback callback);
+
+    /**
+     * @brief 异步读满池化缓冲，完成后缓冲连同数据交给回调
+     */
+    void asyncRead(size_t offset, utils::BufferHandle buffer, BufferReadCallback callback);
+
+    /**
+     * @brief 借出一个固定缓冲
+     * @return 无空闲缓冲（或未配置）时返回无效的 DiskBuffer
+     */
+    DiskBuffer acquireBuffer();
+
+    /** @brief 尚未完成的请求数 */
+    size_t inFlight() const;
+
+    /** @brief 运行统计快照 */
+    DiskIoStatistics statistics() const;
+
+private:
+    struct Request;
+    struct RequestPool;
+    struct Ring;
+
+    void submit(std::shared_ptr<Request> request);
+    void runBlocking(const std::shared_ptr<Request>& request);
+    void runRing();
+    void complete(std::shared_ptr<Request> request, bool success);
+
+private:
+    asio::io_context& io_context_;
+    FileManager& files_;
+    DiskIoConfig config_;
+    DiskIoBackend backend_{DiskIoBackend::ThreadPool};
+
+    std::shared_ptr<DiskBuffer::Pool> buffer_pool_;
+    bool buffers_registered_{false};
+
+    // 完成的请求回收复用，稳态下每块不分配 Request；完成回调持有引用，可晚于引擎析构
+    std::shared_ptr<RequestPool> request_pool_;
+
+    // io_uring 后端
+    std::unique_ptr<Ring> ring_;
+    std::thread ring_thread_;
+    std::vector<std::shared_ptr<Request>> queue_;
+    std::condition_variable queue_cv_;
+
+    // 线程池后端
+    std::unique_ptr<async::EventLoopManager> workers_;
+
+    mutable std::mutex mutex_;          // 保护 queue_、stopping_ 与统计
+    bool stopping_{false};
+    DiskIoStatistics stats_;
+};
+
+} // namespace magnet::storage
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace magnet::storage {
+
+// ============================================================================
+// FileDescriptor
+// ============================================================================
+
+/**
+ * @class FileDescriptor
+ * @brief 持有一个 POSIX 文件描述符，析构时关闭
+ */
+class FileDescriptor {
+public:
+    explicit FileDescriptor(int fd) : fd_(fd) {}
+    ~FileDescriptor();
+
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+    int get() const { return fd_; }
+
+private:
+    int fd_{-1};
+};
+
+// ============================================================================
+// FileHandleCache 类
+// ============================================================================
+
+/**
+ * @class FileHandleCache
+ * @brief 按路径缓存打开的文件描述符，数量受 LRU 限制
+ *
+ * - acquire() 返回 shared_ptr，调用方在 pread/pwrite 期间持有；
+ *   被 LRU 淘汰的描述符要等最后一个使用者释放后才真正关闭，不会在 I/O 中途失效
+ * - 只有查找/插入时持有内部锁，I/O 本身不加锁
+ *
+ * 线程安全：所有公开方法均可跨线程调用
+ *
+ * 使用示例：
+ * @code
+ * FileHandleCache cache(64);
+ * auto fd = cache.acquire("/downloads/a.bin");
+ * if (fd) {
+ *     ::pwrite(fd->get(), data, size, offset);
+ * }
+ * @endcode
+ */
+class FileHandleCache {
+public:
+    using Handle = std::shared_ptr<FileDescriptor>;
+
+    /**
+     * @param max_open 同时打开的描述符上限（至少 1）
+     */
+    explicit FileHandleCache(size_t max_open);
+
+    FileHandleCache(const FileHandleCache&) = delete;
+    FileHandleCache& operator=(const FileHandleCache&) = delete;
+
+    /**
+     * @brief 获取文件的读写描述符，不存在时创建
+     * @return 打开失败返回 nullptr
+     */
+    Handle acquire(const std::string& path);
+
+    /** @brief 从缓存中移除所有描述符（正在使用的在释放后关闭） */
+    void clear();
+
+    /** @brief 缓存中的描述符数量 */
+    size_t size() const;
+
+    /** @brief 上限 */
+    size_t capacity() const { return max_open_; }
+
+    /** @brief 缓存中所有描述符的快照（用于 fsync 等批量操作） */
+    std::vector<Handle> snapshot() const;
+
+private:
+    struct Entry {
+        Handle handle;
+        std::list<std::string>::iterator lru_position;
+    };
+
+    size_t max_open_;
+    mutable std::mutex mutex_;
+    std::list<std::string> lru_;                      // 最近使用的在前
+    std::unordered_map<std::string, Entry> entries_;
+};
+
+} // namespace magnet::storage
@@ -7,8 +7,12 @@
 #include <mutex>
 #include <cstdint>
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <memory>
 
+#include "file_handle_cache.h"
+
 namespace magnet::storage {
 
 // ============================================================================
@@ -29,6 +33,36 @@ struct FileEntry {
         : path(p), size(s), offset(o) {}
 };
 
+// ============================================================================
+// 预分配
+// ============================================================================
+
+/**
+ * @enum PreallocateMode
+ * @brief 文件空间预分配方式
+ */
+enum class PreallocateMode {
+    None,       // 只创建文件，大小随写入增长
+    Sparse,     // 设置逻辑大小，不分配磁盘块（稀疏文件）
+    Full,       // fallocate/posix_fallocate 立即分配全部磁盘块，空间不足时初始化失败
+    Lazy        // 启动时按稀疏文件创建，某个文件首次写入时再为其分配磁盘块
+};
+
+/** @brief 预分配方式名称，用于日志 */
+const char* preallocateModeName(PreallocateMode mode);
+
+/**
+ * @struct FileAllocationStats
+ * @brief 单个文件的创建/预分配耗时，用于衡量启动开销
+ */
+struct FileAllocationStats {
+    std::string path;
+    size_t size{0};
+    PreallocateMode mode{PreallocateMode::None};
+    bool success{false};
+    std::chrono::microseconds elapsed{0};
+};
+
 // ============================================================================
 // 存储配置
 // ============================================================================
@@ -44,8 +78,16 @@ struct StorageConfig {
     std::vector<FileEntry> files;       // 文件列表
     std::vector<std::array<uint8_t, 20>> piece_hashes; // 分片哈希
     
-    bool preallocate{true};             // 是否预分配空间
+    PreallocateMode preallocate_mode{PreallocateMode::Sparse}; // 预分配方式
+    size_t preallocate_threads{0};      // 并行创建/预分配文件的线程数（0 = 按 CPU 核心数，不超过文件数）
+    bool truncate_oversized{false};     // 已有文件比预期大时是否截断（否则初始化失败，避免误删数据）
     size_t write_buffer_size{1024*1024};// 写缓冲大小 (1MB)
+    size_t max_open_files{64};          // 同时打开的文件描述符上限（LRU 淘汰）
+    
+    // 内存映射模式：每个文件 MAP_SHARED 映射，读写变为 memcpy，校验/上传可零拷贝访问
+    bool memory_map{false};             // 是否启用内存映射（映射的文件总是完整分配）
+    size_t mmap_max_file_size{0};       // 超过此大小的文件不映射，走 pread/pwrite（0 = 不限；32 位平台另有上限）
+    size_t mmap_sync_interval{64*1024*1024}; // 累计写入多少字节后发起一次异步 msync
     
     /**
      * @brief 获取分片数量
@@ -79,6 +121,33 @@ struct StorageConfig {
     }
 };
 
+// ============================================================================
+// 分散/聚集 I/O 缓冲
+// ============================================================================
+
+/** @brief 写入用的缓冲片段 */
+struct ConstIoBuffer {
+    const uint8_t* data{nullptr};
+    size_t size{0};
+};
+
+/** @brief 读取用的缓冲片段 */
+struct IoBuffer {
+    uint8_t* data{nullptr};
+    size_t size{0};
+};
+
+/**
+ * @struct FileSlice
+ * @brief 一段连续数据落在单个文件内的部分，供异步 I/O 引擎直接提交
+ */
+struct FileSlice {
+    FileHandleCache::Handle handle;     // I/O 完成前持有，描述符不会被关闭
+    size_t file_offset{0};              // 文件内偏移
+    size_t buffer_offset{0};            // 在调用方缓冲中的偏移
+    size_t length{0};
+};
+
 // ============================================================================
 // FileManager 类
 // ============================================================================
@@ -93,6 +162,18 @@ struct StorageConfig {
  * - 预分配磁盘空间
  * - 管理多个文件
  * 
+ * POSIX 平台上使用 pread/pwrite/preadv/pwritev 按位置读写，不移动文件指针，
+ * 不同范围的读写可以并发进行，不需要全局锁；打开的描述符数量由 LRU 限制。
+ * 偏移到文件的映射按 FileEntry::offset 二分查找。
+ * 其他平台退回 std::fstream + 全局锁。
+ * 
+ * 启用 StorageConfig::memory_map 时，初始化后每个文件以 MAP_SHARED 映射
+ * （MADV_RANDOM，分片按稀有度乱序到达），读写直接 memcpy，写入累计到一定量后
+ * 异步 msync；view() 返回映射内的只读视图，校验和上传不再复制数据。
+ * 映射前按完整大小分配磁盘空间（不论 preallocate_mode），否则写入稀疏空洞时
+ * 空间不足只会表现为 SIGBUS。分配或映射失败（空间不足、32 位地址空间不足、
+ * 文件超过上限等）的文件自动退回 pread/pwrite。
+ * 
  * 使用示例：
  * @code
  * StorageConfig config;
@@ -148,7 +229,7 @@ public:
     /**
      * @brief 检查是否已初始化
      */
-    bool isInitialized() const { return initialized_; }
+    bool isInitialized() const { return initialized_.load(std::memory_order_acquire); }
     
     // ========================================================================
     // 读写操作
@@ -171,12 +252,60 @@ public:
     bool write(size_t offset, const std::vector<uint8_t>& data);
     
     /**
-     * @brief 刷新所有文件缓冲
+     * @brief 写入数据
+     * @param offset 全局偏移
+     * @param data 数据指针
+     * @param length 数据长度
+     * @return true 如果成功
+     */
+    bool write(size_t offset, const uint8_t* data, size_t length);
+    
+    /**
+     * @brief 读取数据到调用方提供的缓冲区
+     * @return true 如果成功
+     */
+    bool readInto(size_t offset, uint8_t* out, size_t length);
+    
+    /**
+     * @brief 聚集写：多个缓冲片段依次写入从 offset 开始的连续区域（pwritev）
+     * @return true 如果成功
+     */
+    bool writev(size_t offset, const std::vector<ConstIoBuffer>& buffers);
+    
+    /**
+     * @brief 分散读：从 offset 开始的连续区域依次读入多个缓冲片段（preadv）
+     * @return true 如果成功
+     */
+    bool readv(size_t offset, const std::vector<IoBuffer>& buffers);
+    
+    /**
+     * @brief 把 [offset, offset + length) 拆分为各文件内的片段并打开对应描述符
+     * @return false 如果越界、打开失败，或平台不支持按描述符访问
+     */
+    bool mapRange(size_t offset, size_t length, std::vector<FileSlice>& slices);
+    
+    /**
+     * @brief 获取 [offset, offset + length) 在内存映射中的只读视图（零拷贝）
+     * 
+     * 跨文件时返回多段，并对该范围发出 MADV_WILLNEED 预读。
+     * 视图在 close() 之前有效
+     * 
+     * @return false 如果未启用内存映射、越界，或范围内有文件未能映射（此时应改用 read）
+     */
+    bool view(size_t offset, size_t length, std::vector<ConstIoBuffer>& segments) const;
+    
+    /**
+     * @brief 是否有文件处于内存映射状态
+     */
+    bool isMapped() const { return mapped_files_ > 0; }
+    
+    /**
+     * @brief 刷新所有文件缓冲（映射区域 msync，POSIX 后端对打开的描述符执行 fdatasync）
      */
     void flush();
     
     /**
-     * @brief 关闭所有文件
+     * @brief 关闭所有文件并解除映射，不能与读写并发调用
      */
     void close();
     
@@ -208,6 +337,11 @@ public:
      * @brief 获取基础路径
      */
     const std::string& getBasePath() const { return config_.base_path; }
+    
+    /**
+     * @brief 初始化时各文件的创建/预分配耗时（顺序与 getFiles() 一致）
+     */
+    const std::vector<FileAllocationStats>& allocationStats() const { return allocation_stats_; }
 
 private:
     // ========================================================================
@@ -220,24 +354,67 @@ private:
     bool createDirectories();
     
     /**
-     * @brief 创建单个文件
+     * @brief 创建单个文件并按 preallocate_mode 预分配（可在多个线程上并行调用）
+     * 
+     * 已有文件不会被清空：比预期小时扩展，比预期大时按 truncate_oversized 截断或报错
      */
     bool createFile(const FileEntry& file);
     
     /**
-     * @brief 预分配文件空间
+     * @brief 为文件分配全部磁盘块（fallocate，不支持时 posix_fallocate）
+     * @param keep_size 为 true 时不改变文件逻辑大小
      */
-    bool preallocateFile(const std::string& path, size_t size);
+    bool preallocateFile(int fd, size_t size, bool keep_size);
     
     /**
-     * @brief 打开文件
+     * @brief 打开文件（fstream 后端）
      */
     std::fstream* openFile(const std::string& path);
     
     /**
-     * @brief 获取包含指定偏移的文件
+     * @brief 文件在全局地址空间中的区间（不含空文件），按 offset 排序
      */
-    const FileEntry* getFileForOffset(size_t offset) const;
+    struct FileSpan {
+        size_t offset{0};
+        size_t size{0};
+        const FileEntry* file{nullptr};
+        std::string full_path;
+        uint8_t* mapping{nullptr};      // 内存映射模式下的映射地址，nullptr 表示走 pread/pwrite
+    };
+    
+    /**
+     * @brief 映射所有文件（初始化时调用），失败的文件保持未映射
+     */
+    void mapFiles();
+    
+    /**
+     * @brief 解除所有映射
+     */
+    void unmapFiles();
+    
+    /**
+     * @brief 记录写入映射的字节数，达到阈值时异步 msync
+     */
+    void noteMappedWrite(size_t bytes);
+    
+    /**
+     * @brief 获取包含指定偏移的文件区间（二分查找）
+     */
+    const FileSpan* getFileForOffset(size_t offset) const;
+    
+    /**
+     * @brief 按位置读写一段连续的全局区域，跨文件时逐个文件拆分
+     * @param iov 缓冲片段（iovec 布局），总长度即读写长度
+     * @param iov_count 片段数
+     */
+    bool transfer(size_t offset, const IoBuffer* iov, size_t iov_count, bool is_write);
+    
+    /**
+     * @brief 在单个文件内按位置读写，处理部分完成和 EINTR
+     * @param parts 缓冲片段，可能被修改
+     */
+    bool transferFile(const FileSpan& span, size_t file_offset,
+                      std::vector<IoBuffer>& parts, bool is_write);
     
     /**
      * @brief 获取完整文件路径
@@ -246,9 +423,16 @@ private:
 
 private:
     StorageConfig config_;
-    bool initialized_{false};
+    std::atomic<bool> initialized_{false};
+    std::vector<FileSpan> spans_;
+    
+    FileHandleCache handles_;           // POSIX 后端：描述符 LRU
+    size_t mapped_files_{0};            // 已映射的文件数
+    std::vector<FileAllocationStats> allocation_stats_;
+    std::unique_ptr<std::once_flag[]> lazy_reserved_;  // Lazy 模式：每个区间首次写入时分配一次
+    std::atomic<size_t> unsynced_bytes_{0}; // 上次 msync 以来写入映射的字节数
     
-    mutable std::mutex mutex_;
+    mutable std::mutex mutex_;          // fstream 后端：串行化所有 I/O
     std::map<std::string, std::unique_ptr<std::fstream>> open_files_;
 };
 
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "../async/event_loop_manager.h"
+#include "../utils/sha1.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace magnet::storage {
+
+// ============================================================================
+// 配置与结果
+// ============================================================================
+
+/**
+ * @struct HashPoolConfig
+ * @brief HashPool 配置参数
+ */
+struct HashPoolConfig {
+    size_t thread_count{0};         // 工作线程数（0 = CPU 核心数的一半，至少 1）
+    size_t max_pending_jobs{16};    // 排队 + 执行中的作业上限，超过后拒绝提交（背压）
+};
+
+/**
+ * @struct HashResult
+ * @brief 一次哈希作业的结果
+ */
+struct HashResult {
+    bool success{false};            // false 表示作业本身失败（例如读盘失败）
+    utils::SHA1::Digest digest{};   // 计算出的 SHA1
+    size_t bytes{0};                // 本次作业实际计入哈希的字节数
+};
+
+/**
+ * @struct HashPoolStatistics
+ * @brief HashPool 运行统计
+ */
+struct HashPoolStatistics {
+    size_t thread_count{0};         // 工作线程数
+    size_t queued{0};               // 等待执行的作业数
+    size_t running{0};              // 正在执行的作业数
+    size_t peak_pending{0};         // 排队 + 执行中的历史峰值
+    uint64_t completed{0};          // 已完成作业数
+    uint64_t rejected{0};           // 因队列已满被拒绝的提交次数
+    uint64_t bytes_hashed{0};       // 累计哈希字节数
+    std::chrono::microseconds busy_time{0};  // 所有作业执行耗时之和
+
+    /** @brief 工作线程上的平均哈希吞吐（字节/秒） */
+    double throughput() const {
+        return busy_time.count() > 0
+            ? static_cast<double>(bytes_hashed) * 1e6 / static_cast<double>(busy_time.count())
+            : 0;
+    }
+};
+
+// ============================================================================
+// HashPool 类
+// ============================================================================
+
+/**
+ * @class HashPool
+ * @brief 分片校验用的哈希工作线程池
+ *
+ * 基于 async::EventLoopManager，把 SHA1 计算（以及为此需要的读盘）从网络线程移走：
+ * - 作业和完成回调都在工作线程上执行，回调负责把结果投递回调用方的线程；
+ *   调用回调前已释放名额，回调（或它投递的任务）看到的 saturated() 已不含本作业
+ * - 排队 + 执行中的作业数有上限，submit() 在达到上限时返回 false，
+ *   调用方应暂缓提交（并停止开始新分片），待有作业完成后再重试
+ * - 统计队列深度、峰值、吞吐，便于观察哈希是否成为瓶颈
+ *
+ * 线程安全：所有公开方法均可跨线程调用
+ *
+ * 使用示例：
+ * @code
+ * HashPool pool;
+ * bool accepted = pool.submit(
+ *     [data]() { return HashPool::hashBuffer(data.data(), data.size()); },
+ *     [&io](HashResult result) {
+ *         asio::post(io, [result]() { onHashed(result); });
+ *     });
+ * if (!accepted) {
+ *     // 队列已满，稍后重试
+ * }
+ * @endcode
+ */
+class HashPool {
+public:
+    /** @brief 哈希作业，在工作线程上执行 */
+    using HashJob = std::function<HashResult()>;
+
+    /** @brief 完成回调，在工作线程上执行 */
+    using HashCallback = std::function<void(HashResult)>;
+
+    /**
+     * @brief 构造函数，立即启动工作线程
+     */
+    explicit HashPool(HashPoolConfig config = {});
+
+    /**
+     * @brief 析构函数，等待已提交的作业全部完成
+     */
+    ~HashPool();
+
+    HashPool(const HashPool&) = delete;
+    HashPool& operator=(const HashPool&) = delete;
+
+    /**
+     * @brief 停止线程池
+     *
+     * 已提交的作业会执行完毕（包括完成回调），之后的 submit() 一律返回 false
+     */
+    void stop();
+
+    /**
+     * @brief 提交一个哈希作业
+     * @return false 如果队列已满或线程池已停止，作业不会执行
+     */
+    bool submit(HashJob job, HashCallback callback);
+
+    /** @brief 队列是否已满（此时 submit() 会被拒绝） */
+    bool saturated() const;
+
+    /** @brief 排队 + 执行中的作业数 */
+    size_t pendingJobs() const { return pending_.load(std::memory_order_acquire); }
+
+    /** @brief 运行统计快照 */
+    HashPoolStatistics statistics() const;
+
+    /** @brief 对一段连续内存计算 SHA1，便于构造简单作业 */
+    static HashResult hashBuffer(const uint8_t* data, size_t length);
+
+private:
+    void runJob(const HashJob& job, const HashCallback& callback);
+
+private:
+    HashPoolConfig config_;
+    std::unique_ptr<async::EventLoopManager> workers_;
+    std::mutex submit_mutex_;           // 串行化 submit 与 stop，避免向已停止的线程投递
+    bool running_{false};
+
+    std::atomic<size_t> pending_{0};    // 排队 + 执行中
+    std::atomic<size_t> running_jobs_{0};
+
+    mutable std::mutex stats_mutex_;
+    size_t peak_pending_{0};
+    uint64_t completed_{0};
+    uint64_t rejected_{0};
+    uint64_t bytes_hashed_{0};
+    std::chrono::microseconds busy_time_{0};
+};
+
+} // namespace magnet::storage
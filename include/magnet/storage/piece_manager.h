@@ -199,6 +199,8 @@ public:
     
     /**
      * @brief 验证所有分片
+     * 
+     * 等长分片成批读出后用多缓冲 SHA1 一起计算（CPU 支持时每批 8 个）
      * @return 验证通过的分片数
      */
     size_t verifyAll();
@@ -310,6 +312,11 @@ private:
      * @brief 重置分片状态（验证失败时）
      */
     void resetPiece(uint32_t index);
+    
+    /**
+     * @brief 记录分片校验结果
+     */
+    void applyVerifyResult(uint32_t index, bool match);
 
 private:
     FileManager& file_manager_;
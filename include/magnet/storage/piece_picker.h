@@ -0,0 +1,179 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include <random>
+#include <cstdint>
+
+namespace magnet::storage {
+
+// ============================================================================
+// PiecePicker 类
+// ============================================================================
+
+/**
+ * @class PiecePicker
+ * @brief 基于可用度分桶的稀有优先分片选择器
+ *
+ * 增量维护每个分片的可用度（拥有该分片的 Peer 数），
+ * 由 Bitfield / Have / 断开事件驱动更新，选择时不需要遍历 Peer：
+ * - 可选分片按可用度放入不同的桶，桶内位置可 O(1) 交换删除
+ * - 可用度 +1/-1 只是在相邻两个桶之间移动一个元素
+ * - 做种者（拥有全部分片）单独计数，不逐个分片累加
+ * - 同一可用度内随机选择，避免所有客户端都抢同一个分片
+ * - 每个 Peer 记录它拥有的可选分片数，为某个 Peer 选择时没有可选分片直接返回
+ *
+ * 线程安全：不加锁，由调用方（DownloadController）在自己的锁内使用
+ *
+ * 使用示例：
+ * @code
+ * PiecePicker picker(piece_count);
+ * picker.setPeerBitfield("1.2.3.4:6881", bitfield);
+ * picker.peerHas("1.2.3.4:6881", 42);
+ *
+ * int32_t piece = picker.pickPieceFor("1.2.3.4:6881");
+ * if (piece >= 0) {
+ *     picker.markDownloading(piece);
+ * }
+ * @endcode
+ */
+class PiecePicker {
+public:
+    /** @brief 桶选择过滤器，返回 false 表示跳过该分片 */
+    using PieceFilter = std::function<bool(uint32_t piece_index)>;
+
+    /**
+     * @brief 构造函数
+     * @param piece_count 分片数量，初始全部为可选（Missing）
+     */
+    explicit PiecePicker(size_t piece_count);
+
+    // ========================================================================
+    // 可用度更新（Peer 事件）
+    // ========================================================================
+
+    /**
+     * @brief 设置 Peer 的完整位图（Bitfield 消息）
+     *
+     * 如果该 Peer 已经有记录（例如先收到了 Have），先撤销旧记录再计入新位图。
+     * 超出分片数的填充位会被忽略。
+     */
+    void setPeerBitfield(const std::string& peer, const std::vector<bool>& bitfield);
+
+    /**
+     * @brief Peer 拥有了一个新分片（Have 消息）
+     *
+     * 重复的 Have 不会重复计数
+     */
+    void peerHas(const std::string& peer, uint32_t piece_index);
+
+    /**
+     * @brief Peer 断开，撤销其全部贡献
+     */
+    void removePeer(const std::string& peer);
+
+    // ========================================================================
+    // 本地分片状态
+    // ========================================================================
+
+    /** @brief 分片开始下载，不再参与选择 */
+    void markDownloading(uint32_t piece_index);
+
+    /** @brief 分片已验证，不再参与选择 */
+    void markHave(uint32_t piece_index);
+
+    /** @brief 分片重新变为缺失（超时或校验失败），重新参与选择 */
+    void markMissing(uint32_t piece_index);
+
+    // ========================================================================
+    // 选择
+    // ========================================================================
+
+    /**
+     * @brief 选择最稀有的可选分片
+     * @param filter 可选过滤器（例如只选某个 Peer 拥有的分片）
+     * @return 分片索引，-1 表示没有可用度 > 0 的可选分片
+     *
+     * 从可用度最低的非空桶开始，桶内从随机位置开始查找
+     */
+    int32_t pickPiece(const PieceFilter& filter = nullptr);
+
+    /**
+     * @brief 选择指定 Peer 拥有的最稀有可选分片
+     * @return 分片索引，-1 表示该 Peer 没有可选分片
+     *
+     * Peer 的位图只查找一次；它没有任何可选分片时不遍历桶
+     */
+    int32_t pickPieceFor(const std::string& peer);
+
+    // ========================================================================
+    // 查询
+    // ========================================================================
+
+    /** @brief 获取分片可用度（包含做种者） */
+    size_t availability(uint32_t piece_index) const;
+
+    /** @brief 指定 Peer 是否拥有某个分片 */
+    bool peerHasPiece(const std::string& peer, uint32_t piece_index) const;
+
+    /** @brief Peer 的位图（没有记录时返回 nullptr），在下一次 Peer 事件前有效 */
+    const std::vector<bool>* peerPieces(const std::string& peer) const;
+
+    /** @brief Peer 拥有的可选分片数 */
+    size_t wantedCount(const std::string& peer) const;
+
+    /** @brief 当前可选分片数 */
+    size_t pickableCount() const { return pickable_count_; }
+
+    /** @brief 已记录的 Peer 数 */
+    size_t peerCount() const { return peers_.size(); }
+
+    /** @brief 已记录的做种者数 */
+    size_t seedCount() const { return seeds_; }
+
+    /** @brief 分片数量 */
+    size_t pieceCount() const { return pieces_.size(); }
+
+private:
+    static constexpr uint32_t kNotInBucket = UINT32_MAX;
+
+    enum class LocalState : uint8_t {
+        Missing,        // 可选
+        Downloading,    // 正在下载
+        Have            // 已拥有
+    };
+
+    struct PieceEntry {
+        uint32_t availability{0};           // 非做种者的拥有数
+        uint32_t bucket_pos{kNotInBucket};  // 在桶内的位置
+        LocalState state{LocalState::Missing};
+    };
+
+    struct PeerRecord {
+        std::vector<bool> have;
+        size_t wanted{0};               // 拥有的可选（Missing）分片数
+        bool is_seed{false};
+    };
+
+    void incAvailability(uint32_t piece_index);
+    void decAvailability(uint32_t piece_index);
+    void bucketInsert(uint32_t piece_index);
+    void bucketErase(uint32_t piece_index);
+    void addPeerContribution(PeerRecord& record);
+    void removePeerContribution(const PeerRecord& record);
+    void updateWanted(uint32_t piece_index, bool pickable);
+
+private:
+    std::vector<PieceEntry> pieces_;
+    std::vector<std::vector<uint32_t>> buckets_;  // 下标 = 可用度（不含做种者）
+    std::unordered_map<std::string, PeerRecord> peers_;
+
+    size_t seeds_{0};
+    size_t pickable_count_{0};
+
+    std::mt19937 rng_;
+};
+
+} // namespace magnet::storage
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "../utils/buffer_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace magnet::storage {
+
+class DiskIoEngine;
+class FileManager;
+
+// ============================================================================
+// 配置与统计
+// ============================================================================
+
+/**
+ * @struct ReadCacheConfig
+ * @brief ReadCache 配置参数
+ */
+struct ReadCacheConfig {
+    size_t capacity{8 * 1024 * 1024};   // 缓存上限（字节）
+    size_t read_ahead_blocks{4};        // 未命中时连同后续几个块一起读入（不跨分片）
+};
+
+/**
+ * @struct ReadCacheStatistics
+ * @brief ReadCache 运行统计
+ */
+struct ReadCacheStatistics {
+    uint64_t hits{0};               // 命中次数
+    uint64_t misses{0};             // 未命中次数（触发读盘）
+    uint64_t evictions{0};          // 因容量淘汰的块数
+    uint64_t bytes_read{0};         // 从磁盘读取的字节数（含预读）
+    size_t cached_bytes{0};         // 当前缓存的字节数
+};
+
+// ============================================================================
+// ReadCache 类
+// ============================================================================
+
+/**
+ * @class ReadCache
+ * @brief 上传用的块级读缓存（LRU + 分片内预读）
+ *
+ * Peer 通常按顺序请求同一分片的连续块，未命中时顺带读入同一分片中
+ * 后续的几个块，后面的请求直接命中内存。块放在池化缓冲中，
+ * 返回的句柄只增加引用计数，可以直接交给发送队列。
+ *
+ * 只缓存已校验的分片数据（由调用方保证），分片内容不会再变化，无需失效处理。
+ *
+ * 给出 DiskIoEngine 时，asyncRead 的未命中交给磁盘引擎读取，不阻塞网络线程；
+ * 文件已内存映射时直接从映射复制。同一块的并发未命中只读一次盘。
+ *
+ * 线程安全：非线程安全，应在 io_context 线程上使用
+ *
+ * 使用示例：
+ * @code
+ * ReadCache cache(file_manager, piece_length, total_size, {}, &disk_io);
+ * cache.asyncRead(piece_index, begin, 16384, [peer](utils::BufferHandle block) {
+ *     if (block) {
+ *         peer->sendPiece(piece_index, begin, block);
+ *     }
+ * });
+ * @endcode
+ */
+class ReadCache {
+public:
+    /** @brief asyncRead 完成回调；读盘失败或越界时句柄为空 */
+    using ReadCallback = std::function<void(utils::BufferHandle data)>;
+
+    /**
+     * @param file_manager 数据来源（须比缓存活得久）
+     * @param piece_length 分片大小
+     * @param total_size 种子总大小（最后一个分片可能较短）
+     * @param config 配置参数
+     * @param disk_io 异步读盘引擎（可为空，此时 asyncRead 同步读盘；须比缓存活得久）
+     */
+    ReadCache(FileManager& file_manager, size_t piece_length, size_t total_size,
+              ReadCacheConfig config = {}, DiskIoEngine* disk_io = nullptr);
+
+    ReadCache(const ReadCache&) = delete;
+    ReadCache& operator=(const ReadCache&) = delete;
+
+    /**
+     * @brief 读取一个块
+     * @return 块数据；越界或读盘失败时返回空句柄
+     */
+    utils::BufferHandle read(uint32_t piece_index, uint32_t begin, uint32_t length);
+
+    /**
+     * @brief 异步读取一个块
+     *
+     * 命中（或文件已映射）时立即回调；否则经 DiskIoEngine 读盘，
+     * 完成后在 io_context 线程上回调，同时按 read() 的规则预读
+     */
+    void asyncRead(uint32_t piece_index, uint32_t begin, uint32_t length, ReadCallback callback);
+
+    /**
+     * @brief 清空缓存
+     */
+    void clear();
+
+    ReadCacheStatistics statistics() const;
+
+private:
+    using Key = uint64_t;
+
+    struct Entry {
+        Key key;
+        utils::BufferHandle data;
+    };
+
+    struct PendingLoad {
+        uint32_t length{0};
+        std::vector<ReadCallback> callbacks;
+    };
+
+    static Key makeKey(uint32_t piece_index, uint32_t begin) {
+        return (static_cast<Key>(piece_index) << 32) | begin;
+    }
+
+    /** @brief 分片实际长度（最后一个分片可能较短） */
+    size_t pieceSize(uint32_t piece_index) const;
+
+    /** @brief 从磁盘读取一个块到池化缓冲 */
+    utils::BufferHandle load(uint32_t piece_index, uint32_t begin, uint32_t length);
+
+    /**
+     * @brief 提交一个块的异步读盘，同一块已在读取中时只登记回调
+     * @return false 如果该块正以不同长度读取（调用方应改走同步读取）
+     */
+    bool loadAsync(uint32_t piece_index, uint32_t begin, uint32_t length, ReadCallback callback);
+
+    /** @brief 命中时移到 LRU 头部并返回，否则返回空句柄 */
+    utils::BufferHandle lookup(Key key, uint32_t length);
+
+    /** @brief 放入缓存（最新使用），超出容量时淘汰最久未用的块 */
+    void insert(Key key, utils::BufferHandle data);
+
+    FileManager& file_manager_;
+    DiskIoEngine* disk_io_;
+    size_t piece_length_;
+    size_t total_size_;
+    ReadCacheConfig config_;
+
+    std::list<Entry> lru_;      // 头部为最近使用
+    std::unordered_map<Key, std::list<Entry>::iterator> index_;
+    std::unordered_map<Key, PendingLoad> loading_;  // 读盘中的块及等待的回调
+    std::shared_ptr<ReadCache*> self_;  // 读盘回调持有弱引用，缓存析构后不再访问
+    ReadCacheStatistics statistics_;
+};
+
+} // namespace magnet::storage
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace magnet::utils {
+
+class BufferPool;
+
+// ============================================================================
+// 缓冲头
+// ============================================================================
+
+/**
+ * @brief 池化缓冲的头部（紧挨在数据之前，64 字节对齐）
+ */
+struct alignas(64) BufferHeader {
+    std::atomic<uint32_t> refs{1};
+    uint32_t size_class{0};         // 大小级别；kHeapClass 表示超出级别直接从堆分配
+    size_t size{0};                 // 当前有效长度
+    size_t capacity{0};             // 可用容量
+    BufferPool* pool{nullptr};
+};
+
+// ============================================================================
+// BufferHandle 类
+// ============================================================================
+
+/**
+ * @class BufferHandle
+ * @brief 池化缓冲的引用计数句柄
+ *
+ * 拷贝只增加引用计数，不复制数据；最后一个句柄释放时缓冲归还到池中。
+ * 引用计数是原子的，句柄可以跨线程传递（例如交给磁盘线程写盘），
+ * 但同一块数据的并发写入需要调用方自己保证。
+ */
+class BufferHandle {
+public:
+    BufferHandle() = default;
+    ~BufferHandle() { reset(); }
+
+    BufferHandle(const BufferHandle& other) noexcept : header_(other.header_) {
+        if (header_) {
+            header_->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    BufferHandle& operator=(const BufferHandle& other) noexcept {
+        if (this != &other) {
+            BufferHandle copy(other);
+            std::swap(header_, copy.header_);
+        }
+        return *this;
+    }
+
+    BufferHandle(BufferHandle&& other) noexcept : header_(other.header_) {
+        other.header_ = nullptr;
+    }
+
+    BufferHandle& operator=(BufferHandle&& other) noexcept {
+        if (this != &other) {
+            reset();
+            header_ = other.header_;
+            other.header_ = nullptr;
+        }
+        return *this;
+    }
+
+    bool valid() const { return header_ != nullptr; }
+    explicit operator bool() const { return valid(); }
+
+    uint8_t* data() const {
+        return header_ ? reinterpret_cast<uint8_t*>(header_ + 1) : nullptr;
+    }
+
+    size_t size() const { return header_ ? header_->size : 0; }
+    size_t capacity() const { return header_ ? header_->capacity : 0; }
+    bool empty() const { return size() == 0; }
+
+    /** @brief 调整有效长度（不超过容量，不重新分配） */
+    void resize(size_t size) {
+        if (header_) {
+            header_->size = size < header_->capacity ? size : header_->capacity;
+        }
+    }
+
+    /** @brief 当前引用数（调试和测试用） */
+    uint32_t useCount() const {
+        return header_ ? header_->refs.load(std::memory_order_relaxed) : 0;
+    }
+
+    /** @brief 释放引用 */
+    void reset();
+
+private:
+    friend class BufferPool;
+    explicit BufferHandle(BufferHeader* header) : header_(header) {}
+
+    BufferHeader* header_{nullptr};
+};
+
+// ============================================================================
+// 统计信息
+// ============================================================================
+
+struct BufferPoolStatistics {
+    size_t slabs{0};                // 已分配的 slab 数
+    size_t slab_bytes{0};           // slab 占用的总字节数
+    size_t in_use{0};               // 借出中的缓冲数
+    size_t acquired{0};             // 累计借出次数
+    size_t slab_allocations{0};     // 因空闲链表为空而新分配 slab 的次数
+    size_t heap_allocations{0};     // 超出最大级别、直接从堆分配的次数
+};
+
+// ============================================================================
+// BufferPool 类
+// ============================================================================
+
+/**
+ * @class BufferPool
+ * @brief 按大小分级的缓冲池（slab 分配）
+ *
+ * 三个大小级别：小消息（256 字节，REQUEST/HAVE 等）、4KB、
+ * 16KB 块（16KB + 256 字节余量，容纳 PIECE 头部或 ut_metadata 片段的字典头）。
+ * 每个级别按 slab 成批分配，借出和归还只在空闲链表上操作，
+ * 稳态下载中不再触发 malloc/free。超过最大级别的请求直接从堆分配。
+ *
+ * instance() 返回的全局池带有线程局部缓存：每个线程先在自己的缓存中
+ * 借还，缓存空了或满了才批量与全局链表交换，减少锁竞争。
+ * 单独构造的池（测试等）不使用线程缓存。
+ *
+ * 使用示例：
+ * @code
+ * auto block = BufferPool::instance().acquire(16384);
+ * std::memcpy(block.data(), src, 16384);
+ * auto shared = block;    // 只增加引用计数
+ * @endcode
+ */
+class BufferPool {
+public:
+    static constexpr size_t kClassCount = 3;
+    static constexpr std::array<size_t, kClassCount> kClassSizes = {256, 4096, 16384 + 256};
+    static constexpr uint32_t kHeapClass = 0xFFFFFFFF;
+
+    /** @brief 进程级缓冲池（不析构，线程缓存可以安全地在线程退出时归还） */
+    static BufferPool& instance();
+
+    /**
+     * @param slab_bytes 每个 slab 的大致字节数
+     */
+    explicit BufferPool(size_t slab_bytes = 256 * 1024);
+
+    /** @brief 析构时释放所有 slab，所有句柄必须已经释放 */
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /**
+     * @brief 借出至少 size 字节的缓冲，有效长度为 size
+     */
+    BufferHandle acquire(size_t size);
+
+    /**
+     * @brief 借出缓冲并拷入数据
+     */
+    BufferHandle copy(const uint8_t* data, size_t size);
+
+    BufferPoolStatistics statistics() const;
+
+private:
+    friend class BufferHandle;
+    friend struct BufferThreadCache;
+
+    static uint32_t classFor(size_t size);
+    static size_t strideFor(uint32_t size_class);
+
+    BufferHeader* allocate(uint32_t size_class);
+    void release(BufferHeader* header);
+
+    // 全局空闲链表（mutex_ 保护）
+    BufferHeader* popShared(uint32_t size_class);
+    void pushShared(BufferHeader* header);
+    void allocateSlab(uint32_t size_class);
+
+    size_t slab_bytes_;
+    bool thread_cached_{false};
+
+    mutable std::mutex mutex_;
+    std::array<std::vector<BufferHeader*>, kClassCount> free_;
+    std::vector<void*> slabs_;
+    size_t slab_total_bytes_{0};
+    size_t slab_allocations_{0};
+
+    std::atomic<size_t> in_use_{0};
+    std::atomic<size_t> acquired_{0};
+    std::atomic<size_t> heap_allocations_{0};
+};
+
+} // namespace magnet::utils
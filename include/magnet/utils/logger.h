@@ -180,3 +180,10 @@ namespace magnet::utils {
         return oss.str();
     }
 } // namespace magnet::utils
+
+// 调试日志：先检查级别再求值 msg，调试级别关闭时热路径上不拼接字符串
+#define MAGNET_LOG_DEBUG(msg) \
+    do { \
+        if (::magnet::utils::Logger::instance().should_log(::magnet::utils::LogLevel::Debug)) \
+            ::magnet::utils::Logger::instance().debug(msg); \
+    } while (0)
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <cstring>
@@ -7,14 +8,53 @@
 
 namespace magnet::utils {
 
+// ============================================================================
+// 压缩函数后端
+// ============================================================================
+
+/**
+ * @brief SHA1 压缩函数实现
+ *
+ * 启动时按 CPU 特性自动选择最快的可用实现，标量实现始终可用
+ */
+enum class SHA1Backend {
+    Scalar,         // 可移植的标量实现
+    X86ShaNi,       // x86 SHA 扩展（SHA-NI）
+    ArmCrypto       // ARMv8 SHA1 指令
+};
+
+/** @brief 后端名称 */
+const char* sha1BackendName(SHA1Backend backend);
+
+/** @brief 当前 CPU 是否支持该后端 */
+bool sha1BackendSupported(SHA1Backend backend);
+
+/** @brief 当前使用的后端 */
+SHA1Backend sha1Backend();
+
+/**
+ * @brief 切换后端（用于基准测试和测试）
+ * @return false 如果当前 CPU 不支持，保持原后端
+ */
+bool setSHA1Backend(SHA1Backend backend);
+
+/**
+ * @brief 用当前后端压缩若干个完整的 64 字节块
+ * @param state 5 个字的链接状态
+ * @param data 数据指针，长度为 blocks × 64
+ */
+void sha1CompressBlocks(uint32_t state[5], const uint8_t* data, size_t blocks);
+
 /**
- * @brief 简单的 SHA1 实现
+ * @brief SHA1 哈希器
  * 
- * 用于验证 BitTorrent 分片数据的完整性
+ * 用于验证 BitTorrent 分片数据的完整性。
+ * update() 直接从输入压缩整块，只有首尾不足 64 字节的部分经过内部缓冲
  */
 class SHA1 {
 public:
     static constexpr size_t kDigestSize = 20;
+    static constexpr size_t kBlockSize = 64;
     using Digest = std::array<uint8_t, kDigestSize>;
     
 private:
@@ -24,12 +64,6 @@ private:
     static constexpr uint32_t kH2 = 0x98BADCFE;
     static constexpr uint32_t kH3 = 0x10325476;
     static constexpr uint32_t kH4 = 0xC3D2E1F0;
-    
-    // SHA1 轮常量
-    static constexpr uint32_t kK0 = 0x5A827999;  // 0-19 轮
-    static constexpr uint32_t kK1 = 0x6ED9EBA1;  // 20-39 轮
-    static constexpr uint32_t kK2 = 0x8F1BBCDC;  // 40-59 轮
-    static constexpr uint32_t kK3 = 0xCA62C1D6;  // 60-79 轮
 
 public:
     
@@ -46,13 +80,34 @@ public:
     }
     
     void update(const uint8_t* data, size_t len) {
-        for (size_t i = 0; i < len; ++i) {
-            buffer_[buffer_len_++] = data[i];
-            count_++;
-            if (buffer_len_ == 64) {
-                processBlock(buffer_);
-                buffer_len_ = 0;
+        count_ += len;
+        
+        // 先补齐上次留下的不完整块
+        if (buffer_len_ > 0) {
+            size_t fill = std::min(kBlockSize - buffer_len_, len);
+            std::memcpy(buffer_ + buffer_len_, data, fill);
+            buffer_len_ += fill;
+            data += fill;
+            len -= fill;
+            
+            if (buffer_len_ < kBlockSize) {
+                return;
             }
+            sha1CompressBlocks(state_, buffer_, 1);
+            buffer_len_ = 0;
+        }
+        
+        // 整块直接从输入压缩，不经过缓冲
+        size_t blocks = len / kBlockSize;
+        if (blocks > 0) {
+            sha1CompressBlocks(state_, data, blocks);
+            data += blocks * kBlockSize;
+            len -= blocks * kBlockSize;
+        }
+        
+        if (len > 0) {
+            std::memcpy(buffer_, data, len);
+            buffer_len_ = len;
         }
     }
     
@@ -61,20 +116,19 @@ public:
         
         // 填充
         buffer_[buffer_len_++] = 0x80;
-        
-        while (buffer_len_ != 56) {
-            if (buffer_len_ == 64) {
-                processBlock(buffer_);
-                buffer_len_ = 0;
-            }
-            buffer_[buffer_len_++] = 0x00;
+        if (buffer_len_ > 56) {
+            std::memset(buffer_ + buffer_len_, 0, kBlockSize - buffer_len_);
+            sha1CompressBlocks(state_, buffer_, 1);
+            buffer_len_ = 0;
         }
+        std::memset(buffer_ + buffer_len_, 0, 56 - buffer_len_);
         
         // 追加长度（大端）
-        for (int i = 7; i >= 0; --i) {
-            buffer_[buffer_len_++] = static_cast<uint8_t>(bit_count >> (i * 8));
+        for (int i = 0; i < 8; ++i) {
+            buffer_[56 + i] = static_cast<uint8_t>(bit_count >> ((7 - i) * 8));
         }
-        processBlock(buffer_);
+        sha1CompressBlocks(state_, buffer_, 1);
+        buffer_len_ = 0;
         
         // 输出摘要
         Digest digest;
@@ -89,64 +143,9 @@ public:
     }
 
 private:
-    static uint32_t rotl(uint32_t x, int n) {
-        return (x << n) | (x >> (32 - n));
-    }
-    
-    void processBlock(const uint8_t* block) {
-        uint32_t w[80];
-        
-        // 扩展消息
-        for (int i = 0; i < 16; ++i) {
-            w[i] = (static_cast<uint32_t>(block[i * 4 + 0]) << 24) |
-                   (static_cast<uint32_t>(block[i * 4 + 1]) << 16) |
-                   (static_cast<uint32_t>(block[i * 4 + 2]) << 8) |
-                   (static_cast<uint32_t>(block[i * 4 + 3]));
-        }
-        for (int i = 16; i < 80; ++i) {
-            w[i] = rotl(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
-        }
-        
-        uint32_t a = state_[0];
-        uint32_t b = state_[1];
-        uint32_t c = state_[2];
-        uint32_t d = state_[3];
-        uint32_t e = state_[4];
-        
-        for (int i = 0; i < 80; ++i) {
-            uint32_t f, k;
-            if (i < 20) {
-                f = (b & c) | ((~b) & d);
-                k = kK0;
-            } else if (i < 40) {
-                f = b ^ c ^ d;
-                k = kK1;
-            } else if (i < 60) {
-                f = (b & c) | (b & d) | (c & d);
-                k = kK2;
-            } else {
-                f = b ^ c ^ d;
-                k = kK3;
-            }
-            
-            uint32_t temp = rotl(a, 5) + f + e + k + w[i];
-            e = d;
-            d = c;
-            c = rotl(b, 30);
-            b = a;
-            a = temp;
-        }
-        
-        state_[0] += a;
-        state_[1] += b;
-        state_[2] += c;
-        state_[3] += d;
-        state_[4] += e;
-    }
-    
     uint32_t state_[5];
     uint64_t count_;
-    uint8_t buffer_[64];
+    uint8_t buffer_[kBlockSize];
     size_t buffer_len_;
 };
 
@@ -171,5 +170,34 @@ inline std::array<uint8_t, 20> sha1(const std::vector<uint8_t>& data) {
     return sha1(data.data(), data.size());
 }
 
+// ============================================================================
+// 多缓冲哈希
+// ============================================================================
+
+/**
+ * @brief 多缓冲模式一次并行处理的缓冲区数（不可用时为 1）
+ */
+size_t sha1MultiBufferLanes();
+
+/** @brief 多缓冲模式是否启用（CPU 支持时默认启用） */
+bool sha1MultiBufferEnabled();
+
+/**
+ * @brief 启用/禁用多缓冲模式（用于基准测试和测试）
+ * @return false 如果 CPU 不支持（此时保持禁用）
+ */
+bool setSHA1MultiBuffer(bool enabled);
+
+/**
+ * @brief 对多个等长缓冲区分别计算 SHA1
+ *
+ * 有 AVX2 且多缓冲已启用时每次并行处理 8 个缓冲区（各自独立的 SHA1），
+ * 否则逐个使用当前单流后端。用于批量校验等长分片。
+ *
+ * @param data 缓冲区指针数组，每个长度均为 length
+ * @param digests 输出，长度为 count
+ */
+void sha1Many(const uint8_t* const* data, size_t length, SHA1::Digest* digests, size_t count);
+
 } // namespace magnet::utils
 
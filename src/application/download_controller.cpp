@@ -9,15 +9,77 @@
 #include <sstream>
 #include <iomanip>
 #include <cstring>
+#include <optional>
 
 namespace magnet::application {
 
 // 日志宏
-#define LOG_DEBUG(msg) magnet::utils::Logger::instance().debug(msg)
+// 调试日志先判断级别：热路径上每个块都会调用，避免无谓地构造字符串
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(msg)
 #define LOG_INFO(msg) magnet::utils::Logger::instance().info(msg)
 #define LOG_WARNING(msg) magnet::utils::Logger::instance().warn(msg)
 #define LOG_ERROR(msg) magnet::utils::Logger::instance().error(msg)
 
+namespace {
+
+/**
+ * @brief 移交给哈希线程池的分片校验作业
+ *
+ * 持有分片的哈希状态和乱序块缓存，工作线程上不需要访问 pieces_
+ */
+struct PieceHashJob {
+    uint32_t piece_index{0};
+    size_t offset{0};                   // 分片在整个种子中的字节偏移
+    size_t size{0};
+    std::unique_ptr<utils::SHA1> hasher;
+    size_t hashed_bytes{0};
+    std::vector<utils::BufferHandle> cached_blocks;    // 按块序号
+};
+
+/**
+ * @brief 补齐分片哈希：缓存中有的块直接计入，其余按块从磁盘读回（在工作线程上执行）
+ */
+storage::HashResult hashPieceRemainder(PieceHashJob& job, storage::FileManager& file_manager,
+                                       size_t block_size) {
+    storage::HashResult result;
+    std::vector<storage::ConstIoBuffer> segments;
+    
+    while (job.hashed_bytes < job.size) {
+        utils::BufferHandle block;
+        size_t block_index = job.hashed_bytes / block_size;
+        if (block_index < job.cached_blocks.size() && job.cached_blocks[block_index]) {
+            block = std::move(job.cached_blocks[block_index]);
+        } else {
+            size_t length = std::min(block_size, job.size - job.hashed_bytes);
+            
+            // 内存映射模式：直接对映射区域计算哈希，不复制
+            if (file_manager.view(job.offset + job.hashed_bytes, length, segments)) {
+                for (const auto& segment : segments) {
+                    job.hasher->update(segment.data, segment.size);
+                }
+                job.hashed_bytes += length;
+                result.bytes += length;
+                continue;
+            }
+            
+            block = utils::BufferPool::instance().acquire(length);
+            if (!file_manager.readInto(job.offset + job.hashed_bytes, block.data(), length)) {
+                return result;
+            }
+        }
+        
+        job.hasher->update(block.data(), block.size());
+        job.hashed_bytes += block.size();
+        result.bytes += block.size();
+    }
+    
+    result.digest = job.hasher->finalize();
+    result.success = true;
+    return result;
+}
+
+} // namespace
+
 // ============================================================================
 // 构造和析构
 // ============================================================================
@@ -28,6 +90,8 @@ DownloadController::DownloadController(asio::io_context& io_context)
     , peer_search_timer_(io_context)
     , metadata_timeout_timer_(io_context)
     , download_stall_timer_(io_context)
+    , block_timeout_timer_(io_context)
+    , upload_timer_(io_context)
 {
     my_peer_id_ = generatePeerId();
     LOG_DEBUG("DownloadController created, peer_id=" + my_peer_id_);
@@ -57,6 +121,13 @@ bool DownloadController::start(const DownloadConfig& config) {
     
     config_ = config;
     start_time_ = std::chrono::steady_clock::now();
+    dht_peer_found_ = false;
+    
+    // 种子级限速器，挂在（可选的）进程级限速器之下；各 Peer 的限速器再挂在它下面
+    download_limiter_ = std::make_shared<network::RateLimiter>(
+        io_context_, config_.max_download_speed, config_.global_download_limiter);
+    upload_limiter_ = std::make_shared<network::RateLimiter>(
+        io_context_, config_.max_upload_speed, config_.global_upload_limiter);
     
     LOG_INFO("Starting download: " + config.magnet_uri);
     
@@ -93,10 +164,14 @@ bool DownloadController::start(const DownloadConfig& config) {
     // 通知状态变化
     setState(DownloadState::ResolvingMetadata);
     
+    // 先开始监听，通告给 Tracker 的是实际监听的端口
+    startListening();
+    uint16_t announce_port = peer_acceptor_ ? peer_acceptor_->localPort() : config_.listen_port;
+    
     // 初始化 TrackerClient（优先使用 Tracker）
     if (!tracker_urls_.empty()) {
         tracker_client_ = std::make_shared<protocols::TrackerClient>(
-            io_context_, magnet_info.info_hash.value(), my_peer_id_, 6881);
+            io_context_, magnet_info.info_hash.value(), my_peer_id_, announce_port);
         
         // 立即向所有 Tracker 发送请求
         auto self = shared_from_this();
@@ -121,7 +196,9 @@ bool DownloadController::start(const DownloadConfig& config) {
     }
     
     // 初始化 DHT（作为备用）
-    initializeDht();
+    if (config_.enable_dht) {
+        initializeDht();
+    }
     
     // 启动元数据超时定时器
     metadata_timeout_timer_.expires_after(config_.metadata_timeout);
@@ -149,6 +226,7 @@ void DownloadController::pause() {
     
     // 取消定时器
     progress_timer_.cancel();
+    block_timeout_timer_.cancel();
 }
 
 void DownloadController::resume() {
@@ -162,6 +240,7 @@ void DownloadController::resume() {
     
     // 重新启动定时器
     startProgressTimer();
+    startBlockTimeoutTimer();
     
     // 继续请求数据
     requestMoreBlocks();
@@ -183,8 +262,11 @@ void DownloadController::stop() {
     peer_search_timer_.cancel();
     metadata_timeout_timer_.cancel();
     download_stall_timer_.cancel();
+    block_timeout_timer_.cancel();
+    upload_timer_.cancel();
     
     // 停止组件
+    stopListening();
     if (peer_manager_) {
         peer_manager_->stop();
     }
@@ -194,6 +276,12 @@ void DownloadController::stop() {
     if (tracker_client_) {
         tracker_client_->cancel();
     }
+    if (hash_pool_) {
+        hash_pool_->stop();
+    }
+    if (disk_io_) {
+        disk_io_->stop();
+    }
     
     setState(DownloadState::Stopped);
 }
@@ -255,12 +343,43 @@ void DownloadController::setMetadata(const TorrentMetadata& metadata) {
         metadata_callback_(metadata);
     }
     
-    // 初始化文件存储
+    // 初始化文件存储（块到达即写盘，没有存储无法下载）
     initializeFileStorage();
+    if (!file_manager_) {
+        fail("Failed to initialize file storage");
+        return;
+    }
     
     // 初始化分片状态
     initializePieces();
     
+    // 分片校验线程池
+    storage::HashPoolConfig hash_config;
+    hash_config.thread_count = config_.hash_threads;
+    hash_config.max_pending_jobs = config_.max_hash_jobs;
+    hash_pool_ = std::make_unique<storage::HashPool>(hash_config);
+    
+    // 异步磁盘引擎，写盘不占用网络线程
+    if (config_.async_disk_io) {
+        storage::DiskIoConfig disk_config;
+        disk_config.backend = config_.disk_io_backend;
+        disk_config.thread_count = config_.disk_io_threads;
+        disk_config.registered_buffers = config_.disk_write_buffers;
+        disk_config.registered_buffer_size = kBlockSize;
+        disk_io_ = std::make_unique<storage::DiskIoEngine>(io_context_, *file_manager_, disk_config);
+    }
+    
+    // 上传读缓存：只服务已校验的分片，未命中时经磁盘引擎读盘
+    storage::ReadCacheConfig cache_config;
+    cache_config.capacity = config_.read_cache_size;
+    read_cache_ = std::make_unique<storage::ReadCache>(
+        *file_manager_, metadata.piece_length, metadata.total_size, cache_config, disk_io_.get());
+    
+    if (peer_manager_) {
+        std::lock_guard<std::mutex> lock(pieces_mutex_);
+        peer_manager_->updateBitfield(bitfield_);
+    }
+    
     // 转换到下载状态
     setState(DownloadState::Downloading);
     
@@ -270,6 +389,9 @@ void DownloadController::setMetadata(const TorrentMetadata& metadata) {
     // 启动下载停滞检测定时器
     startDownloadStallTimer();
     
+    // 启动块请求超时检测定时器
+    startBlockTimeoutTimer();
+    
     // 开始请求数据
     LOG_INFO("Starting to request blocks after metadata set");
     requestMoreBlocks();
@@ -317,6 +439,11 @@ void DownloadController::onNewPeerConnected(std::shared_ptr<protocols::PeerConne
     LOG_DEBUG("onNewPeerConnected: state=" + std::string(downloadStateToString(current_state)) +
               ", metadata_fetcher=" + (metadata_fetcher_ ? "yes" : "no"));
     
+    // 入站 Peer 可能早于任何 Peer 发现结果到达，此时才创建 MetadataFetcher
+    if (current_state == DownloadState::ResolvingMetadata && !metadata_fetcher_) {
+        initializeMetadataFetcher();
+    }
+    
     // 如果正在获取元数据，将新连接的 Peer 添加到 MetadataFetcher
     if (current_state == DownloadState::ResolvingMetadata && metadata_fetcher_) {
         LOG_INFO("Adding peer to MetadataFetcher");
@@ -397,6 +524,7 @@ void DownloadController::onMetadataFetched(const protocols::TorrentMetadata* met
 void DownloadController::initializeDht() {
     protocols::DhtClientConfig dht_config;
     dht_config.listen_port = 6881;  // 固定端口，方便防火墙配置
+    dht_config.state_file = config_.dht_state_file;
     
     // 添加引导节点 - 使用多个公共 DHT 节点增加成功率
     dht_config.bootstrap_nodes = {
@@ -409,9 +537,14 @@ void DownloadController::initializeDht() {
         {"dht.vuze.com", 6881}
     };
     
-    // 大幅增加超时时间（国内网络环境需要更长时间）
-    dht_config.query_config.default_timeout = std::chrono::milliseconds(10000);
-    dht_config.query_config.default_max_retries = 6;
+    // 超时按测得的 RTT 自适应：没有样本时从 3 秒起步，慢网络（如国内环境）下
+    // RTO 会自行变大，重试时翻倍到最多 10 秒；单个查询总时长不超过 20 秒，
+    // 不再让一个失效节点占住槽位 70 秒（原来固定 10 秒 × 7 次）
+    dht_config.query_config.adaptive_timeout = true;
+    dht_config.query_config.default_timeout = std::chrono::milliseconds(3000);
+    dht_config.query_config.max_timeout = std::chrono::milliseconds(10000);
+    dht_config.query_config.max_query_time = std::chrono::milliseconds(20000);
+    dht_config.query_config.default_max_retries = 3;
     
     dht_client_ = std::make_shared<protocols::DhtClient>(io_context_, dht_config);
     dht_client_->start();
@@ -485,6 +618,15 @@ void DownloadController::findPeers() {
     if (dht_client_) {
         dht_client_->findPeers(info_hash, 
             [self](const protocols::PeerInfo& peer) {
+                if (!self->dht_peer_found_) {
+                    self->dht_peer_found_ = true;
+                    auto stats = self->dht_client_->getStatistics();
+                    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - self->start_time_);
+                    LOG_INFO("DHT time to first peer: " + std::to_string(elapsed.count()) + "ms (" +
+                             (stats.warm_started ? "warm start" : "bootstrap nodes") + ", joined in " +
+                             std::to_string(stats.bootstrap_time.count()) + "ms)");
+                }
                 std::vector<protocols::PeerInfo> peers = {peer};
                 self->onPeersFound(peers);
             },
@@ -492,10 +634,144 @@ void DownloadController::findPeers() {
                 if (success && !all_peers.empty()) {
                     LOG_INFO("DHT lookup complete, found " + std::to_string(all_peers.size()) + " peers");
                 }
+                auto query_stats = self->dht_client_->getQueryStatistics();
+                LOG_DEBUG("DHT query latency p50/p90: " +
+                          std::to_string(query_stats.latency_histogram.percentile(0.5).count()) + "/" +
+                          std::to_string(query_stats.latency_histogram.percentile(0.9).count()) +
+                          "ms, SRTT " + std::to_string(static_cast<int>(query_stats.smoothed_rtt_ms)) +
+                          "ms, timeouts " + std::to_string(query_stats.queries_timeout));
             });
     }
 }
 
+void DownloadController::startListening() {
+    if (!config_.accept_incoming) {
+        return;
+    }
+    
+    if (config_.global_peer_acceptor) {
+        // 所有任务共用一个监听端口，按握手中的 info_hash 路由
+        peer_acceptor_ = config_.global_peer_acceptor;
+        owns_peer_acceptor_ = false;
+    } else {
+        peer_acceptor_ = std::make_shared<protocols::PeerAcceptor>(io_context_);
+        owns_peer_acceptor_ = true;
+        if (!peer_acceptor_->listen(config_.listen_port)) {
+            // 端口被占用等：只是少了入站连接，下载照常进行
+            LOG_WARNING("Cannot listen on port " + std::to_string(config_.listen_port) +
+                        ", incoming peers disabled");
+            peer_acceptor_.reset();
+            return;
+        }
+    }
+    
+    // 入站连接要能路由到 PeerManager，所以在发现 Peer 之前就创建它（创建时向接受器注册）
+    ensurePeerManager();
+}
+
+void DownloadController::stopListening() {
+    if (!peer_acceptor_) {
+        return;
+    }
+    if (owns_peer_acceptor_) {
+        peer_acceptor_->stop();
+        return;
+    }
+    
+    protocols::InfoHash info_hash;
+    {
+        std::lock_guard<std::mutex> lock(metadata_mutex_);
+        info_hash = metadata_.info_hash;
+    }
+    peer_acceptor_->unregisterTorrent(info_hash);
+}
+
+void DownloadController::ensurePeerManager() {
+    if (peer_manager_) {
+        return;
+    }
+    
+    protocols::InfoHash info_hash;
+    {
+        std::lock_guard<std::mutex> lock(metadata_mutex_);
+        info_hash = metadata_.info_hash;
+    }
+    
+    protocols::PeerManagerConfig pm_config;
+    pm_config.max_connections = config_.max_connections;
+    pm_config.download_limiter = download_limiter_;
+    pm_config.upload_limiter = upload_limiter_;
+    pm_config.max_peer_download_speed = config_.max_peer_download_speed;
+    pm_config.max_peer_upload_speed = config_.max_peer_upload_speed;
+    if (config_.max_upload_speed > 0) {
+        // 限速时发送队列只积压约一秒的上传量，取消的请求不会在队列里排太久
+        pm_config.max_upload_backlog = std::min(
+            pm_config.max_upload_backlog,
+            std::max<size_t>(config_.max_upload_speed, 2 * kBlockSize));
+    }
+    
+    peer_manager_ = std::make_shared<protocols::PeerManager>(
+        io_context_, info_hash, my_peer_id_, pm_config);
+    
+    // 设置回调
+    auto self = shared_from_this();
+    
+    peer_manager_->setPieceCallback(
+        [self](const network::TcpEndpoint& ep, uint32_t piece, uint32_t begin,
+               network::ByteSpan data) {
+            self->onPieceReceived(ep, piece, begin, data);
+        });
+    
+    peer_manager_->setPeerStatusCallback(
+        [self](const network::TcpEndpoint& ep, bool connected) {
+            self->onPeerStatusChanged(ep, connected);
+        });
+    
+    peer_manager_->setBitfieldCallback(
+        [self](const network::TcpEndpoint& ep, const std::vector<bool>& bitfield) {
+            self->onPeerBitfield(ep, bitfield);
+        });
+    
+    peer_manager_->setHaveCallback(
+        [self](const network::TcpEndpoint& ep, uint32_t piece_index) {
+            self->onPeerHave(ep, piece_index);
+        });
+    
+    peer_manager_->setChokeCallback(
+        [self](const network::TcpEndpoint& ep, bool choked) {
+            self->onPeerChoke(ep, choked);
+        });
+    
+    peer_manager_->setUploadRequestCallback(
+        [self](const network::TcpEndpoint&, const protocols::BlockInfo&) {
+            self->onUploadRequest();
+        });
+    
+    peer_manager_->setNeedMorePeersCallback([self]() {
+        self->findPeers();
+    });
+    
+    // 设置新 Peer 连接回调（用于元数据获取）
+    peer_manager_->setNewPeerCallback(
+        [self](std::shared_ptr<protocols::PeerConnection> peer) {
+            self->onNewPeerConnected(peer);
+        });
+    
+    // 元数据已到达时（例如入站监听失败、Peer 晚于元数据出现）同步本地位图
+    {
+        std::lock_guard<std::mutex> lock(pieces_mutex_);
+        if (!bitfield_.empty()) {
+            peer_manager_->updateBitfield(bitfield_);
+        }
+    }
+    
+    peer_manager_->start();
+    
+    if (peer_acceptor_) {
+        peer_acceptor_->registerTorrent(info_hash, peer_manager_);
+    }
+}
+
 void DownloadController::onPeersFound(const std::vector<protocols::PeerInfo>& peers) {
     if (peers.empty()) {
         LOG_DEBUG("No peers found");
@@ -505,44 +781,7 @@ void DownloadController::onPeersFound(const std::vector<protocols::PeerInfo>& pe
     LOG_INFO("Found " + std::to_string(peers.size()) + " peers");
     
     // 初始化 PeerManager（如果还没有）
-    if (!peer_manager_) {
-        protocols::InfoHash info_hash;
-        {
-            std::lock_guard<std::mutex> lock(metadata_mutex_);
-            info_hash = metadata_.info_hash;
-        }
-        
-        protocols::PeerManagerConfig pm_config;
-        pm_config.max_connections = config_.max_connections;
-        
-        peer_manager_ = std::make_shared<protocols::PeerManager>(
-            io_context_, info_hash, my_peer_id_, pm_config);
-        
-        // 设置回调
-        auto self = shared_from_this();
-        
-        peer_manager_->setPieceCallback(
-            [self](uint32_t piece, uint32_t begin, const std::vector<uint8_t>& data) {
-                self->onPieceReceived(piece, begin, data);
-            });
-        
-        peer_manager_->setPeerStatusCallback(
-            [self](const network::TcpEndpoint& ep, bool connected) {
-                self->onPeerStatusChanged(ep, connected);
-            });
-        
-        peer_manager_->setNeedMorePeersCallback([self]() {
-            self->findPeers();
-        });
-        
-        // 设置新 Peer 连接回调（用于元数据获取）
-        peer_manager_->setNewPeerCallback(
-            [self](std::shared_ptr<protocols::PeerConnection> peer) {
-                self->onNewPeerConnected(peer);
-            });
-        
-        peer_manager_->start();
-    }
+    ensurePeerManager();
     
     // 如果还没有元数据，初始化 MetadataFetcher
     if (state_.load() == DownloadState::ResolvingMetadata && !metadata_fetcher_) {
@@ -563,8 +802,9 @@ void DownloadController::onPeersFound(const std::vector<protocols::PeerInfo>& pe
     }
 }
 
-void DownloadController::onPieceReceived(uint32_t piece_index, uint32_t begin, 
-                                          const std::vector<uint8_t>& data) {
+void DownloadController::onPieceReceived(const network::TcpEndpoint& endpoint,
+                                          uint32_t piece_index, uint32_t begin, 
+                                          network::ByteSpan data) {
     if (state_.load() != DownloadState::Downloading) {
         return;
     }
@@ -577,50 +817,99 @@ void DownloadController::onPieceReceived(uint32_t piece_index, uint32_t begin,
     
     auto& piece = pieces_[piece_index];
     
-    // 计算块索引
-    size_t block_index = begin / kBlockSize;
-    if (block_index >= piece.blocks.size()) {
+    // 偏移和长度由 Peer 决定，写盘前必须校验：只接受按块对齐、长度恰好为
+    // 该块大小的数据，否则会越界写到相邻（可能已校验）的分片上
+    if (begin % kBlockSize != 0 || begin >= piece.size ||
+        data.size() != std::min(kBlockSize, piece.size - begin)) {
+        LOG_WARNING("Dropping malformed block from " + endpoint.toString() +
+                    ": piece=" + std::to_string(piece_index) +
+                    " begin=" + std::to_string(begin) +
+                    " size=" + std::to_string(data.size()));
         return;
     }
     
-    // 检查是否已经收到
-    if (piece.blocks[block_index]) {
+    // 更新该 Peer 的管道（速度、延迟估计）；没有向该 Peer 请求过的块直接丢弃
+    protocols::BlockInfo received{piece_index, begin, static_cast<uint32_t>(data.size())};
+    if (!block_scheduler_.onBlockReceived(endpoint, received, std::chrono::steady_clock::now())) {
+        LOG_DEBUG("Dropping unrequested block from " + endpoint.toString() +
+                  ": piece=" + std::to_string(piece_index) +
+                  " begin=" + std::to_string(begin));
         return;
     }
     
-    // 保存数据
-    if (piece.data.size() < begin + data.size()) {
-        piece.data.resize(begin + data.size());
+    size_t block_index = begin / kBlockSize;
+    
+    // 检查是否已经收到（或分片已不在下载中，例如超时重发后原 Peer 又送达）
+    if (piece.state != PieceState::Pending || piece.blocks[block_index]) {
+        return;
+    }
+    
+    // 同一个块可能还挂在其他 Peer 的管道上（endgame 重复请求或超时重发），
+    // 移除并发送 CANCEL，避免重复下载
+    for (const auto& holder : block_scheduler_.releaseBlock(piece_index, begin)) {
+        if (peer_manager_) {
+            peer_manager_->cancelBlockFrom(holder, received);
+        }
+    }
+    piece.requested[block_index] = false;
+    
+    // 直接写盘，不在内存中缓存整个分片
+    size_t offset = static_cast<size_t>(piece_index) * piece_length_ + begin;
+    if (disk_io_) {
+        // 异步写盘：块先计为已收到，分片校验等到所有写入完成后再提交。
+        // 完成通知经 DiskWriteSink 回到 onDiskWrite，每块不构造回调闭包
+        std::weak_ptr<storage::DiskWriteSink> sink = shared_from_this();
+        // data 指向 Peer 的接收缓冲区，这里是块数据唯一的一次拷贝
+        auto buffer = disk_io_->acquireBuffer();
+        if (buffer.valid() && buffer.size() >= data.size()) {
+            std::memcpy(buffer.data(), data.data(), data.size());
+            disk_io_->asyncWrite(offset, std::move(buffer), data.size(), std::move(sink), piece_index);
+        } else {
+            // 固定缓冲用完时退回池化缓冲，同样不经过 malloc
+            disk_io_->asyncWrite(offset, utils::BufferPool::instance().copy(data.data(), data.size()),
+                                 std::move(sink), piece_index);
+        }
+        piece.pending_writes++;
+    } else if (!file_manager_ || !file_manager_->write(offset, data.data(), data.size())) {
+        LOG_ERROR("Failed to write block: piece=" + std::to_string(piece_index) +
+                  " begin=" + std::to_string(begin));
+        partial_pieces_.insert(piece_index);
+        return;
     }
-    std::copy(data.begin(), data.end(), piece.data.begin() + begin);
     
     piece.blocks[block_index] = true;
     piece.downloaded += data.size();
     
+    // 增量哈希：按顺序到达的块立即计入，乱序块在缓存预算内暂存
+    if (!piece.hasher) {
+        piece.hasher = std::make_unique<utils::SHA1>();
+    }
+    if (begin == piece.hashed_bytes) {
+        piece.hasher->update(data.data(), data.size());
+        piece.hashed_bytes += data.size();
+        advanceHashCursor(piece);
+    } else if (cached_bytes_ + data.size() <= config_.block_cache_size) {
+        // 按块序号存放：每个分片只在第一次乱序时分配一次槽位
+        piece.cached_blocks.resize(piece.blocks.size());
+        piece.cached_blocks[block_index] = utils::BufferPool::instance().copy(data.data(), data.size());
+        cached_bytes_ += data.size();
+    }
+    
     LOG_DEBUG("Received block: piece=" + std::to_string(piece_index) + 
               " begin=" + std::to_string(begin) + 
               " size=" + std::to_string(data.size()));
     
-    // 检查分片是否完整
+    // 分片完整且全部落盘后交给哈希线程池校验，结果投递回 io_context 线程
     if (piece.isComplete()) {
-        piece.state = PieceState::Downloaded;
-        
-        // 异步验证
-        auto self = shared_from_this();
-        asio::post(io_context_, [self, piece_index]() {
-            if (self->verifyPiece(piece_index)) {
-                self->checkCompletion();
-            }
-            self->requestMoreBlocks();
-        });
-    } else {
-        // 每收到一个 block 就尝试请求更多，保持管道满载
-        auto self = shared_from_this();
-        asio::post(io_context_, [self]() {
-            self->requestMoreBlocks();
-        });
+        setPieceState(piece, PieceState::Downloaded);
+        if (piece.pending_writes == 0) {
+            submitPieceHash(piece);
+        }
     }
     
+    // 每收到一个 block 就补满该 Peer 的管道
+    fillPeerPipeline(endpoint);
+    
     // 更新进度
     {
         std::lock_guard<std::mutex> progress_lock(progress_mutex_);
@@ -630,6 +919,19 @@ void DownloadController::onPieceReceived(uint32_t piece_index, uint32_t begin,
 
 void DownloadController::onPeerStatusChanged(const network::TcpEndpoint& endpoint, 
                                               bool connected) {
+    {
+        std::lock_guard<std::mutex> pieces_lock(pieces_mutex_);
+        if (connected) {
+            block_scheduler_.addPeer(endpoint);
+        } else {
+            // 断开的 Peer 上未完成的块重新分配
+            releaseBlocks(block_scheduler_.removePeer(endpoint));
+            if (piece_picker_) {
+                piece_picker_->removePeer(endpoint.toString());
+            }
+        }
+    }
+    
     std::lock_guard<std::mutex> lock(progress_mutex_);
     
     if (connected) {
@@ -643,6 +945,39 @@ void DownloadController::onPeerStatusChanged(const network::TcpEndpoint& endpoin
     }
 }
 
+void DownloadController::onPeerBitfield(const network::TcpEndpoint& endpoint, 
+                                         const std::vector<bool>& bitfield) {
+    std::lock_guard<std::mutex> lock(pieces_mutex_);
+    
+    // 元数据到达前忽略，initializePieces 时会从 PeerManager 回填
+    if (piece_picker_) {
+        piece_picker_->setPeerBitfield(endpoint.toString(), bitfield);
+    }
+}
+
+void DownloadController::onPeerHave(const network::TcpEndpoint& endpoint, uint32_t piece_index) {
+    std::lock_guard<std::mutex> lock(pieces_mutex_);
+    
+    if (piece_picker_) {
+        piece_picker_->peerHas(endpoint.toString(), piece_index);
+    }
+}
+
+void DownloadController::onPeerChoke(const network::TcpEndpoint& endpoint, bool choked) {
+    {
+        std::lock_guard<std::mutex> lock(pieces_mutex_);
+        // 被 choke 后对方会丢弃未完成的请求
+        releaseBlocks(block_scheduler_.setPeerChoked(endpoint, choked));
+    }
+    
+    LOG_DEBUG(std::string(choked ? "Choked by " : "Unchoked by ") + endpoint.toString());
+    
+    auto self = shared_from_this();
+    asio::post(io_context_, [self]() {
+        self->requestMoreBlocks();
+    });
+}
+
 void DownloadController::initializeFileStorage() {
     TorrentMetadata meta;
     {
@@ -668,6 +1003,8 @@ void DownloadController::initializeFileStorage() {
     storage_config.base_path = base_path;
     storage_config.piece_length = meta.piece_length;
     storage_config.total_size = meta.total_size;
+    storage_config.memory_map = config_.memory_map_storage;
+    storage_config.preallocate_mode = config_.preallocate_mode;
     
     // 添加文件信息
     size_t current_offset = 0;
@@ -719,6 +1056,7 @@ void DownloadController::initializePieces() {
         // 计算块数
         size_t block_count = (piece.size + kBlockSize - 1) / kBlockSize;
         piece.blocks.resize(block_count, false);
+        piece.requested.resize(block_count, false);
         
         pieces_.push_back(std::move(piece));
     }
@@ -726,6 +1064,23 @@ void DownloadController::initializePieces() {
     // 初始化位图
     bitfield_.resize(meta.piece_count, false);
     
+    pending_count_ = 0;
+    verified_count_ = 0;
+    piece_length_ = meta.piece_length;
+    cached_bytes_ = 0;
+    partial_pieces_.clear();
+    hash_backlog_.clear();
+    endgame_ = false;
+    
+    // 初始化分片选择器，并用已连接 Peer 的位图回填可用度
+    // （Peer 通常在元数据获取阶段就已经连接并发送了 Bitfield）
+    piece_picker_ = std::make_unique<storage::PiecePicker>(meta.piece_count);
+    if (peer_manager_) {
+        for (const auto& [endpoint, peer_bitfield] : peer_manager_->getPeerBitfields()) {
+            piece_picker_->setPeerBitfield(endpoint.toString(), peer_bitfield);
+        }
+    }
+    
     // 更新进度
     {
         std::lock_guard<std::mutex> progress_lock(progress_mutex_);
@@ -736,223 +1091,504 @@ void DownloadController::initializePieces() {
     LOG_INFO("Initialized " + std::to_string(meta.piece_count) + " pieces");
 }
 
-int32_t DownloadController::selectNextPiece() {
+int32_t DownloadController::selectNextPiece(const network::TcpEndpoint& peer) {
     // 注意：调用时已持有 pieces_mutex_
     
-    // 收集所有 Missing 的分片
-    std::vector<uint32_t> missing_pieces;
-    for (const auto& piece : pieces_) {
-        if (piece.state == PieceState::Missing) {
-            missing_pieces.push_back(piece.index);
-        }
+    if (!piece_picker_) {
+        return -1;
     }
     
-    if (missing_pieces.empty()) {
-        LOG_DEBUG("selectNextPiece: no missing pieces");
-        return -1;
+    // 稀有优先：PiecePicker 按可用度分桶增量维护，选择时不需要遍历 Peer
+    // 可用度为 0（没有 Peer 拥有）的分片不会被选中；
+    // 该 Peer 没有我们需要的分片时直接返回，不扫描桶
+    return piece_picker_->pickPieceFor(peer.toString());
+}
+
+size_t DownloadController::fillPeerPipeline(const network::TcpEndpoint& peer) {
+    // 注意：调用时已持有 pieces_mutex_
+    
+    if (!peer_manager_ || !piece_picker_) {
+        return 0;
+    }
+    
+    size_t slots = block_scheduler_.freeSlots(peer);
+    if (slots == 0) {
+        return 0;
     }
     
-    LOG_DEBUG("selectNextPiece: " + std::to_string(missing_pieces.size()) + " missing pieces");
+    // 位图只查找一次，下面逐分片判断时不再按字符串键查表
+    const std::vector<bool>* have = piece_picker_->peerPieces(peer.toString());
+    if (!have) {
+        return 0;
+    }
     
-    // 稀有优先算法：计算每个分片的稀有度
-    // 稀有度 = 拥有该分片的 Peer 数量（越少越稀有）
+    size_t sent = 0;
+    bool ok = true;
     
-    if (peer_manager_) {
-        int32_t best_piece = -1;
-        size_t min_availability = SIZE_MAX;
-        size_t pieces_with_peers = 0;
+    // 1. 先补齐已开始的分片，尽快完成，减少内存中的半成品
+    for (auto it = partial_pieces_.begin(); it != partial_pieces_.end() && slots > 0 && ok;) {
+        uint32_t piece_index = *it;
+        if (!(*have)[piece_index]) {
+            ++it;
+            continue;
+        }
         
-        for (uint32_t piece_idx : missing_pieces) {
-            auto peers = peer_manager_->getPeersWithPiece(piece_idx);
-            size_t availability = peers.size();
-            
-            if (availability > 0) {
-                pieces_with_peers++;
-                if (availability < min_availability) {
-                    min_availability = availability;
-                    best_piece = static_cast<int32_t>(piece_idx);
-                }
-            }
+        auto& piece = pieces_[piece_index];
+        sent += requestBlocksOf(peer, piece, slots, ok);
+        
+        it = piece.hasUnrequestedBlocks() ? std::next(it) : partial_pieces_.erase(it);
+    }
+    
+    // 2. 再按稀有优先开始新分片
+    // 限制并发下载的分片数；哈希线程池积压时不开始新分片，避免校验跟不上下载
+    const size_t max_pending = 100;
+    while (ok && slots > 0 && pending_count_ < max_pending && hash_backlog_.empty()) {
+        int32_t next_piece = selectNextPiece(peer);
+        if (next_piece < 0) {
+            break;
         }
         
-        LOG_DEBUG("selectNextPiece: " + std::to_string(pieces_with_peers) + 
-                  " pieces have peers available");
+        auto& piece = pieces_[next_piece];
+        setPieceState(piece, PieceState::Pending);
         
-        if (best_piece >= 0) {
-            LOG_DEBUG("selectNextPiece: selected piece " + std::to_string(best_piece) + 
-                      " with availability " + std::to_string(min_availability));
-            return best_piece;
+        size_t piece_sent = requestBlocksOf(peer, piece, slots, ok);
+        if (piece_sent == 0) {
+            // 一个块都没发出去，放回可选集合
+            setPieceState(piece, PieceState::Missing);
+            break;
         }
+        sent += piece_sent;
         
-        LOG_DEBUG("selectNextPiece: no peers have any of the missing pieces");
-    } else {
-        LOG_DEBUG("selectNextPiece: peer_manager is null");
+        if (!piece.hasUnrequestedBlocks()) {
+            partial_pieces_.erase(piece.index);
+        }
+    }
+    
+    // 3. 没有新块可请求时，进入 endgame 重复请求
+    if (ok && slots > 0 && config_.enable_endgame) {
+        sent += requestEndgameBlocks(peer, slots);
     }
     
-    // 如果没有 peer 有这些分片，返回 -1（不要盲目请求）
-    return -1;
+    return sent;
 }
 
-void DownloadController::requestPiece(uint32_t piece_index) {
+size_t DownloadController::requestEndgameBlocks(const network::TcpEndpoint& peer, size_t& slots) {
     // 注意：调用时已持有 pieces_mutex_
     
-    if (piece_index >= pieces_.size()) {
-        return;
+    // 所有剩余块都已请求（没有半成品分片，也没有可开始的新分片）
+    bool all_requested = partial_pieces_.empty() && piece_picker_->pickPiece() < 0;
+    
+    // 先用总请求数粗略判断，避免在大量未完成请求上排序
+    if (!all_requested || block_scheduler_.totalOutstanding() == 0 ||
+        block_scheduler_.totalOutstanding() > 
+            config_.endgame_max_blocks * config_.endgame_max_duplicates) {
+        endgame_ = false;
+        return 0;
     }
     
-    auto& piece = pieces_[piece_index];
-    if (piece.state != PieceState::Missing) {
-        return;
+    auto blocks = block_scheduler_.outstandingBlocks();
+    if (blocks.size() > config_.endgame_max_blocks) {
+        endgame_ = false;
+        return 0;
     }
     
-    // 统计成功发送的请求数
-    size_t requests_sent = 0;
+    if (!endgame_) {
+        endgame_ = true;
+        LOG_INFO("Entering endgame mode: " + std::to_string(blocks.size()) + " blocks outstanding");
+    }
     
-    // 生成块请求
-    for (size_t i = 0; i < piece.blocks.size(); ++i) {
-        if (piece.blocks[i]) {
-            continue;  // 已下载
+    std::string key = peer.toString();
+    const std::vector<bool>* have = piece_picker_->peerPieces(key);
+    if (!have) {
+        return 0;
+    }
+    
+    size_t sent = 0;
+    auto now = std::chrono::steady_clock::now();
+    
+    // 请求数少的块优先
+    for (const auto& item : blocks) {
+        if (slots == 0) {
+            break;
+        }
+        
+        const auto& block = item.block;
+        if (item.requests >= config_.endgame_max_duplicates ||
+            !(*have)[block.piece_index] ||
+            block_scheduler_.isRequestedFrom(peer, block.piece_index, block.begin)) {
+            continue;
+        }
+        
+        if (!peer_manager_->requestBlockFrom(peer, block)) {
+            break;
+        }
+        
+        block_scheduler_.onBlockRequested(peer, block, now);
+        slots--;
+        sent++;
+    }
+    
+    if (sent > 0) {
+        LOG_DEBUG("Endgame: sent " + std::to_string(sent) + " duplicate requests to " + key);
+    }
+    
+    return sent;
+}
+
+size_t DownloadController::requestBlocksOf(const network::TcpEndpoint& peer, PieceInfo& piece,
+                                           size_t& slots, bool& ok) {
+    // 注意：调用时已持有 pieces_mutex_
+    
+    auto now = std::chrono::steady_clock::now();
+    size_t sent = 0;
+    
+    for (size_t i = 0; i < piece.blocks.size() && slots > 0; ++i) {
+        if (piece.blocks[i] || piece.requested[i]) {
+            continue;  // 已下载或已请求
         }
         
         uint32_t begin = static_cast<uint32_t>(i * kBlockSize);
         uint32_t length = static_cast<uint32_t>(
             std::min(kBlockSize, piece.size - begin));
         
-        protocols::BlockInfo block{piece_index, begin, length};
+        protocols::BlockInfo block{piece.index, begin, length};
         
-        if (peer_manager_ && peer_manager_->requestBlock(block)) {
-            requests_sent++;
+        if (!peer_manager_->requestBlockFrom(peer, block)) {
+            ok = false;
+            break;
         }
+        
+        piece.requested[i] = true;
+        block_scheduler_.onBlockRequested(peer, block, now);
+        slots--;
+        sent++;
     }
     
-    // 只有当成功发送了请求时，才将 piece 标记为 Pending
-    if (requests_sent > 0) {
-        piece.state = PieceState::Pending;
-        piece.request_time = std::chrono::steady_clock::now();  // 记录请求时间
-        LOG_DEBUG("Requested piece " + std::to_string(piece_index) + 
-                  " with " + std::to_string(requests_sent) + " blocks");
-    } else {
-        LOG_DEBUG("No peer available for piece " + std::to_string(piece_index));
+    return sent;
+}
+
+void DownloadController::advanceHashCursor(PieceInfo& piece) {
+    // 注意：调用时已持有 pieces_mutex_
+    
+    for (size_t i = piece.hashed_bytes / kBlockSize;
+         i < piece.cached_blocks.size() && piece.cached_blocks[i]; ++i) {
+        auto& block = piece.cached_blocks[i];
+        piece.hasher->update(block.data(), block.size());
+        piece.hashed_bytes += block.size();
+        cached_bytes_ -= block.size();
+        
+        block.reset();
     }
 }
 
-void DownloadController::requestMoreBlocks() {
-    if (state_.load() != DownloadState::Downloading) {
-        LOG_DEBUG("requestMoreBlocks: not in Downloading state");
+void DownloadController::submitPieceHash(PieceInfo& piece) {
+    // 注意：调用时已持有 pieces_mutex_
+    
+    if (!hash_pool_ || !file_manager_) {
         return;
     }
     
-    std::lock_guard<std::mutex> lock(pieces_mutex_);
+    // 线程池已满（或前面还有积压）时排队，保持提交顺序
+    if (!hash_backlog_.empty() || hash_pool_->saturated()) {
+        hash_backlog_.push_back(piece.index);
+        return;
+    }
+    
+    if (!piece.hasher) {
+        piece.hasher = std::make_unique<utils::SHA1>();
+    }
+    advanceHashCursor(piece);
+    
+    // 哈希状态和缓存随作业移交，不再计入缓存预算
+    auto job = std::make_shared<PieceHashJob>();
+    job->piece_index = piece.index;
+    job->offset = static_cast<size_t>(piece.index) * piece_length_;
+    job->size = piece.size;
+    job->hasher = std::move(piece.hasher);
+    job->hashed_bytes = piece.hashed_bytes;
+    job->cached_blocks = std::move(piece.cached_blocks);
+    for (const auto& block : job->cached_blocks) {
+        cached_bytes_ -= block.size();
+    }
+    piece.cached_blocks.clear();
+    piece.hashed_bytes = 0;
+    
+    // 工作线程只持有弱引用：控制器析构时等待作业结束，作业不能延长其生命周期
+    std::weak_ptr<DownloadController> weak = shared_from_this();
+    
+    bool accepted = hash_pool_->submit(
+        [weak, job]() {
+            auto self = weak.lock();
+            if (!self || !self->file_manager_) {
+                return storage::HashResult{};
+            }
+            return hashPieceRemainder(*job, *self->file_manager_, kBlockSize);
+        },
+        [weak, piece_index = piece.index](storage::HashResult result) {
+            auto self = weak.lock();
+            if (!self) {
+                return;
+            }
+            auto& io_context = self->io_context_;
+            asio::post(io_context, [self = std::move(self), piece_index, result]() {
+                self->onPieceHashed(piece_index, result);
+            });
+        });
+    
+    if (!accepted) {
+        // 线程池已停止：放弃校验，分片重新下载
+        LOG_WARNING("Hash pool rejected piece " + std::to_string(piece.index));
+        resetPiece(piece);
+    }
+}
+
+void DownloadController::drainHashBacklog() {
+    // 注意：调用时已持有 pieces_mutex_
     
-    // 统计正在下载的分片数和各状态数量
-    size_t pending_count = 0;
-    size_t missing_count = 0;
-    size_t verified_count = 0;
-    for (const auto& piece : pieces_) {
-        if (piece.state == PieceState::Pending) {
-            pending_count++;
-        } else if (piece.state == PieceState::Missing) {
-            missing_count++;
-        } else if (piece.state == PieceState::Verified) {
-            verified_count++;
+    while (!hash_backlog_.empty() && hash_pool_ && !hash_pool_->saturated()) {
+        uint32_t piece_index = hash_backlog_.front();
+        hash_backlog_.pop_front();
+        
+        auto& piece = pieces_[piece_index];
+        if (piece.state == PieceState::Downloaded) {
+            submitPieceHash(piece);
         }
     }
+}
+
+void DownloadController::releasePieceBuffers(PieceInfo& piece) {
+    // 注意：调用时已持有 pieces_mutex_
     
-    LOG_DEBUG("requestMoreBlocks: pieces=" + std::to_string(pieces_.size()) +
-              ", pending=" + std::to_string(pending_count) +
-              ", missing=" + std::to_string(missing_count) +
-              ", verified=" + std::to_string(verified_count));
+    for (const auto& block : piece.cached_blocks) {
+        cached_bytes_ -= block.size();
+    }
+    piece.cached_blocks.clear();
+    piece.hasher.reset();
+    piece.hashed_bytes = 0;
+}
+
+void DownloadController::releaseBlocks(const std::vector<protocols::BlockInfo>& blocks) {
+    // 注意：调用时已持有 pieces_mutex_
     
-    // 限制并发下载的分片数（增加到 100 以提高下载速度）
-    const size_t max_pending = 100;
-    size_t requested = 0;
-    while (pending_count < max_pending) {
-        int32_t next_piece = selectNextPiece();
-        if (next_piece < 0) {
-            LOG_DEBUG("requestMoreBlocks: no more pieces to request (selectNextPiece returned -1)");
-            break;
+    for (const auto& block : blocks) {
+        if (block.piece_index >= pieces_.size()) {
+            continue;
+        }
+        
+        auto& piece = pieces_[block.piece_index];
+        size_t block_index = block.begin / kBlockSize;
+        if (piece.state != PieceState::Pending || block_index >= piece.requested.size()) {
+            continue;
+        }
+        
+        // endgame 时同一个块可能还有其他 Peer 在下载，不需要重新分配
+        if (endgame_ && block_scheduler_.isRequested(block.piece_index, block.begin)) {
+            continue;
         }
         
-        LOG_DEBUG("requestMoreBlocks: requesting piece " + std::to_string(next_piece));
-        requestPiece(static_cast<uint32_t>(next_piece));
-        pending_count++;
-        requested++;
+        if (!piece.blocks[block_index]) {
+            piece.requested[block_index] = false;
+            partial_pieces_.insert(piece.index);
+        }
     }
+}
+
+void DownloadController::resetPiece(PieceInfo& piece) {
+    // 注意：调用时已持有 pieces_mutex_
     
-    LOG_DEBUG("requestMoreBlocks: requested " + std::to_string(requested) + " pieces");
+    // 还在路上的块到达后也无处可写，撤回并通知对方不必再发
+    for (uint32_t begin = 0; begin < piece.size; begin += kBlockSize) {
+        protocols::BlockInfo block{piece.index, begin,
+                                   static_cast<uint32_t>(std::min(kBlockSize, piece.size - begin))};
+        for (const auto& holder : block_scheduler_.releaseBlock(piece.index, begin)) {
+            if (peer_manager_) {
+                peer_manager_->cancelBlockFrom(holder, block);
+            }
+        }
+    }
     
-    // 更新进度
-    {
-        std::lock_guard<std::mutex> progress_lock(progress_mutex_);
-        current_progress_.pending_pieces = pending_count;
+    releasePieceBuffers(piece);
+    piece.downloaded = 0;
+    std::fill(piece.blocks.begin(), piece.blocks.end(), false);
+    std::fill(piece.requested.begin(), piece.requested.end(), false);
+    
+    setPieceState(piece, PieceState::Pending);
+    partial_pieces_.insert(piece.index);
+}
+
+void DownloadController::setPieceState(PieceInfo& piece, PieceState new_state) {
+    // 注意：调用时已持有 pieces_mutex_
+    
+    if (piece.state == new_state) {
+        return;
+    }
+    
+    if (piece.state == PieceState::Pending) {
+        pending_count_--;
+        partial_pieces_.erase(piece.index);
+    } else if (piece.state == PieceState::Verified) {
+        verified_count_--;
+    }
+    
+    piece.state = new_state;
+    
+    // 分片不再下载时释放哈希状态和缓存
+    if (new_state == PieceState::Missing || new_state == PieceState::Verified) {
+        releasePieceBuffers(piece);
+    }
+    
+    if (new_state == PieceState::Pending) {
+        pending_count_++;
+        partial_pieces_.insert(piece.index);
+    } else if (new_state == PieceState::Verified) {
+        verified_count_++;
+    }
+    
+    if (!piece_picker_) {
+        return;
+    }
+    
+    switch (new_state) {
+        case PieceState::Missing:
+            piece_picker_->markMissing(piece.index);
+            break;
+        case PieceState::Verified:
+            piece_picker_->markHave(piece.index);
+            break;
+        case PieceState::Pending:
+        case PieceState::Downloaded:
+        case PieceState::Failed:
+            piece_picker_->markDownloading(piece.index);
+            break;
     }
 }
 
-bool DownloadController::verifyPiece(uint32_t piece_index) {
+void DownloadController::requestMoreBlocks() {
+    if (state_.load() != DownloadState::Downloading) {
+        LOG_DEBUG("requestMoreBlocks: not in Downloading state");
+        return;
+    }
+    
     std::lock_guard<std::mutex> lock(pieces_mutex_);
     
-    if (piece_index >= pieces_.size()) {
-        return false;
-    }
+    // 快的 Peer 先选，优先拿到稀有分片
+    auto peers = block_scheduler_.requestablePeers();
+    std::sort(peers.begin(), peers.end(), [this](const auto& a, const auto& b) {
+        return block_scheduler_.downloadRate(a) > block_scheduler_.downloadRate(b);
+    });
     
-    auto& piece = pieces_[piece_index];
-    if (piece.state != PieceState::Downloaded) {
-        return false;
+    size_t requested = 0;
+    for (const auto& peer : peers) {
+        requested += fillPeerPipeline(peer);
     }
     
-    TorrentMetadata meta;
+    LOG_DEBUG("requestMoreBlocks: peers=" + std::to_string(peers.size()) +
+              ", requested=" + std::to_string(requested) + " blocks" +
+              ", outstanding=" + std::to_string(block_scheduler_.totalOutstanding()) +
+              ", pending=" + std::to_string(pending_count_) +
+              ", verified=" + std::to_string(verified_count_));
+    
+    // 更新进度
     {
-        std::lock_guard<std::mutex> meta_lock(metadata_mutex_);
-        meta = metadata_;
+        std::lock_guard<std::mutex> progress_lock(progress_mutex_);
+        current_progress_.pending_pieces = pending_count_;
+        current_progress_.verifying_pieces = hash_backlog_.size() +
+            (hash_pool_ ? hash_pool_->pendingJobs() : 0);
     }
+}
+
+void DownloadController::onPieceHashed(uint32_t piece_index, const storage::HashResult& result) {
+    bool verified = false;
     
-    // 计算 SHA1
-    if (piece_index < meta.piece_hashes.size()) {
-        auto expected_hash = meta.piece_hashes[piece_index];
-        auto actual_hash = utils::sha1(piece.data.data(), piece.data.size());
+    {
+        std::lock_guard<std::mutex> lock(pieces_mutex_);
+        
+        // 作业完成释放了线程池名额，先把积压的分片提交出去
+        drainHashBacklog();
+        
+        if (piece_index >= pieces_.size()) {
+            return;
+        }
+        
+        auto& piece = pieces_[piece_index];
+        if (piece.state != PieceState::Downloaded) {
+            return;
+        }
+        
+        std::optional<utils::SHA1::Digest> expected_hash;
+        {
+            std::lock_guard<std::mutex> meta_lock(metadata_mutex_);
+            if (piece_index < metadata_.piece_hashes.size()) {
+                expected_hash = metadata_.piece_hashes[piece_index];
+            }
+        }
         
-        if (actual_hash != expected_hash) {
-            LOG_WARNING("Piece " + std::to_string(piece_index) + " verification failed");
-            piece.state = PieceState::Failed;
-            // 重置，准备重新下载
-            piece.state = PieceState::Missing;
+        if (expected_hash && (!result.success || result.digest != *expected_hash)) {
+            LOG_WARNING("Piece " + std::to_string(piece_index) + " verification failed" +
+                        (result.success ? "" : " (read back failed)"));
+            // 重置，准备重新下载（磁盘上的数据会被覆盖）
+            setPieceState(piece, PieceState::Missing);
             piece.downloaded = 0;
             std::fill(piece.blocks.begin(), piece.blocks.end(), false);
-            piece.data.clear();
-            return false;
-        }
-    }
-    
-    piece.state = PieceState::Verified;
-    bitfield_[piece_index] = true;
-    
-    // 写入文件
-    if (file_manager_) {
-        size_t offset = static_cast<size_t>(piece_index) * meta.piece_length;
-        if (!file_manager_->write(offset, piece.data)) {
-            LOG_ERROR("Failed to write piece " + std::to_string(piece_index) + " to disk");
+            std::fill(piece.requested.begin(), piece.requested.end(), false);
         } else {
-            LOG_DEBUG("Piece " + std::to_string(piece_index) + " written to disk");
-            // 写入成功后释放内存
-            piece.data.clear();
-            piece.data.shrink_to_fit();
+            setPieceState(piece, PieceState::Verified);
+            bitfield_[piece_index] = true;
+            verified = true;
+            
+            // 广播 Have
+            if (peer_manager_) {
+                peer_manager_->broadcastHave(piece_index);
+            }
+            
+            LOG_DEBUG("Piece " + std::to_string(piece_index) + " verified");
         }
     }
     
-    // 广播 Have
-    if (peer_manager_) {
-        peer_manager_->broadcastHave(piece_index);
+    if (verified) {
+        {
+            std::lock_guard<std::mutex> progress_lock(progress_mutex_);
+            current_progress_.completed_pieces++;
+        }
+        checkCompletion();
     }
     
-    LOG_DEBUG("Piece " + std::to_string(piece_index) + " verified");
-    
-    // 更新进度
+    requestMoreBlocks();
+}
+
+void DownloadController::onDiskWrite(uint64_t tag, bool success) {
+    onBlockWritten(static_cast<uint32_t>(tag), success);
+}
+
+void DownloadController::onBlockWritten(uint32_t piece_index, bool success) {
     {
-        std::lock_guard<std::mutex> progress_lock(progress_mutex_);
-        current_progress_.completed_pieces++;
+        std::lock_guard<std::mutex> lock(pieces_mutex_);
+        
+        if (piece_index >= pieces_.size()) {
+            return;
+        }
+        
+        auto& piece = pieces_[piece_index];
+        if (piece.pending_writes > 0) {
+            piece.pending_writes--;
+        }
+        
+        if (success) {
+            if (piece.state == PieceState::Downloaded && piece.pending_writes == 0) {
+                submitPieceHash(piece);
+            }
+            return;
+        }
+        
+        LOG_ERROR("Failed to write block: piece=" + std::to_string(piece_index));
+        
+        // 不知道哪些块没有落盘，整个分片重新下载
+        if (piece.state == PieceState::Pending || piece.state == PieceState::Downloaded) {
+            resetPiece(piece);
+        }
     }
     
-    return true;
+    requestMoreBlocks();
 }
 
 void DownloadController::updateProgress() {
@@ -965,21 +1601,27 @@ void DownloadController::updateProgress() {
         auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
             now - last_progress_update_).count();
         
+        // 获取 Peer 统计
+        if (peer_manager_) {
+            auto pm_stats = peer_manager_->getStatistics();
+            current_progress_.connected_peers = pm_stats.peers_connected;
+            current_progress_.total_peers = pm_stats.total_peers_known;
+            current_progress_.uploaded_size = pm_stats.total_bytes_uploaded;
+        }
+        
         if (elapsed > 0) {
             size_t bytes_diff = current_progress_.downloaded_size - last_downloaded_size_;
             current_progress_.download_speed = 
                 static_cast<double>(bytes_diff) * 1000.0 / elapsed;
+            
+            size_t uploaded_diff = current_progress_.uploaded_size - last_uploaded_size_;
+            current_progress_.upload_speed = 
+                static_cast<double>(uploaded_diff) * 1000.0 / elapsed;
         }
         
         last_progress_update_ = now;
         last_downloaded_size_ = current_progress_.downloaded_size;
-        
-        // 获取 Peer 统计
-        if (peer_manager_) {
-            auto pm_stats = peer_manager_->getStatistics();
-            current_progress_.connected_peers = pm_stats.peers_connected;
-            current_progress_.total_peers = pm_stats.total_peers_known;
-        }
+        last_uploaded_size_ = current_progress_.uploaded_size;
     }
     
     // 通知回调
@@ -987,6 +1629,15 @@ void DownloadController::updateProgress() {
         std::lock_guard<std::mutex> lock(progress_mutex_);
         progress_callback_(current_progress_);
     }
+    
+    // 做种达到上限后结束
+    if (state_.load() == DownloadState::Seeding && seedingLimitReached()) {
+        finishSeeding();
+        return;
+    }
+    
+    // 因发送队列积压而跳过的上传请求借此定期重试
+    onUploadRequest();
 }
 
 void DownloadController::checkCompletion() {
@@ -994,29 +1645,147 @@ void DownloadController::checkCompletion() {
     
     {
         std::lock_guard<std::mutex> lock(pieces_mutex_);
-        all_verified = std::all_of(pieces_.begin(), pieces_.end(), 
-                                    [](const PieceInfo& p) {
-                                        return p.state == PieceState::Verified;
-                                    });
+        all_verified = verified_count_ == pieces_.size();
     }
     
-    if (all_verified) {
-        LOG_INFO("All pieces verified, download complete!");
-        setState(DownloadState::Completed);
-        
-        // 停止组件
-        progress_timer_.cancel();
-        peer_search_timer_.cancel();
-        
-        if (peer_manager_) {
-            peer_manager_->stop();
+    auto state = state_.load();
+    if (!all_verified || state == DownloadState::Seeding || state == DownloadState::Completed) {
+        return;
+    }
+    
+    LOG_INFO("All pieces verified, download complete!");
+    
+    block_timeout_timer_.cancel();
+    download_stall_timer_.cancel();
+    
+    bool seed = config_.enable_seeding && peer_manager_ && peer_manager_->isRunning();
+    if (seed) {
+        // 做种：保留 PeerManager 和进度定时器，不再请求数据
+        seeding_start_ = std::chrono::steady_clock::now();
+        peer_manager_->setSeeding(true);
+        setState(DownloadState::Seeding);
+        LOG_INFO("Seeding until ratio " +
+                 (config_.seed_ratio_limit > 0 ? std::to_string(config_.seed_ratio_limit) : "unlimited") +
+                 " or " +
+                 (config_.seed_time_limit.count() > 0
+                      ? std::to_string(config_.seed_time_limit.count()) + "s" : "unlimited time"));
+    }
+    
+    // 下载本身已完成，做种期间也先通知
+    if (completed_callback_) {
+        completed_callback_(true, "");
+    }
+    
+    if (!seed) {
+        finishSeeding();
+    }
+}
+
+void DownloadController::onUploadRequest() {
+    if (upload_scheduled_) {
+        return;
+    }
+    upload_scheduled_ = true;
+    
+    // 通常在 Peer 的消息处理中调用：同一批到达的请求合并到下一轮事件一起处理
+    auto self = shared_from_this();
+    asio::post(io_context_, [self]() {
+        self->serveUploads();
+    });
+}
+
+void DownloadController::serveUploads() {
+    // 每轮最多处理的请求数，避免一次提交过多读盘、长时间占用网络线程
+    static constexpr size_t kMaxUploadBatch = 64;
+    static constexpr auto kUploadRetryDelay = std::chrono::milliseconds(50);
+    
+    upload_scheduled_ = false;
+    
+    auto state = state_.load();
+    if ((state != DownloadState::Downloading && state != DownloadState::Seeding) ||
+        !peer_manager_ || !read_cache_) {
+        return;
+    }
+    
+    // 限速由各连接的上传限速器完成，这里只受每个 Peer 的发送积压约束
+    auto requests = peer_manager_->takeUploadRequests(kMaxUploadBatch);
+    
+    for (const auto& request : requests) {
+        const auto& block = request.block;
+        {
+            std::lock_guard<std::mutex> lock(pieces_mutex_);
+            if (block.piece_index >= bitfield_.size() || !bitfield_[block.piece_index]) {
+                LOG_DEBUG("Peer " + request.endpoint.toString() + " requested missing piece " +
+                          std::to_string(block.piece_index));
+                continue;
+            }
         }
         
-        // 通知完成
-        if (completed_callback_) {
-            completed_callback_(true, "");
+        // 命中时立即发送；未命中时读盘完成后在 io_context 线程上发送
+        std::weak_ptr<DownloadController> weak = shared_from_this();
+        read_cache_->asyncRead(block.piece_index, block.begin, block.length,
+            [weak, endpoint = request.endpoint, block](utils::BufferHandle data) {
+                auto self = weak.lock();
+                if (!self || !self->peer_manager_) {
+                    return;
+                }
+                if (!data) {
+                    LOG_WARNING("Failed to read block " + std::to_string(block.piece_index) + ":" +
+                                std::to_string(block.begin) + " for upload");
+                    return;
+                }
+                self->peer_manager_->sendBlock(endpoint, block.piece_index, block.begin, std::move(data));
+            });
+    }
+    
+    // 本轮取满，稍后继续；否则等下一个请求回调（或进度定时器）
+    if (requests.size() == kMaxUploadBatch) {
+        upload_scheduled_ = true;
+        auto self = shared_from_this();
+        upload_timer_.expires_after(kUploadRetryDelay);
+        upload_timer_.async_wait([self](const asio::error_code& ec) {
+            if (ec) {
+                return;
+            }
+            self->serveUploads();
+        });
+    }
+}
+
+bool DownloadController::seedingLimitReached() const {
+    if (config_.seed_time_limit.count() > 0 &&
+        std::chrono::steady_clock::now() - seeding_start_ >= config_.seed_time_limit) {
+        return true;
+    }
+    
+    if (config_.seed_ratio_limit > 0) {
+        std::lock_guard<std::mutex> lock(progress_mutex_);
+        if (current_progress_.total_size > 0 &&
+            static_cast<double>(current_progress_.uploaded_size) >=
+                config_.seed_ratio_limit * static_cast<double>(current_progress_.total_size)) {
+            return true;
         }
     }
+    
+    return false;
+}
+
+void DownloadController::finishSeeding() {
+    if (state_.load() == DownloadState::Seeding) {
+        LOG_INFO("Seeding limit reached, stopping");
+    }
+    setState(DownloadState::Completed);
+    
+    // 停止组件
+    progress_timer_.cancel();
+    block_timeout_timer_.cancel();
+    peer_search_timer_.cancel();
+    upload_timer_.cancel();
+    
+    stopListening();
+    if (peer_manager_) {
+        peer_manager_->stop();
+    }
 }
 
 void DownloadController::setState(DownloadState new_state) {
@@ -1040,6 +1809,7 @@ void DownloadController::fail(const std::string& error) {
     progress_timer_.cancel();
     peer_search_timer_.cancel();
     metadata_timeout_timer_.cancel();
+    block_timeout_timer_.cancel();
     
     if (peer_manager_) {
         peer_manager_->stop();
@@ -1047,6 +1817,12 @@ void DownloadController::fail(const std::string& error) {
     if (dht_client_) {
         dht_client_->stop();
     }
+    if (hash_pool_) {
+        hash_pool_->stop();
+    }
+    if (disk_io_) {
+        disk_io_->stop();
+    }
     
     setState(DownloadState::Failed);
     
@@ -1060,9 +1836,13 @@ void DownloadController::startProgressTimer() {
     
     progress_timer_.expires_after(std::chrono::seconds(1));
     progress_timer_.async_wait([self](const asio::error_code& ec) {
-        if (!ec && self->state_.load() == DownloadState::Downloading) {
+        auto state = self->state_.load();
+        if (!ec && (state == DownloadState::Downloading || state == DownloadState::Seeding)) {
             self->updateProgress();
-            self->startProgressTimer();  // 重新启动
+            // 做种达到上限时 updateProgress 会结束任务
+            if (self->state_.load() != DownloadState::Completed) {
+                self->startProgressTimer();  // 重新启动
+            }
         }
     });
 }
@@ -1075,7 +1855,8 @@ void DownloadController::startPeerSearchTimer() {
         if (!ec) {
             auto state = self->state_.load();
             if (state == DownloadState::ResolvingMetadata || 
-                state == DownloadState::Downloading) {
+                state == DownloadState::Downloading ||
+                state == DownloadState::Seeding) {
                 self->findPeers();
                 self->startPeerSearchTimer();  // 重新启动
             }
@@ -1135,9 +1916,7 @@ void DownloadController::startDownloadStallTimer() {
             } else {
                 LOG_WARNING("No download progress for " + std::to_string(stall_duration.count()) + 
                             " seconds, will retry...");
-                // 重置超时的 pending pieces
-                self->resetTimedOutPieces();
-                // 尝试请求更多数据
+                // 尝试请求更多数据（超时的块已由块超时定时器释放）
                 self->requestMoreBlocks();
             }
         }
@@ -1147,30 +1926,48 @@ void DownloadController::startDownloadStallTimer() {
     });
 }
 
-void DownloadController::resetTimedOutPieces() {
-    std::lock_guard<std::mutex> lock(pieces_mutex_);
+void DownloadController::startBlockTimeoutTimer() {
+    auto self = shared_from_this();
     
-    auto now = std::chrono::steady_clock::now();
-    const auto timeout = std::chrono::seconds(15);  // 15秒超时（缩短以更快重试）
-    size_t reset_count = 0;
+    block_timeout_timer_.expires_after(std::chrono::seconds(1));
+    block_timeout_timer_.async_wait([self](const asio::error_code& ec) {
+        if (!ec && self->state_.load() == DownloadState::Downloading) {
+            self->checkBlockTimeouts();
+            self->startBlockTimeoutTimer();  // 重新启动
+        }
+    });
+}
+
+void DownloadController::checkBlockTimeouts() {
+    size_t timed_out = 0;
+    bool drained = false;
     
-    for (auto& piece : pieces_) {
-        if (piece.state == PieceState::Pending) {
-            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-                now - piece.request_time);
-            
-            if (elapsed >= timeout) {
-                // 重置为 Missing 状态，允许重新请求
-                piece.state = PieceState::Missing;
-                reset_count++;
-                LOG_DEBUG("Reset timed out piece " + std::to_string(piece.index) + 
-                          " after " + std::to_string(elapsed.count()) + " seconds");
+    {
+        std::lock_guard<std::mutex> lock(pieces_mutex_);
+        
+        // 兜底补交哈希积压：积压不清空就不会开始新分片，不能只依赖作业完成时的补交
+        bool had_backlog = !hash_backlog_.empty();
+        drainHashBacklog();
+        drained = had_backlog && hash_backlog_.empty();
+        
+        auto expired = block_scheduler_.collectTimedOut(std::chrono::steady_clock::now());
+        if (!expired.empty()) {
+            std::vector<protocols::BlockInfo> blocks;
+            blocks.reserve(expired.size());
+            for (const auto& item : expired) {
+                blocks.push_back(item.block);
             }
+            releaseBlocks(blocks);
+            timed_out = blocks.size();
         }
     }
     
-    if (reset_count > 0) {
-        LOG_INFO("Reset " + std::to_string(reset_count) + " timed out pieces");
+    if (timed_out > 0) {
+        LOG_INFO("Reassigning " + std::to_string(timed_out) + " timed out blocks");
+    }
+    
+    if (timed_out > 0 || drained) {
+        requestMoreBlocks();
     }
 }
 
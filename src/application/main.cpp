@@ -8,6 +8,8 @@
 #include <atomic>
 #include <csignal>
 #include <iomanip>
+#include <filesystem>
+#include <cstdlib>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -33,6 +35,27 @@ void setupConsole() {
 #endif
 }
 
+// DHT state file (node id, routing table, token secrets) in the per-user
+// state directory rather than the download directory; empty = don't persist
+std::string dhtStatePath() {
+#ifdef _WIN32
+    const char* base = std::getenv("LOCALAPPDATA");
+    if (base && *base) {
+        return (std::filesystem::path(base) / "MagnetDownload" / "dht_state").string();
+    }
+#else
+    const char* state = std::getenv("XDG_STATE_HOME");
+    if (state && *state) {
+        return (std::filesystem::path(state) / "magnetdownload" / "dht_state").string();
+    }
+    const char* home = std::getenv("HOME");
+    if (home && *home) {
+        return (std::filesystem::path(home) / ".local" / "state" / "magnetdownload" / "dht_state").string();
+    }
+#endif
+    return {};
+}
+
 // Global variables
 std::atomic<bool> g_running{true};
 std::shared_ptr<application::DownloadController> g_controller;
@@ -60,6 +83,10 @@ void printHelp(const char* program) {
 |  Options:                                                    |
 |    -o, --output <path>    Save path (default: current dir)   |
 |    -c, --connections <n>  Max connections (default: 200)     |
+|    -s, --seed             Seed after download completes      |
+|    --seed-ratio <r>       Stop seeding at ratio (default: 1) |
+|    --seed-time <sec>      Stop seeding after (default: 1800) |
+|                           (0 = no limit)                     |
 |    -v, --verbose          Verbose output                     |
 |    -h, --help             Show help                          |
 |    --version              Show version information           |
@@ -163,6 +190,9 @@ void printState(application::DownloadState state) {
         case application::DownloadState::Verifying:
             std::cout << "Verifying";
             break;
+        case application::DownloadState::Seeding:
+            std::cout << "Seeding";
+            break;
         case application::DownloadState::Completed:
             std::cout << "Download completed!";
             break;
@@ -194,6 +224,9 @@ int main(int argc, char* argv[]) {
     std::string output_path = ".";
     size_t max_connections = 100;
     bool verbose = false;
+    bool seed = false;
+    double seed_ratio = 1.0;
+    long seed_time = 1800;
     
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
@@ -212,6 +245,16 @@ int main(int argc, char* argv[]) {
             if (i + 1 < argc) {
                 max_connections = std::stoul(argv[++i]);
             }
+        } else if (arg == "-s" || arg == "--seed") {
+            seed = true;
+        } else if (arg == "--seed-ratio") {
+            if (i + 1 < argc) {
+                seed_ratio = std::stod(argv[++i]);
+            }
+        } else if (arg == "--seed-time") {
+            if (i + 1 < argc) {
+                seed_time = std::stol(argv[++i]);
+            }
         } else if (arg == "-v" || arg == "--verbose") {
             verbose = true;
         } else if (arg[0] != '-' && magnet_uri.empty()) {
@@ -244,6 +287,11 @@ int main(int argc, char* argv[]) {
     std::cout << "[>] Magnet: " << magnet_uri.substr(0, 60) << "..." << std::endl;
     std::cout << "[>] Output: " << output_path << std::endl;
     std::cout << "[>] Max connections: " << max_connections << std::endl;
+    if (seed) {
+        std::cout << "[>] Seeding: ratio " << (seed_ratio > 0 ? std::to_string(seed_ratio) : "unlimited")
+                  << ", time " << (seed_time > 0 ? std::to_string(seed_time) + "s" : "unlimited")
+                  << std::endl;
+    }
     std::cout << std::endl;
     
     try {
@@ -289,6 +337,10 @@ int main(int argc, char* argv[]) {
         config.save_path = output_path;
         config.max_connections = max_connections;
         config.metadata_timeout = std::chrono::seconds(120);  // 增加到 120 秒超时
+        config.enable_seeding = seed;
+        config.seed_ratio_limit = seed_ratio;
+        config.seed_time_limit = std::chrono::seconds(seed_time);
+        config.dht_state_file = dhtStatePath();
         
         // Start download
         std::cout << "[*] Starting download..." << std::endl;
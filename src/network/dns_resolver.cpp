@@ -0,0 +1,205 @@
+#include "magnet/network/dns_resolver.h"
+#include "magnet/utils/logger.h"
+
+#include <algorithm>
+#include <map>
+
+namespace magnet::network {
+
+// 日志宏
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(std::string("[DnsResolver] ") + msg)
+#define LOG_WARN(msg) magnet::utils::Logger::instance().warn(std::string("[DnsResolver] ") + msg)
+
+// ============================================================================
+// 共用实例
+// ============================================================================
+
+std::shared_ptr<DnsResolver> DnsResolver::shared(asio::io_context& io_context) {
+    static std::mutex registry_mutex;
+    static std::map<asio::io_context*, std::weak_ptr<DnsResolver>> registry;
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    // 顺便清理已释放的实例（io_context 地址可能被复用）
+    for (auto it = registry.begin(); it != registry.end();) {
+        it = it->second.expired() ? registry.erase(it) : std::next(it);
+    }
+
+    auto& slot = registry[&io_context];
+    auto resolver = slot.lock();
+    if (!resolver) {
+        resolver = std::make_shared<DnsResolver>(io_context);
+        slot = resolver;
+    }
+    return resolver;
+}
+
+// ============================================================================
+// 构造
+// ============================================================================
+
+DnsResolver::DnsResolver(asio::io_context& io_context, DnsResolverConfig config)
+    : io_context_(io_context)
+    , config_(config)
+{
+}
+
+// ============================================================================
+// 解析
+// ============================================================================
+
+void DnsResolver::resolve(const std::string& host, ResolveCallback callback) {
+    // IP 字面量无需查询
+    asio::error_code parse_ec;
+    auto literal = asio::ip::make_address(host, parse_ec);
+    if (!parse_ec) {
+        asio::post(io_context_, [callback = std::move(callback), literal]() {
+            callback({}, Addresses{literal});
+        });
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto cached = cache_.find(host);
+    if (cached != cache_.end()) {
+        if (cached->second.expires > std::chrono::steady_clock::now()) {
+            statistics_.hits++;
+            asio::post(io_context_, [callback = std::move(callback), entry = cached->second]() {
+                callback(entry.error, entry.addresses);
+            });
+            return;
+        }
+        cache_.erase(cached);
+    }
+
+    auto pending = lookups_.find(host);
+    if (pending != lookups_.end()) {
+        statistics_.coalesced++;
+        pending->second.callbacks.push_back(std::move(callback));
+        return;
+    }
+
+    statistics_.lookups++;
+    LOG_DEBUG("Resolving " + host);
+
+    Lookup& lookup = lookups_[host];
+    lookup.resolver = std::make_shared<asio::ip::tcp::resolver>(io_context_);
+    lookup.callbacks.push_back(std::move(callback));
+
+    // asio 在内部线程中执行 getaddrinfo，完成处理在 io_context 线程中执行
+    auto self = shared_from_this();
+    lookup.resolver->async_resolve(host, "",
+        [self, host, resolver = lookup.resolver](const asio::error_code& ec,
+                                                 asio::ip::tcp::resolver::results_type results) {
+            self->handleResolve(host, ec, results);
+        });
+}
+
+void DnsResolver::handleResolve(const std::string& host, const asio::error_code& ec,
+                                const asio::ip::tcp::resolver::results_type& results) {
+    CacheEntry entry;
+    entry.error = ec;
+    if (!ec) {
+        for (const auto& result : results) {
+            auto address = result.endpoint().address();
+            if (std::find(entry.addresses.begin(), entry.addresses.end(), address) ==
+                entry.addresses.end()) {
+                entry.addresses.push_back(address);
+            }
+        }
+        if (entry.addresses.empty()) {
+            entry.error = asio::error::host_not_found;
+        }
+    }
+
+    std::vector<ResolveCallback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto pending = lookups_.find(host);
+        if (pending != lookups_.end()) {
+            callbacks = std::move(pending->second.callbacks);
+            lookups_.erase(pending);
+        }
+
+        if (entry.error) {
+            statistics_.failures++;
+        }
+        entry.expires = std::chrono::steady_clock::now() +
+                         (entry.error ? config_.negative_ttl : config_.ttl);
+        store(host, entry);
+    }
+
+    if (entry.error) {
+        LOG_WARN("Failed to resolve " + host + ": " + entry.error.message());
+    } else {
+        LOG_DEBUG("Resolved " + host + " to " + std::to_string(entry.addresses.size()) +
+                  " address(es)");
+    }
+
+    for (auto& callback : callbacks) {
+        callback(entry.error, entry.addresses);
+    }
+}
+
+void DnsResolver::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cache_.clear();
+}
+
+DnsResolverStatistics DnsResolver::getStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto stats = statistics_;
+    stats.cached_entries = cache_.size();
+    return stats;
+}
+
+// ============================================================================
+// 内部方法
+// ============================================================================
+
+void DnsResolver::store(const std::string& host, CacheEntry entry) {
+    if (config_.max_entries == 0) {
+        return;
+    }
+
+    if (cache_.size() >= config_.max_entries && cache_.find(host) == cache_.end()) {
+        auto now = std::chrono::steady_clock::now();
+        for (auto it = cache_.begin(); it != cache_.end();) {
+            it = it->second.expires <= now ? cache_.erase(it) : std::next(it);
+        }
+        if (cache_.size() >= config_.max_entries) {
+            auto oldest = std::min_element(cache_.begin(), cache_.end(),
+                [](const auto& a, const auto& b) { return a.second.expires < b.second.expires; });
+            cache_.erase(oldest);
+        }
+    }
+
+    cache_[host] = std::move(entry);
+}
+
+// ============================================================================
+// 地址排序
+// ============================================================================
+
+DnsResolver::Addresses interleaveAddressFamilies(const DnsResolver::Addresses& addresses) {
+    DnsResolver::Addresses v6;
+    DnsResolver::Addresses v4;
+    for (const auto& address : addresses) {
+        (address.is_v6() ? v6 : v4).push_back(address);
+    }
+
+    DnsResolver::Addresses ordered;
+    ordered.reserve(addresses.size());
+    for (size_t i = 0; i < std::max(v6.size(), v4.size()); ++i) {
+        if (i < v6.size()) {
+            ordered.push_back(v6[i]);
+        }
+        if (i < v4.size()) {
+            ordered.push_back(v4[i]);
+        }
+    }
+    return ordered;
+}
+
+} // namespace magnet::network
@@ -0,0 +1,239 @@
+#include "magnet/network/rate_limiter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace magnet::network {
+
+// ============================================================================
+// 构造
+// ============================================================================
+
+RateLimiter::RateLimiter(asio::io_context& io_context,
+                         size_t bytes_per_second,
+                         std::shared_ptr<RateLimiter> parent)
+    : parent_(std::move(parent))
+    , timer_(io_context)
+    , rate_(bytes_per_second)
+    , last_refill_(std::chrono::steady_clock::now())
+{
+}
+
+// ============================================================================
+// 速率
+// ============================================================================
+
+void RateLimiter::setRate(size_t bytes_per_second) {
+    std::vector<std::shared_ptr<RateLimiter>> watchers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        refill(std::chrono::steady_clock::now());
+        rate_ = bytes_per_second;
+        if (rate_ == 0) {
+            tokens_ = 0;
+        }
+        
+        // 下级的定时器是按旧的链路延迟设置的，同样要重新计算
+        watchers.reserve(watchers_.size());
+        for (const auto& weak : watchers_) {
+            if (auto watcher = weak.lock()) {
+                watchers.push_back(std::move(watcher));
+            }
+        }
+    }
+
+    rescheduleWaiters();
+    for (const auto& watcher : watchers) {
+        watcher->rescheduleWaiters();
+    }
+}
+
+size_t RateLimiter::rate() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rate_;
+}
+
+// ============================================================================
+// 令牌
+// ============================================================================
+
+bool RateLimiter::ready() {
+    return chainDelay().count() == 0;
+}
+
+size_t RateLimiter::quantum() const {
+    size_t result = std::numeric_limits<size_t>::max();
+    for (const RateLimiter* level = this; level; level = level->parent_.get()) {
+        std::lock_guard<std::mutex> lock(level->mutex_);
+        result = std::min(result, quantumForRate(level->rate_));
+    }
+    return result;
+}
+
+void RateLimiter::consume(size_t bytes) {
+    auto now = std::chrono::steady_clock::now();
+    for (RateLimiter* level = this; level; level = level->parent_.get()) {
+        std::lock_guard<std::mutex> lock(level->mutex_);
+        level->refill(now);
+        if (level->rate_ > 0) {
+            level->tokens_ -= static_cast<double>(bytes);
+        }
+        auto& stats = level->statistics_;
+        if (stats.bytes_consumed == 0) {
+            stats.first_consume = now;
+        }
+        stats.bytes_consumed += bytes;
+        stats.last_consume = now;
+        stats.last_consume_bytes = bytes;
+    }
+}
+
+void RateLimiter::wait(WaitCallback callback) {
+    watchParents();
+    
+    bool arm = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        waiters_.push_back(std::move(callback));
+        statistics_.waits++;
+        if (!timer_armed_) {
+            timer_armed_ = true;
+            arm = true;
+        }
+    }
+
+    if (arm) {
+        armTimer(chainDelay());
+    }
+}
+
+void RateLimiter::cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    waiters_.clear();
+    timer_armed_ = false;
+    timer_.cancel();
+}
+
+RateLimiterStatistics RateLimiter::getStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+}
+
+// ============================================================================
+// 内部方法
+// ============================================================================
+
+void RateLimiter::refill(std::chrono::steady_clock::time_point now) {
+    if (rate_ == 0) {
+        last_refill_ = now;
+        return;
+    }
+
+    double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+    double burst = std::max(static_cast<double>(rate_) *
+                                std::chrono::duration<double>(kBurstWindow).count(),
+                            static_cast<double>(quantumForRate(rate_)));
+    tokens_ = std::min(burst, tokens_ + elapsed * static_cast<double>(rate_));
+    last_refill_ = now;
+}
+
+std::chrono::nanoseconds RateLimiter::levelDelay(std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    refill(now);
+    if (rate_ == 0 || tokens_ >= 0) {
+        return std::chrono::nanoseconds{0};
+    }
+    double seconds = -tokens_ / static_cast<double>(rate_);
+    return std::chrono::nanoseconds(static_cast<int64_t>(std::ceil(seconds * 1e9)));
+}
+
+std::chrono::nanoseconds RateLimiter::chainDelay() {
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::nanoseconds delay{0};
+    for (RateLimiter* level = this; level; level = level->parent_.get()) {
+        delay = std::max(delay, level->levelDelay(now));
+    }
+    return delay;
+}
+
+void RateLimiter::wakeWaiters() {
+    while (true) {
+        auto delay = chainDelay();
+        WaitCallback callback;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (waiters_.empty()) {
+                timer_armed_ = false;
+                return;
+            }
+            if (delay.count() > 0) {
+                break;  // 令牌又被用完（前一个等待者已传输），继续等
+            }
+            callback = std::move(waiters_.front());
+            waiters_.pop_front();
+        }
+
+        // 回调中通常会 consume()，下一轮重新检查令牌
+        callback();
+    }
+
+    armTimer(chainDelay());
+}
+
+void RateLimiter::armTimer(std::chrono::nanoseconds delay) {
+    std::weak_ptr<RateLimiter> weak = shared_from_this();
+    timer_.expires_after(delay);
+    timer_.async_wait([weak](const asio::error_code& ec) {
+        if (ec) {
+            return;
+        }
+        if (auto self = weak.lock()) {
+            self->wakeWaiters();
+        }
+    });
+}
+
+void RateLimiter::rescheduleWaiters() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (waiters_.empty()) {
+            return;
+        }
+        timer_armed_ = true;
+    }
+
+    // 重新设置定时器会取消原来的等待，按新速率立即重新计算
+    armTimer(std::chrono::nanoseconds{0});
+}
+
+void RateLimiter::watchParents() {
+    if (watching_parents_ || !parent_) {
+        return;
+    }
+    watching_parents_ = true;
+
+    std::weak_ptr<RateLimiter> self = shared_from_this();
+    for (RateLimiter* level = parent_.get(); level; level = level->parent_.get()) {
+        std::lock_guard<std::mutex> lock(level->mutex_);
+        // Peer 级限速器随连接创建和销毁，登记时顺便清理已失效的
+        auto& watchers = level->watchers_;
+        watchers.erase(std::remove_if(watchers.begin(), watchers.end(),
+                                      [](const std::weak_ptr<RateLimiter>& weak) {
+                                          return weak.expired();
+                                      }),
+                       watchers.end());
+        watchers.push_back(self);
+    }
+}
+
+size_t RateLimiter::quantumForRate(size_t bytes_per_second) {
+    if (bytes_per_second == 0) {
+        return std::numeric_limits<size_t>::max();
+    }
+    auto window = static_cast<size_t>(static_cast<double>(bytes_per_second) *
+                                      std::chrono::duration<double>(kQuantumWindow).count());
+    return std::clamp(window, kMinQuantum, kMaxQuantum);
+}
+
+} // namespace magnet::network
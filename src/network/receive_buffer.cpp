@@ -0,0 +1,71 @@
+#include "magnet/network/receive_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace magnet::network {
+
+ReceiveBuffer::ReceiveBuffer(size_t initial_capacity)
+    : buffer_(new uint8_t[std::max<size_t>(1, initial_capacity)])
+    , capacity_(std::max<size_t>(1, initial_capacity))
+{
+}
+
+uint8_t* ReceiveBuffer::prepare(size_t min_space) {
+    if (writable() >= min_space) {
+        return buffer_.get() + write_pos_;
+    }
+
+    size_t pending = size();
+
+    // 先把未处理的数据搬到开头，腾出已消费的空间
+    if (read_pos_ > 0) {
+        if (pending > 0) {
+            std::memmove(buffer_.get(), buffer_.get() + read_pos_, pending);
+        }
+        read_pos_ = 0;
+        write_pos_ = pending;
+    }
+
+    // 仍不够则按倍数扩容
+    if (writable() < min_space) {
+        size_t new_capacity = std::max(capacity_ * 2, pending + min_space);
+        std::unique_ptr<uint8_t[]> grown(new uint8_t[new_capacity]);
+        if (pending > 0) {
+            std::memcpy(grown.get(), buffer_.get(), pending);
+        }
+        buffer_ = std::move(grown);
+        capacity_ = new_capacity;
+    }
+
+    return buffer_.get() + write_pos_;
+}
+
+void ReceiveBuffer::commit(size_t length) {
+    write_pos_ += std::min(length, writable());
+}
+
+void ReceiveBuffer::consume(size_t length) {
+    read_pos_ += std::min(length, size());
+
+    // 全部处理完时游标归零，下次写入不需要搬移
+    if (read_pos_ == write_pos_) {
+        read_pos_ = 0;
+        write_pos_ = 0;
+    }
+}
+
+void ReceiveBuffer::append(const uint8_t* data, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    std::memcpy(prepare(length), data, length);
+    commit(length);
+}
+
+void ReceiveBuffer::clear() {
+    read_pos_ = 0;
+    write_pos_ = 0;
+}
+
+} // namespace magnet::network
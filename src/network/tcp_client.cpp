@@ -1,14 +1,59 @@
 #include "magnet/network/tcp_client.h"
 #include "magnet/utils/logger.h"
 
+#include <algorithm>
+#include <limits>
+
 namespace magnet::network {
 
 // 日志宏
-#define LOG_DEBUG(msg) magnet::utils::Logger::instance().debug(msg)
+// 调试日志先判断级别：热路径上每个块都会调用，避免无谓地构造字符串
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(msg)
 #define LOG_INFO(msg) magnet::utils::Logger::instance().info(msg)
 #define LOG_WARNING(msg) magnet::utils::Logger::instance().warn(msg)
 #define LOG_ERROR(msg) magnet::utils::Logger::instance().error(msg)
 
+namespace {
+
+/**
+ * @brief 引用 write_buffers_ 的缓冲序列
+ *
+ * async_write 会按值保存缓冲序列，直接传 std::vector 每次都要拷贝一份
+ */
+struct BufferSequenceRef {
+    using value_type = asio::const_buffer;
+    using const_iterator = const asio::const_buffer*;
+
+    const asio::const_buffer* first;
+    size_t count;
+
+    const_iterator begin() const { return first; }
+    const_iterator end() const { return first + count; }
+};
+
+} // namespace
+
+/**
+ * @brief 一次 connect() 的解析与连接竞速状态
+ *
+ * 所有异步处理都持有它的 shared_ptr；每个尝试使用独立的 socket，
+ * 胜出的 socket 移入 socket_
+ */
+struct TcpClient::ConnectRace {
+    explicit ConnectRace(asio::io_context& io_context) : attempt_timer(io_context) {}
+    
+    uint16_t port{0};
+    ConnectCallback callback;
+    std::vector<asio::ip::tcp::endpoint> endpoints;         // 按 RFC 8305 排好序的候选地址
+    size_t next{0};                                         // 下一个要尝试的候选
+    std::vector<std::shared_ptr<asio::ip::tcp::socket>> sockets;
+    size_t in_flight{0};                                    // 进行中的尝试数
+    asio::steady_timer attempt_timer;                       // 错开后续尝试
+    asio::error_code last_error;                            // 最近一次尝试失败的原因
+    asio::error_code abort_error;                           // 超时或 close() 中止
+    bool finished{false};
+};
+
 // ============================================================================
 // 构造函数和析构函数
 // ============================================================================
@@ -17,11 +62,40 @@ TcpClient::TcpClient(asio::io_context& io_context)
     : io_context_(io_context)
     , socket_(io_context)
     , connect_timer_(io_context)
-    , receive_buffer_(kReceiveBufferSize)
 {
     LOG_DEBUG("TcpClient created");
 }
 
+TcpClient::TcpClient(asio::io_context& io_context, asio::ip::tcp::socket socket)
+    : io_context_(io_context)
+    , socket_(std::move(socket))
+    , connect_timer_(io_context)
+{
+    asio::error_code ec;
+    auto remote = socket_.remote_endpoint(ec);
+    if (ec) {
+        // 对端在接管前已断开，保持 Disconnected，由调用方丢弃
+        LOG_WARNING("Accepted socket is no longer connected: " + ec.message());
+        socket_.close(ec);
+        return;
+    }
+    
+    // 双栈监听接受的 IPv4 连接以 v4 映射地址出现，还原为 IPv4，与出站连接的地址一致
+    auto address = remote.address();
+    if (address.is_v6() && address.to_v6().is_v4_mapped()) {
+        address = asio::ip::make_address_v4(asio::ip::v4_mapped, address.to_v6());
+    }
+    remote_endpoint_ = TcpEndpoint{address.to_string(), remote.port()};
+    state_.store(TcpConnectionState::Connected);
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        statistics_.connect_time = std::chrono::steady_clock::now();
+    }
+    
+    configureSocket();
+    LOG_DEBUG("TcpClient adopted connection from " + remote_endpoint_.toString());
+}
+
 TcpClient::~TcpClient() {
     close();
     LOG_DEBUG("TcpClient destroyed");
@@ -56,51 +130,170 @@ void TcpClient::connect(const TcpEndpoint& endpoint,
     
     LOG_INFO("Connecting to " + endpoint.ip + ":" + std::to_string(endpoint.port));
     
-    // 解析端点
-    asio::ip::tcp::endpoint resolved;
-    try {
-        resolved = resolveEndpoint(endpoint);
-    } catch (const std::exception& e) {
-        LOG_ERROR("Failed to resolve endpoint: " + std::string(e.what()));
-        state_.store(TcpConnectionState::Disconnected);
-        {
-            std::lock_guard<std::mutex> lock(stats_mutex_);
-            statistics_.connect_failures++;
-        }
-        if (callback) {
-            asio::post(io_context_, [callback]() {
-                callback(asio::error::host_not_found);
-            });
-        }
-        return;
-    }
+    auto self = shared_from_this();
+    auto race = std::make_shared<ConnectRace>(io_context_);
+    race->port = endpoint.port;
+    race->callback = std::move(callback);
+    race_ = race;
     
-    // 设置超时
+    // 设置超时（覆盖解析和全部连接尝试）
     if (timeout.count() > 0) {
-        auto self = shared_from_this();
         connect_timer_.expires_after(timeout);
-        connect_timer_.async_wait([self](const asio::error_code& ec) {
-            if (!ec) {
-                // 超时，取消连接
-                LOG_WARNING("Connection timeout");
-                asio::error_code ignored;
-                self->socket_.cancel(ignored);
+        connect_timer_.async_wait([self, race](const asio::error_code& ec) {
+            if (ec || race->finished) {
+                return;
+            }
+            LOG_WARNING("Connection timeout");
+            self->abortRace(race, asio::error::timed_out);
+            if (race->in_flight == 0) {
+                // 还在解析，没有尝试可等
+                self->finishRace(race, asio::error::timed_out);
             }
         });
     }
     
-    // 执行连接
-    doConnect(resolved, std::move(callback));
+    // IP 字面量直接连接
+    asio::error_code parse_ec;
+    auto address = asio::ip::make_address(endpoint.ip, parse_ec);
+    if (!parse_ec) {
+        startRace(race, {address});
+        return;
+    }
+    
+    // 异步解析，不阻塞 io_context 线程
+    DnsResolver::shared(io_context_)->resolve(endpoint.ip,
+        [self, race](const asio::error_code& ec, const DnsResolver::Addresses& addresses) {
+            if (race->finished) {
+                return;
+            }
+            if (race->abort_error) {
+                self->finishRace(race, race->abort_error);
+                return;
+            }
+            if (ec) {
+                LOG_ERROR("Failed to resolve endpoint: " + ec.message());
+                self->finishRace(race, asio::error::host_not_found);
+                return;
+            }
+            self->startRace(race, interleaveAddressFamilies(addresses));
+        });
+}
+
+// ============================================================================
+// 连接竞速（RFC 8305）
+// ============================================================================
+
+void TcpClient::startRace(const std::shared_ptr<ConnectRace>& race,
+                          const std::vector<asio::ip::address>& addresses) {
+    for (const auto& address : addresses) {
+        race->endpoints.emplace_back(address, race->port);
+    }
+    if (race->endpoints.size() > 1) {
+        LOG_DEBUG("Racing " + std::to_string(race->endpoints.size()) + " addresses for " +
+                  remote_endpoint_.toString());
+    }
+    startAttempt(race);
 }
 
-void TcpClient::doConnect(const asio::ip::tcp::endpoint& endpoint, ConnectCallback callback) {
+void TcpClient::startAttempt(const std::shared_ptr<ConnectRace>& race) {
+    if (race->finished || race->abort_error || race->next >= race->endpoints.size()) {
+        return;
+    }
+    
     auto self = shared_from_this();
+    const auto& target = race->endpoints[race->next++];
+    auto socket = std::make_shared<asio::ip::tcp::socket>(io_context_);
+    race->sockets.push_back(socket);
+    race->in_flight++;
+    
+    socket->async_connect(target, [self, race, socket](const asio::error_code& ec) {
+        self->handleAttempt(race, socket, ec);
+    });
+    
+    // 当前尝试迟迟没有结果时，错开一段时间发起下一个
+    if (race->next < race->endpoints.size()) {
+        size_t armed_for = race->next;
+        race->attempt_timer.expires_after(kConnectionAttemptDelay);
+        race->attempt_timer.async_wait([self, race, armed_for](const asio::error_code& ec) {
+            // 失败触发的提前尝试已经用掉这个位置时不再重复发起
+            if (!ec && race->next == armed_for) {
+                self->startAttempt(race);
+            }
+        });
+    }
+}
+
+void TcpClient::handleAttempt(const std::shared_ptr<ConnectRace>& race,
+                              const std::shared_ptr<asio::ip::tcp::socket>& socket,
+                              const asio::error_code& ec) {
+    race->in_flight--;
+    if (race->finished) {
+        return;
+    }
     
-    socket_.async_connect(endpoint, 
-        [self, callback = std::move(callback)](const asio::error_code& ec) {
-            self->handleConnect(ec, callback);
+    if (!ec && !race->abort_error) {
+        // 胜出：关闭其余尝试，接管这个 socket
+        race->attempt_timer.cancel();
+        asio::error_code ignored;
+        for (auto& other : race->sockets) {
+            if (other != socket) {
+                other->close(ignored);
+            }
         }
-    );
+        race->sockets.clear();
+        socket_ = std::move(*socket);
+        finishRace(race, ec);
+        return;
+    }
+    
+    if (race->abort_error) {
+        if (race->in_flight == 0) {
+            finishRace(race, race->abort_error);
+        }
+        return;
+    }
+    
+    race->last_error = ec;
+    LOG_DEBUG("Connection attempt failed: " + ec.message());
+    
+    // 失败后不必等间隔，立即尝试下一个地址
+    if (race->next < race->endpoints.size()) {
+        startAttempt(race);
+    } else if (race->in_flight == 0) {
+        finishRace(race, race->last_error);
+    }
+}
+
+void TcpClient::abortRace(const std::shared_ptr<ConnectRace>& race, const asio::error_code& ec) {
+    if (race->finished || race->abort_error) {
+        return;
+    }
+    race->abort_error = ec;
+    race->attempt_timer.cancel();
+    
+    // 尝试的完成处理会带着 operation_aborted 回来，最后一个负责结束竞速
+    asio::error_code ignored;
+    for (auto& socket : race->sockets) {
+        socket->close(ignored);
+    }
+}
+
+void TcpClient::finishRace(const std::shared_ptr<ConnectRace>& race, const asio::error_code& ec) {
+    race->finished = true;
+    race->attempt_timer.cancel();
+    race->sockets.clear();
+    auto callback = std::move(race->callback);
+    
+    if (race_ != race) {
+        // 已被 close() 放弃：状态由 close() 负责，只通知调用方
+        if (callback) {
+            callback(ec ? ec : asio::error::operation_aborted);
+        }
+        return;
+    }
+    
+    race_.reset();
+    handleConnect(ec, std::move(callback));
 }
 
 void TcpClient::handleConnect(const asio::error_code& ec, ConnectCallback callback) {
@@ -146,9 +339,18 @@ void TcpClient::close() {
     
     state_.store(TcpConnectionState::Closing);
     receiving_.store(false);
+    receive_generation_++;
     
-    // 取消定时器
+    // 调用方的缓冲区可能随后释放，已排队的接收完成也不能再写入
+    external_buffer_ = nullptr;
+    buffer_callback_ = nullptr;
+    
+    // 取消定时器，放弃进行中的连接（调用方稍后收到 operation_aborted）
     connect_timer_.cancel();
+    if (race_) {
+        abortRace(race_, asio::error::operation_aborted);
+        race_.reset();
+    }
     
     // 关闭 socket
     asio::error_code ignored;
@@ -171,46 +373,208 @@ void TcpClient::setDisconnectCallback(DisconnectCallback callback) {
 // ============================================================================
 
 void TcpClient::send(const std::vector<uint8_t>& data, SendCallback callback) {
+    send(std::vector<uint8_t>(data), std::move(callback));
+}
+
+void TcpClient::send(std::vector<uint8_t>&& data, SendCallback callback) {
+    PendingSend pending;
+    pending.data = std::move(data);
+    pending.callback = std::move(callback);
+    enqueue(std::move(pending));
+}
+
+void TcpClient::send(utils::BufferHandle buffer, SendCallback callback) {
+    PendingSend pending;
+    pending.buffer = std::move(buffer);
+    pending.callback = std::move(callback);
+    enqueue(std::move(pending));
+}
+
+void TcpClient::enqueue(PendingSend&& pending) {
     if (state_.load() != TcpConnectionState::Connected) {
         LOG_WARNING("TcpClient::send called while not connected");
-        if (callback) {
-            asio::post(io_context_, [callback]() {
+        if (pending.callback) {
+            asio::post(io_context_, [callback = std::move(pending.callback)]() {
                 callback(asio::error::not_connected, 0);
             });
         }
         return;
     }
     
-    // 拷贝数据到 shared_ptr，确保在异步操作期间数据有效
-    auto buffer = std::make_shared<std::vector<uint8_t>>(data);
-    auto self = shared_from_this();
+    bool schedule = false;
+    WatermarkCallback watermark_callback;
+    {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        pending_send_bytes_ += pending.bytes().size();
+        send_queue_.push_back(std::move(pending));
+        
+        // 空闲时安排一次写操作；同一轮事件中后续的 send 只排队，随后一起写出
+        if (!write_scheduled_) {
+            write_scheduled_ = true;
+            schedule = true;
+        }
+        
+        if (high_watermark_ > 0 && !above_watermark_ &&
+            pending_send_bytes_ >= high_watermark_) {
+            above_watermark_ = true;
+            watermark_callback = watermark_callback_;
+        }
+    }
+    
+    if (schedule) {
+        auto self = shared_from_this();
+        asio::post(io_context_, [self]() {
+            self->doWrite();
+        });
+    }
+    
+    if (watermark_callback) {
+        watermark_callback(true);
+    }
+}
+
+void TcpClient::setSendWatermark(size_t high_watermark, WatermarkCallback callback) {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    high_watermark_ = high_watermark;
+    watermark_callback_ = std::move(callback);
+    above_watermark_ = high_watermark_ > 0 && pending_send_bytes_ >= high_watermark_;
+}
+
+size_t TcpClient::pendingSendBytes() const {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    return pending_send_bytes_;
+}
+
+void TcpClient::setRateLimiters(std::shared_ptr<RateLimiter> read_limiter,
+                                std::shared_ptr<RateLimiter> write_limiter) {
+    read_limiter_ = std::move(read_limiter);
+    write_limiter_ = std::move(write_limiter);
+}
+
+void TcpClient::doWrite() {
+    // 限速：等令牌可用再取批次；等待期间 write_scheduled_ 保持为 true，新消息只排队
+    if (write_limiter_ && state_.load() == TcpConnectionState::Connected &&
+        !write_limiter_->ready()) {
+        auto self = shared_from_this();
+        write_limiter_->wait([self]() {
+            self->doWrite();
+        });
+        return;
+    }
+    
+    std::vector<PendingSend> dropped;
+    size_t batch_bytes = 0;
+    {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        
+        if (state_.load() != TcpConnectionState::Connected) {
+            // 连接已关闭，队列中的消息不再发送
+            dropped.swap(send_queue_);
+            pending_send_bytes_ = 0;
+            write_scheduled_ = false;
+        } else {
+            // write_batch_ 和 write_buffers_ 复用容量，稳态下不分配内存
+            // 限速时每批凑满约一个 quantum 即止（至少一条消息）
+            size_t max_bytes = write_limiter_ ? write_limiter_->quantum() : std::numeric_limits<size_t>::max();
+            size_t count = 0;
+            while (count < send_queue_.size() && count < kMaxWriteBatch &&
+                   (count == 0 || batch_bytes < max_bytes)) {
+                write_batch_.push_back(std::move(send_queue_[count]));
+                write_buffers_.push_back(write_batch_.back().bytes());
+                batch_bytes += write_buffers_.back().size();
+                ++count;
+            }
+            send_queue_.erase(send_queue_.begin(), send_queue_.begin() + count);
+        }
+    }
+    
+    for (auto& pending : dropped) {
+        if (pending.callback) {
+            pending.callback(asio::error::not_connected, 0);
+        }
+    }
+    if (write_buffers_.empty()) {
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        statistics_.write_calls++;
+    }
+    
+    if (write_limiter_) {
+        write_limiter_->consume(batch_bytes);
+    }
     
-    asio::async_write(socket_, asio::buffer(*buffer),
-        [self, buffer, callback](const asio::error_code& ec, size_t bytes_sent) {
-            self->handleSend(ec, bytes_sent, buffer, callback);
+    // 以引用方式传递缓冲序列，避免 async_write 拷贝 vector
+    auto self = shared_from_this();
+    asio::async_write(socket_, BufferSequenceRef{write_buffers_.data(), write_buffers_.size()},
+        [self](const asio::error_code& ec, size_t bytes_sent) {
+            self->handleWrite(ec, bytes_sent);
         }
     );
 }
 
-void TcpClient::handleSend(const asio::error_code& ec, size_t bytes_sent,
-                           std::shared_ptr<std::vector<uint8_t>> /*buffer*/, 
-                           SendCallback callback) {
-    if (ec) {
-        LOG_DEBUG("Send failed: " + ec.message());
-        updateSendStats(0, false);
+void TcpClient::handleWrite(const asio::error_code& ec, size_t bytes_sent) {
+    std::vector<PendingSend> dropped;
+    bool more = false;
+    WatermarkCallback watermark_callback;
+    {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        
+        if (ec) {
+            // 写失败后连接不可用，排队的消息一并失败
+            dropped.swap(send_queue_);
+            pending_send_bytes_ = 0;
+        } else {
+            pending_send_bytes_ -= std::min(pending_send_bytes_, bytes_sent);
+        }
         
-        // 检查是否是连接错误
-        if (ec == asio::error::connection_reset ||
-            ec == asio::error::broken_pipe ||
-            ec == asio::error::eof) {
-            handleDisconnect(ec);
+        if (above_watermark_ && pending_send_bytes_ <= high_watermark_ / 2) {
+            above_watermark_ = false;
+            watermark_callback = watermark_callback_;
         }
+        
+        more = !send_queue_.empty();
+        write_scheduled_ = more;
+    }
+    
+    if (ec) {
+        LOG_DEBUG("Send failed: " + ec.message());
+        updateSendStats(0, 0, false);
     } else {
-        updateSendStats(bytes_sent, true);
+        updateSendStats(bytes_sent, write_batch_.size(), true);
     }
     
-    if (callback) {
-        callback(ec, bytes_sent);
+    // 下一次 doWrite 只会在本函数末尾或投递的任务中执行，回调期间批次保持不变
+    for (auto& pending : write_batch_) {
+        if (pending.callback) {
+            pending.callback(ec, ec ? 0 : pending.bytes().size());
+        }
+    }
+    write_batch_.clear();
+    write_buffers_.clear();
+    
+    for (auto& pending : dropped) {
+        if (pending.callback) {
+            pending.callback(ec, 0);
+        }
+    }
+    
+    if (watermark_callback) {
+        watermark_callback(false);
+    }
+    
+    // 检查是否是连接错误
+    if (ec == asio::error::connection_reset ||
+        ec == asio::error::broken_pipe ||
+        ec == asio::error::eof) {
+        handleDisconnect(ec);
+        return;
+    }
+    
+    if (more) {
+        doWrite();
     }
 }
 
@@ -220,14 +584,38 @@ void TcpClient::startReceive(ReceiveCallback callback) {
         return;
     }
     
+    if (receive_buffer_.empty()) {
+        receive_buffer_.resize(kReceiveBufferSize);
+    }
+    
+    external_buffer_ = nullptr;
+    buffer_callback_ = nullptr;
     receive_callback_ = std::move(callback);
     receiving_.store(true);
+    receive_generation_++;
+    doReceive();
+}
+
+void TcpClient::startReceive(ReceiveBuffer& buffer, BufferReceiveCallback callback) {
+    if (state_.load() != TcpConnectionState::Connected) {
+        LOG_WARNING("TcpClient::startReceive called while not connected");
+        return;
+    }
+    
+    receive_callback_ = nullptr;
+    external_buffer_ = &buffer;
+    buffer_callback_ = std::move(callback);
+    receiving_.store(true);
+    receive_generation_++;
     doReceive();
 }
 
 void TcpClient::stopReceive() {
     receiving_.store(false);
+    receive_generation_++;
     receive_callback_ = nullptr;
+    buffer_callback_ = nullptr;
+    external_buffer_ = nullptr;
 }
 
 void TcpClient::doReceive() {
@@ -235,8 +623,30 @@ void TcpClient::doReceive() {
         return;
     }
     
+    // 限速：令牌不足时先等待，期间没有进行中的读取（调用方可以安全地整理缓冲区）
+    if (read_limiter_ && !read_limiter_->ready()) {
+        auto self = shared_from_this();
+        uint64_t generation = receive_generation_;
+        read_limiter_->wait([self, generation]() {
+            if (self->receive_generation_ == generation) {
+                self->doReceive();
+            }
+        });
+        return;
+    }
+    
+    // 缓冲区模式直接读入调用方缓冲区的尾部空间
+    asio::mutable_buffer target = asio::buffer(receive_buffer_);
+    if (external_buffer_) {
+        uint8_t* out = external_buffer_->prepare(kMinReadSpace);
+        target = asio::buffer(out, external_buffer_->writable());
+    }
+    if (read_limiter_) {
+        target = asio::buffer(target.data(), std::min(target.size(), read_limiter_->quantum()));
+    }
+    
     auto self = shared_from_this();
-    socket_.async_read_some(asio::buffer(receive_buffer_),
+    socket_.async_read_some(target,
         [self](const asio::error_code& ec, size_t bytes_received) {
             self->handleReceive(ec, bytes_received);
         }
@@ -263,7 +673,9 @@ void TcpClient::handleReceive(const asio::error_code& ec, size_t bytes_received)
         updateReceiveStats(0, false);
         
         // 通知回调
-        if (receive_callback_) {
+        if (buffer_callback_) {
+            buffer_callback_(ec, 0);
+        } else if (receive_callback_) {
             receive_callback_(ec, {});
         }
         
@@ -276,9 +688,17 @@ void TcpClient::handleReceive(const asio::error_code& ec, size_t bytes_received)
     
     // 成功接收
     updateReceiveStats(bytes_received, true);
+    if (read_limiter_) {
+        read_limiter_->consume(bytes_received);
+    }
     
-    // 构造数据并调用回调
-    if (receive_callback_) {
+    // 缓冲区模式：数据已在调用方缓冲区中，只需确认长度
+    if (external_buffer_) {
+        external_buffer_->commit(bytes_received);
+        if (buffer_callback_) {
+            buffer_callback_(ec, bytes_received);
+        }
+    } else if (receive_callback_) {
         std::vector<uint8_t> data(receive_buffer_.begin(), 
                                    receive_buffer_.begin() + bytes_received);
         receive_callback_(ec, data);
@@ -351,32 +771,11 @@ void TcpClient::resetStatistics() {
 // 内部方法
 // ============================================================================
 
-asio::ip::tcp::endpoint TcpClient::resolveEndpoint(const TcpEndpoint& endpoint) {
-    // 尝试直接解析为 IP 地址
-    asio::error_code ec;
-    auto addr = asio::ip::make_address(endpoint.ip, ec);
-    
-    if (!ec) {
-        // 是有效的 IP 地址
-        return asio::ip::tcp::endpoint(addr, endpoint.port);
-    }
-    
-    // 需要 DNS 解析
-    asio::ip::tcp::resolver resolver(io_context_);
-    auto results = resolver.resolve(endpoint.ip, std::to_string(endpoint.port));
-    
-    if (results.empty()) {
-        throw std::runtime_error("DNS resolution failed for: " + endpoint.ip);
-    }
-    
-    return *results.begin();
-}
-
-void TcpClient::updateSendStats(size_t bytes, bool success) {
+void TcpClient::updateSendStats(size_t bytes, size_t messages, bool success) {
     std::lock_guard<std::mutex> lock(stats_mutex_);
     if (success) {
         statistics_.bytes_sent += bytes;
-        statistics_.messages_sent++;
+        statistics_.messages_sent += messages;
     } else {
         statistics_.send_errors++;
     }
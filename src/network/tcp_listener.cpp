@@ -0,0 +1,163 @@
+#include "magnet/network/tcp_listener.h"
+#include "magnet/utils/logger.h"
+
+namespace magnet::network {
+
+// 日志宏
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(msg)
+#define LOG_INFO(msg) magnet::utils::Logger::instance().info(msg)
+#define LOG_WARNING(msg) magnet::utils::Logger::instance().warn(msg)
+#define LOG_ERROR(msg) magnet::utils::Logger::instance().error(msg)
+
+// ============================================================================
+// 构造函数和析构函数
+// ============================================================================
+
+TcpListener::TcpListener(asio::io_context& io_context)
+    : io_context_(io_context)
+    , acceptor_(io_context)
+    , retry_timer_(io_context)
+{
+}
+
+TcpListener::~TcpListener() {
+    close();
+}
+
+// ============================================================================
+// 监听管理
+// ============================================================================
+
+bool TcpListener::listen(uint16_t port, AcceptCallback callback) {
+    if (listening_.load()) {
+        LOG_WARNING("TcpListener::listen called while already listening");
+        return false;
+    }
+
+    // 优先双栈 IPv6 监听：一个端口同时接受两种地址族的 Peer，
+    // IPv4 对端以 v4 映射地址出现；系统不支持 IPv6 时退回纯 IPv4
+    asio::error_code ec;
+    dual_stack_ = open(asio::ip::tcp::v6(), port, ec);
+    if (!dual_stack_) {
+        LOG_DEBUG("Dual-stack TCP listen failed (" + ec.message() + "), falling back to IPv4");
+        open(asio::ip::tcp::v4(), port, ec);
+    }
+    if (ec) {
+        LOG_ERROR("Failed to listen on TCP port " + std::to_string(port) + ": " + ec.message());
+        return false;
+    }
+
+    local_port_ = acceptor_.local_endpoint(ec).port();
+    accept_callback_ = std::move(callback);
+    listening_.store(true);
+
+    LOG_INFO("Listening for peers on TCP port " + std::to_string(local_port_) +
+             (dual_stack_ ? " (dual-stack)" : " (IPv4 only)"));
+
+    doAccept();
+    return true;
+}
+
+void TcpListener::close() {
+    if (!listening_.exchange(false)) {
+        return;
+    }
+
+    retry_timer_.cancel();
+
+    asio::error_code ignored;
+    acceptor_.cancel(ignored);
+    acceptor_.close(ignored);
+
+    LOG_INFO("Stopped listening on TCP port " + std::to_string(local_port_));
+}
+
+uint16_t TcpListener::localPort() const {
+    return local_port_;
+}
+
+TcpListenerStatistics TcpListener::getStatistics() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return statistics_;
+}
+
+// ============================================================================
+// 内部方法
+// ============================================================================
+
+bool TcpListener::open(const asio::ip::tcp& protocol, uint16_t port, asio::error_code& ec) {
+    acceptor_.open(protocol, ec);
+    if (!ec && protocol == asio::ip::tcp::v6()) {
+        acceptor_.set_option(asio::ip::v6_only(false), ec);
+    }
+    if (!ec) {
+        acceptor_.set_option(asio::ip::tcp::acceptor::reuse_address(true), ec);
+    }
+    if (!ec) {
+        acceptor_.bind(asio::ip::tcp::endpoint(protocol, port), ec);
+    }
+    if (!ec) {
+        acceptor_.listen(asio::socket_base::max_listen_connections, ec);
+    }
+    if (ec) {
+        asio::error_code ignored;
+        acceptor_.close(ignored);
+        return false;
+    }
+    return true;
+}
+
+void TcpListener::doAccept() {
+    if (!listening_.load()) {
+        return;
+    }
+
+    auto self = shared_from_this();
+    acceptor_.async_accept(io_context_,
+        [self](const asio::error_code& ec, asio::ip::tcp::socket socket) {
+            self->handleAccept(ec, std::move(socket));
+        }
+    );
+}
+
+void TcpListener::handleAccept(const asio::error_code& ec, asio::ip::tcp::socket socket) {
+    if (ec == asio::error::operation_aborted || !listening_.load()) {
+        return;
+    }
+
+    if (ec) {
+        // 通常是文件描述符耗尽：稍后再试，避免在错误上空转
+        LOG_WARNING("Accept failed: " + ec.message());
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            statistics_.accept_errors++;
+        }
+
+        auto self = shared_from_this();
+        retry_timer_.expires_after(kAcceptRetryDelay);
+        retry_timer_.async_wait([self](const asio::error_code& ec) {
+            if (!ec) {
+                self->doAccept();
+            }
+        });
+        return;
+    }
+
+    auto client = std::make_shared<TcpClient>(io_context_, std::move(socket));
+    if (client->isConnected()) {
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            statistics_.accepted++;
+        }
+
+        LOG_DEBUG("Accepted connection from " + client->remoteEndpoint().toString());
+
+        if (accept_callback_) {
+            accept_callback_(client);
+        }
+    }
+
+    doAccept();
+}
+
+} // namespace magnet::network
@@ -2,19 +2,78 @@
 // Asynchronous UDP communication for DHT protocol
 
 #include "magnet/network/udp_client.h"
+#include "magnet/network/dns_resolver.h"
 #include "magnet/utils/logger.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <stdexcept>
 #include <sstream>
 
+// recvmmsg/sendmmsg are Linux-specific; other platforms fall back to
+// one asio operation per datagram
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <sys/uio.h>
+#define MAGNET_HAS_MMSG 1
+#endif
+
+#ifndef MAGNET_HAS_MMSG
+#define MAGNET_HAS_MMSG 0
+#endif
+
 namespace magnet::network {
 
 // Helper macro for logging
-#define LOG_DEBUG(msg) magnet::utils::Logger::instance().debug(std::string("[UdpClient] ") + msg)
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(std::string("[UdpClient] ") + msg)
 #define LOG_INFO(msg) magnet::utils::Logger::instance().info(std::string("[UdpClient] ") + msg)
 #define LOG_WARN(msg) magnet::utils::Logger::instance().warn(std::string("[UdpClient] ") + msg)
 #define LOG_ERROR(msg) magnet::utils::Logger::instance().error(std::string("[UdpClient] ") + msg)
 
+// Upper bound of recvmmsg rounds per readiness notification, so a flood on
+// the socket cannot starve other handlers on the io_context thread
+static constexpr int kMaxBatchesPerWakeup = 8;
+
+// ============================================================================
+// Batch state
+// ============================================================================
+
+/*
+ * Preallocated message headers and data arenas for recvmmsg/sendmmsg.
+ *
+ * Receive side is only touched on the io_context thread. Send side: send()
+ * appends to queue/queue_arena under send_mutex_ from any thread; the
+ * io_context thread swaps them with flushing/flush_arena and drains those
+ * without holding the lock. Arenas keep their capacity, so steady-state
+ * traffic allocates nothing.
+ */
+struct UdpClient::BatchState {
+#if MAGNET_HAS_MMSG
+    struct Pending {
+        sockaddr_storage address;
+        socklen_t address_length;
+        size_t offset;              // offset into the arena
+        size_t size;
+    };
+
+    std::vector<uint8_t> receive_arena;     // kBatchSize slots of kMaxDatagramSize
+    std::array<mmsghdr, kBatchSize> receive_headers{};
+    std::array<iovec, kBatchSize> receive_iovecs{};
+    std::array<sockaddr_storage, kBatchSize> receive_addresses{};
+
+    std::vector<Pending> queue;             // guarded by send_mutex_
+    std::vector<uint8_t> queue_arena;       // guarded by send_mutex_
+    bool flush_scheduled{false};            // guarded by send_mutex_
+
+    std::vector<Pending> flushing;          // batch being drained (io_context thread)
+    std::vector<uint8_t> flush_arena;
+    size_t flushed{0};
+    std::array<mmsghdr, kBatchSize> send_headers{};
+    std::array<iovec, kBatchSize> send_iovecs{};
+#endif
+};
+
 // ============================================================================
 // Constructor / Destructor
 // ============================================================================
@@ -26,15 +85,31 @@ UdpClient::UdpClient(asio::io_context& io_context, uint16_t local_port)
     , receive_callback_(nullptr)
     , receive_buffer_()
     , remote_endpoint_()
+    , batch_(std::make_unique<BatchState>())
     , statistics_()
 {
     asio::error_code ec;
     
-    // Open socket for IPv4 UDP
-    socket_.open(asio::ip::udp::v4(), ec);
-    if (ec) {
-        LOG_ERROR("Failed to open UDP socket: " + ec.message());
-        throw std::runtime_error("Failed to open UDP socket: " + ec.message());
+    // Prefer a dual-stack IPv6 socket (BEP 32): one socket serves both
+    // address families, IPv4 peers show up as v4-mapped addresses
+    socket_.open(asio::ip::udp::v6(), ec);
+    if (!ec) {
+        socket_.set_option(asio::ip::v6_only(false), ec);
+        if (ec) {
+            LOG_WARN("Failed to disable IPV6_V6ONLY, falling back to IPv4: " + ec.message());
+            asio::error_code ignored;
+            socket_.close(ignored);
+        } else {
+            dual_stack_ = true;
+        }
+    }
+    
+    if (!dual_stack_) {
+        socket_.open(asio::ip::udp::v4(), ec);
+        if (ec) {
+            LOG_ERROR("Failed to open UDP socket: " + ec.message());
+            throw std::runtime_error("Failed to open UDP socket: " + ec.message());
+        }
     }
     
     // Set socket options
@@ -46,7 +121,8 @@ UdpClient::UdpClient(asio::io_context& io_context, uint16_t local_port)
     }
     
     // Bind to local port (0 = system assigns a free port)
-    asio::ip::udp::endpoint local_endpoint(asio::ip::udp::v4(), local_port);
+    asio::ip::udp::endpoint local_endpoint(
+        dual_stack_ ? asio::ip::udp::v6() : asio::ip::udp::v4(), local_port);
     socket_.bind(local_endpoint, ec);
     if (ec) {
         std::ostringstream oss;
@@ -56,7 +132,8 @@ UdpClient::UdpClient(asio::io_context& io_context, uint16_t local_port)
     }
     
     std::ostringstream oss;
-    oss << "UdpClient created, listening on port " << socket_.local_endpoint().port();
+    oss << "UdpClient created, listening on port " << socket_.local_endpoint().port()
+        << (dual_stack_ ? " (dual-stack)" : " (IPv4 only)");
     LOG_INFO(oss.str());
 }
 
@@ -100,35 +177,84 @@ void UdpClient::send(const UdpEndpoint& endpoint,
         return;
     }
     
-    // Resolve endpoint (may involve DNS lookup for domain names)
-    asio::ip::udp::endpoint target;
-    try {
-        target = resolveEndpoint(endpoint);
-    } catch (const std::exception& e) {
-        LOG_WARN("Failed to resolve endpoint " + endpoint.ip + ": " + e.what());
+    // IP literals are sent directly. Without a callback nobody waits for the
+    // individual result, so the datagram goes to the sendmmsg queue instead
+    // of a heap copy plus one async operation per packet
+    asio::error_code ec;
+    auto address = asio::ip::make_address(endpoint.ip, ec);
+    if (!ec) {
+        asio::ip::udp::endpoint target(address, endpoint.port);
+        if (!callback && enqueue(target, data.data(), data.size())) {
+            return;
+        }
+        doSend(target, std::make_shared<std::vector<uint8_t>>(data), std::move(callback));
+        return;
+    }
+    
+    // Copy data for async operation (original may go out of scope)
+    auto data_copy = std::make_shared<std::vector<uint8_t>>(data);
+    
+    // Hostnames are resolved asynchronously through the shared cache,
+    // a slow DNS server must not stall the io_context thread
+    auto self = shared_from_this();
+    DnsResolver::shared(io_context_)->resolve(endpoint.ip,
+        [this, self, endpoint, data_copy, callback](const asio::error_code& ec,
+                                                   const DnsResolver::Addresses& addresses) {
+            // A dual-stack socket reaches every address, an IPv4 socket only IPv4 ones
+            auto target = std::find_if(addresses.begin(), addresses.end(),
+                                       [this](const asio::ip::address& a) {
+                                           return dual_stack_ || a.is_v4();
+                                       });
+            if (ec || target == addresses.end()) {
+                LOG_WARN("Failed to resolve endpoint " + endpoint.ip + ": " +
+                         (ec ? ec.message() : std::string("no usable address")));
+                if (callback) {
+                    callback(asio::error::host_not_found, 0);
+                }
+                updateSendStats(0, false);
+                return;
+            }
+            doSend(asio::ip::udp::endpoint(*target, endpoint.port), data_copy, callback);
+        });
+}
+
+void UdpClient::doSend(const asio::ip::udp::endpoint& target,
+                       std::shared_ptr<std::vector<uint8_t>> data,
+                       SendCallback callback) {
+    if (!socket_.is_open()) {
         if (callback) {
             asio::post(io_context_, [callback]() {
-                callback(asio::error::host_not_found, 0);
+                callback(asio::error::bad_descriptor, 0);
             });
         }
         updateSendStats(0, false);
         return;
     }
     
-    // Copy data for async operation (original may go out of scope)
-    auto data_copy = std::make_shared<std::vector<uint8_t>>(data);
+    asio::ip::udp::endpoint destination = target;
+    if (!mapDestination(destination)) {
+        LOG_DEBUG("IPv6 destination on IPv4-only socket: " + target.address().to_string());
+        if (callback) {
+            asio::post(io_context_, [callback]() {
+                callback(asio::error::address_family_not_supported, 0);
+            });
+        }
+        updateSendStats(0, false);
+        return;
+    }
     
     // Capture self to extend lifetime during async operation
     auto self = shared_from_this();
     
     std::ostringstream oss;
-    oss << "Sending " << data.size() << " bytes to " << endpoint.toString();
+    oss << "Sending " << data->size() << " bytes to " << target.address().to_string()
+        << ":" << target.port();
     LOG_DEBUG(oss.str());
     
     socket_.async_send_to(
-        asio::buffer(*data_copy),
-        target,
-        [this, self, data_copy, callback](const asio::error_code& ec, size_t bytes_sent) {
+        asio::buffer(*data),
+        destination,
+        [this, self, data, callback](const asio::error_code& ec, size_t bytes_sent) {
             if (ec) {
                 LOG_WARN("Send failed: " + ec.message());
                 updateSendStats(0, false);
@@ -146,6 +272,145 @@ void UdpClient::send(const UdpEndpoint& endpoint,
     );
 }
 
+bool UdpClient::mapDestination(asio::ip::udp::endpoint& target) const {
+    if (dual_stack_ && target.address().is_v4()) {
+        target.address(asio::ip::make_address_v6(asio::ip::v4_mapped, target.address().to_v4()));
+    } else if (!dual_stack_ && target.address().is_v6()) {
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Batched send (sendmmsg)
+// ============================================================================
+
+bool UdpClient::enqueue(const asio::ip::udp::endpoint& target, const uint8_t* data, size_t size) {
+#if MAGNET_HAS_MMSG
+    asio::ip::udp::endpoint destination = target;
+    if (!mapDestination(destination)) {
+        updateSendStats(0, false);
+        return true;
+    }
+    
+    auto& batch = *batch_;
+    bool dropped = false;
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        if (batch.queue.size() >= kMaxQueuedDatagrams) {
+            dropped = true;
+        } else {
+            BatchState::Pending pending;
+            std::memcpy(&pending.address, destination.data(), destination.size());
+            pending.address_length = static_cast<socklen_t>(destination.size());
+            pending.offset = batch.queue_arena.size();
+            pending.size = size;
+            batch.queue.push_back(pending);
+            batch.queue_arena.insert(batch.queue_arena.end(), data, data + size);
+            
+            schedule = !batch.flush_scheduled;
+            batch.flush_scheduled = true;
+        }
+    }
+    
+    if (dropped) {
+        LOG_WARN("Send queue full, dropping datagram");
+        updateSendStats(0, false);
+        return true;
+    }
+    
+    if (schedule) {
+        auto self = shared_from_this();
+        asio::post(io_context_, [this, self]() {
+            flushQueue();
+        });
+    }
+    return true;
+#else
+    (void)target;
+    (void)data;
+    (void)size;
+    return false;
+#endif
+}
+
+void UdpClient::flushQueue() {
+#if MAGNET_HAS_MMSG
+    auto& batch = *batch_;
+    Statistics delta;
+    
+    while (true) {
+        if (batch.flushed == batch.flushing.size()) {
+            batch.flushing.clear();
+            batch.flush_arena.clear();
+            batch.flushed = 0;
+            
+            std::lock_guard<std::mutex> lock(send_mutex_);
+            if (batch.queue.empty()) {
+                batch.flush_scheduled = false;
+                break;
+            }
+            std::swap(batch.queue, batch.flushing);
+            std::swap(batch.queue_arena, batch.flush_arena);
+        }
+        
+        if (!socket_.is_open()) {
+            // Closed while datagrams were queued: drop them
+            delta.send_errors += batch.flushing.size() - batch.flushed;
+            batch.flushed = batch.flushing.size();
+            continue;
+        }
+        
+        size_t count = std::min(kBatchSize, batch.flushing.size() - batch.flushed);
+        for (size_t i = 0; i < count; ++i) {
+            auto& pending = batch.flushing[batch.flushed + i];
+            batch.send_iovecs[i].iov_base = batch.flush_arena.data() + pending.offset;
+            batch.send_iovecs[i].iov_len = pending.size;
+            
+            auto& header = batch.send_headers[i].msg_hdr;
+            header = msghdr{};
+            header.msg_name = &pending.address;
+            header.msg_namelen = pending.address_length;
+            header.msg_iov = &batch.send_iovecs[i];
+            header.msg_iovlen = 1;
+        }
+        
+        int sent = ::sendmmsg(socket_.native_handle(), batch.send_headers.data(),
+                              static_cast<unsigned int>(count), MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Socket buffer full: resume once it becomes writable
+                addStatistics(delta);
+                auto self = shared_from_this();
+                socket_.async_wait(asio::socket_base::wait_write,
+                    [this, self](const asio::error_code&) {
+                        flushQueue();
+                    });
+                return;
+            }
+            // sendmmsg reports an error only for the first datagram of the
+            // batch (e.g. unreachable network): skip it and go on
+            LOG_DEBUG("sendmmsg failed: " + std::string(std::strerror(errno)));
+            delta.send_errors++;
+            batch.flushed++;
+            continue;
+        }
+        
+        for (int i = 0; i < sent; ++i) {
+            delta.bytes_sent += batch.send_headers[i].msg_len;
+        }
+        delta.messages_sent += static_cast<size_t>(sent);
+        batch.flushed += static_cast<size_t>(sent);
+    }
+    
+    addStatistics(delta);
+#endif
+}
+
 // ============================================================================
 // Receive
 // ============================================================================
@@ -173,6 +438,33 @@ void UdpClient::startReceive(ReceiveCallback callback) {
     doReceive();
 }
 
+void UdpClient::startReceiveBatch(DatagramCallback callback) {
+    bool expected = false;
+    if (!receiving_.compare_exchange_strong(expected, true)) {
+        LOG_WARN("Already receiving, call stopReceive() first");
+        throw std::runtime_error("Already receiving, call stopReceive() first");
+    }
+    
+    if (!callback) {
+        receiving_ = false;
+        throw std::invalid_argument("Receive callback cannot be null");
+    }
+    
+    datagram_callback_ = std::move(callback);
+    
+    std::ostringstream oss;
+    oss << "Started batched receiving on port " << localPort()
+        << (MAGNET_HAS_MMSG ? " (recvmmsg)" : " (per-datagram fallback)");
+    LOG_INFO(oss.str());
+    
+#if MAGNET_HAS_MMSG
+    batch_->receive_arena.resize(kBatchSize * kMaxDatagramSize);
+    doReceiveBatch();
+#else
+    doReceive();
+#endif
+}
+
 void UdpClient::stopReceive() {
     bool expected = true;
     if (receiving_.compare_exchange_strong(expected, false)) {
@@ -187,6 +479,7 @@ void UdpClient::stopReceive() {
         }
         
         receive_callback_ = nullptr;
+        datagram_callback_ = nullptr;
     }
 }
 
@@ -207,6 +500,104 @@ void UdpClient::doReceive() {
     );
 }
 
+void UdpClient::doReceiveBatch() {
+    if (!receiving_ || !socket_.is_open()) {
+        return;
+    }
+    
+    auto self = shared_from_this();
+    socket_.async_wait(asio::socket_base::wait_read,
+        [this, self](const asio::error_code& ec) {
+            handleReadable(ec);
+        });
+}
+
+void UdpClient::handleReadable(const asio::error_code& ec) {
+    if (!receiving_ || !datagram_callback_) {
+        return;
+    }
+    
+    if (ec) {
+        if (ec == asio::error::operation_aborted) {
+            return;
+        }
+        LOG_WARN("Receive error: " + ec.message());
+        updateReceiveStats(0, false);
+        doReceiveBatch();
+        return;
+    }
+    
+#if MAGNET_HAS_MMSG
+    auto& batch = *batch_;
+    // The callback may call stopReceive(), which clears the member
+    auto callback = datagram_callback_;
+    Statistics delta;
+    UdpDatagram datagram;
+    
+    for (int round = 0; round < kMaxBatchesPerWakeup && receiving_; ++round) {
+        for (size_t i = 0; i < kBatchSize; ++i) {
+            batch.receive_iovecs[i].iov_base = batch.receive_arena.data() + i * kMaxDatagramSize;
+            batch.receive_iovecs[i].iov_len = kMaxDatagramSize;
+            
+            auto& header = batch.receive_headers[i].msg_hdr;
+            header = msghdr{};
+            header.msg_name = &batch.receive_addresses[i];
+            header.msg_namelen = sizeof(sockaddr_storage);
+            header.msg_iov = &batch.receive_iovecs[i];
+            header.msg_iovlen = 1;
+        }
+        
+        int received = ::recvmmsg(socket_.native_handle(), batch.receive_headers.data(),
+                                  static_cast<unsigned int>(kBatchSize), MSG_DONTWAIT, nullptr);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_WARN("recvmmsg failed: " + std::string(std::strerror(errno)));
+                delta.receive_errors++;
+            }
+            break;
+        }
+        
+        for (int i = 0; i < received && receiving_; ++i) {
+            const auto& header = batch.receive_headers[i];
+            if (header.msg_hdr.msg_flags & MSG_TRUNC) {
+                // Larger than a slot; DHT messages never are
+                delta.receive_errors++;
+                continue;
+            }
+            
+            std::memcpy(datagram.remote.data(), &batch.receive_addresses[i],
+                        header.msg_hdr.msg_namelen);
+            datagram.remote.resize(header.msg_hdr.msg_namelen);
+            auto sender = datagram.remote.address();
+            if (sender.is_v6() && sender.to_v6().is_v4_mapped()) {
+                datagram.remote.address(asio::ip::make_address_v4(asio::ip::v4_mapped, sender.to_v6()));
+            }
+            datagram.data = ByteSpan(batch.receive_arena.data() + i * kMaxDatagramSize,
+                                     header.msg_len);
+            
+            delta.bytes_received += header.msg_len;
+            delta.messages_received++;
+            
+            try {
+                callback(datagram);
+            } catch (const std::exception& e) {
+                LOG_WARN("Exception in receive callback: " + std::string(e.what()));
+            }
+        }
+        
+        if (static_cast<size_t>(received) < kBatchSize) {
+            break;
+        }
+    }
+    
+    addStatistics(delta);
+    doReceiveBatch();
+#endif
+}
+
 void UdpClient::handleReceive(const asio::error_code& ec, size_t bytes_received) {
     // Check if we should continue receiving
     if (!receiving_) {
@@ -231,17 +622,39 @@ void UdpClient::handleReceive(const asio::error_code& ec, size_t bytes_received)
         return;
     }
     
+    updateReceiveStats(bytes_received, true);
+    
+    // Batched mode on platforms without recvmmsg: same callback, one datagram at a time
+    if (datagram_callback_) {
+        UdpDatagram datagram{ByteSpan(receive_buffer_.data(), bytes_received), remote_endpoint_};
+        auto sender = remote_endpoint_.address();
+        if (sender.is_v6() && sender.to_v6().is_v4_mapped()) {
+            datagram.remote.address(asio::ip::make_address_v4(asio::ip::v4_mapped, sender.to_v6()));
+        }
+        auto callback = datagram_callback_;
+        try {
+            callback(datagram);
+        } catch (const std::exception& e) {
+            LOG_WARN("Exception in receive callback: " + std::string(e.what()));
+        }
+        doReceive();
+        return;
+    }
+    
     std::ostringstream oss;
     oss << "Received " << bytes_received << " bytes from " 
         << remote_endpoint_.address().to_string() << ":" << remote_endpoint_.port();
     LOG_DEBUG(oss.str());
     
-    updateReceiveStats(bytes_received, true);
-    
     // Construct UdpMessage
     UdpMessage message;
     message.data.assign(receive_buffer_.begin(), receive_buffer_.begin() + bytes_received);
-    message.remote_endpoint.ip = remote_endpoint_.address().to_string();
+    // Report IPv4 peers on the dual-stack socket as plain IPv4
+    auto sender = remote_endpoint_.address();
+    if (sender.is_v6() && sender.to_v6().is_v4_mapped()) {
+        sender = asio::ip::make_address_v4(asio::ip::v4_mapped, sender.to_v6());
+    }
+    message.remote_endpoint.ip = sender.to_string();
     message.remote_endpoint.port = remote_endpoint_.port();
     
     // Call user callback
@@ -313,6 +726,16 @@ void UdpClient::updateSendStats(size_t bytes, bool success) {
     }
 }
 
+void UdpClient::addStatistics(const Statistics& delta) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    statistics_.bytes_sent += delta.bytes_sent;
+    statistics_.bytes_received += delta.bytes_received;
+    statistics_.messages_sent += delta.messages_sent;
+    statistics_.messages_received += delta.messages_received;
+    statistics_.send_errors += delta.send_errors;
+    statistics_.receive_errors += delta.receive_errors;
+}
+
 void UdpClient::updateReceiveStats(size_t bytes, bool success) {
     std::lock_guard<std::mutex> lock(stats_mutex_);
     if (success) {
@@ -323,45 +746,4 @@ void UdpClient::updateReceiveStats(size_t bytes, bool success) {
     }
 }
 
-// ============================================================================
-// Endpoint Resolution
-// ============================================================================
-
-asio::ip::udp::endpoint UdpClient::resolveEndpoint(const UdpEndpoint& endpoint) {
-    asio::error_code ec;
-    
-    // First, try to parse as IP address directly
-    auto address = asio::ip::make_address(endpoint.ip, ec);
-    if (!ec) {
-        // Successfully parsed as IP address
-        return asio::ip::udp::endpoint(address, endpoint.port);
-    }
-    
-    // If not an IP, try DNS resolution
-    LOG_DEBUG("Resolving hostname: " + endpoint.ip);
-    
-    asio::ip::udp::resolver resolver(io_context_);
-    auto results = resolver.resolve(
-        asio::ip::udp::v4(),
-        endpoint.ip,
-        std::to_string(endpoint.port),
-        ec
-    );
-    
-    if (ec) {
-        LOG_WARN("DNS resolution failed for " + endpoint.ip + ": " + ec.message());
-        throw std::runtime_error("DNS resolution failed: " + ec.message());
-    }
-    
-    if (results.empty()) {
-        throw std::runtime_error("No addresses found for hostname: " + endpoint.ip);
-    }
-    
-    // Return first result
-    auto resolved = results.begin()->endpoint();
-    LOG_DEBUG("Resolved " + endpoint.ip + " to " + resolved.address().to_string());
-    
-    return resolved;
-}
-
 } // namespace magnet::network
@@ -0,0 +1,349 @@
+#include "magnet/protocols/block_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace magnet::protocols {
+
+// ============================================================================
+// 构造
+// ============================================================================
+
+BlockScheduler::BlockScheduler(BlockSchedulerConfig config)
+    : config_(std::move(config))
+{
+}
+
+// ============================================================================
+// Peer 管理
+// ============================================================================
+
+void BlockScheduler::addPeer(const network::TcpEndpoint& peer) {
+    auto key = peer.toString();
+    if (peers_.find(key) != peers_.end()) {
+        return;
+    }
+
+    PeerPipeline pipeline;
+    pipeline.endpoint = peer;
+    pipeline.window_start = Clock::now();
+    pipeline.rtt_window_start = pipeline.window_start;
+    peers_.emplace(std::move(key), std::move(pipeline));
+}
+
+std::vector<BlockInfo> BlockScheduler::removePeer(const network::TcpEndpoint& peer) {
+    auto it = peers_.find(peer.toString());
+    if (it == peers_.end()) {
+        return {};
+    }
+
+    auto blocks = drain(it->second);
+    peers_.erase(it);
+    return blocks;
+}
+
+std::vector<BlockInfo> BlockScheduler::setPeerChoked(const network::TcpEndpoint& peer, bool choked) {
+    auto* pipeline = find(peer);
+    if (!pipeline) {
+        addPeer(peer);
+        pipeline = find(peer);
+    }
+
+    if (pipeline->choked == choked) {
+        return {};
+    }
+
+    pipeline->choked = choked;
+
+    if (!choked) {
+        // 重新开始速度采样窗口，避免把 choke 期间算进去
+        pipeline->window_start = Clock::now();
+        pipeline->window_bytes = 0;
+        return {};
+    }
+
+    // 被 choke 后对方会丢弃所有未完成的请求
+    return drain(*pipeline);
+}
+
+bool BlockScheduler::hasPeer(const network::TcpEndpoint& peer) const {
+    return find(peer) != nullptr;
+}
+
+std::vector<network::TcpEndpoint> BlockScheduler::requestablePeers() const {
+    std::vector<network::TcpEndpoint> result;
+    for (const auto& [key, pipeline] : peers_) {
+        if (!pipeline.choked && pipeline.outstanding.size() < targetDepth(pipeline)) {
+            result.push_back(pipeline.endpoint);
+        }
+    }
+    return result;
+}
+
+// ============================================================================
+// 请求记账
+// ============================================================================
+
+void BlockScheduler::onBlockRequested(const network::TcpEndpoint& peer, const BlockInfo& block,
+                                      Clock::time_point now) {
+    auto* pipeline = find(peer);
+    if (!pipeline) {
+        return;
+    }
+
+    // 管道从空闲恢复时重新开始速度窗口，空闲时间不计入速度
+    if (pipeline->outstanding.empty() && pipeline->window_bytes == 0) {
+        pipeline->window_start = now;
+    }
+
+    pipeline->outstanding.push_back({block, now});
+    total_outstanding_++;
+}
+
+bool BlockScheduler::onBlockReceived(const network::TcpEndpoint& peer, const BlockInfo& block,
+                                     Clock::time_point now) {
+    auto* pipeline = find(peer);
+    if (!pipeline) {
+        return false;
+    }
+
+    auto& outstanding = pipeline->outstanding;
+    auto it = std::find_if(outstanding.begin(), outstanding.end(), [&block](const Outstanding& o) {
+        return o.block.piece_index == block.piece_index && o.block.begin == block.begin;
+    });
+    if (it == outstanding.end() || it->block.length != block.length) {
+        return false;
+    }
+
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(now - it->sent_time);
+    outstanding.erase(it);
+    total_outstanding_--;
+
+    updateEstimates(*pipeline, block.length, latency, now);
+    return true;
+}
+
+std::vector<network::TcpEndpoint> BlockScheduler::releaseBlock(uint32_t piece_index, uint32_t begin) {
+    std::vector<network::TcpEndpoint> holders;
+
+    for (auto& [key, pipeline] : peers_) {
+        auto& outstanding = pipeline.outstanding;
+        auto it = std::find_if(outstanding.begin(), outstanding.end(),
+                               [piece_index, begin](const Outstanding& o) {
+                                   return o.block.piece_index == piece_index && o.block.begin == begin;
+                               });
+        if (it != outstanding.end()) {
+            outstanding.erase(it);
+            total_outstanding_--;
+            holders.push_back(pipeline.endpoint);
+        }
+    }
+
+    return holders;
+}
+
+std::vector<BlockScheduler::TimedOutBlock> BlockScheduler::collectTimedOut(Clock::time_point now) {
+    std::vector<TimedOutBlock> result;
+
+    for (auto& [key, pipeline] : peers_) {
+        auto timeout = timeoutFor(pipeline);
+        auto& outstanding = pipeline.outstanding;
+
+        auto expired = std::stable_partition(outstanding.begin(), outstanding.end(),
+                                             [now, timeout](const Outstanding& o) {
+                                                 return now - o.sent_time < timeout;
+                                             });
+        if (expired == outstanding.end()) {
+            continue;
+        }
+
+        for (auto it = expired; it != outstanding.end(); ++it) {
+            result.push_back({pipeline.endpoint, it->block});
+        }
+        total_outstanding_ -= static_cast<size_t>(outstanding.end() - expired);
+        outstanding.erase(expired, outstanding.end());
+
+        // 超时说明管道过深或 Peer 变慢：速度估计减半，管道随之缩小
+        if (pipeline.has_rate) {
+            pipeline.rate /= 2;
+        }
+    }
+
+    return result;
+}
+
+// ============================================================================
+// 查询
+// ============================================================================
+
+size_t BlockScheduler::freeSlots(const network::TcpEndpoint& peer) const {
+    const auto* pipeline = find(peer);
+    if (!pipeline || pipeline->choked) {
+        return 0;
+    }
+
+    size_t depth = targetDepth(*pipeline);
+    return depth > pipeline->outstanding.size() ? depth - pipeline->outstanding.size() : 0;
+}
+
+size_t BlockScheduler::queueDepth(const network::TcpEndpoint& peer) const {
+    const auto* pipeline = find(peer);
+    return pipeline ? targetDepth(*pipeline) : 0;
+}
+
+size_t BlockScheduler::outstanding(const network::TcpEndpoint& peer) const {
+    const auto* pipeline = find(peer);
+    return pipeline ? pipeline->outstanding.size() : 0;
+}
+
+std::chrono::milliseconds BlockScheduler::blockTimeout(const network::TcpEndpoint& peer) const {
+    const auto* pipeline = find(peer);
+    return pipeline ? timeoutFor(*pipeline) : config_.initial_block_timeout;
+}
+
+double BlockScheduler::downloadRate(const network::TcpEndpoint& peer) const {
+    const auto* pipeline = find(peer);
+    return pipeline ? pipeline->rate : 0;
+}
+
+bool BlockScheduler::isRequested(uint32_t piece_index, uint32_t begin) const {
+    for (const auto& [key, pipeline] : peers_) {
+        if (isRequestedFrom(pipeline.endpoint, piece_index, begin)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BlockScheduler::isRequestedFrom(const network::TcpEndpoint& peer, uint32_t piece_index,
+                                     uint32_t begin) const {
+    const auto* pipeline = find(peer);
+    if (!pipeline) {
+        return false;
+    }
+
+    return std::any_of(pipeline->outstanding.begin(), pipeline->outstanding.end(),
+                       [piece_index, begin](const Outstanding& o) {
+                           return o.block.piece_index == piece_index && o.block.begin == begin;
+                       });
+}
+
+std::vector<BlockScheduler::OutstandingBlock> BlockScheduler::outstandingBlocks() const {
+    std::vector<BlockInfo> all;
+    all.reserve(total_outstanding_);
+    for (const auto& [key, pipeline] : peers_) {
+        for (const auto& o : pipeline.outstanding) {
+            all.push_back(o.block);
+        }
+    }
+
+    auto less = [](const BlockInfo& a, const BlockInfo& b) {
+        return a.piece_index != b.piece_index ? a.piece_index < b.piece_index : a.begin < b.begin;
+    };
+    std::sort(all.begin(), all.end(), less);
+
+    std::vector<OutstandingBlock> result;
+    for (const auto& block : all) {
+        if (!result.empty() && result.back().block.piece_index == block.piece_index &&
+            result.back().block.begin == block.begin) {
+            result.back().requests++;
+        } else {
+            result.push_back({block, 1});
+        }
+    }
+
+    std::stable_sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+        return a.requests < b.requests;
+    });
+    return result;
+}
+
+// ============================================================================
+// 内部方法
+// ============================================================================
+
+BlockScheduler::PeerPipeline* BlockScheduler::find(const network::TcpEndpoint& peer) {
+    auto it = peers_.find(peer.toString());
+    return it != peers_.end() ? &it->second : nullptr;
+}
+
+const BlockScheduler::PeerPipeline* BlockScheduler::find(const network::TcpEndpoint& peer) const {
+    auto it = peers_.find(peer.toString());
+    return it != peers_.end() ? &it->second : nullptr;
+}
+
+size_t BlockScheduler::targetDepth(const PeerPipeline& pipeline) const {
+    if (!pipeline.has_rate || !pipeline.has_rtt) {
+        return std::clamp(config_.initial_queue_depth, config_.min_queue_depth, config_.max_queue_depth);
+    }
+
+    // 带宽时延积：在一个 RTT 内对方能发出的字节数
+    double rtt_seconds = static_cast<double>(pipeline.min_rtt.count()) / 1e6;
+    double bdp_blocks = pipeline.rate * rtt_seconds / BlockInfo::kDefaultBlockSize;
+
+    size_t depth = static_cast<size_t>(std::ceil(bdp_blocks)) + config_.queue_headroom;
+    return std::clamp(depth, config_.min_queue_depth, config_.max_queue_depth);
+}
+
+std::chrono::milliseconds BlockScheduler::timeoutFor(const PeerPipeline& pipeline) const {
+    if (!pipeline.has_rtt) {
+        return config_.initial_block_timeout;
+    }
+
+    auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+        pipeline.srtt * config_.timeout_latency_factor);
+    return std::clamp(timeout, config_.min_block_timeout, config_.max_block_timeout);
+}
+
+std::vector<BlockInfo> BlockScheduler::drain(PeerPipeline& pipeline) {
+    std::vector<BlockInfo> blocks;
+    blocks.reserve(pipeline.outstanding.size());
+    for (const auto& o : pipeline.outstanding) {
+        blocks.push_back(o.block);
+    }
+
+    total_outstanding_ -= pipeline.outstanding.size();
+    pipeline.outstanding.clear();
+    return blocks;
+}
+
+void BlockScheduler::updateEstimates(PeerPipeline& pipeline, size_t bytes,
+                                     std::chrono::microseconds latency, Clock::time_point now) {
+    // 请求延迟：平滑值用于超时，窗口最小值近似 RTT（不含排队）
+    if (!pipeline.has_rtt) {
+        pipeline.srtt = latency;
+        pipeline.min_rtt = latency;
+        pipeline.window_min_rtt = latency;
+        pipeline.rtt_window_start = now;
+        pipeline.has_rtt = true;
+    } else {
+        pipeline.srtt = (pipeline.srtt * 7 + latency) / 8;
+        pipeline.min_rtt = std::min(pipeline.min_rtt, latency);
+        pipeline.window_min_rtt = pipeline.window_min_rtt.count() == 0
+                                      ? latency
+                                      : std::min(pipeline.window_min_rtt, latency);
+
+        // 窗口过期后采用本窗口的最小值，使 RTT 能随网络变化上升
+        if (now - pipeline.rtt_window_start >= config_.min_rtt_window) {
+            pipeline.min_rtt = pipeline.window_min_rtt;
+            pipeline.window_min_rtt = std::chrono::microseconds(0);
+            pipeline.rtt_window_start = now;
+        }
+    }
+
+    // 速度：按采样窗口统计，EWMA 平滑
+    pipeline.window_bytes += bytes;
+    auto elapsed = now - pipeline.window_start;
+    if (elapsed >= config_.rate_sample_interval) {
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        double sample = static_cast<double>(pipeline.window_bytes) / seconds;
+
+        pipeline.rate = pipeline.has_rate ? pipeline.rate * 0.7 + sample * 0.3 : sample;
+        pipeline.has_rate = true;
+
+        pipeline.window_bytes = 0;
+        pipeline.window_start = now;
+    }
+}
+
+} // namespace magnet::protocols
@@ -151,6 +151,15 @@ BtMessage BtMessage::createPiece(const PieceBlock& block) {
     return msg;
 }
 
+BtMessage BtMessage::createPiece(uint32_t piece_index, uint32_t begin, utils::BufferHandle block) {
+    BtMessage msg;
+    msg.type_ = BtMessageType::Piece;
+    msg.piece_index_ = piece_index;
+    msg.begin_ = begin;
+    msg.pooled_data_ = std::move(block);
+    return msg;
+}
+
 BtMessage BtMessage::createCancel(const BlockInfo& block) {
     BtMessage msg;
     msg.type_ = BtMessageType::Cancel;
@@ -179,87 +188,113 @@ BtMessage BtMessage::createExtended(uint8_t extension_id, const std::vector<uint
 // BtMessage 编码
 // ============================================================================
 
-std::vector<uint8_t> BtMessage::encode() const {
-    std::vector<uint8_t> result;
+size_t BtMessage::encodedSize() const {
+    switch (type_) {
+        case BtMessageType::KeepAlive:
+            return 4;
+        case BtMessageType::Choke:
+        case BtMessageType::Unchoke:
+        case BtMessageType::Interested:
+        case BtMessageType::NotInterested:
+            return 5;
+        case BtMessageType::Have:
+            return 9;
+        case BtMessageType::Bitfield:
+            return 5 + (bitfield_.size() + 7) / 8;
+        case BtMessageType::Request:
+        case BtMessageType::Cancel:
+            return 17;
+        case BtMessageType::Piece:
+            return 13 + data().size();
+        case BtMessageType::Port:
+            return 7;
+        case BtMessageType::Extended:
+            return 6 + payload_.size();
+    }
+    return 0;
+}
+
+void BtMessage::encodeInto(uint8_t* out) const {
+    // length 字段不包含自身
+    bt::storeUint32BE(out, static_cast<uint32_t>(encodedSize() - 4));
+    if (type_ == BtMessageType::KeepAlive) {
+        return;
+    }
+    out[4] = static_cast<uint8_t>(type_);
+    uint8_t* body = out + 5;
     
     switch (type_) {
         case BtMessageType::KeepAlive:
-            // length = 0
-            bt::writeUint32BE(result, 0);
-            break;
-            
         case BtMessageType::Choke:
         case BtMessageType::Unchoke:
         case BtMessageType::Interested:
         case BtMessageType::NotInterested:
-            // length = 1, id only
-            bt::writeUint32BE(result, 1);
-            result.push_back(static_cast<uint8_t>(type_));
+            // id only
             break;
             
         case BtMessageType::Have:
-            // length = 5, id + piece_index
-            bt::writeUint32BE(result, 5);
-            result.push_back(static_cast<uint8_t>(type_));
-            bt::writeUint32BE(result, piece_index_);
+            // id + piece_index
+            bt::storeUint32BE(body, piece_index_);
             break;
             
         case BtMessageType::Bitfield: {
             // 将 bitfield 转换为字节数组
             size_t byte_count = (bitfield_.size() + 7) / 8;
-            std::vector<uint8_t> bitfield_bytes(byte_count, 0);
-            
+            std::memset(body, 0, byte_count);
             for (size_t i = 0; i < bitfield_.size(); ++i) {
                 if (bitfield_[i]) {
-                    bitfield_bytes[i / 8] |= (1 << (7 - (i % 8)));
+                    body[i / 8] |= (1 << (7 - (i % 8)));
                 }
             }
-            
-            // length = 1 + N
-            bt::writeUint32BE(result, static_cast<uint32_t>(1 + bitfield_bytes.size()));
-            result.push_back(static_cast<uint8_t>(type_));
-            result.insert(result.end(), bitfield_bytes.begin(), bitfield_bytes.end());
             break;
         }
             
         case BtMessageType::Request:
         case BtMessageType::Cancel:
-            // length = 13, id + index + begin + length
-            bt::writeUint32BE(result, 13);
-            result.push_back(static_cast<uint8_t>(type_));
-            bt::writeUint32BE(result, piece_index_);
-            bt::writeUint32BE(result, begin_);
-            bt::writeUint32BE(result, length_);
+            // id + index + begin + length
+            bt::storeUint32BE(body, piece_index_);
+            bt::storeUint32BE(body + 4, begin_);
+            bt::storeUint32BE(body + 8, length_);
             break;
             
-        case BtMessageType::Piece:
-            // length = 9 + N, id + index + begin + data
-            bt::writeUint32BE(result, static_cast<uint32_t>(9 + data_.size()));
-            result.push_back(static_cast<uint8_t>(type_));
-            bt::writeUint32BE(result, piece_index_);
-            bt::writeUint32BE(result, begin_);
-            result.insert(result.end(), data_.begin(), data_.end());
+        case BtMessageType::Piece: {
+            // id + index + begin + data
+            auto block = data();
+            bt::storeUint32BE(body, piece_index_);
+            bt::storeUint32BE(body + 4, begin_);
+            if (!block.empty()) {
+                std::memcpy(body + 8, block.data(), block.size());
+            }
             break;
+        }
             
         case BtMessageType::Port:
-            // length = 3, id + port
-            bt::writeUint32BE(result, 3);
-            result.push_back(static_cast<uint8_t>(type_));
-            bt::writeUint16BE(result, port_);
+            // id + port
+            bt::storeUint16BE(body, port_);
             break;
             
         case BtMessageType::Extended:
-            // length = 2 + N, id + extension_id + payload
-            bt::writeUint32BE(result, static_cast<uint32_t>(2 + payload_.size()));
-            result.push_back(static_cast<uint8_t>(type_));
-            result.push_back(extended_id_);
-            result.insert(result.end(), payload_.begin(), payload_.end());
+            // id + extension_id + payload
+            body[0] = extended_id_;
+            if (!payload_.empty()) {
+                std::memcpy(body + 1, payload_.data(), payload_.size());
+            }
             break;
     }
-    
+}
+
+std::vector<uint8_t> BtMessage::encode() const {
+    std::vector<uint8_t> result(encodedSize());
+    encodeInto(result.data());
     return result;
 }
 
+utils::BufferHandle BtMessage::encodePooled() const {
+    auto buffer = utils::BufferPool::instance().acquire(encodedSize());
+    encodeInto(buffer.data());
+    return buffer;
+}
+
 // ============================================================================
 // BtMessage 解码
 // ============================================================================
@@ -347,7 +382,8 @@ std::optional<BtMessage> BtMessage::decode(const uint8_t* data, size_t len) {
             msg.type_ = BtMessageType::Piece;
             msg.piece_index_ = bt::readUint32BE(payload);
             msg.begin_ = bt::readUint32BE(payload + 4);
-            msg.data_.assign(payload + 8, payload + payload_size);
+            // 不拷贝块数据，只记录其在输入缓冲区中的位置
+            msg.borrowed_data_ = network::ByteSpan(payload + 8, payload_size - 8);
             break;
             
         case 8:  // Cancel
@@ -4,8 +4,10 @@
 
 #ifdef _WIN32
 #include <winsock2.h>
+#include <ws2tcpip.h>
 #else
 #include <arpa/inet.h>
+#include <sys/socket.h>
 #endif
 
 namespace magnet::protocols {
@@ -122,26 +124,75 @@ namespace magnet::protocols {
         return data_ < other.data_;
     }
 
+    std::string encodeCompactAddress(const std::string& ip, uint16_t port) {
+        uint8_t address[16];
+        size_t address_size = 0;
+        if (inet_pton(AF_INET, ip.c_str(), address) == 1) {
+            address_size = 4;
+        } else if (inet_pton(AF_INET6, ip.c_str(), address) == 1) {
+            address_size = 16;
+        } else {
+            return {};
+        }
+
+        std::string result(reinterpret_cast<const char*>(address), address_size);
+        uint16_t net_port = htons(port);
+        result.append(reinterpret_cast<const char*>(&net_port), 2);
+        return result;
+    }
+
+    std::optional<network::Endpoint> decodeCompactAddress(const uint8_t* data, size_t len) {
+        int family;
+        size_t address_size;
+        if (len == s_kCompactAddressSize) {
+            family = AF_INET;
+            address_size = 4;
+        } else if (len == s_kCompactAddress6Size) {
+            family = AF_INET6;
+            address_size = 16;
+        } else {
+            return std::nullopt;
+        }
+
+        char ip_str[INET6_ADDRSTRLEN];
+        if (!inet_ntop(family, data, ip_str, sizeof(ip_str))) {
+            return std::nullopt;
+        }
+
+        uint16_t net_port;
+        std::memcpy(&net_port, data + address_size, 2);
+        return network::Endpoint(ip_str, ntohs(net_port));
+    }
+
+    bool isIpv6Address(const std::string& ip) {
+        uint8_t address[16];
+        return inet_pton(AF_INET6, ip.c_str(), address) == 1;
+    }
+
     std::optional<CompactNodeInfo> CompactNodeInfo::fromBytes(const uint8_t* data, size_t len) {
-        if (len < s_kCompactNodeSize) {
+        if (len != s_kCompactNodeSize && len != s_kCompactNode6Size) {
+            return std::nullopt;
+        }
+
+        auto endpoint = decodeCompactAddress(data + 20, len - 20);
+        if (!endpoint) {
             return std::nullopt;
         }
 
         CompactNodeInfo info;
         NodeId::ByteArray id_bytes;
-
         std::memcpy(id_bytes.data(), data, 20);
         info.id_ = NodeId(id_bytes);
-
-        std::memcpy(&info.ip_, data + 20, 4);
-        std::memcpy(&info.port_, data + 24, 2);
+        info.ip_ = endpoint->ip;
+        info.port_ = endpoint->port;
         return info;
     }
 
-    std::vector<CompactNodeInfo> CompactNodeInfo::parseNodes(const std::string& data) {
+    std::vector<CompactNodeInfo> CompactNodeInfo::parseNodes(const std::string& data, bool ipv6) {
+        size_t stride = ipv6 ? s_kCompactNode6Size : s_kCompactNodeSize;
         std::vector<CompactNodeInfo> nodes;
-        for (size_t i = 0; i + s_kCompactNodeSize <= data.size(); i += s_kCompactNodeSize) {
-            auto node = fromBytes(reinterpret_cast<const uint8_t*>(data.data() + i), s_kCompactNodeSize);
+        for (size_t i = 0; i + stride <= data.size(); i += stride) {
+            auto node = fromBytes(reinterpret_cast<const uint8_t*>(data.data() + i), stride);
             if (node) {
                 nodes.push_back(*node);
             }
@@ -149,27 +200,15 @@ namespace magnet::protocols {
         return nodes;
     }
 
-    std::array<uint8_t, CompactNodeInfo::s_kCompactNodeSize> CompactNodeInfo::toBytes() const {
-        std::array<uint8_t, s_kCompactNodeSize> result;
-        std::memcpy(result.data(), id_.bytes().data(), 20);
-        std::memcpy(result.data() + 20, &ip_, 4);
-        std::memcpy(result.data() + 24, &port_, 2);
-        return result;
+    std::string CompactNodeInfo::toBytes() const {
+        std::string address = encodeCompactAddress(ip_, port_);
+        if (address.empty()) {
+            return {};
+        }
+        return id_.toString() + address;
     }
 
     DhtNode CompactNodeInfo::toDhtNode() const {
-        // 将网络字节序转换为主机字节序
-        uint32_t host_ip = ntohl(ip_);
-        uint16_t host_port = ntohs(port_);
-        
-        // 转换 IP 为字符串
-        char ip_str[16];
-        snprintf(ip_str, sizeof(ip_str), "%u.%u.%u.%u",
-            (host_ip >> 24) & 0xFF,
-            (host_ip >> 16) & 0xFF,
-            (host_ip >> 8) & 0xFF,
-            host_ip & 0xFF);
-        
-        return DhtNode(id_, ip_str, host_port);
+        return DhtNode(id_, ip_, port_);
     }
 };
\ No newline at end of file
@@ -17,11 +17,15 @@
 namespace magnet::protocols {
 
 // 日志宏定义
-#define LOG_DEBUG(msg) magnet::utils::Logger::instance().debug(msg)
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(msg)
 #define LOG_INFO(msg) magnet::utils::Logger::instance().info(msg)
 #define LOG_WARNING(msg) magnet::utils::Logger::instance().warn(msg)
 #define LOG_ERROR(msg) magnet::utils::Logger::instance().error(msg)
 
+// 查询超过 RTT 估计的这个倍数仍未响应视为慢节点（不低于 kMinSlowThreshold）
+constexpr int kSlowRttMultiplier = 3;
+constexpr std::chrono::milliseconds kMinSlowThreshold{100};
+
 // ============================================================================
 // 构造函数和析构函数
 // ============================================================================
@@ -29,15 +33,31 @@ namespace magnet::protocols {
 DhtClient::DhtClient(asio::io_context& io_context, DhtClientConfig config)
     : io_context_(io_context)
     , config_(std::move(config))
-    , my_id_(NodeId::random())
+    , state_lock_(config_.state_file)
+    , saved_state_(state_lock_.owned() ? DhtState::load(config_.state_file) : std::nullopt)
+    , my_id_(saved_state_ ? saved_state_->node_id : NodeId::random())
     , routing_table_(my_id_)
+    , routing_table6_(my_id_)
     , refresh_timer_(io_context)
+    , state_timer_(io_context)
 {
-    LOG_INFO("DhtClient created with NodeId: " + my_id_.toHex().substr(0, 16) + "...");
-    
-    // 初始化 Token 密钥
-    token_secret_ = DhtMessage::generateTransactionId(16);
-    prev_token_secret_ = token_secret_;
+    if (!config_.state_file.empty() && !state_lock_.owned()) {
+        LOG_WARNING("DHT state file " + config_.state_file +
+                    " is in use by another instance, starting with a fresh node ID");
+    }
+    LOG_INFO("DhtClient created with NodeId: " + my_id_.toHex().substr(0, 16) + "..." +
+             (saved_state_ ? " (restored, " + std::to_string(saved_state_->nodes.size()) +
+                             " saved nodes)" : std::string()));
+    
+    // 初始化 Token 密钥（沿用保存的密钥，重启前发出的 Token 仍然有效）
+    if (saved_state_ && !saved_state_->token_secret.empty()) {
+        token_secret_ = saved_state_->token_secret;
+        prev_token_secret_ = saved_state_->prev_token_secret.empty()
+            ? token_secret_ : saved_state_->prev_token_secret;
+    } else {
+        token_secret_ = DhtMessage::generateTransactionId(16);
+        prev_token_secret_ = token_secret_;
+    }
     token_rotate_time_ = std::chrono::steady_clock::now();
 }
 
@@ -65,14 +85,15 @@ void DhtClient::start() {
     query_manager_ = std::make_shared<QueryManager>(io_context_, udp_client_, config_.query_config);
     query_manager_->start();
     
-    // 启动 UDP 接收
+    // 启动 UDP 接收（批量模式，数据报直接在接收区中解析）
     auto self = shared_from_this();
-    udp_client_->startReceive([self](const network::UdpMessage& message) {
-        self->onReceive(message);
+    udp_client_->startReceiveBatch([self](const network::UdpDatagram& datagram) {
+        self->onReceive(datagram);
     });
     
     // 启动路由表刷新定时器
     scheduleRefresh();
+    scheduleStateSave();
     
     LOG_INFO("DhtClient started, listening on port " + std::to_string(udp_client_->localPort()));
 }
@@ -84,9 +105,13 @@ void DhtClient::stop() {
     
     LOG_INFO("Stopping DhtClient...");
     
+    // 路由表还完整时保存状态
+    saveState();
+    
     // 取消定时器
     asio::error_code ec;
     refresh_timer_.cancel();
+    state_timer_.cancel();
     
     // 停止 QueryManager
     if (query_manager_) {
@@ -127,10 +152,115 @@ void DhtClient::bootstrap(BootstrapCallback callback) {
         return;
     }
     
+    bootstrap_start_ = std::chrono::steady_clock::now();
+    
+    // 保存的节点只用一次：热启动失败后再次 bootstrap 直接走引导节点
+    if (saved_state_ && !saved_state_->nodes.empty()) {
+        auto nodes = std::move(saved_state_->nodes);
+        saved_state_.reset();
+        warmStart(std::move(nodes), std::move(callback));
+        return;
+    }
+    saved_state_.reset();
+    
+    bootstrapFromRouters(std::move(callback));
+}
+
+bool DhtClient::saveState() const {
+    if (!state_lock_.owned()) {
+        return false;
+    }
+    
+    DhtState state;
+    state.node_id = my_id_;
+    state.nodes = routing_table_.getGoodNodes();
+    auto nodes6 = routing_table6_.getGoodNodes();
+    state.nodes.insert(state.nodes.end(), nodes6.begin(), nodes6.end());
+    state.token_secret = token_secret_;
+    state.prev_token_secret = prev_token_secret_;
+    
+    // 还没加入网络（路由表为空）时不要覆盖上次保存的节点
+    if (state.nodes.empty()) {
+        return false;
+    }
+    return state.save(config_.state_file);
+}
+
+// ============================================================================
+// 加入网络
+// ============================================================================
+
+void DhtClient::warmStart(std::vector<DhtNode> nodes, BootstrapCallback callback) {
+    LOG_INFO("Warm start: pinging " + std::to_string(nodes.size()) + " saved nodes");
+    
+    struct WarmStartState {
+        size_t remaining;
+        size_t responded{0};
+        size_t needed;
+        bool finished{false};
+        BootstrapCallback callback;
+    };
+    auto warm = std::make_shared<WarmStartState>();
+    warm->remaining = nodes.size();
+    warm->needed = std::max<size_t>(1, std::min(config_.min_warm_start_nodes, nodes.size()));
+    warm->callback = std::move(callback);
+    
+    auto self = shared_from_this();
+    for (const auto& node : nodes) {
+        query_manager_->sendQuery(node, DhtMessage::createPing(my_id_),
+            [self, warm, node](QueryResult result) {
+                warm->remaining--;
+                if (result.is_ok()) {
+                    // 节点 ID 以响应为准（节点可能换了 ID）
+                    DhtNode responder = node;
+                    responder.id_ = result.value().senderId();
+                    responder.markResponded();
+                    self->addNode(responder);
+                    warm->responded++;
+                }
+                
+                if (warm->finished || !self->running_.load()) {
+                    return;
+                }
+                if (warm->responded >= warm->needed) {
+                    warm->finished = true;
+                    LOG_INFO("Warm start succeeded, " + std::to_string(warm->responded) +
+                             " saved nodes responded");
+                    self->finishBootstrap(true, true, std::move(warm->callback));
+                } else if (warm->remaining == 0) {
+                    warm->finished = true;
+                    LOG_WARNING("Warm start: only " + std::to_string(warm->responded) +
+                                " saved nodes responded, falling back to bootstrap nodes");
+                    self->bootstrapFromRouters(std::move(warm->callback));
+                }
+            }
+        );
+    }
+}
+
+void DhtClient::finishBootstrap(bool success, bool warm, BootstrapCallback callback) {
+    size_t node_count = nodeCount();
+    if (success) {
+        bootstrapped_.store(true);
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        statistics_.warm_started = warm;
+        statistics_.bootstrap_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - bootstrap_start_);
+    }
+    if (callback) {
+        callback(success, node_count);
+    }
+}
+
+void DhtClient::bootstrapFromRouters(BootstrapCallback callback) {
     LOG_INFO("Starting bootstrap...");
     
     auto self = shared_from_this();
     size_t pending_count = config_.bootstrap_nodes.size();
+    if (pending_count == 0) {
+        finishBootstrap(nodeCount() > 0, false, std::move(callback));
+        return;
+    }
     auto success_count = std::make_shared<std::atomic<size_t>>(0);
     auto remaining = std::make_shared<std::atomic<size_t>>(pending_count);
     
@@ -144,6 +274,7 @@ void DhtClient::bootstrap(BootstrapCallback callback) {
         
         // 发送 find_node 查询（查找自己）
         auto msg = DhtMessage::createFindNode(my_id_, my_id_);
+        applyWant(msg);
         
         query_manager_->sendQuery(bootstrap_node, std::move(msg),
             [self, callback, success_count, remaining, host, port](QueryResult result) {
@@ -157,7 +288,7 @@ void DhtClient::bootstrap(BootstrapCallback callback) {
                     // 添加节点到路由表（过滤无效节点）
                     for (const auto& node : nodes) {
                         if (node.port_ != 0) {
-                            self->routing_table_.addNode(node);
+                            self->addNode(node);
                         } else {
                             LOG_DEBUG("Skipping node with invalid port: " + node.ip_);
                         }
@@ -168,7 +299,7 @@ void DhtClient::bootstrap(BootstrapCallback callback) {
                     responder.id_ = response.senderId();
                     responder.ip_ = host;
                     responder.port_ = port;
-                    self->routing_table_.addNode(responder);
+                    self->addNode(responder);
                     
                     success_count->fetch_add(1);
                 } else {
@@ -177,20 +308,17 @@ void DhtClient::bootstrap(BootstrapCallback callback) {
                 
                 // 检查是否所有查询都完成
                 if (remaining->fetch_sub(1) == 1) {
-                    size_t node_count = self->routing_table_.nodeCount();
+                    size_t node_count = self->nodeCount();
                     bool success = success_count->load() > 0 && node_count > 0;
                     
                     if (success) {
-                        self->bootstrapped_.store(true);
                         LOG_INFO("Bootstrap completed successfully, " + 
                                  std::to_string(node_count) + " nodes in routing table");
                     } else {
                         LOG_ERROR("Bootstrap failed, no nodes in routing table");
                     }
                     
-                    if (callback) {
-                        callback(success, node_count);
-                    }
+                    self->finishBootstrap(success, false, callback);
                 }
             }
         );
@@ -229,7 +357,7 @@ void DhtClient::announce(const InfoHash& info_hash, uint16_t port) {
     // 获取最近的节点
     NodeId target_id = NodeId::fromInfoHash(info_hash);
     
-    auto closest = routing_table_.findCloset(target_id, config_.k);
+    auto closest = findClosest(target_id, config_.k);
     
     for (const auto& node : closest) {
         // 注意：这里需要有从之前 get_peers 获得的 token
@@ -256,10 +384,15 @@ DhtClientStatistics DhtClient::getStatistics() const {
     std::lock_guard<std::mutex> lock(stats_mutex_);
     DhtClientStatistics stats = statistics_;
     stats.bootstrapped = bootstrapped_.load();
-    stats.node_count = routing_table_.nodeCount();
+    stats.node_count = nodeCount();
+    stats.ipv6_node_count = routing_table6_.nodeCount();
     return stats;
 }
 
+QueryManagerStatistics DhtClient::getQueryStatistics() const {
+    return query_manager_ ? query_manager_->getStatistics() : QueryManagerStatistics{};
+}
+
 void DhtClient::resetStatistics() {
     std::lock_guard<std::mutex> lock(stats_mutex_);
     statistics_.reset();
@@ -273,32 +406,24 @@ uint16_t DhtClient::localPort() const {
 // 消息处理
 // ============================================================================
 
-void DhtClient::onReceive(const network::UdpMessage& message) {
-    LOG_DEBUG("Received UDP packet from " + message.remote_endpoint.ip + 
-              ":" + std::to_string(message.remote_endpoint.port) + 
-              ", size=" + std::to_string(message.data.size()));
+void DhtClient::onReceive(const network::UdpDatagram& datagram) {
+    LOG_DEBUG("Received UDP packet from " + datagram.remote.address().to_string() + 
+              ":" + std::to_string(datagram.remote.port()) + 
+              ", size=" + std::to_string(datagram.data.size()));
     
     // 解析消息
-    auto parsed = DhtMessage::parse(message.data);
+    auto parsed = DhtMessage::parse(datagram.data.data(), datagram.data.size());
     if (!parsed) {
-        LOG_DEBUG("Failed to parse DHT message from " + message.remote_endpoint.ip);
-        // 打印前 50 字节帮助调试
-        std::string hex;
-        for (size_t i = 0; i < std::min(message.data.size(), size_t(50)); ++i) {
-            char buf[4];
-            snprintf(buf, sizeof(buf), "%02x ", message.data[i]);
-            hex += buf;
-        }
-        LOG_DEBUG("Data (hex): " + hex);
+        LOG_DEBUG("Failed to parse DHT message from " + datagram.remote.address().to_string());
         return;
     }
     
     const auto& msg = *parsed;
-    LOG_DEBUG(std::string("Parsed DHT message: type=") + 
-              (msg.isQuery() ? "query" : (msg.isResponse() ? "response" : "error")));
     
     if (msg.isQuery()) {
-        handleQuery(msg, message.remote_endpoint);
+        // 只有查询需要回复来源地址，响应由 QueryManager 按事务 ID 匹配
+        network::UdpEndpoint sender(datagram.remote.address().to_string(), datagram.remote.port());
+        handleQuery(msg, sender);
     } else if (msg.isResponse()) {
         handleResponse(msg);
     } else if (msg.isError()) {
@@ -319,7 +444,7 @@ void DhtClient::handleQuery(const DhtMessage& message, const network::UdpEndpoin
     sender_node.id_ = message.senderId();
     sender_node.ip_ = sender.ip;
     sender_node.port_ = sender.port;
-    routing_table_.addNode(sender_node);
+    addNode(sender_node);
     
     switch (message.queryType()) {
         case DhtQueryType::Ping:
@@ -363,8 +488,8 @@ void DhtClient::handlePing(const DhtMessage& query, const network::UdpEndpoint&
 }
 
 void DhtClient::handleFindNode(const DhtMessage& query, const network::UdpEndpoint& sender) {
-    auto closest = routing_table_.findCloset(query.targetId(), config_.k);
-    auto response = DhtMessage::createFindNodeResponse(query.transactionId(), my_id_, closest);
+    auto response = DhtMessage::createFindNodeResponse(query.transactionId(), my_id_, {});
+    appendClosestNodes(response, query, sender, query.targetId());
     sendResponse(sender, response);
 }
 
@@ -388,9 +513,9 @@ void DhtClient::handleGetPeers(const DhtMessage& query, const network::UdpEndpoi
     } else {
         // 返回最近的节点
         NodeId target_id = NodeId::fromInfoHash(query.infoHash());
-        auto closest = routing_table_.findCloset(target_id, config_.k);
         auto response = DhtMessage::createGetPeersResponseWithNodes(
-            query.transactionId(), my_id_, token, closest);
+            query.transactionId(), my_id_, token, {});
+        appendClosestNodes(response, query, sender, target_id);
         sendResponse(sender, response);
     }
 }
@@ -445,34 +570,31 @@ void DhtClient::startLookup(const InfoHash& target,
                             LookupCompleteCallback on_complete) {
     std::string lookup_id = generateLookupId();
     
-    LookupState state;
+    LookupState state(target, config_);
     state.id = lookup_id;
-    state.target = target;
-    state.target_id = NodeId::fromInfoHash(target);
     state.on_peer = std::move(on_peer);
     state.on_complete = std::move(on_complete);
-    state.alpha = config_.alpha;
-    state.max_rounds = config_.max_lookup_rounds;
+    state.slow_timer = std::make_unique<asio::steady_timer>(io_context_);
     state.start_time = std::chrono::steady_clock::now();
     
-    // 从路由表获取初始节点
-    auto initial_nodes = routing_table_.findCloset(state.target_id, config_.k);
+    // 从路由表获取初始节点（填满候选列表）
+    auto initial_nodes = findClosest(state.target_id, config_.k * 3);
     
     if (initial_nodes.empty()) {
         LOG_WARNING("No nodes in routing table, cannot start lookup");
-        if (on_complete) {
-            on_complete(false, {});
+        if (state.on_complete) {
+            state.on_complete(false, {});
         }
         return;
     }
     
     for (const auto& node : initial_nodes) {
-        state.candidates[node.id_] = node;
+        state.shortlist.add(node);
     }
     
     {
         std::lock_guard<std::mutex> lock(lookups_mutex_);
-        active_lookups_[lookup_id] = std::move(state);
+        active_lookups_.emplace(lookup_id, std::move(state));
     }
     
     // 开始查找
@@ -493,20 +615,25 @@ void DhtClient::continueLookup(const std::string& lookup_id) {
         }
         
         auto& state = it->second;
+        auto& shortlist = state.shortlist;
+        bool out_of_queries = shortlist.queried() >= state.max_queries;
         
-        if (!state.shouldContinue()) {
+        if (shortlist.finished() || (out_of_queries && shortlist.inFlight() == 0)) {
             // 标记为需要完成（在锁外执行）
             should_complete = true;
             complete_success = !state.found_peers.empty();
         } else {
-            state.current_round++;
-            nodes_to_query = state.getNextNodes(state.alpha);
-            target = state.target;
-            
-            // 标记为 pending
-            for (const auto& node : nodes_to_query) {
-                state.pending.insert(node.id_);
+            auto now = std::chrono::steady_clock::now();
+            auto threshold = [this](const DhtNode& node) { return slowThreshold(node); };
+            while (shortlist.queried() < state.max_queries) {
+                auto node = shortlist.next(now, threshold);
+                if (!node) {
+                    break;
+                }
+                nodes_to_query.push_back(std::move(*node));
             }
+            target = state.target;
+            scheduleSlowCheck(lookup_id, state);
         }
     }
     
@@ -516,30 +643,25 @@ void DhtClient::continueLookup(const std::string& lookup_id) {
         return;
     }
     
-    if (nodes_to_query.empty()) {
-        completeLookup(lookup_id, false);
-        return;
-    }
-    
     auto self = shared_from_this();
     
     for (const auto& node : nodes_to_query) {
         auto msg = DhtMessage::createGetPeers(my_id_, target);
+        applyWant(msg);
         
         query_manager_->sendQuery(node, std::move(msg),
             [self, lookup_id, node](QueryResult result) {
                 if (result.is_ok()) {
                     self->handleLookupResponse(lookup_id, node, result.value());
                 } else {
-                    // 查询失败，从 pending 移除
+                    // 查询失败，腾出并发名额
                     std::lock_guard<std::mutex> lock(self->lookups_mutex_);
                     auto it = self->active_lookups_.find(lookup_id);
                     if (it != self->active_lookups_.end()) {
-                        it->second.pending.erase(node.id_);
-                        it->second.queried.insert(node.id_);
+                        it->second.shortlist.markFailed(node.id_);
                         
                         // 标记节点失败
-                        self->routing_table_.markNodeFailed(node.id_);
+                        self->routingTableFor(node.ip_).markNodeFailed(node.id_);
                     }
                 }
                 
@@ -550,6 +672,42 @@ void DhtClient::continueLookup(const std::string& lookup_id) {
     }
 }
 
+void DhtClient::scheduleSlowCheck(const std::string& lookup_id, LookupState& state) {
+    auto deadline = state.shortlist.nextDeadline();
+    if (!deadline) {
+        state.slow_timer->cancel();
+        return;
+    }
+    if (state.slow_timer->expiry() == *deadline) {
+        return;   // 已经按这个时间等待
+    }
+    
+    state.slow_timer->expires_at(*deadline);
+    auto self = shared_from_this();
+    state.slow_timer->async_wait([self, lookup_id](const asio::error_code& ec) {
+        if (ec) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(self->lookups_mutex_);
+            auto it = self->active_lookups_.find(lookup_id);
+            if (it == self->active_lookups_.end() || it->second.completed) {
+                return;
+            }
+            size_t marked = it->second.shortlist.markSlow(std::chrono::steady_clock::now());
+            LOG_DEBUG(std::to_string(marked) + " slow node(s) in " + lookup_id +
+                      ", querying further candidates");
+        }
+        self->continueLookup(lookup_id);
+    });
+}
+
+std::chrono::milliseconds DhtClient::slowThreshold(const DhtNode& node) const {
+    auto rtt = query_manager_ ? query_manager_->rttEstimate(node) : kMinSlowThreshold;
+    return std::clamp(rtt * kSlowRttMultiplier, kMinSlowThreshold,
+                      std::max(kMinSlowThreshold, config_.query_config.default_timeout));
+}
+
 void DhtClient::handleLookupResponse(const std::string& lookup_id,
                                      const DhtNode& responder,
                                      const DhtMessage& response) {
@@ -566,9 +724,7 @@ void DhtClient::handleLookupResponse(const std::string& lookup_id,
         
         auto& state = it->second;
         
-        // 从 pending 移除，添加到 queried
-        state.pending.erase(responder.id_);
-        state.queried.insert(responder.id_);
+        state.shortlist.markResponded(responder.id_);
         
         // 保存回调（用于后面在锁外调用）
         on_peer_callback = state.on_peer;
@@ -582,9 +738,10 @@ void DhtClient::handleLookupResponse(const std::string& lookup_id,
         LOG_INFO("Lookup response from " + responder.ip_ + ":" + std::to_string(responder.port_) +
                  " - hasPeers=" + std::string(response.hasPeers() ? "YES" : "no") +
                  ", hasNodes=" + std::string(response.hasNodes() ? "yes" : "no") +
-                 ", round=" + std::to_string(state.current_round) + "/" + std::to_string(state.max_rounds) +
-                 ", queried=" + std::to_string(state.queried.size()) +
-                 ", candidates=" + std::to_string(state.candidates.size()));
+                 ", queried=" + std::to_string(state.shortlist.queried()) + "/" +
+                 std::to_string(state.max_queries) +
+                 ", in_flight=" + std::to_string(state.shortlist.inFlight()) +
+                 ", slow=" + std::to_string(state.shortlist.slow()));
         
         // 处理 Peers
         if (response.hasPeers()) {
@@ -614,18 +771,22 @@ void DhtClient::handleLookupResponse(const std::string& lookup_id,
         if (response.hasNodes()) {
             nodes_to_add = response.getNodes();
             LOG_DEBUG("Got " + std::to_string(nodes_to_add.size()) + " closer nodes");
-            state.addNodes(nodes_to_add);
+            for (const auto& node : nodes_to_add) {
+                if (node.id_ != my_id_) {
+                    state.shortlist.add(node);
+                }
+            }
         }
     }
     
     // 在锁外更新路由表
     DhtNode updated_responder = responder;
     updated_responder.id_ = response.senderId();
-    routing_table_.addNode(updated_responder);
-    routing_table_.markNodeResponded(response.senderId());
+    addNode(updated_responder);
+    routingTableFor(responder.ip_).markNodeResponded(response.senderId());
     
     for (const auto& node : nodes_to_add) {
-        routing_table_.addNode(node);
+        addNode(node);
     }
     
     // 在锁外调用回调，避免死锁
@@ -653,6 +814,7 @@ void DhtClient::completeLookup(const std::string& lookup_id, bool success) {
         
         auto& state = it->second;
         state.completed = true;
+        state.slow_timer->cancel();
         callback = state.on_complete;
         peers = state.found_peers;
         
@@ -660,7 +822,9 @@ void DhtClient::completeLookup(const std::string& lookup_id, bool success) {
         auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
         
         LOG_INFO("Lookup completed in " + std::to_string(elapsed_ms) + "ms, found " +
-                 std::to_string(peers.size()) + " peers");
+                 std::to_string(peers.size()) + " peers, " +
+                 std::to_string(state.shortlist.queried()) + " queries (" +
+                 std::to_string(state.shortlist.responded()) + " responded)");
         
         active_lookups_.erase(it);
     }
@@ -697,31 +861,49 @@ void DhtClient::scheduleRefresh() {
     });
 }
 
+void DhtClient::scheduleStateSave() {
+    if (!running_.load() || !state_lock_.owned()) {
+        return;
+    }
+    
+    auto self = shared_from_this();
+    state_timer_.expires_after(config_.state_save_interval);
+    state_timer_.async_wait([self](const asio::error_code& ec) {
+        if (!ec && self->running_.load()) {
+            self->saveState();
+            self->scheduleStateSave();
+        }
+    });
+}
+
 void DhtClient::refreshRoutingTable() {
     LOG_DEBUG("Refreshing routing table...");
     
-    // 获取需要刷新的桶
-    auto stale_buckets = routing_table_.getStaleBuckets();
-    
-    for (size_t bucket_idx : stale_buckets) {
-        // 生成该桶范围内的随机 ID
-        NodeId random_id = routing_table_.getRandomIdInBucket(bucket_idx);
+    // 两张路由表分别刷新需要刷新的桶
+    for (auto* table : {&routing_table_, &routing_table6_}) {
+        auto stale_buckets = table->getStaleBuckets();
         
-        // 查找该 ID 附近的节点
-        auto closest = routing_table_.findCloset(random_id, config_.alpha);
-        
-        for (const auto& node : closest) {
-            auto msg = DhtMessage::createFindNode(my_id_, random_id);
-            query_manager_->sendQuery(node, std::move(msg),
-                [this](QueryResult result) {
-                    if (result.is_ok()) {
-                        auto nodes = result.value().getNodes();
-                        for (const auto& node : nodes) {
-                            routing_table_.addNode(node);
+        for (size_t bucket_idx : stale_buckets) {
+            // 生成该桶范围内的随机 ID
+            NodeId random_id = table->getRandomIdInBucket(bucket_idx);
+            
+            // 查找该 ID 附近的节点
+            auto closest = table->findCloset(random_id, config_.alpha);
+            
+            for (const auto& node : closest) {
+                auto msg = DhtMessage::createFindNode(my_id_, random_id);
+                applyWant(msg);
+                query_manager_->sendQuery(node, std::move(msg),
+                    [this](QueryResult result) {
+                        if (result.is_ok()) {
+                            auto nodes = result.value().getNodes();
+                            for (const auto& node : nodes) {
+                                addNode(node);
+                            }
                         }
                     }
-                }
-            );
+                );
+            }
         }
     }
     
@@ -780,6 +962,65 @@ bool DhtClient::verifyToken(const network::UdpEndpoint& node, const std::string&
     return old_token == token;
 }
 
+// ============================================================================
+// 路由表
+// ============================================================================
+
+RoutingTable& DhtClient::routingTableFor(const std::string& ip) {
+    return isIpv6Address(ip) ? routing_table6_ : routing_table_;
+}
+
+void DhtClient::addNode(const DhtNode& node) {
+    routingTableFor(node.ip_).addNode(node);
+}
+
+std::vector<DhtNode> DhtClient::findClosest(const NodeId& target, size_t count,
+                                            bool ipv4, bool ipv6) const {
+    std::vector<DhtNode> result;
+    if (ipv4) {
+        result = routing_table_.findCloset(target, count);
+    }
+    if (ipv6) {
+        auto closest6 = routing_table6_.findCloset(target, count);
+        result.insert(result.end(), closest6.begin(), closest6.end());
+    }
+    return result;
+}
+
+void DhtClient::appendClosestNodes(DhtMessage& response, const DhtMessage& query,
+                                   const network::UdpEndpoint& sender, const NodeId& target) const {
+    bool ipv4 = true;
+    bool ipv6 = true;
+    if (query.hasWant()) {
+        ipv4 = query.wantsIpv4();
+        ipv6 = query.wantsIpv6();
+    } else {
+        ipv6 = isIpv6Address(sender.ip);
+        ipv4 = !ipv6;
+    }
+    
+    std::array<RoutingTable::NodeRecord, RoutingTable::s_kBucketSize> closest;
+    size_t count = std::min(config_.k, closest.size());
+    auto append = [&](const RoutingTable& table) {
+        size_t found = table.findClosest(target, closest.data(), count);
+        for (size_t i = 0; i < found; ++i) {
+            response.appendCompactNode(closest[i].id, closest[i].address.data(), closest[i].address_size);
+        }
+    };
+    if (ipv4) {
+        append(routing_table_);
+    }
+    if (ipv6) {
+        append(routing_table6_);
+    }
+}
+
+void DhtClient::applyWant(DhtMessage& query) const {
+    if (udp_client_ && udp_client_->isDualStack()) {
+        query.setWant(true, true);
+    }
+}
+
 // ============================================================================
 // 工具方法
 // ============================================================================
@@ -18,7 +18,7 @@
 namespace magnet::protocols {
 
 // Helper macros for logging
-#define LOG_DEBUG(msg) magnet::utils::Logger::instance().debug(std::string("[DhtMessage] ") + msg)
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(std::string("[DhtMessage] ") + msg)
 #define LOG_WARN(msg) magnet::utils::Logger::instance().warn(std::string("[DhtMessage] ") + msg)
 
 // ============================================================================
@@ -91,7 +91,7 @@ DhtMessage DhtMessage::createFindNodeResponse(const std::string& transaction_id,
     msg.type_ = DhtMessageType::Response;
     msg.transaction_id_ = transaction_id;
     msg.sender_id_ = my_id;
-    msg.nodes_data_ = nodesToCompact(nodes);
+    msg.setNodes(nodes);
     return msg;
 }
 
@@ -117,7 +117,7 @@ DhtMessage DhtMessage::createGetPeersResponseWithNodes(const std::string& transa
     msg.transaction_id_ = transaction_id;
     msg.sender_id_ = my_id;
     msg.token_ = token;
-    msg.nodes_data_ = nodesToCompact(nodes);
+    msg.setNodes(nodes);
     return msg;
 }
 
@@ -136,7 +136,11 @@ DhtMessage DhtMessage::createError(const std::string& transaction_id,
 // ============================================================================
 
 std::optional<DhtMessage> DhtMessage::parse(const std::vector<uint8_t>& data) {
-    std::string_view sv(reinterpret_cast<const char*>(data.data()), data.size());
+    return parse(data.data(), data.size());
+}
+
+std::optional<DhtMessage> DhtMessage::parse(const uint8_t* data, size_t size) {
+    std::string_view sv(reinterpret_cast<const char*>(data), size);
     auto bencode_result = Bencode::decode(sv);
     if (!bencode_result) {
         LOG_WARN("Failed to decode Bencode data");
@@ -243,6 +247,20 @@ std::optional<DhtMessage> DhtMessage::parse(const BencodeValue& value) {
             }
         }
         
+        // Parse want (BEP 32)
+        if (msg.query_type_ == DhtQueryType::FindNode ||
+            msg.query_type_ == DhtQueryType::GetPeers) {
+            auto want_it = args.find(krpc::kWant);
+            if (want_it != args.end() && want_it->second.isList()) {
+                for (const auto& w : want_it->second.asList()) {
+                    if (w.isString()) {
+                        msg.want_n4_ |= (w.asString() == krpc::kWantN4);
+                        msg.want_n6_ |= (w.asString() == krpc::kWantN6);
+                    }
+                }
+            }
+        }
+        
         // Parse announce_peer specific fields
         if (msg.query_type_ == DhtQueryType::AnnouncePeer) {
             auto token_it = args.find(krpc::kToken);
@@ -297,6 +315,11 @@ std::optional<DhtMessage> DhtMessage::parse(const BencodeValue& value) {
             msg.nodes_data_ = nodes_it->second.asString();
         }
         
+        auto nodes6_it = resp.find(krpc::kNodes6);
+        if (nodes6_it != resp.end() && nodes6_it->second.isString()) {
+            msg.nodes6_data_ = nodes6_it->second.asString();
+        }
+        
         // Parse values (peer list)
         auto values_it = resp.find(krpc::kValues);
         if (values_it != resp.end()) {
@@ -377,6 +400,18 @@ BencodeValue DhtMessage::toBencode() const {
             args[krpc::kTarget] = BencodeValue(target_id_.toString());
         }
         
+        if ((query_type_ == DhtQueryType::FindNode || query_type_ == DhtQueryType::GetPeers) &&
+            hasWant()) {
+            BencodeList want;
+            if (want_n4_) {
+                want.push_back(BencodeValue(krpc::kWantN4));
+            }
+            if (want_n6_) {
+                want.push_back(BencodeValue(krpc::kWantN6));
+            }
+            args[krpc::kWant] = BencodeValue(want);
+        }
+        
         if (query_type_ == DhtQueryType::GetPeers || 
             query_type_ == DhtQueryType::AnnouncePeer) {
             // Convert InfoHash bytes to string
@@ -409,6 +444,10 @@ BencodeValue DhtMessage::toBencode() const {
             resp[krpc::kNodes] = BencodeValue(nodes_data_);
         }
         
+        if (!nodes6_data_.empty()) {
+            resp[krpc::kNodes6] = BencodeValue(nodes6_data_);
+        }
+        
         if (!peers_data_.empty()) {
             BencodeList values;
             for (const auto& peer : peers_data_) {
@@ -443,12 +482,10 @@ std::vector<uint8_t> DhtMessage::encode() const {
 std::vector<DhtNode> DhtMessage::getNodes() const {
     std::vector<DhtNode> result;
     
-    if (nodes_data_.empty()) {
-        return result;
+    for (const auto& cn : CompactNodeInfo::parseNodes(nodes_data_)) {
+        result.push_back(cn.toDhtNode());
     }
-    
-    auto compact_nodes = CompactNodeInfo::parseNodes(nodes_data_);
-    for (const auto& cn : compact_nodes) {
+    for (const auto& cn : CompactNodeInfo::parseNodes(nodes6_data_, true)) {
         result.push_back(cn.toDhtNode());
     }
     
@@ -459,14 +496,12 @@ std::vector<PeerInfo> DhtMessage::getPeers() const {
     std::vector<PeerInfo> result;
     
     for (const auto& peer_data : peers_data_) {
-        if (peer_data.size() >= CompactPeerInfo::s_kCompactPeerSize) {
-            auto peer = CompactPeerInfo::fromBytes(
-                reinterpret_cast<const uint8_t*>(peer_data.data()),
-                peer_data.size()
-            );
-            if (peer) {
-                result.emplace_back(peer->ipString(), peer->hostPort());
-            }
+        auto peer = CompactPeerInfo::fromBytes(
+            reinterpret_cast<const uint8_t*>(peer_data.data()),
+            peer_data.size()
+        );
+        if (peer) {
+            result.emplace_back(peer->ipString(), peer->hostPort());
         }
     }
     
@@ -490,34 +525,39 @@ std::string DhtMessage::generateTransactionId(size_t length) {
     return tid;
 }
 
-std::string DhtMessage::nodesToCompact(const std::vector<DhtNode>& nodes) {
-    std::string result;
-    result.reserve(nodes.size() * CompactNodeInfo::s_kCompactNodeSize);
+void DhtMessage::setWant(bool ipv4, bool ipv6) {
+    want_n4_ = ipv4;
+    want_n6_ = ipv6;
+}
+
+void DhtMessage::setNodes(const std::vector<DhtNode>& nodes) {
+    nodes_data_.clear();
+    nodes6_data_.clear();
     
     for (const auto& node : nodes) {
-        // NodeId (20 bytes)
-        const auto& id_bytes = node.id_.bytes();
-        result.append(reinterpret_cast<const char*>(id_bytes.data()), id_bytes.size());
-        
-        // IP address (4 bytes, network byte order)
-        // Parse IP string to uint32_t
-        uint32_t ip = 0;
-        unsigned int a = 0, b = 0, c = 0, d = 0;
-#ifdef _MSC_VER
-        if (sscanf_s(node.ip_.c_str(), "%u.%u.%u.%u", &a, &b, &c, &d) == 4) {
-#else
-        if (sscanf(node.ip_.c_str(), "%u.%u.%u.%u", &a, &b, &c, &d) == 4) {
-#endif
-            ip = htonl((a << 24) | (b << 16) | (c << 8) | d);
+        CompactNodeInfo compact{node.id_, node.ip_, node.port_};
+        std::string bytes = compact.toBytes();
+        if (bytes.size() == CompactNodeInfo::s_kCompactNodeSize) {
+            nodes_data_ += bytes;
+        } else if (bytes.size() == CompactNodeInfo::s_kCompactNode6Size) {
+            nodes6_data_ += bytes;
         }
-        result.append(reinterpret_cast<const char*>(&ip), 4);
-        
-        // Port (2 bytes, network byte order)
-        uint16_t port = htons(node.port_);
-        result.append(reinterpret_cast<const char*>(&port), 2);
+    }
+}
+
+void DhtMessage::appendCompactNode(const NodeId& id, const uint8_t* address, size_t address_size) {
+    std::string* target = nullptr;
+    if (address_size == s_kCompactAddressSize) {
+        target = &nodes_data_;
+    } else if (address_size == s_kCompactAddress6Size) {
+        target = &nodes6_data_;
+    } else {
+        return;
     }
     
-    return result;
+    const auto& id_bytes = id.bytes();
+    target->append(reinterpret_cast<const char*>(id_bytes.data()), id_bytes.size());
+    target->append(reinterpret_cast<const char*>(address), address_size);
 }
 
 std::vector<std::string> DhtMessage::peersToCompact(const std::vector<PeerInfo>& peers) {
@@ -525,26 +565,10 @@ std::vector<std::string> DhtMessage::peersToCompact(const std::vector<PeerInfo>&
     result.reserve(peers.size());
     
     for (const auto& peer : peers) {
-        std::string compact;
-        compact.reserve(CompactPeerInfo::s_kCompactPeerSize);
-        
-        // IP address (4 bytes, network byte order)
-        uint32_t ip = 0;
-        unsigned int a = 0, b = 0, c = 0, d = 0;
-#ifdef _MSC_VER
-        if (sscanf_s(peer.ip.c_str(), "%u.%u.%u.%u", &a, &b, &c, &d) == 4) {
-#else
-        if (sscanf(peer.ip.c_str(), "%u.%u.%u.%u", &a, &b, &c, &d) == 4) {
-#endif
-            ip = htonl((a << 24) | (b << 16) | (c << 8) | d);
+        std::string compact = encodeCompactAddress(peer.ip, peer.port);
+        if (!compact.empty()) {
+            result.push_back(std::move(compact));
         }
-        compact.append(reinterpret_cast<const char*>(&ip), 4);
-        
-        // Port (2 bytes, network byte order)
-        uint16_t port = htons(peer.port);
-        compact.append(reinterpret_cast<const char*>(&port), 2);
-        
-        result.push_back(compact);
     }
     
     return result;
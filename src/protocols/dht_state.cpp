@@ -0,0 +1,236 @@
+#include "magnet/protocols/dht_state.h"
+#include "magnet/protocols/bencode.h"
+#include "magnet/utils/logger.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#include <share.h>
+#else
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace magnet::protocols {
+
+// 日志宏
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(std::string("[DhtState] ") + msg)
+#define LOG_WARN(msg) magnet::utils::Logger::instance().warn(std::string("[DhtState] ") + msg)
+
+namespace {
+
+const char* const kId = "id";
+const char* const kNodes = "nodes";
+const char* const kNodes6 = "nodes6";
+const char* const kSecret = "secret";
+const char* const kPrevSecret = "prev-secret";
+
+std::string stringField(const BencodeDict& dict, const char* key) {
+    auto it = dict.find(key);
+    if (it == dict.end() || !it->second.isString()) {
+        return {};
+    }
+    return it->second.asString();
+}
+
+// 在目标文件同目录下创建唯一的临时文件（rename 要求同一文件系统），返回描述符
+int createTempFile(const std::string& path, std::string& temp_path) {
+    temp_path = path + ".XXXXXX";
+#ifdef _WIN32
+    if (::_mktemp_s(temp_path.data(), temp_path.size() + 1) != 0) {
+        return -1;
+    }
+    int fd = -1;
+    ::_sopen_s(&fd, temp_path.c_str(), _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY,
+               _SH_DENYNO, _S_IREAD | _S_IWRITE);
+    return fd;
+#else
+    // mkstemp 以 0600 创建，令牌密钥从不以更宽的权限落盘
+    return ::mkstemp(temp_path.data());
+#endif
+}
+
+bool writeAll(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+#ifdef _WIN32
+        int n = ::_write(fd, data.data() + written, static_cast<unsigned>(data.size() - written));
+#else
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+#endif
+        if (n <= 0) {
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool closeFile(int fd) {
+#ifdef _WIN32
+    return ::_close(fd) == 0;
+#else
+    return ::close(fd) == 0;
+#endif
+}
+
+} // namespace
+
+// ============================================================================
+// 编解码
+// ============================================================================
+
+std::string DhtState::encode() const {
+    std::string nodes4;
+    std::string nodes6;
+    for (const auto& node : nodes) {
+        auto compact = CompactNodeInfo{node.id_, node.ip_, node.port_}.toBytes();
+        if (compact.size() == CompactNodeInfo::s_kCompactNodeSize) {
+            nodes4 += compact;
+        } else if (compact.size() == CompactNodeInfo::s_kCompactNode6Size) {
+            nodes6 += compact;
+        }
+    }
+
+    BencodeDict dict;
+    dict[kId] = BencodeValue(node_id.toString());
+    dict[kNodes] = BencodeValue(nodes4);
+    dict[kNodes6] = BencodeValue(nodes6);
+    dict[kSecret] = BencodeValue(token_secret);
+    dict[kPrevSecret] = BencodeValue(prev_token_secret);
+    return Bencode::encode(BencodeValue(dict));
+}
+
+std::optional<DhtState> DhtState::decode(std::string_view data) {
+    auto value = Bencode::decode(data);
+    if (!value || !value->isDict()) {
+        return std::nullopt;
+    }
+    const auto& dict = value->asDict();
+
+    std::string id = stringField(dict, kId);
+    if (id.size() != NodeId::s_KNodeSize) {
+        return std::nullopt;
+    }
+
+    DhtState state;
+    NodeId::ByteArray id_bytes;
+    std::copy(id.begin(), id.end(), id_bytes.begin());
+    state.node_id = NodeId(id_bytes);
+
+    for (bool ipv6 : {false, true}) {
+        for (const auto& node : CompactNodeInfo::parseNodes(stringField(dict, ipv6 ? kNodes6 : kNodes), ipv6)) {
+            state.nodes.push_back(node.toDhtNode());
+        }
+    }
+    state.token_secret = stringField(dict, kSecret);
+    state.prev_token_secret = stringField(dict, kPrevSecret);
+    return state;
+}
+
+// ============================================================================
+// 文件读写
+// ============================================================================
+
+bool DhtState::save(const std::string& path) const {
+    std::error_code ec;
+    auto parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent, ec);
+    }
+
+    // 令牌密钥泄露后别人可以替我们签发 announce_peer 令牌：
+    // 临时文件创建时即为 0600，写入内容前再确认一次
+    std::string temp_path;
+    int fd = createTempFile(path, temp_path);
+    if (fd < 0) {
+        LOG_WARN("Cannot create temporary file for " + path);
+        return false;
+    }
+    std::filesystem::permissions(temp_path,
+                                 std::filesystem::perms::owner_read | std::filesystem::perms::owner_write,
+                                 std::filesystem::perm_options::replace, ec);
+    if (ec) {
+        LOG_WARN("Cannot restrict permissions of " + temp_path + ": " + ec.message());
+        closeFile(fd);
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+    bool written = writeAll(fd, encode());
+    if (!closeFile(fd) || !written) {
+        LOG_WARN("Failed to write " + temp_path);
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec) {
+        LOG_WARN("Failed to replace " + path + ": " + ec.message());
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+
+    LOG_DEBUG("Saved " + std::to_string(nodes.size()) + " nodes to " + path);
+    return true;
+}
+
+std::optional<DhtState> DhtState::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return std::nullopt;
+    }
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    auto state = decode(data);
+    if (!state) {
+        LOG_WARN("Ignoring corrupt state file " + path);
+    }
+    return state;
+}
+
+// ============================================================================
+// DhtStateLock
+// ============================================================================
+
+DhtStateLock::DhtStateLock(const std::string& state_path) {
+    if (state_path.empty()) {
+        return;
+    }
+    std::error_code ec;
+    auto parent = std::filesystem::path(state_path).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent, ec);
+    }
+
+    std::string lock_path = state_path + ".lock";
+#ifdef _WIN32
+    // 独占共享模式打开即为锁：其他实例打开失败
+    ::_sopen_s(&fd_, lock_path.c_str(), _O_RDWR | _O_CREAT | _O_BINARY, _SH_DENYRW, _S_IREAD | _S_IWRITE);
+#else
+    int flags = O_RDWR | O_CREAT;
+#ifdef O_CLOEXEC
+    flags |= O_CLOEXEC;
+#endif
+    fd_ = ::open(lock_path.c_str(), flags, 0600);
+    if (fd_ >= 0 && ::flock(fd_, LOCK_EX | LOCK_NB) != 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+#endif
+    if (fd_ < 0) {
+        LOG_DEBUG("State file " + state_path + " is locked by another instance");
+    }
+}
+
+DhtStateLock::~DhtStateLock() {
+    if (fd_ >= 0) {
+        closeFile(fd_);    // 关闭描述符即释放锁
+    }
+}
+
+} // namespace magnet::protocols
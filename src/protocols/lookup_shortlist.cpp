@@ -0,0 +1,174 @@
+#include "magnet/protocols/lookup_shortlist.h"
+
+#include <algorithm>
+
+namespace magnet::protocols {
+
+// ============================================================================
+// 构造
+// ============================================================================
+
+LookupShortlist::LookupShortlist(const NodeId& target, size_t k, size_t alpha,
+                                 size_t max_outstanding, size_t capacity)
+    : target_(target)
+    , k_(std::max<size_t>(k, 1))
+    , alpha_(std::max<size_t>(alpha, 1))
+    , max_outstanding_(std::max(max_outstanding, alpha_))
+    , capacity_(capacity > 0 ? std::max(capacity, k_) : k_ * 3)
+{
+    entries_.reserve(capacity_ + 1);
+}
+
+// ============================================================================
+// 候选
+// ============================================================================
+
+std::vector<LookupShortlist::Entry>::iterator LookupShortlist::find(const NodeId& id) {
+    NodeId distance = target_.distance(id);
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), distance,
+        [](const Entry& entry, const NodeId& d) { return entry.distance < d; });
+    return it != entries_.end() && it->distance == distance ? it : entries_.end();
+}
+
+bool LookupShortlist::add(const DhtNode& node) {
+    if (node.port_ == 0 || node.ip_.empty()) {
+        return false;
+    }
+
+    NodeId distance = target_.distance(node.id_);
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), distance,
+        [](const Entry& entry, const NodeId& d) { return entry.distance < d; });
+
+    if (it != entries_.end() && it->distance == distance) {
+        return false;   // 已在列表中
+    }
+    if (entries_.size() >= capacity_ && it == entries_.end()) {
+        return false;   // 比所有候选都远
+    }
+
+    Entry entry;
+    entry.node = node;
+    entry.distance = distance;
+    entries_.insert(it, std::move(entry));
+
+    if (entries_.size() > capacity_) {
+        release(entries_.back());
+        entries_.pop_back();
+    }
+    return true;
+}
+
+// ============================================================================
+// 调度
+// ============================================================================
+
+std::optional<DhtNode> LookupShortlist::next(std::chrono::steady_clock::time_point now,
+                                             const SlowThreshold& threshold) {
+    if (in_flight_ + slow_ >= max_outstanding_) {
+        return std::nullopt;
+    }
+
+    // 只查询最近的 k 个有效候选（跳过失败和慢节点）。更近的节点加入后，
+    // 被挤出这个窗口的在途查询不再占用 alpha 名额，可以立即向新节点发查询
+    auto it = entries_.end();
+    size_t live = 0;
+    size_t active = 0;
+    for (auto e = entries_.begin(); e != entries_.end() && live < k_; ++e) {
+        if (e->status == Status::Failed || e->status == Status::Slow) {
+            continue;
+        }
+        if (e->status == Status::Fresh && it == entries_.end()) {
+            it = e;
+        } else if (e->status == Status::InFlight) {
+            active++;
+        }
+        live++;
+    }
+    if (it == entries_.end() || active >= alpha_) {
+        return std::nullopt;
+    }
+
+    it->status = Status::InFlight;
+    it->deadline = now + threshold(it->node);
+    in_flight_++;
+    queried_++;
+    return it->node;
+}
+
+void LookupShortlist::release(const Entry& entry) {
+    if (entry.status == Status::InFlight) {
+        in_flight_--;
+    } else if (entry.status == Status::Slow) {
+        slow_--;
+    }
+}
+
+bool LookupShortlist::markResponded(const NodeId& id) {
+    auto it = find(id);
+    if (it == entries_.end() ||
+        (it->status != Status::InFlight && it->status != Status::Slow)) {
+        return false;
+    }
+    release(*it);
+    it->status = Status::Responded;
+    responded_++;
+    return true;
+}
+
+bool LookupShortlist::markFailed(const NodeId& id) {
+    auto it = find(id);
+    if (it == entries_.end() ||
+        (it->status != Status::InFlight && it->status != Status::Slow)) {
+        return false;
+    }
+    release(*it);
+    it->status = Status::Failed;
+    return true;
+}
+
+size_t LookupShortlist::markSlow(std::chrono::steady_clock::time_point now) {
+    size_t marked = 0;
+    for (auto& entry : entries_) {
+        if (entry.status == Status::InFlight && entry.deadline <= now) {
+            entry.status = Status::Slow;
+            in_flight_--;
+            slow_++;
+            marked++;
+        }
+    }
+    return marked;
+}
+
+std::optional<std::chrono::steady_clock::time_point> LookupShortlist::nextDeadline() const {
+    std::optional<std::chrono::steady_clock::time_point> earliest;
+    for (const auto& entry : entries_) {
+        if (entry.status == Status::InFlight && (!earliest || entry.deadline < *earliest)) {
+            earliest = entry.deadline;
+        }
+    }
+    return earliest;
+}
+
+bool LookupShortlist::finished() const {
+    // 慢节点不阻塞终止：它们多半已经失效，晚到的响应仍会被计入
+    size_t responded = 0;
+    for (const auto& entry : entries_) {
+        if (responded == k_) {
+            break;
+        }
+        switch (entry.status) {
+            case Status::Responded:
+                responded++;
+                break;
+            case Status::Fresh:
+            case Status::InFlight:
+                return false;
+            case Status::Slow:
+            case Status::Failed:
+                break;
+        }
+    }
+    return true;
+}
+
+} // namespace magnet::protocols
@@ -11,7 +11,7 @@
 
 namespace magnet::protocols {
 
-#define LOG_DEBUG(msg) magnet::utils::Logger::instance().debug(std::string("[MetadataExt] ") + msg)
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(std::string("[MetadataExt] ") + msg)
 #define LOG_INFO(msg) magnet::utils::Logger::instance().info(std::string("[MetadataExt] ") + msg)
 #define LOG_WARNING(msg) magnet::utils::Logger::instance().warn(std::string("[MetadataExt] ") + msg)
 
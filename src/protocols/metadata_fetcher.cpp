@@ -7,7 +7,7 @@
 namespace magnet::protocols {
 
 // 日志宏
-#define LOG_DEBUG(msg) magnet::utils::Logger::instance().debug(std::string("[MetadataFetcher] ") + msg)
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(std::string("[MetadataFetcher] ") + msg)
 #define LOG_INFO(msg) magnet::utils::Logger::instance().info(std::string("[MetadataFetcher] ") + msg)
 #define LOG_WARNING(msg) magnet::utils::Logger::instance().warn(std::string("[MetadataFetcher] ") + msg)
 #define LOG_ERROR(msg) magnet::utils::Logger::instance().error(std::string("[MetadataFetcher] ") + msg)
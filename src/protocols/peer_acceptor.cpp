@@ -0,0 +1,243 @@
+#include "magnet/protocols/peer_acceptor.h"
+#include "magnet/protocols/peer_manager.h"
+#include "magnet/protocols/bt_message.h"
+#include "magnet/utils/logger.h"
+
+namespace magnet::protocols {
+
+// 日志宏
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(msg)
+#define LOG_INFO(msg) magnet::utils::Logger::instance().info(msg)
+#define LOG_WARNING(msg) magnet::utils::Logger::instance().warn(msg)
+#define LOG_ERROR(msg) magnet::utils::Logger::instance().error(msg)
+
+// ============================================================================
+// 构造和析构
+// ============================================================================
+
+PeerAcceptor::PeerAcceptor(asio::io_context& io_context, PeerAcceptorConfig config)
+    : io_context_(io_context)
+    , config_(std::move(config))
+    , listener_(std::make_shared<network::TcpListener>(io_context))
+{
+}
+
+PeerAcceptor::~PeerAcceptor() {
+    stop();
+}
+
+// ============================================================================
+// 监听管理
+// ============================================================================
+
+bool PeerAcceptor::listen(uint16_t port) {
+    std::weak_ptr<PeerAcceptor> weak = shared_from_this();
+    return listener_->listen(port, [weak](std::shared_ptr<network::TcpClient> client) {
+        if (auto self = weak.lock()) {
+            self->onAccepted(std::move(client));
+        } else {
+            client->close();
+        }
+    });
+}
+
+void PeerAcceptor::stop() {
+    listener_->close();
+
+    std::map<network::TcpClient*, std::shared_ptr<PendingHandshake>> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending.swap(pending_);
+    }
+
+    for (auto& [key, entry] : pending) {
+        entry->timer.cancel();
+        entry->client->close();
+    }
+}
+
+uint16_t PeerAcceptor::localPort() const {
+    return listener_->localPort();
+}
+
+void PeerAcceptor::registerTorrent(const InfoHash& info_hash, std::weak_ptr<PeerManager> manager) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    torrents_[info_hash] = std::move(manager);
+}
+
+void PeerAcceptor::unregisterTorrent(const InfoHash& info_hash) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    torrents_.erase(info_hash);
+}
+
+PeerAcceptorStatistics PeerAcceptor::getStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+}
+
+// ============================================================================
+// 内部方法
+// ============================================================================
+
+void PeerAcceptor::onAccepted(std::shared_ptr<network::TcpClient> client) {
+    auto pending = std::make_shared<PendingHandshake>(io_context_);
+    pending->client = client;
+    network::TcpClient* key = client.get();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        statistics_.accepted++;
+
+        if (pending_.size() >= config_.max_handshaking) {
+            statistics_.rejected_busy++;
+            LOG_DEBUG("Too many pending handshakes, closing " + client->remoteEndpoint().toString());
+            client->close();
+            return;
+        }
+
+        pending_[key] = pending;
+    }
+
+    // 回调只捕获弱引用和连接地址，避免 连接 → 回调 → 接受器 的引用环
+    std::weak_ptr<PeerAcceptor> weak = shared_from_this();
+
+    client->setDisconnectCallback([weak, key](const asio::error_code&) {
+        if (auto self = weak.lock()) {
+            self->drop(key);
+        }
+    });
+
+    pending->timer.expires_after(config_.handshake_timeout);
+    pending->timer.async_wait([weak, key](const asio::error_code& ec) {
+        if (ec) {
+            return;
+        }
+        if (auto self = weak.lock()) {
+            LOG_DEBUG("Incoming handshake timed out");
+            self->drop(key);
+        }
+    });
+
+    client->startReceive(pending->buffer, [weak, key](const asio::error_code& ec, size_t) {
+        if (auto self = weak.lock()) {
+            self->onHandshakeData(key, ec);
+        }
+    });
+}
+
+void PeerAcceptor::onHandshakeData(network::TcpClient* key, const asio::error_code& ec) {
+    if (ec) {
+        return;  // 非致命错误，TcpClient 会继续读取
+    }
+
+    std::shared_ptr<PendingHandshake> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = pending_.find(key);
+        if (it == pending_.end()) {
+            return;
+        }
+        pending = it->second;
+
+        // 第一个字节就不是协议名长度：不是 BitTorrent 连接（或是加密连接），不必等满握手
+        const auto& buffer = pending->buffer;
+        bool garbage = !buffer.empty() && buffer.data()[0] != Handshake::kProtocolLength;
+        if (!garbage && buffer.size() < Handshake::kSize) {
+            return;
+        }
+
+        pending_.erase(it);
+        if (garbage) {
+            statistics_.handshake_failures++;
+        }
+    }
+
+    // 握手已完整：停止在这里读取，剩余数据随连接一起转交
+    pending->timer.cancel();
+    pending->client->stopReceive();
+    pending->client->setDisconnectCallback(nullptr);
+
+    if (pending->buffer.data()[0] != Handshake::kProtocolLength) {
+        LOG_DEBUG("Not a BitTorrent handshake from " + pending->client->remoteEndpoint().toString());
+        pending->client->close();
+        return;
+    }
+
+    // 当前仍在 TcpClient 的接收回调中，转交（会重新开始读取）放到下一轮事件
+    auto self = shared_from_this();
+    asio::post(io_context_, [self, pending]() {
+        self->route(pending);
+    });
+}
+
+void PeerAcceptor::route(std::shared_ptr<PendingHandshake> pending) {
+    auto& client = pending->client;
+    network::TcpEndpoint endpoint = client->remoteEndpoint();
+
+    auto handshake = Handshake::decode(pending->buffer.data(), pending->buffer.size());
+    if (!handshake) {
+        LOG_DEBUG("Invalid handshake from " + endpoint.toString());
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            statistics_.handshake_failures++;
+        }
+        client->close();
+        return;
+    }
+
+    InfoHash info_hash(handshake->info_hash);
+    std::shared_ptr<PeerManager> manager;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = torrents_.find(info_hash);
+        if (it != torrents_.end()) {
+            manager = it->second.lock();
+        }
+        if (!manager) {
+            statistics_.rejected_unknown++;
+        }
+    }
+
+    if (!manager) {
+        LOG_DEBUG("Incoming peer " + endpoint.toString() + " asked for unknown info_hash " +
+                  info_hash.toHex().substr(0, 16) + "...");
+        client->close();
+        return;
+    }
+
+    network::ByteSpan received(pending->buffer.data(), pending->buffer.size());
+    if (!manager->acceptPeer(client, received)) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            statistics_.rejected_limit++;
+        }
+        client->close();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        statistics_.routed++;
+    }
+    LOG_INFO("Incoming peer " + endpoint.toString() + " routed to torrent " +
+             info_hash.toHex().substr(0, 16) + "...");
+}
+
+void PeerAcceptor::drop(network::TcpClient* key) {
+    std::shared_ptr<PendingHandshake> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = pending_.find(key);
+        if (it == pending_.end()) {
+            return;
+        }
+        pending = std::move(it->second);
+        pending_.erase(it);
+        statistics_.handshake_failures++;
+    }
+
+    pending->timer.cancel();
+    pending->client->close();
+}
+
+} // namespace magnet::protocols
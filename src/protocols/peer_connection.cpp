@@ -2,10 +2,13 @@
 #include "magnet/protocols/metadata_extension.h"
 #include "magnet/utils/logger.h"
 
+#include <algorithm>
+
 namespace magnet::protocols {
 
 // 日志宏
-#define LOG_DEBUG(msg) magnet::utils::Logger::instance().debug(msg)
+// 调试日志先判断级别：热路径上每个块都会调用，避免无谓地构造字符串
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(msg)
 #define LOG_INFO(msg) magnet::utils::Logger::instance().info(msg)
 #define LOG_WARNING(msg) magnet::utils::Logger::instance().warn(msg)
 #define LOG_ERROR(msg) magnet::utils::Logger::instance().error(msg)
@@ -55,11 +58,13 @@ void PeerConnection::connect(const network::TcpEndpoint& endpoint,
     peer_info_.ip = endpoint.ip;
     peer_info_.port = endpoint.port;
     connect_callback_ = std::move(callback);
+    incoming_ = false;
     
     LOG_INFO("Connecting to peer " + endpoint.toString());
     
     // 创建 TCP 客户端
     tcp_client_ = std::make_shared<network::TcpClient>(io_context_);
+    tcp_client_->setRateLimiters(download_limiter_, upload_limiter_);
     
     // 设置断线回调
     auto self = shared_from_this();
@@ -76,6 +81,58 @@ void PeerConnection::connect(const network::TcpEndpoint& endpoint,
     );
 }
 
+void PeerConnection::accept(std::shared_ptr<network::TcpClient> client,
+                            network::ByteSpan received,
+                            PeerConnectCallback callback) {
+    PeerConnectionState expected = PeerConnectionState::Disconnected;
+    if (!client || !client->isConnected() ||
+        !state_.compare_exchange_strong(expected, PeerConnectionState::Handshaking)) {
+        LOG_WARNING("PeerConnection::accept called in invalid state");
+        if (client) {
+            client->close();
+        }
+        if (callback) {
+            asio::post(io_context_, [callback]() { callback(false); });
+        }
+        return;
+    }
+    
+    auto endpoint = client->remoteEndpoint();
+    peer_info_.ip = endpoint.ip;
+    peer_info_.port = endpoint.port;
+    connect_callback_ = std::move(callback);
+    incoming_ = true;
+    tcp_client_ = std::move(client);
+    tcp_client_->setRateLimiters(download_limiter_, upload_limiter_);
+    
+    LOG_INFO("Accepted incoming peer " + endpoint.toString());
+    
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        statistics_.connect_time = std::chrono::steady_clock::now();
+        statistics_.last_activity = statistics_.connect_time;
+    }
+    
+    auto self = shared_from_this();
+    tcp_client_->setDisconnectCallback([self](const asio::error_code& ec) {
+        self->onDisconnect(ec);
+    });
+    
+    // 监听方读到的数据（对方的握手以及可能紧随其后的消息）
+    // 先处理完再开始读取：处理过程中 consume 可能重置游标，不能与进行中的读取重叠
+    receive_buffer_.append(received.data(), received.size());
+    processReceiveBuffer();
+    
+    // 握手失败时连接已断开
+    if (!tcp_client_ || state_.load() == PeerConnectionState::Disconnected) {
+        return;
+    }
+    
+    tcp_client_->startReceive(receive_buffer_, [self](const asio::error_code& ec, size_t bytes) {
+        self->onReceive(ec, bytes);
+    });
+}
+
 void PeerConnection::disconnect() {
     PeerConnectionState current = state_.load();
     if (current == PeerConnectionState::Disconnected) {
@@ -97,6 +154,7 @@ void PeerConnection::disconnect() {
     {
         std::lock_guard<std::mutex> lock(requests_mutex_);
         pending_requests_.clear();
+        incoming_requests_.clear();
     }
     
     state_.store(PeerConnectionState::Disconnected);
@@ -136,9 +194,18 @@ void PeerConnection::sendChoke() {
     
     {
         std::lock_guard<std::mutex> lock(state_mutex_);
+        if (peer_state_.am_choking) {
+            return;  // 对方本来就处于阻塞状态
+        }
         peer_state_.am_choking = true;
     }
     
+    // 阻塞后对方会认为未完成的请求都已作废（BEP 3）
+    {
+        std::lock_guard<std::mutex> lock(requests_mutex_);
+        incoming_requests_.clear();
+    }
+    
     sendMessage(BtMessage::createChoke());
     LOG_DEBUG("Sent Choke to " + peer_info_.toString());
 }
@@ -148,6 +215,9 @@ void PeerConnection::sendUnchoke() {
     
     {
         std::lock_guard<std::mutex> lock(state_mutex_);
+        if (!peer_state_.am_choking) {
+            return;
+        }
         peer_state_.am_choking = false;
     }
     
@@ -212,6 +282,34 @@ void PeerConnection::sendPiece(const PieceBlock& block) {
     }
 }
 
+void PeerConnection::sendPiece(uint32_t piece_index, uint32_t begin, utils::BufferHandle data) {
+    if (!tcp_client_ || !isConnected() || !data) return;
+    
+    size_t length = data.size();
+    
+    // 消息头：<len=9+X><id=7><index><begin>，块数据作为第二段随后发送，
+    // 两段在发送队列中合并为一次 writev
+    auto header = utils::BufferPool::instance().acquire(13);
+    bt::storeUint32BE(header.data(), static_cast<uint32_t>(9 + length));
+    header.data()[4] = static_cast<uint8_t>(BtMessageType::Piece);
+    bt::storeUint32BE(header.data() + 5, piece_index);
+    bt::storeUint32BE(header.data() + 9, begin);
+    
+    tcp_client_->send(std::move(header));
+    tcp_client_->send(std::move(data), [](const asio::error_code& ec, size_t) {
+        if (ec) {
+            LOG_DEBUG("Failed to send piece: " + ec.message());
+        }
+    });
+    
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        statistics_.messages_sent++;
+        statistics_.bytes_uploaded += length;
+        statistics_.pieces_sent++;
+    }
+}
+
 void PeerConnection::sendKeepAlive() {
     if (!isConnected()) return;
     
@@ -245,6 +343,35 @@ PeerStatistics PeerConnection::getStatistics() const {
     return statistics_;
 }
 
+// ============================================================================
+// 上传队列
+// ============================================================================
+
+bool PeerConnection::popIncomingRequest(BlockInfo& block) {
+    std::lock_guard<std::mutex> lock(requests_mutex_);
+    if (incoming_requests_.empty()) {
+        return false;
+    }
+    block = incoming_requests_.front();
+    incoming_requests_.pop_front();
+    return true;
+}
+
+size_t PeerConnection::incomingRequestCount() const {
+    std::lock_guard<std::mutex> lock(requests_mutex_);
+    return incoming_requests_.size();
+}
+
+void PeerConnection::setRateLimiters(std::shared_ptr<network::RateLimiter> download,
+                                     std::shared_ptr<network::RateLimiter> upload) {
+    download_limiter_ = std::move(download);
+    upload_limiter_ = std::move(upload);
+}
+
+size_t PeerConnection::pendingSendBytes() const {
+    return tcp_client_ ? tcp_client_->pendingSendBytes() : 0;
+}
+
 // ============================================================================
 // 回调设置
 // ============================================================================
@@ -265,6 +392,10 @@ void PeerConnection::setErrorCallback(PeerErrorCallback callback) {
     error_callback_ = std::move(callback);
 }
 
+void PeerConnection::setRequestCallback(PeerRequestCallback callback) {
+    request_callback_ = std::move(callback);
+}
+
 // ============================================================================
 // 内部方法
 // ============================================================================
@@ -292,17 +423,15 @@ void PeerConnection::onConnected(const asio::error_code& ec) {
     
     // 开始接收数据
     auto self = shared_from_this();
-    tcp_client_->startReceive([self](const asio::error_code& ec, 
-                                      const std::vector<uint8_t>& data) {
-        self->onReceive(ec, data);
+    tcp_client_->startReceive(receive_buffer_, [self](const asio::error_code& ec, size_t bytes) {
+        self->onReceive(ec, bytes);
     });
     
     // 发送握手
     sendHandshake();
 }
 
-void PeerConnection::onReceive(const asio::error_code& ec, 
-                               const std::vector<uint8_t>& data) {
+void PeerConnection::onReceive(const asio::error_code& ec, size_t /*bytes*/) {
     if (ec) {
         if (ec != asio::error::operation_aborted) {
             LOG_WARNING("Receive error: " + ec.message());
@@ -311,9 +440,17 @@ void PeerConnection::onReceive(const asio::error_code& ec,
         return;
     }
     
+    // 数据已由 TcpClient 直接读入接收缓冲区
+    processReceiveBuffer();
+}
+
+void PeerConnection::feed(const uint8_t* data, size_t size) {
     // 追加到接收缓冲区
-    receive_buffer_.insert(receive_buffer_.end(), data.begin(), data.end());
-    
+    receive_buffer_.append(data, size);
+    processReceiveBuffer();
+}
+
+void PeerConnection::processReceiveBuffer() {
     // 更新活动时间
     {
         std::lock_guard<std::mutex> lock(stats_mutex_);
@@ -348,7 +485,7 @@ void PeerConnection::sendHandshake() {
               ", info_hash=" + info_hash_.toHex().substr(0, 16) + "..." +
               ", peer_id=" + my_peer_id_.substr(0, 8) + "...");
     
-    tcp_client_->send(data, [this](const asio::error_code& ec, size_t bytes_sent) {
+    tcp_client_->send(std::move(data), [this](const asio::error_code& ec, size_t bytes_sent) {
         if (ec) {
             LOG_ERROR("Failed to send handshake: " + ec.message());
         } else {
@@ -397,6 +534,11 @@ bool PeerConnection::handleHandshake() {
     
     LOG_DEBUG("info_hash verified for " + peer_info_.toString());
     
+    // 入站连接：确认对方要的是这个种子之后才回复握手
+    if (incoming_) {
+        sendHandshake();
+    }
+    
     // 保存 peer_id
     peer_info_.peer_id = handshake->peer_id;
     
@@ -406,8 +548,7 @@ bool PeerConnection::handleHandshake() {
               (peer_supports_extension ? "yes" : "no"));
     
     // 从缓冲区移除握手数据
-    receive_buffer_.erase(receive_buffer_.begin(), 
-                          receive_buffer_.begin() + Handshake::kSize);
+    receive_buffer_.consume(Handshake::kSize);
     
     handshake_received_ = true;
     setState(PeerConnectionState::Connected);
@@ -454,9 +595,8 @@ void PeerConnection::processMessages() {
             }
         }
         
-        // 从缓冲区移除已处理的数据
-        receive_buffer_.erase(receive_buffer_.begin(), 
-                              receive_buffer_.begin() + msg_len);
+        // 只移动读游标，不搬移剩余数据（回调中断开连接时缓冲区已被清空，consume 无副作用）
+        receive_buffer_.consume(msg_len);
     }
 }
 
@@ -522,12 +662,36 @@ void PeerConnection::handleMessage(const BtMessage& msg) {
             break;
             
         case BtMessageType::Request:
-            // 对方请求数据，通知上层处理
+            {
+                // 对方请求数据：进入上传队列，由上层读盘后发送
+                BlockInfo block = msg.toBlockInfo();
+                
+                bool choking;
+                {
+                    std::lock_guard<std::mutex> lock(state_mutex_);
+                    choking = peer_state_.am_choking;
+                }
+                
+                // 阻塞期间的请求、超长请求、队列已满时的请求都直接丢弃
+                bool queued = false;
+                if (!choking && block.length > 0 && block.length <= kMaxRequestLength) {
+                    std::lock_guard<std::mutex> lock(requests_mutex_);
+                    if (incoming_requests_.size() < kMaxIncomingRequests) {
+                        incoming_requests_.push_back(block);
+                        queued = true;
+                    }
+                }
+                
+                if (queued && request_callback_) {
+                    request_callback_(block);
+                }
+            }
             break;
             
         case BtMessageType::Piece:
             {
-                auto block = msg.toPieceBlock();
+                // 块数据仍在接收缓冲区中，交给上层时不拷贝
+                auto block = msg.toPieceBlockView();
                 
                 // 从待处理请求中移除
                 {
@@ -565,7 +729,15 @@ void PeerConnection::handleMessage(const BtMessage& msg) {
             break;
             
         case BtMessageType::Cancel:
-            // 对方取消请求
+            {
+                // 对方取消请求：尚未发出的直接从上传队列移除
+                BlockInfo block = msg.toBlockInfo();
+                std::lock_guard<std::mutex> lock(requests_mutex_);
+                auto it = std::find(incoming_requests_.begin(), incoming_requests_.end(), block);
+                if (it != incoming_requests_.end()) {
+                    incoming_requests_.erase(it);
+                }
+            }
             break;
             
         case BtMessageType::Port:
@@ -588,8 +760,8 @@ void PeerConnection::sendMessage(const BtMessage& msg) {
         return;
     }
     
-    auto data = msg.encode();
-    tcp_client_->send(data, [](const asio::error_code& ec, size_t) {
+    // 编码到池化缓冲，发送队列只持有引用
+    tcp_client_->send(msg.encodePooled(), [](const asio::error_code& ec, size_t) {
         if (ec) {
             LOG_DEBUG("Failed to send message: " + ec.message());
         }
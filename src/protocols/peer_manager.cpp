@@ -7,7 +7,8 @@
 namespace magnet::protocols {
 
 // 日志宏
-#define LOG_DEBUG(msg) magnet::utils::Logger::instance().debug(msg)
+// 调试日志先判断级别：热路径上每个块都会调用，避免无谓地构造字符串
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(msg)
 #define LOG_INFO(msg) magnet::utils::Logger::instance().info(msg)
 #define LOG_WARNING(msg) magnet::utils::Logger::instance().warn(msg)
 #define LOG_ERROR(msg) magnet::utils::Logger::instance().error(msg)
@@ -166,6 +167,67 @@ void PeerManager::removePeer(const network::TcpEndpoint& endpoint) {
     LOG_DEBUG("Removed peer " + endpoint.toString());
 }
 
+bool PeerManager::acceptPeer(std::shared_ptr<network::TcpClient> client,
+                             network::ByteSpan received) {
+    if (!client || !running_.load()) {
+        return false;
+    }
+    
+    network::TcpEndpoint endpoint = client->remoteEndpoint();
+    std::string key = endpointToKey(endpoint);
+    std::shared_ptr<PeerConnection> conn;
+    
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex_);
+        
+        auto it = peers_.find(key);
+        bool busy = it != peers_.end() && (it->second.is_connecting || it->second.is_connected);
+        bool full = connected_peers_.size() + connecting_peers_.size() >= config_.max_connections;
+        if (busy || full) {
+            std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+            statistics_.incoming_rejected++;
+            LOG_DEBUG("Rejecting incoming peer " + endpoint.toString() +
+                      (busy ? ": already connected" : ": connection limit reached"));
+            return false;
+        }
+        
+        // 已知但尚未连接的 Peer 直接复用条目
+        if (it == peers_.end()) {
+            it = peers_.emplace(key, PeerEntry(endpoint)).first;
+            std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+            statistics_.total_peers_known++;
+        }
+        
+        it->second.is_incoming = true;
+        it->second.is_connecting = true;
+        it->second.last_connect_attempt = std::chrono::steady_clock::now();
+        it->second.connection = std::make_shared<PeerConnection>(io_context_, info_hash_, my_peer_id_);
+        conn = it->second.connection;
+        
+        pending_peers_.erase(key);
+        connecting_peers_.insert(key);
+        
+        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+        statistics_.incoming_accepted++;
+        statistics_.peers_pending = pending_peers_.size();
+        statistics_.peers_connecting = connecting_peers_.size();
+    }
+    
+    attachCallbacks(conn, endpoint);
+    applyRateLimits(conn);
+    
+    auto self = shared_from_this();
+    conn->accept(std::move(client), received, [self, endpoint](bool success) {
+        if (success) {
+            self->onPeerConnected(endpoint);
+        } else {
+            self->onPeerDisconnected(endpoint, "incoming handshake failed");
+        }
+    });
+    
+    return true;
+}
+
 // ============================================================================
 // 数据传输
 // ============================================================================
@@ -191,6 +253,28 @@ bool PeerManager::requestBlock(const BlockInfo& block) {
     return true;
 }
 
+bool PeerManager::requestBlockFrom(const network::TcpEndpoint& endpoint, const BlockInfo& block) {
+    if (!running_.load()) {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(peers_mutex_);
+    
+    auto it = peers_.find(lookupKey(endpoint));
+    if (it == peers_.end() || !it->second.is_connected || !it->second.connection) {
+        return false;
+    }
+    
+    if (!it->second.connection->peerState().canRequest()) {
+        return false;
+    }
+    
+    it->second.connection->requestBlock(block);
+    it->second.pending_requests++;
+    
+    return true;
+}
+
 void PeerManager::cancelBlock(const BlockInfo& block) {
     std::lock_guard<std::mutex> lock(peers_mutex_);
     
@@ -202,7 +286,28 @@ void PeerManager::cancelBlock(const BlockInfo& block) {
     }
 }
 
+void PeerManager::cancelBlockFrom(const network::TcpEndpoint& endpoint, const BlockInfo& block) {
+    std::lock_guard<std::mutex> lock(peers_mutex_);
+    
+    auto it = peers_.find(lookupKey(endpoint));
+    if (it == peers_.end() || !it->second.is_connected || !it->second.connection) {
+        return;
+    }
+    
+    it->second.connection->cancelBlock(block);
+    if (it->second.pending_requests > 0) {
+        it->second.pending_requests--;
+    }
+}
+
 void PeerManager::broadcastHave(uint32_t piece_index) {
+    {
+        std::lock_guard<std::mutex> lock(bitfield_mutex_);
+        if (piece_index < my_bitfield_.size()) {
+            my_bitfield_[piece_index] = true;
+        }
+    }
+    
     std::lock_guard<std::mutex> lock(peers_mutex_);
     
     for (auto& [key, entry] : peers_) {
@@ -217,6 +322,101 @@ void PeerManager::updateBitfield(const std::vector<bool>& bitfield) {
     my_bitfield_ = bitfield;
 }
 
+// ============================================================================
+// 上传
+// ============================================================================
+
+std::vector<UploadRequest> PeerManager::takeUploadRequests(size_t max_requests) {
+    std::vector<UploadRequest> requests;
+    std::lock_guard<std::mutex> lock(peers_mutex_);
+    
+    // 从上次停下的 Peer 之后开始轮转，保证限速时各 Peer 机会均等
+    std::vector<PeerEntry*> candidates;
+    auto start = peers_.upper_bound(upload_cursor_);
+    auto collect = [&](auto first, auto last) {
+        for (auto it = first; it != last; ++it) {
+            auto& entry = it->second;
+            if (entry.is_connected && entry.connection &&
+                entry.connection->incomingRequestCount() > 0 &&
+                entry.connection->pendingSendBytes() < config_.max_upload_backlog) {
+                candidates.push_back(&entry);
+            }
+        }
+    };
+    collect(start, peers_.end());
+    collect(peers_.begin(), start);
+    
+    bool progress = true;
+    while (requests.size() < max_requests && progress) {
+        progress = false;
+        for (auto* entry : candidates) {
+            if (requests.size() >= max_requests) {
+                break;
+            }
+            BlockInfo block;
+            if (entry->connection->popIncomingRequest(block)) {
+                requests.push_back({entry->endpoint, block});
+                upload_cursor_ = endpointToKey(entry->endpoint);
+                progress = true;
+            }
+        }
+    }
+    
+    return requests;
+}
+
+bool PeerManager::sendBlock(const network::TcpEndpoint& endpoint, uint32_t piece_index,
+                            uint32_t begin, utils::BufferHandle data) {
+    size_t length = data.size();
+    
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex_);
+        auto it = peers_.find(lookupKey(endpoint));
+        if (it == peers_.end() || !it->second.is_connected || !it->second.connection) {
+            return false;
+        }
+        it->second.connection->sendPiece(piece_index, begin, std::move(data));
+    }
+    
+    {
+        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+        statistics_.total_bytes_uploaded += length;
+    }
+    return true;
+}
+
+void PeerManager::setSeeding(bool seeding) {
+    if (seeding_.exchange(seeding) == seeding) {
+        return;
+    }
+    
+    std::vector<std::shared_ptr<PeerConnection>> seeds;
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex_);
+        for (auto& [key, entry] : peers_) {
+            if (!entry.is_connected || !entry.connection) {
+                continue;
+            }
+            if (!seeding) {
+                entry.connection->sendInterested();
+            } else if (entry.is_seed) {
+                seeds.push_back(entry.connection);
+            } else {
+                entry.connection->sendNotInterested();
+            }
+        }
+    }
+    
+    // 断开会回调 onPeerDisconnected，不能持锁调用
+    for (auto& conn : seeds) {
+        conn->disconnect();
+    }
+    
+    if (!seeds.empty()) {
+        LOG_INFO("Seeding: disconnected " + std::to_string(seeds.size()) + " seed peers");
+    }
+}
+
 // ============================================================================
 // 查询
 // ============================================================================
@@ -251,6 +451,22 @@ std::vector<network::TcpEndpoint> PeerManager::getConnectedPeers() const {
     return result;
 }
 
+std::vector<std::pair<network::TcpEndpoint, std::vector<bool>>> 
+PeerManager::getPeerBitfields() const {
+    std::vector<std::pair<network::TcpEndpoint, std::vector<bool>>> result;
+    
+    std::lock_guard<std::mutex> lock(peers_mutex_);
+    
+    for (const auto& key : connected_peers_) {
+        auto it = peers_.find(key);
+        if (it != peers_.end() && it->second.connection) {
+            result.emplace_back(it->second.endpoint, it->second.connection->peerBitfield());
+        }
+    }
+    
+    return result;
+}
+
 size_t PeerManager::connectedCount() const {
     std::lock_guard<std::mutex> lock(peers_mutex_);
     return connected_peers_.size();
@@ -281,6 +497,22 @@ void PeerManager::setNewPeerCallback(NewPeerCallback callback) {
     new_peer_callback_ = std::move(callback);
 }
 
+void PeerManager::setBitfieldCallback(PeerBitfieldCallback callback) {
+    bitfield_callback_ = std::move(callback);
+}
+
+void PeerManager::setHaveCallback(PeerHaveCallback callback) {
+    have_callback_ = std::move(callback);
+}
+
+void PeerManager::setChokeCallback(PeerChokeCallback callback) {
+    choke_callback_ = std::move(callback);
+}
+
+void PeerManager::setUploadRequestCallback(UploadRequestCallback callback) {
+    upload_request_callback_ = std::move(callback);
+}
+
 // ============================================================================
 // 内部方法
 // ============================================================================
@@ -344,6 +576,23 @@ void PeerManager::connectToPeer(const network::TcpEndpoint& endpoint) {
     }
     
     // 设置回调
+    attachCallbacks(conn, endpoint);
+    applyRateLimits(conn);
+    
+    // 连接
+    auto self = shared_from_this();
+    LOG_INFO("Connecting to peer " + endpoint.toString());
+    conn->connect(endpoint, [self, endpoint](bool success) {
+        if (success) {
+            self->onPeerConnected(endpoint);
+        } else {
+            self->onPeerDisconnected(endpoint, "connection failed");
+        }
+    });
+}
+
+void PeerManager::attachCallbacks(const std::shared_ptr<PeerConnection>& conn,
+                                  const network::TcpEndpoint& endpoint) {
     auto self = shared_from_this();
     
     conn->setStateCallback([self, endpoint](PeerConnectionState state) {
@@ -356,28 +605,49 @@ void PeerManager::connectToPeer(const network::TcpEndpoint& endpoint) {
         self->onPeerMessage(endpoint, msg);
     });
     
-    conn->setPieceCallback([self, endpoint](const PieceBlock& block) {
+    conn->setPieceCallback([self, endpoint](const PieceBlockView& block) {
         self->onPieceReceived(endpoint, block);
     });
     
+    conn->setRequestCallback([self, endpoint](const BlockInfo& block) {
+        if (self->upload_request_callback_) {
+            self->upload_request_callback_(endpoint, block);
+        }
+    });
+    
     conn->setErrorCallback([self, endpoint](const std::string& error) {
         LOG_WARNING("Peer " + endpoint.toString() + " error: " + error);
     });
+}
+
+void PeerManager::applyRateLimits(const std::shared_ptr<PeerConnection>& conn) {
+    std::shared_ptr<network::RateLimiter> download;
+    std::shared_ptr<network::RateLimiter> upload;
     
-    // 连接
-    LOG_INFO("Connecting to peer " + endpoint.toString());
-    conn->connect(endpoint, [self, endpoint](bool success) {
-        if (success) {
-            self->onPeerConnected(endpoint);
-        } else {
-            self->onPeerDisconnected(endpoint, "connection failed");
-        }
-    });
+    if (config_.download_limiter || config_.max_peer_download_speed > 0) {
+        download = std::make_shared<network::RateLimiter>(
+            io_context_, config_.max_peer_download_speed, config_.download_limiter);
+    }
+    if (config_.upload_limiter || config_.max_peer_upload_speed > 0) {
+        upload = std::make_shared<network::RateLimiter>(
+            io_context_, config_.max_peer_upload_speed, config_.upload_limiter);
+    }
+    
+    conn->setRateLimiters(std::move(download), std::move(upload));
 }
 
 void PeerManager::onPeerConnected(const network::TcpEndpoint& endpoint) {
     std::string key = endpointToKey(endpoint);
     
+    // 握手之后先告诉对方我们有哪些分片（一个都没有时按惯例不发）
+    std::vector<bool> bitfield;
+    {
+        std::lock_guard<std::mutex> lock(bitfield_mutex_);
+        if (std::find(my_bitfield_.begin(), my_bitfield_.end(), true) != my_bitfield_.end()) {
+            bitfield = my_bitfield_;
+        }
+    }
+    
     {
         std::lock_guard<std::mutex> lock(peers_mutex_);
         
@@ -393,9 +663,14 @@ void PeerManager::onPeerConnected(const network::TcpEndpoint& endpoint) {
         connecting_peers_.erase(key);
         connected_peers_.insert(key);
         
-        // 发送 Interested
         if (it->second.connection) {
-            it->second.connection->sendInterested();
+            if (!bitfield.empty()) {
+                it->second.connection->sendBitfield(bitfield);
+            }
+            // 做种时不需要对方的数据
+            if (!seeding_.load()) {
+                it->second.connection->sendInterested();
+            }
         }
     }
     
@@ -456,8 +731,9 @@ void PeerManager::onPeerDisconnected(const network::TcpEndpoint& endpoint,
         connecting_peers_.erase(key);
         connected_peers_.erase(key);
         
-        // 如果失败次数未超限，重新加入等待队列
-        if (it->second.connect_failures < config_.max_connect_failures) {
+        // 如果失败次数未超限，重新加入等待队列（入站连接的端口无法回连，直接移除）
+        if (!it->second.is_incoming &&
+            it->second.connect_failures < config_.max_connect_failures) {
             pending_peers_.insert(key);
         } else {
             peers_.erase(it);
@@ -487,8 +763,8 @@ void PeerManager::onPeerDisconnected(const network::TcpEndpoint& endpoint,
 }
 
 void PeerManager::onPieceReceived(const network::TcpEndpoint& endpoint, 
-                                   const PieceBlock& block) {
-    std::string key = endpointToKey(endpoint);
+                                   const PieceBlockView& block) {
+    const std::string& key = lookupKey(endpoint);
     
     // 更新统计
     {
@@ -507,7 +783,7 @@ void PeerManager::onPieceReceived(const network::TcpEndpoint& endpoint,
     
     // 回调通知
     if (piece_callback_) {
-        piece_callback_(block.piece_index, block.begin, block.data);
+        piece_callback_(endpoint, block.piece_index, block.begin, block.data);
     }
 }
 
@@ -517,13 +793,39 @@ void PeerManager::onPeerMessage(const network::TcpEndpoint& endpoint,
     
     // 处理特定消息
     if (msg.type() == BtMessageType::Bitfield) {
-        std::lock_guard<std::mutex> lock(peers_mutex_);
-        auto it = peers_.find(key);
-        if (it != peers_.end()) {
-            auto bitfield = msg.bitfield();
-            // 检查是否是做种者
-            it->second.is_seed = std::all_of(bitfield.begin(), bitfield.end(), 
-                                              [](bool b) { return b; });
+        std::shared_ptr<PeerConnection> redundant_seed;
+        {
+            std::lock_guard<std::mutex> lock(peers_mutex_);
+            auto it = peers_.find(key);
+            if (it != peers_.end()) {
+                const auto& bitfield = msg.bitfield();
+                // 检查是否是做种者
+                it->second.is_seed = std::all_of(bitfield.begin(), bitfield.end(), 
+                                                  [](bool b) { return b; });
+                if (it->second.is_seed && seeding_.load()) {
+                    redundant_seed = it->second.connection;
+                }
+            }
+        }
+        
+        // 双方都是做种者，连接没有意义；仍在该连接的消息处理中，断开放到下一轮事件
+        if (redundant_seed) {
+            asio::post(io_context_, [redundant_seed]() {
+                redundant_seed->disconnect();
+            });
+            return;
+        }
+        
+        if (bitfield_callback_) {
+            bitfield_callback_(endpoint, msg.bitfield());
+        }
+    } else if (msg.type() == BtMessageType::Have) {
+        if (have_callback_) {
+            have_callback_(endpoint, msg.pieceIndex());
+        }
+    } else if (msg.type() == BtMessageType::Choke || msg.type() == BtMessageType::Unchoke) {
+        if (choke_callback_) {
+            choke_callback_(endpoint, msg.type() == BtMessageType::Choke);
         }
     }
 }
@@ -4,15 +4,27 @@
 #include "magnet/protocols/query_manager.h"
 #include "magnet/utils/logger.h"
 
+#include <algorithm>
+#include <cmath>
+#include <random>
 #include <sstream>
 
 namespace magnet::protocols {
 
-// Helper macros for logging
-#define LOG_DEBUG(msg) magnet::utils::Logger::instance().debug(std::string("[QueryManager] ") + msg)
+// Helper macros for logging (debug is on the per-query path, skip formatting when disabled)
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(std::string("[QueryManager] ") + msg)
 #define LOG_INFO(msg) magnet::utils::Logger::instance().info(std::string("[QueryManager] ") + msg)
 #define LOG_WARN(msg) magnet::utils::Logger::instance().warn(std::string("[QueryManager] ") + msg)
 
+// Slot index lives in the upper 16 bits of a transaction id
+constexpr size_t kMaxSlots = 0xFFFF;
+
+// Rebuild the deadline heap once stale entries outnumber the slots this much
+constexpr size_t kDeadlineHeapSlack = 2;
+
+// RFC 6298 "G": lower bound on the variance term of the RTO
+constexpr double kClockGranularityMs = 10;
+
 // ============================================================================
 // Constructor / Destructor
 // ============================================================================
@@ -26,6 +38,17 @@ QueryManager::QueryManager(asio::io_context& io_context,
     , timeout_timer_(io_context)
     , running_(false)
 {
+    config_.max_pending_queries = std::min(config_.max_pending_queries, kMaxSlots);
+    slots_.resize(config_.max_pending_queries);
+    
+    // Random starting generations keep transaction ids hard to guess
+    std::mt19937 rng(std::random_device{}());
+    free_slots_.reserve(slots_.size());
+    for (size_t i = slots_.size(); i-- > 0;) {
+        slots_[i].generation = static_cast<uint16_t>(rng());
+        free_slots_.push_back(static_cast<uint16_t>(i));
+    }
+    
     LOG_INFO("QueryManager created");
 }
 
@@ -46,7 +69,6 @@ void QueryManager::start() {
     }
     
     LOG_INFO("QueryManager started");
-    scheduleTimeoutCheck();
 }
 
 void QueryManager::stop() {
@@ -58,7 +80,11 @@ void QueryManager::stop() {
     LOG_INFO("QueryManager stopping");
     
     // Cancel timer
-    timeout_timer_.cancel();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        timeout_timer_.cancel();
+        timer_expiry_ = std::chrono::steady_clock::time_point::max();
+    }
     
     // Cancel all pending queries
     cancelAll();
@@ -91,20 +117,23 @@ void QueryManager::sendQuery(const DhtNode& target,
     }
     
     // Use defaults if not specified
-    if (timeout.count() == 0) {
-        timeout = config_.default_timeout;
-    }
     if (max_retries < 0) {
         max_retries = config_.default_max_retries;
     }
     
-    std::string tid = message.transactionId();
-    
+    size_t pending = 0;
     {
         std::lock_guard<std::mutex> lock(mutex_);
         
+        // No explicit timeout: start from the node's RTO and back off on retries
+        bool adaptive = false;
+        if (timeout.count() == 0) {
+            timeout = queryTimeoutLocked(target);
+            adaptive = config_.adaptive_timeout;
+        }
+        
         // Check queue limit
-        if (pending_queries_.size() >= config_.max_pending_queries) {
+        if (free_slots_.empty()) {
             LOG_WARN("Pending query queue full, rejecting query");
             asio::post(io_context_, [callback]() {
                 callback(QueryResult::err(QueryError::QueueFull));
@@ -112,84 +141,97 @@ void QueryManager::sendQuery(const DhtNode& target,
             return;
         }
         
-        // Check for duplicate transaction ID (very unlikely with random IDs)
-        if (pending_queries_.find(tid) != pending_queries_.end()) {
-            LOG_WARN("Duplicate transaction ID: " + tid);
-            // Generate new ID
-            message.setTransactionId(DhtMessage::generateTransactionId());
-            tid = message.transactionId();
-        }
+        uint16_t index = free_slots_.back();
+        free_slots_.pop_back();
+        
+        PendingQuery& query = slots_[index];
+        query.generation++;
+        uint32_t tid = (static_cast<uint32_t>(index) << 16) | query.generation;
         
-        // Create pending query
-        PendingQuery query;
-        query.transaction_id = tid;
+        // Encode once; retries resend the same bytes
+        message.setTransactionId(encodeTransactionId(tid));
+        query.payload = message.encode();
         query.target = target;
-        query.message = std::move(message);
+        query.endpoint = network::UdpEndpoint(target.ip_, target.port_);
         query.callback = std::move(callback);
         query.sent_time = std::chrono::steady_clock::now();
+        query.first_sent_time = query.sent_time;
+        query.deadline = query.sent_time + timeout;
         query.retry_count = 0;
         query.max_retries = max_retries;
         query.timeout = timeout;
+        query.adaptive = adaptive;
+        query.active = true;
+        pending = ++pending_count_;
         
         // Send the query
         doSend(query);
         
-        // Store in pending map
-        pending_queries_[tid] = std::move(query);
+        deadlines_.push({query.deadline, tid});
+        armTimerLocked();
     }
     
     // Update statistics
     {
         std::lock_guard<std::mutex> lock(stats_mutex_);
         statistics_.queries_sent++;
-        statistics_.current_pending = pending_queries_.size();
+        statistics_.timeout_histogram.record(timeout);
+        statistics_.current_pending = pending;
     }
     
-    std::ostringstream oss;
-    oss << "Query sent to " << target.ip_ << ":" << target.port_ 
-        << ", tid=" << tid.size() << " bytes";
-    LOG_DEBUG(oss.str());
+    LOG_DEBUG("Query sent to " + target.ip_ + ":" + std::to_string(target.port_) +
+              ", timeout=" + std::to_string(timeout.count()) + "ms");
 }
 
 bool QueryManager::handleResponse(const DhtMessage& response) {
-    const std::string& tid = response.transactionId();
+    auto tid = decodeTransactionId(response.transactionId());
+    if (!tid) {
+        LOG_DEBUG("Response with foreign transaction ID");
+        return false;
+    }
     
     QueryCallback callback;
-    std::chrono::steady_clock::time_point sent_time;
+    std::chrono::milliseconds latency{0};
+    std::chrono::milliseconds total_latency{0};
+    size_t pending = 0;
     
     {
         std::lock_guard<std::mutex> lock(mutex_);
         
-        auto it = pending_queries_.find(tid);
-        if (it == pending_queries_.end()) {
+        PendingQuery* query = findLocked(*tid);
+        if (!query) {
             // No matching query - could be expired or unsolicited
             LOG_DEBUG("No pending query for transaction ID");
             return false;
         }
         
         // Extract callback and timing info
-        callback = std::move(it->second.callback);
-        sent_time = it->second.sent_time;
+        callback = std::move(query->callback);
+        auto now = std::chrono::steady_clock::now();
+        latency = std::chrono::duration_cast<std::chrono::milliseconds>(now - query->sent_time);
+        total_latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+            now - query->first_sent_time);
         
-        // Remove from pending
-        pending_queries_.erase(it);
+        // Karn: a retransmitted query's response can't be matched to one send
+        if (query->retry_count == 0) {
+            updateRttLocked(query->target, latency);
+        }
+        
+        // Free the slot; its deadline stays in the heap and is skipped later
+        releaseLocked(*tid);
+        pending = pending_count_;
     }
     
-    // Calculate latency
-    auto now = std::chrono::steady_clock::now();
-    auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(now - sent_time);
-    
     // Update statistics
     {
         std::lock_guard<std::mutex> lock(stats_mutex_);
         statistics_.queries_succeeded++;
         statistics_.total_latency_ms += latency.count();
-        statistics_.current_pending = pending_queries_.size();
+        statistics_.latency_histogram.record(total_latency);
+        statistics_.current_pending = pending;
     }
     
-    std::ostringstream oss;
-    oss << "Query succeeded, latency=" << latency.count() << "ms";
-    LOG_DEBUG(oss.str());
+    LOG_DEBUG("Query succeeded, latency=" + std::to_string(latency.count()) + "ms");
     
     // Call callback (outside lock to avoid deadlock)
     if (callback) {
@@ -200,25 +242,32 @@ bool QueryManager::handleResponse(const DhtMessage& response) {
 }
 
 bool QueryManager::cancelQuery(const std::string& transaction_id) {
+    auto tid = decodeTransactionId(transaction_id);
+    if (!tid) {
+        return false;
+    }
+    
     QueryCallback callback;
+    size_t pending = 0;
     
     {
         std::lock_guard<std::mutex> lock(mutex_);
         
-        auto it = pending_queries_.find(transaction_id);
-        if (it == pending_queries_.end()) {
+        PendingQuery* query = findLocked(*tid);
+        if (!query) {
             return false;
         }
         
-        callback = std::move(it->second.callback);
-        pending_queries_.erase(it);
+        callback = std::move(query->callback);
+        releaseLocked(*tid);
+        pending = pending_count_;
     }
     
     // Update statistics
     {
         std::lock_guard<std::mutex> lock(stats_mutex_);
         statistics_.queries_failed++;
-        statistics_.current_pending = pending_queries_.size();
+        statistics_.current_pending = pending;
     }
     
     LOG_DEBUG("Query cancelled");
@@ -232,15 +281,22 @@ bool QueryManager::cancelQuery(const std::string& transaction_id) {
 }
 
 void QueryManager::cancelAll() {
-    std::map<std::string, PendingQuery> queries_to_cancel;
+    std::vector<QueryCallback> callbacks;
     
     {
         std::lock_guard<std::mutex> lock(mutex_);
-        queries_to_cancel = std::move(pending_queries_);
-        pending_queries_.clear();
+        callbacks.reserve(pending_count_);
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            PendingQuery& query = slots_[i];
+            if (query.active) {
+                callbacks.push_back(std::move(query.callback));
+                releaseLocked((static_cast<uint32_t>(i) << 16) | query.generation);
+            }
+        }
+        deadlines_ = {};
     }
     
-    size_t count = queries_to_cancel.size();
+    size_t count = callbacks.size();
     
     // Update statistics
     {
@@ -257,9 +313,9 @@ void QueryManager::cancelAll() {
     
     // Notify all callbacks
     QueryError error = running_ ? QueryError::Cancelled : QueryError::ShuttingDown;
-    for (auto& [tid, query] : queries_to_cancel) {
-        if (query.callback) {
-            query.callback(QueryResult::err(error));
+    for (auto& callback : callbacks) {
+        if (callback) {
+            callback(QueryResult::err(error));
         }
     }
 }
@@ -270,13 +326,42 @@ void QueryManager::cancelAll() {
 
 size_t QueryManager::pendingCount() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    return pending_queries_.size();
+    return pending_count_;
+}
+
+std::chrono::milliseconds QueryManager::rttEstimate(const DhtNode& node) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    double srtt = rtt_.srtt;
+    auto it = node_rtt_.find(node.ip_ + ":" + std::to_string(node.port_));
+    if (it != node_rtt_.end()) {
+        srtt = it->second.srtt;
+    }
+    if (srtt <= 0) {
+        return config_.default_timeout / 4;
+    }
+    return std::chrono::milliseconds(static_cast<int64_t>(srtt + 0.5));
+}
+
+std::chrono::milliseconds QueryManager::queryTimeout(const DhtNode& node) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queryTimeoutLocked(node);
 }
 
 QueryManagerStatistics QueryManager::getStatistics() const {
+    size_t pending = 0;
+    RttEstimate rtt;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending = pending_count_;
+        rtt = rtt_;
+    }
+    
     std::lock_guard<std::mutex> lock(stats_mutex_);
     QueryManagerStatistics stats = statistics_;
-    stats.current_pending = pending_queries_.size();
+    stats.current_pending = pending;
+    stats.smoothed_rtt_ms = rtt.srtt;
+    stats.rtt_variance_ms = rtt.rttvar;
     return stats;
 }
 
@@ -287,82 +372,156 @@ void QueryManager::resetStatistics() {
 }
 
 // ============================================================================
-// Internal Methods
+// Transaction IDs
 // ============================================================================
 
-void QueryManager::scheduleTimeoutCheck() {
-    if (!running_) {
+std::string QueryManager::encodeTransactionId(uint32_t tid) {
+    std::string bytes(4, '\0');
+    bytes[0] = static_cast<char>(tid >> 24);
+    bytes[1] = static_cast<char>(tid >> 16);
+    bytes[2] = static_cast<char>(tid >> 8);
+    bytes[3] = static_cast<char>(tid);
+    return bytes;
+}
+
+std::optional<uint32_t> QueryManager::decodeTransactionId(const std::string& tid) {
+    if (tid.size() != 4) {
+        return std::nullopt;
+    }
+    auto byte = [&tid](size_t i) { return static_cast<uint32_t>(static_cast<uint8_t>(tid[i])); };
+    return (byte(0) << 24) | (byte(1) << 16) | (byte(2) << 8) | byte(3);
+}
+
+QueryManager::PendingQuery* QueryManager::findLocked(uint32_t tid) {
+    size_t index = tid >> 16;
+    if (index >= slots_.size()) {
+        return nullptr;
+    }
+    PendingQuery& query = slots_[index];
+    if (!query.active || query.generation != static_cast<uint16_t>(tid)) {
+        return nullptr;
+    }
+    return &query;
+}
+
+void QueryManager::releaseLocked(uint32_t tid) {
+    PendingQuery& query = slots_[tid >> 16];
+    query.active = false;
+    query.callback = nullptr;
+    query.payload.clear();
+    free_slots_.push_back(static_cast<uint16_t>(tid >> 16));
+    pending_count_--;
+}
+
+// ============================================================================
+// Timeouts
+// ============================================================================
+
+void QueryManager::armTimerLocked() {
+    // Drop stale entries at the top so the timer isn't woken for nothing
+    while (!deadlines_.empty()) {
+        const Deadline& top = deadlines_.top();
+        const PendingQuery* query = findLocked(top.tid);
+        if (query && query->deadline == top.when) {
+            break;
+        }
+        deadlines_.pop();
+    }
+    
+    // Responses leave their deadlines behind; rebuild before they pile up
+    if (deadlines_.size() > kDeadlineHeapSlack * slots_.size()) {
+        std::vector<Deadline> live;
+        live.reserve(pending_count_);
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            if (slots_[i].active) {
+                live.push_back({slots_[i].deadline,
+                                (static_cast<uint32_t>(i) << 16) | slots_[i].generation});
+            }
+        }
+        deadlines_ = decltype(deadlines_)(std::greater<Deadline>(), std::move(live));
+    }
+    
+    if (deadlines_.empty() || !running_) {
         return;
     }
     
-    timeout_timer_.expires_after(config_.check_interval);
+    auto expiry = deadlines_.top().when;
+    if (expiry == timer_expiry_) {
+        return;  // Already waiting for this deadline
+    }
+    
+    timer_expiry_ = expiry;
+    timeout_timer_.expires_at(expiry);
     
     auto self = shared_from_this();
     timeout_timer_.async_wait([this, self](const asio::error_code& ec) {
         if (ec == asio::error::operation_aborted) {
-            return;  // Timer cancelled
+            return;  // Timer re-armed or cancelled
         }
         
         if (!running_) {
             return;
         }
         
-        checkTimeouts();
-        scheduleTimeoutCheck();
+        processExpired();
     });
 }
 
-void QueryManager::checkTimeouts() {
-    std::vector<std::pair<std::string, QueryCallback>> expired_queries;
-    std::vector<std::string> queries_to_retry;
+void QueryManager::processExpired() {
+    std::vector<QueryCallback> expired_callbacks;
+    std::vector<std::chrono::milliseconds> retry_timeouts;
+    size_t pending = 0;
     
     {
         std::lock_guard<std::mutex> lock(mutex_);
+        timer_expiry_ = std::chrono::steady_clock::time_point::max();
         
-        for (auto& [tid, query] : pending_queries_) {
-            if (query.isExpired()) {
-                if (query.canRetry()) {
-                    // Mark for retry
-                    queries_to_retry.push_back(tid);
-                } else {
-                    // Mark for failure
-                    expired_queries.emplace_back(tid, std::move(query.callback));
-                }
+        auto now = std::chrono::steady_clock::now();
+        while (!deadlines_.empty() && deadlines_.top().when <= now) {
+            Deadline entry = deadlines_.top();
+            deadlines_.pop();
+            
+            PendingQuery* query = findLocked(entry.tid);
+            if (!query || query->deadline != entry.when) {
+                continue;  // Answered or cancelled
             }
-        }
-        
-        // Process retries
-        for (const auto& tid : queries_to_retry) {
-            auto it = pending_queries_.find(tid);
-            if (it != pending_queries_.end()) {
-                it->second.retry_count++;
-                it->second.sent_time = std::chrono::steady_clock::now();
-                doSend(it->second);
+            
+            if (auto timeout = retryTimeout(*query, now)) {
+                query->retry_count++;
+                query->timeout = *timeout;
+                query->sent_time = now;
+                query->deadline = now + query->timeout;
+                doSend(*query);
+                deadlines_.push({query->deadline, entry.tid});
+                retry_timeouts.push_back(query->timeout);
                 
-                std::ostringstream oss;
-                oss << "Retrying query (attempt " << it->second.retry_count + 1 
-                    << "/" << it->second.max_retries + 1 << ")";
-                LOG_DEBUG(oss.str());
+                LOG_DEBUG("Retrying query (attempt " + std::to_string(query->retry_count + 1) +
+                          "/" + std::to_string(query->max_retries + 1) +
+                          ", timeout=" + std::to_string(query->timeout.count()) + "ms)");
+            } else {
+                expired_callbacks.push_back(std::move(query->callback));
+                releaseLocked(entry.tid);
             }
         }
         
-        // Remove expired queries
-        for (const auto& [tid, _] : expired_queries) {
-            pending_queries_.erase(tid);
-        }
+        pending = pending_count_;
+        armTimerLocked();
     }
     
     // Update statistics
-    if (!queries_to_retry.empty() || !expired_queries.empty()) {
+    if (!retry_timeouts.empty() || !expired_callbacks.empty()) {
         std::lock_guard<std::mutex> lock(stats_mutex_);
-        statistics_.retries_total += queries_to_retry.size();
-        statistics_.queries_timeout += expired_queries.size();
-        statistics_.queries_failed += expired_queries.size();
-        statistics_.current_pending = pending_queries_.size();
+        statistics_.retries_total += retry_timeouts.size();
+        for (auto timeout : retry_timeouts) {
+            statistics_.timeout_histogram.record(timeout);
+        }
+        statistics_.queries_timeout += expired_callbacks.size();
+        statistics_.queries_failed += expired_callbacks.size();
+        statistics_.current_pending = pending;
     }
     
     // Notify failed callbacks (outside lock)
-    for (auto& [tid, callback] : expired_queries) {
+    for (auto& callback : expired_callbacks) {
         if (callback) {
             LOG_DEBUG("Query timeout, no more retries");
             callback(QueryResult::err(QueryError::Timeout));
@@ -370,37 +529,90 @@ void QueryManager::checkTimeouts() {
     }
 }
 
-void QueryManager::doSend(PendingQuery& query) {
+void QueryManager::doSend(const PendingQuery& query) {
     if (!udp_client_) {
         LOG_WARN("UDP client not available");
         return;
     }
     
-    // Encode message
-    std::vector<uint8_t> data = query.message.encode();
-    
-    // Create endpoint
-    network::UdpEndpoint endpoint(query.target.ip_, query.target.port_);
-    
     // Send (fire and forget for now - UDP is unreliable anyway)
-    udp_client_->send(endpoint, data, nullptr);
+    udp_client_->send(query.endpoint, query.payload, nullptr);
+}
+
+// ============================================================================
+// RTT Estimation
+// ============================================================================
+
+void QueryManager::RttEstimate::update(double sample) {
+    if (srtt <= 0) {
+        srtt = sample;
+        rttvar = sample / 2;
+        return;
+    }
+    // RTTVAR = 3/4 * RTTVAR + 1/4 * |SRTT - R|, then SRTT = 7/8 * SRTT + 1/8 * R
+    rttvar += (std::abs(srtt - sample) - rttvar) / 4;
+    srtt += (sample - srtt) / 8;
 }
 
-void QueryManager::completeQueryLocked(const std::string& tid, QueryResult result) {
-    auto it = pending_queries_.find(tid);
-    if (it == pending_queries_.end()) {
+std::chrono::milliseconds QueryManager::RttEstimate::rto() const {
+    double rto = srtt + std::max(kClockGranularityMs, 4 * rttvar);
+    return std::chrono::milliseconds(static_cast<int64_t>(rto + 0.5));
+}
+
+void QueryManager::updateRttLocked(const DhtNode& target, std::chrono::milliseconds sample) {
+    double rtt = static_cast<double>(std::max<int64_t>(sample.count(), 1));
+    rtt_.update(rtt);
+    
+    std::string key = target.ip_ + ":" + std::to_string(target.port_);
+    auto it = node_rtt_.find(key);
+    if (it != node_rtt_.end()) {
+        it->second.update(rtt);
         return;
     }
+    if (config_.max_rtt_entries == 0) {
+        return;
+    }
+    if (node_rtt_.size() >= config_.max_rtt_entries) {
+        // Estimates are only hints; drop an arbitrary one
+        node_rtt_.erase(node_rtt_.begin());
+    }
+    node_rtt_[std::move(key)].update(rtt);
+}
+
+std::chrono::milliseconds QueryManager::queryTimeoutLocked(const DhtNode& target) const {
+    if (!config_.adaptive_timeout) {
+        return config_.default_timeout;
+    }
     
-    QueryCallback callback = std::move(it->second.callback);
-    pending_queries_.erase(it);
+    const RttEstimate* estimate = &rtt_;
+    auto it = node_rtt_.find(target.ip_ + ":" + std::to_string(target.port_));
+    if (it != node_rtt_.end()) {
+        estimate = &it->second;
+    }
+    if (estimate->srtt <= 0) {
+        return std::min(config_.default_timeout, config_.max_query_time);   // No samples yet
+    }
+    return std::min(std::clamp(estimate->rto(), config_.min_timeout, config_.max_timeout),
+                    config_.max_query_time);
+}
+
+std::optional<std::chrono::milliseconds> QueryManager::retryTimeout(
+        const PendingQuery& query, std::chrono::steady_clock::time_point now) const {
+    if (query.retry_count >= query.max_retries) {
+        return std::nullopt;
+    }
+    if (!query.adaptive) {
+        return query.timeout;
+    }
     
-    // Note: callback should be called outside the lock
-    // This method is kept for potential future use
-    if (callback) {
-        callback(std::move(result));
+    // Exponential backoff, but never past the query's total time budget
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        query.first_sent_time + config_.max_query_time - now);
+    auto timeout = std::min({query.timeout * 2, config_.max_timeout, remaining});
+    if (timeout < std::min(config_.min_timeout, query.timeout)) {
+        return std::nullopt;   // Not enough time left for a meaningful retry
     }
+    return timeout;
 }
 
 } // namespace magnet::protocols
-
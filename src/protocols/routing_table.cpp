@@ -1,5 +1,6 @@
 #include "../../include/magnet/protocols/routing_table.h"
 #include <algorithm>
+#include <cstring>
 #include <random>
 
 namespace magnet::protocols {
@@ -18,120 +19,203 @@ namespace magnet::protocols {
         return idx;
     }
 
-    bool RoutingTable::addNode(const DhtNode& node) {
-        std::lock_guard<std::mutex> lock(mutex_);
+    namespace {
+
+        // a 是否比 b 更接近 target（逐字节比较 XOR 距离，不构造 NodeId）
+        bool closerTo(const NodeId::ByteArray& target, const NodeId::ByteArray& a,
+                      const NodeId::ByteArray& b) {
+            for (size_t i = 0; i < NodeId::s_KNodeSize; ++i) {
+                uint8_t da = a[i] ^ target[i];
+                uint8_t db = b[i] ^ target[i];
+                if (da != db) {
+                    return da < db;
+                }
+            }
+            return false;
+        }
 
+    } // namespace
+
+    DhtNode RoutingTable::NodeRecord::toDhtNode() const {
+        DhtNode node;
+        node.id_ = id;
+        if (auto endpoint = decodeCompactAddress(address.data(), address_size)) {
+            node.ip_ = endpoint->ip;
+            node.port_ = endpoint->port;
+        }
+        node.failed_queries_ = failed_queries;
+        node.last_seen_ = last_seen;
+        return node;
+    }
+
+    RoutingTable::NodeRecord* RoutingTable::findNode(const NodeId& id) {
+        auto& bucket = buckets_[getBucketIndex(id)];
+        auto it = std::find_if(bucket.begin(), bucket.end(),
+            [&id](const NodeRecord& n) { return n.id == id; });
+        return it != bucket.end() ? it : nullptr;
+    }
+
+    bool RoutingTable::addNode(const DhtNode& node) {
         // 验证节点有效性
         if (node.id_ == local_id_)
             return false;
-        
+
         // 过滤无效端口
         if (node.port_ == 0 || node.ip_.empty())
             return false;
 
+        // 地址在锁外解析
+        std::string compact = encodeCompactAddress(node.ip_, node.port_);
+        if (compact.empty())
+            return false;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
         size_t bucket_idx = getBucketIndex(node.id_);
         auto& bucket = buckets_[bucket_idx];
+        auto now = std::chrono::steady_clock::now();
 
-        auto it = std::find_if(bucket.nodes.begin(), bucket.nodes.end(),
-        [&node](const DhtNode&n) {return n.id_ == node.id_;} );
+        auto it = std::find_if(bucket.begin(), bucket.end(),
+        [&node](const NodeRecord&n) {return n.id == node.id_;} );
 
-        if (it != bucket.nodes.end()) {
-            it->ip_ = node.ip_;
-            it->port_ = node.port_;
-            it->markResponded();
+        if (it != bucket.end()) {
+            std::memcpy(it->address.data(), compact.data(), compact.size());
+            it->address_size = static_cast<uint8_t>(compact.size());
+            it->failed_queries = 0;
+            it->last_seen = now;
 
-            DhtNode updated = *it;
-            bucket.nodes.erase(it);
-            bucket.nodes.push_back(updated);
-            bucket.last_changed = std::chrono::steady_clock::now();
+            // 移到末尾（LRU）
+            std::rotate(it, it + 1, bucket.end());
+            bucket.last_changed = now;
 
             return true;
         }
 
+        NodeRecord record;
+        record.id = node.id_;
+        std::memcpy(record.address.data(), compact.data(), compact.size());
+        record.address_size = static_cast<uint8_t>(compact.size());
+        record.failed_queries = static_cast<uint8_t>(std::min(node.failed_queries_, 255));
+        record.last_seen = node.last_seen_;
+
         // 节点不存在
 
-        if (bucket.nodes.size() < s_kBucketSize) {
-            bucket.nodes.push_back(node);
-            bucket.last_changed = std::chrono::steady_clock::now();
+        if (bucket.size < s_kBucketSize) {
+            bucket.nodes[bucket.size++] = record;
+            bucket.last_changed = now;
             return true;
         }
 
         // 桶满，检查节点是否有坏节点可以替换
 
-        auto bad_it = std::find_if(bucket.nodes.begin(), bucket.nodes.end(),
-            [](const DhtNode& n) { return n.isBad();});
+        auto bad_it = std::find_if(bucket.begin(), bucket.end(),
+            [](const NodeRecord& n) { return n.isBad();});
 
-        if (bad_it != bucket.nodes.end()) {
-            *bad_it = node;
-            bucket.last_changed = std::chrono::steady_clock::now();
+        if (bad_it != bucket.end()) {
+            *bad_it = record;
+            bucket.last_changed = now;
             return true;
         }
 
         return  false;
-    } 
+    }
 
     void RoutingTable::markNodeResponded(const NodeId& id){
 
         std::lock_guard<std::mutex> lock(mutex_);
 
-        size_t bucket_idx = getBucketIndex(id);
-
-        auto& bucket = buckets_[bucket_idx];
-
-        auto it = std::find_if(bucket.nodes.begin(), bucket.nodes.end(), 
-                [&id](const DhtNode& n) { return n.id_ == id;});
-        if (it != bucket.nodes.end()) {
-            it->markResponded();
-            bucket.last_changed = std::chrono::steady_clock::now();
+        if (auto* record = findNode(id)) {
+            record->failed_queries = 0;
+            record->last_seen = std::chrono::steady_clock::now();
+            buckets_[getBucketIndex(id)].last_changed = record->last_seen;
         }
     }
 
     void RoutingTable::markNodeFailed(const NodeId& id) {
         std::lock_guard<std::mutex> lock(mutex_);
 
-        size_t bucket_idx = getBucketIndex(id);
-        auto& bucket = buckets_[bucket_idx];
-
-        auto it = std::find_if(bucket.nodes.begin(), bucket.nodes.end(), 
-            [&id](const DhtNode& n) { return n.id_ == id;});
-        
-        if (it != bucket.nodes.end()) {
-            it->markFailed();
+        if (auto* record = findNode(id)) {
+            if (record->failed_queries < 255) {
+                ++record->failed_queries;
+            }
         }
     }
 
     std::vector<DhtNode> RoutingTable::findCloset(const NodeId& target, size_t count) const {
+        std::vector<NodeRecord> records(std::min(count, s_kBucketCount * s_kBucketSize));
+        size_t found = findClosest(target, records.data(), records.size());
+
+        std::vector<DhtNode> result;
+        result.reserve(found);
+        for (size_t i = 0; i < found; ++i) {
+            result.push_back(records[i].toDhtNode());
+        }
+        return result;
+    }
+
+    size_t RoutingTable::findClosest(const NodeId& target, NodeRecord* out, size_t count) const {
+        if (count == 0) {
+            return 0;
+        }
+
         std::lock_guard<std::mutex> lock(mutex_);
 
-        std::vector<std::pair<NodeId, DhtNode>> candidates;
+        // 与 target 的距离：目标桶 b 内的节点 < 2^b，所有低于 b 的桶在 [2^b, 2^(b+1))，
+        // 高于 b 的桶 i 在 [2^i, 2^(i+1))。按这个顺序逐组收集，凑够 count 后
+        // 剩下的节点一定更远
+        std::array<const NodeRecord*, s_kBucketCount * s_kBucketSize> candidates;
+        size_t collected = 0;
 
-        for (const auto& bucket : buckets_)
-        {
-            for(const auto& node: bucket.nodes) {
+        auto collect = [&](const Bucket& bucket) {
+            for (const auto& node : bucket) {
                 // 过滤掉坏节点
-                if (node.isBad()) {
-                    continue;
+                if (!node.isBad()) {
+                    candidates[collected++] = &node;
                 }
-                NodeId dist = target.distance(node.id_);
-                candidates.emplace_back(dist, node);
+            }
+        };
+
+        size_t target_bucket = getBucketIndex(target);
+        collect(buckets_[target_bucket]);
+        if (collected < count) {
+            for (size_t i = 0; i < target_bucket; ++i) {
+                collect(buckets_[i]);
             }
         }
+        for (size_t i = target_bucket + 1; i < s_kBucketCount && collected < count; ++i) {
+            collect(buckets_[i]);
+        }
 
-        std::sort(candidates.begin(), candidates.end(),
-            [](const auto& a, const auto& b) {
-                return a.first < b.first;
-            });
-        
-        std::vector<DhtNode> result;
+        const auto& target_bytes = target.bytes();
+        auto closer = [&target_bytes](const NodeRecord* a, const NodeRecord* b) {
+            return closerTo(target_bytes, a->id.bytes(), b->id.bytes());
+        };
 
-        result.reserve(std::min(count, candidates.size()));
+        size_t result_count = std::min(count, collected);
+        auto first = candidates.begin();
+        if (collected > result_count) {
+            std::nth_element(first, first + result_count, first + collected, closer);
+        }
+        std::sort(first, first + result_count, closer);
 
-        for (size_t i = 0; i < std::min(count, candidates.size()); ++i) {
-            result.push_back(candidates[i].second);
+        for (size_t i = 0; i < result_count; ++i) {
+            out[i] = *candidates[i];
         }
+        return result_count;
+    }
+
+    std::vector<DhtNode> RoutingTable::getGoodNodes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
 
+        std::vector<DhtNode> result;
+        for (auto bucket = buckets_.rbegin(); bucket != buckets_.rend(); ++bucket) {
+            for (const auto& node : *bucket) {
+                if (node.isGood()) {
+                    result.push_back(node.toDhtNode());
+                }
+            }
+        }
         return result;
-        
     }
 
     std::vector<size_t> RoutingTable::getStaleBuckets() const {
@@ -142,7 +226,7 @@ namespace magnet::protocols {
         auto now = std::chrono::steady_clock::now();
 
         for (size_t i = 0; i < s_kBucketCount; ++i) {
-            if (!buckets_[i].nodes.empty()) {
+            if (buckets_[i].size != 0) {
                 auto elapsed = std::chrono::duration_cast<std::chrono::minutes>(
                 now - buckets_[i].last_changed);
                 if (elapsed.count() >= 15) {
@@ -202,7 +286,7 @@ namespace magnet::protocols {
 
         size_t count = 0;
         for (const auto& bucket : buckets_) {
-            count += bucket.nodes.size();
+            count += bucket.size;
         }
         return count;
     }
@@ -212,7 +296,7 @@ namespace magnet::protocols {
 
         size_t count = 0;
         for (const auto& bucket : buckets_) {
-            for (const auto& node : bucket.nodes) {
+            for (const auto& node : bucket) {
                 if (node.isGood()) {
                     ++count;
                 }
@@ -226,10 +310,10 @@ namespace magnet::protocols {
 
         Statistics stats;
         for (const auto& bucket : buckets_) {
-            if (!bucket.nodes.empty()) {
+            if (bucket.size != 0) {
                 ++stats.non_empty_buckets;
             }
-            for (const auto& node : bucket.nodes) {
+            for (const auto& node : bucket) {
                 ++stats.total_nodes;
                 if (node.isGood()) {
                     ++stats.good_nodes;
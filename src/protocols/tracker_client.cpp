@@ -1,5 +1,6 @@
 #include "magnet/protocols/tracker_client.h"
 #include "magnet/protocols/bencode.h"
+#include "magnet/protocols/dch_types.h"
 #include "magnet/utils/logger.h"
 
 #include <sstream>
@@ -8,7 +9,7 @@
 
 namespace magnet::protocols {
 
-#define LOG_DEBUG(msg) magnet::utils::Logger::instance().debug(std::string("[Tracker] ") + msg)
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(std::string("[Tracker] ") + msg)
 #define LOG_INFO(msg) magnet::utils::Logger::instance().info(std::string("[Tracker] ") + msg)
 #define LOG_WARN(msg) magnet::utils::Logger::instance().warn(std::string("[Tracker] ") + msg)
 #define LOG_ERROR(msg) magnet::utils::Logger::instance().error(std::string("[Tracker] ") + msg)
@@ -372,57 +373,39 @@ TrackerResponse TrackerClient::parseHttpResponse(const std::vector<uint8_t>& dat
         }
     }
     
-    // 解析 peers（紧凑格式：每 6 字节一个 peer）
-    if (dict.count("peers")) {
-        const auto& peers_val = dict.at("peers");
-        if (peers_val.isString()) {
-            response = parseCompactPeers(peers_val.asString());
-            response.success = true;
-            LOG_INFO("Got " + std::to_string(response.peers.size()) + " peers from tracker");
+    // 解析 peers（紧凑格式：每 6 字节一个 peer）和 peers6（每 18 字节一个 IPv6 peer）
+    for (bool ipv6 : {false, true}) {
+        auto it = dict.find(ipv6 ? "peers6" : "peers");
+        if (it != dict.end() && it->second.isString()) {
+            auto peers = parseCompactPeers(it->second.asString(), ipv6);
+            response.peers.insert(response.peers.end(), peers.begin(), peers.end());
         }
     }
+    LOG_INFO("Got " + std::to_string(response.peers.size()) + " peers from tracker");
     
     return response;
 }
 
-TrackerResponse TrackerClient::parseCompactPeers(const std::string& peers_data) {
-    TrackerResponse response;
-    
-    // 紧凑格式：每 6 字节 = 4 字节 IP + 2 字节端口
-    if (peers_data.size() % 6 != 0) {
-        LOG_WARN("Invalid compact peers format");
-        return response;
+std::vector<network::TcpEndpoint> TrackerClient::parseCompactPeers(const std::string& peers_data,
+                                                                   bool ipv6) {
+    std::vector<network::TcpEndpoint> peers;
+    
+    size_t stride = ipv6 ? s_kCompactAddress6Size : s_kCompactAddressSize;
+    if (peers_data.size() % stride != 0) {
+        LOG_WARN(std::string("Invalid compact ") + (ipv6 ? "peers6" : "peers") + " format");
+        return peers;
     }
     
-    size_t peer_count = peers_data.size() / 6;
-    response.peers.reserve(peer_count);
-    
-    for (size_t i = 0; i < peers_data.size(); i += 6) {
-        // 解析 IP（4 字节，网络字节序）
-        uint8_t ip1 = static_cast<uint8_t>(peers_data[i]);
-        uint8_t ip2 = static_cast<uint8_t>(peers_data[i + 1]);
-        uint8_t ip3 = static_cast<uint8_t>(peers_data[i + 2]);
-        uint8_t ip4 = static_cast<uint8_t>(peers_data[i + 3]);
-        
-        // 解析端口（2 字节，大端序）
-        uint16_t port = (static_cast<uint8_t>(peers_data[i + 4]) << 8) |
-                        static_cast<uint8_t>(peers_data[i + 5]);
-        
-        // 构建 IP 字符串
-        std::ostringstream ip;
-        ip << static_cast<int>(ip1) << "."
-           << static_cast<int>(ip2) << "."
-           << static_cast<int>(ip3) << "."
-           << static_cast<int>(ip4);
-        
-        network::TcpEndpoint endpoint;
-        endpoint.ip = ip.str();
-        endpoint.port = port;
-        
-        response.peers.push_back(endpoint);
+    peers.reserve(peers_data.size() / stride);
+    for (size_t i = 0; i < peers_data.size(); i += stride) {
+        auto endpoint = decodeCompactAddress(
+            reinterpret_cast<const uint8_t*>(peers_data.data() + i), stride);
+        if (endpoint) {
+            peers.push_back(*endpoint);
+        }
     }
     
-    return response;
+    return peers;
 }
 
 } // namespace magnet::protocols
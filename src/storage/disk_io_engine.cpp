@@ -0,0 +1,821 @@
+#include "magnet/storage/disk_io_engine.h"
+#include "magnet/utils/logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <new>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define MAGNET_HAS_IO_URING 1
+#endif
+#endif
+#endif
+
+#ifndef MAGNET_HAS_IO_URING
+#define MAGNET_HAS_IO_URING 0
+#endif
+
+namespace magnet::storage {
+
+// 日志宏
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(msg)
+#define LOG_INFO(msg) magnet::utils::Logger::instance().info(msg)
+#define LOG_WARNING(msg) magnet::utils::Logger::instance().warn(msg)
+#define LOG_ERROR(msg) magnet::utils::Logger::instance().error(msg)
+
+const char* diskIoBackendName(DiskIoBackend backend) {
+    switch (backend) {
+        case DiskIoBackend::Auto:       return "auto";
+        case DiskIoBackend::IoUring:    return "io_uring";
+        case DiskIoBackend::ThreadPool: return "thread-pool";
+    }
+    return "unknown";
+}
+
+// ============================================================================
+// 固定缓冲池
+// ============================================================================
+
+struct DiskBuffer::Pool {
+    static constexpr size_t kAlignment = 4096;
+
+    Pool(size_t count, size_t buffer_size)
+        : buffer_size((buffer_size + kAlignment - 1) / kAlignment * kAlignment)
+        , count(count)
+        , memory(static_cast<uint8_t*>(
+              ::operator new(this->buffer_size * count, std::align_val_t{kAlignment})))
+    {
+        for (size_t i = count; i > 0; --i) {
+            free_list.push_back(i - 1);
+        }
+    }
+
+    ~Pool() {
+        ::operator delete(memory, std::align_val_t{kAlignment});
+    }
+
+    uint8_t* at(size_t index) const { return memory + index * buffer_size; }
+
+    const size_t buffer_size;
+    const size_t count;
+    uint8_t* const memory;
+
+    std::mutex mutex;
+    std::vector<size_t> free_list;
+};
+
+DiskBuffer::DiskBuffer(std::shared_ptr<Pool> pool, size_t index)
+    : pool_(std::move(pool))
+    , index_(index)
+{
+}
+
+DiskBuffer::~DiskBuffer() {
+    release();
+}
+
+DiskBuffer::DiskBuffer(DiskBuffer&& other) noexcept
+    : pool_(std::move(other.pool_))
+    , index_(other.index_)
+{
+}
+
+DiskBuffer& DiskBuffer::operator=(DiskBuffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = std::move(other.pool_);
+        index_ = other.index_;
+    }
+    return *this;
+}
+
+uint8_t* DiskBuffer::data() const {
+    return pool_ ? pool_->at(index_) : nullptr;
+}
+
+size_t DiskBuffer::size() const {
+    return pool_ ? pool_->buffer_size : 0;
+}
+
+void DiskBuffer::release() {
+    if (pool_) {
+        std::lock_guard<std::mutex> lock(pool_->mutex);
+        pool_->free_list.push_back(index_);
+    }
+    pool_.reset();
+}
+
+// ============================================================================
+// 请求
+// ============================================================================
+
+namespace {
+
+/**
+ * @brief 请求自带的 asio 处理器内存
+ *
+ * 线程池作业和完成回调都要经 asio 投递，每次投递都会为处理器分配内存；
+ * 同一请求同一时刻至多一个投递在途（asio 在调用处理器前先释放内存），
+ * 因此一块随请求复用的内存即可覆盖，放不下时退回堆分配
+ */
+struct HandlerMemory {
+    static constexpr size_t kSize = 256;
+
+    alignas(std::max_align_t) unsigned char storage[kSize];
+    bool in_use{false};
+};
+
+template <typename T>
+class HandlerAllocator {
+public:
+    using value_type = T;
+
+    explicit HandlerAllocator(HandlerMemory& memory) : memory_(&memory) {}
+
+    template <typename U>
+    HandlerAllocator(const HandlerAllocator<U>& other) : memory_(other.memory_) {}
+
+    T* allocate(size_t n) {
+        size_t bytes = n * sizeof(T);
+        if (!memory_->in_use && bytes <= HandlerMemory::kSize &&
+            alignof(T) <= alignof(std::max_align_t)) {
+            memory_->in_use = true;
+            return reinterpret_cast<T*>(memory_->storage);
+        }
+        return static_cast<T*>(::operator new(bytes));
+    }
+
+    void deallocate(T* p, size_t) {
+        if (reinterpret_cast<unsigned char*>(p) == memory_->storage) {
+            memory_->in_use = false;
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const HandlerAllocator<U>& other) const { return memory_ == other.memory_; }
+
+    template <typename U>
+    bool operator!=(const HandlerAllocator<U>& other) const { return memory_ != other.memory_; }
+
+private:
+    template <typename U>
+    friend class HandlerAllocator;
+
+    HandlerMemory* memory_;
+};
+
+} // namespace
+
+struct DiskIoEngine::Request {
+    bool is_write{false};
+    size_t offset{0};
+    size_t length{0};
+    uint8_t* bytes{nullptr};            // 实际读写的内存（data、buffer 或 pooled）
+    std::vector<uint8_t> data;
+    DiskBuffer buffer;
+    utils::BufferHandle pooled;
+    WriteCallback on_write;
+    ReadCallback on_read;
+    BufferReadCallback on_buffer_read;
+    std::weak_ptr<DiskWriteSink> sink;  // 设置时代替 on_write
+    uint64_t tag{0};
+    HandlerMemory handler_memory;
+
+    HandlerAllocator<void> allocator() { return HandlerAllocator<void>(handler_memory); }
+
+#if MAGNET_HAS_IO_URING
+    // 单个文件内的一次 SQE，短读/短写时原地推进后重新提交
+    struct Op {
+        Request* request{nullptr};
+        FileHandleCache::Handle handle;
+        uint64_t file_offset{0};
+        struct iovec iov{};
+        int buffer_index{-1};           // >= 0 时使用 *_FIXED 操作
+    };
+    std::vector<Op> ops;
+    size_t remaining_ops{0};
+    bool ok{true};
+    std::shared_ptr<Request> self;      // 在环上期间持有自身，全部 SQE 完成后交给 complete
+#endif
+
+    /** @brief 清空以便复用（保留 data 和 ops 的容量） */
+    void reset() {
+        is_write = false;
+        offset = 0;
+        length = 0;
+        bytes = nullptr;
+        data.clear();
+        buffer = DiskBuffer();
+        pooled.reset();
+        on_write = nullptr;
+        on_read = nullptr;
+        on_buffer_read = nullptr;
+        sink.reset();
+        tag = 0;
+#if MAGNET_HAS_IO_URING
+        ops.clear();
+        remaining_ops = 0;
+        ok = true;
+#endif
+    }
+};
+
+// 空闲请求的回收池；完成回调在 io_context 线程上把请求还回来
+struct DiskIoEngine::RequestPool {
+    static constexpr size_t kMaxIdle = 1024;
+
+    std::shared_ptr<Request> acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!idle.empty()) {
+                auto request = std::move(idle.back());
+                idle.pop_back();
+                return request;
+            }
+        }
+        return std::make_shared<Request>();
+    }
+
+    void release(std::shared_ptr<Request> request) {
+        request->reset();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (idle.size() < kMaxIdle) {
+            idle.push_back(std::move(request));
+        }
+    }
+
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Request>> idle;
+};
+
+// ============================================================================
+// io_uring（原始系统调用）
+// ============================================================================
+
+#if MAGNET_HAS_IO_URING
+
+struct DiskIoEngine::Ring {
+    ~Ring() {
+        if (sqes) {
+            ::munmap(sqes, sqes_size);
+        }
+        if (cq_ptr && cq_ptr != sq_ptr) {
+            ::munmap(cq_ptr, cq_size);
+        }
+        if (sq_ptr) {
+            ::munmap(sq_ptr, sq_size);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    bool open(unsigned depth) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(::syscall(__NR_io_uring_setup, depth, &params));
+        if (fd < 0) {
+            return false;
+        }
+
+        sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_size = cq_size = std::max(sq_size, cq_size);
+        }
+
+        sq_ptr = map(sq_size, IORING_OFF_SQ_RING);
+        if (!sq_ptr) {
+            return false;
+        }
+        cq_ptr = single_mmap ? sq_ptr : map(cq_size, IORING_OFF_CQ_RING);
+        if (!cq_ptr) {
+            return false;
+        }
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(map(sqes_size, IORING_OFF_SQES));
+        if (!sqes) {
+            return false;
+        }
+
+        auto* sq = static_cast<uint8_t*>(sq_ptr);
+        sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_entries = params.sq_entries;
+
+        // SQ 数组与 SQE 一一对应，提交时只需推进 tail
+        auto* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        for (unsigned i = 0; i < sq_entries; ++i) {
+            array[i] = i;
+        }
+        local_tail = *sq_tail;
+
+        auto* cq = static_cast<uint8_t*>(cq_ptr);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    /** @brief 取一个空闲 SQE，提交队列满时返回 nullptr */
+    io_uring_sqe* nextSqe() {
+        unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        if (local_tail - head >= sq_entries) {
+            return nullptr;
+        }
+        io_uring_sqe* sqe = &sqes[local_tail & sq_mask];
+        std::memset(sqe, 0, sizeof(*sqe));
+        local_tail++;
+        unsubmitted++;
+        return sqe;
+    }
+
+    /**
+     * @brief 提交已准备的 SQE，并等待至少 wait_nr 个完成
+     * @return 内核接受的 SQE 数，失败返回 -errno
+     */
+    int enter(unsigned wait_nr) {
+        __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+        unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+        int ret = static_cast<int>(::syscall(__NR_io_uring_enter, fd, unsubmitted, wait_nr,
+                                             flags, nullptr, 0));
+        if (ret < 0) {
+            return -errno;
+        }
+        unsubmitted -= std::min<unsigned>(unsubmitted, static_cast<unsigned>(ret));
+        return ret;
+    }
+
+    /** @brief 取出所有已完成的 CQE */
+    template <typename Handler>
+    unsigned reap(Handler&& handler) {
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        while (head != tail) {
+            handler(cqes[head & cq_mask]);
+            head++;
+            count++;
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+        return count;
+    }
+
+    bool registerBuffers(const std::vector<struct iovec>& buffers) {
+        return ::syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS,
+                         buffers.data(), static_cast<unsigned>(buffers.size())) == 0;
+    }
+
+    void* map(size_t size, off_t offset) {
+        void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           fd, offset);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+
+    int fd{-1};
+    void* sq_ptr{nullptr};
+    void* cq_ptr{nullptr};
+    size_t sq_size{0};
+    size_t cq_size{0};
+    io_uring_sqe* sqes{nullptr};
+    size_t sqes_size{0};
+
+    unsigned* sq_head{nullptr};
+    unsigned* sq_tail{nullptr};
+    unsigned sq_mask{0};
+    unsigned sq_entries{0};
+    unsigned local_tail{0};
+    unsigned unsubmitted{0};
+
+    unsigned* cq_head{nullptr};
+    unsigned* cq_tail{nullptr};
+    unsigned cq_mask{0};
+    io_uring_cqe* cqes{nullptr};
+};
+
+#else
+
+struct DiskIoEngine::Ring {};
+
+#endif
+
+// ============================================================================
+// 构造和析构
+// ============================================================================
+
+DiskIoEngine::DiskIoEngine(asio::io_context& io_context, FileManager& files, DiskIoConfig config)
+    : io_context_(io_context)
+    , files_(files)
+    , config_(std::move(config))
+    , request_pool_(std::make_shared<RequestPool>())
+{
+    if (config_.registered_buffers > 0 && config_.registered_buffer_size > 0) {
+        buffer_pool_ = std::make_shared<DiskBuffer::Pool>(config_.registered_buffers,
+                                                          config_.registered_buffer_size);
+    }
+
+#if MAGNET_HAS_IO_URING
+    if (config_.backend != DiskIoBackend::ThreadPool) {
+        auto ring = std::make_unique<Ring>();
+        if (ring->open(std::max(1u, config_.queue_depth))) {
+            ring_ = std::move(ring);
+            backend_ = DiskIoBackend::IoUring;
+        } else {
+            LOG_WARNING("io_uring unavailable (" + std::string(std::strerror(errno)) +
+                        "), falling back to thread pool");
+        }
+    }
+
+    if (ring_ && buffer_pool_) {
+        std::vector<struct iovec> buffers(buffer_pool_->count);
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            buffers[i].iov_base = buffer_pool_->at(i);
+            buffers[i].iov_len = buffer_pool_->buffer_size;
+        }
+        buffers_registered_ = ring_->registerBuffers(buffers);
+        if (!buffers_registered_) {
+            // 常见原因是 RLIMIT_MEMLOCK 不足；缓冲仍可用，只是走普通写入
+            LOG_WARNING("io_uring buffer registration failed: " + std::string(std::strerror(errno)));
+        }
+    }
+#endif
+
+    if (backend_ == DiskIoBackend::IoUring) {
+        ring_thread_ = std::thread([this]() { runRing(); });
+    } else {
+        workers_ = std::make_unique<async::EventLoopManager>(std::max<size_t>(1, config_.thread_count));
+        workers_->start();
+    }
+
+    LOG_INFO(std::string("Disk I/O engine started: ") + diskIoBackendName(backend_) +
+             (buffers_registered_ ? ", registered buffers=" + std::to_string(buffer_pool_->count) : ""));
+}
+
+DiskIoEngine::~DiskIoEngine() {
+    stop();
+}
+
+void DiskIoEngine::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    queue_cv_.notify_all();
+
+    // 两种后端都会先处理完已提交的请求
+    if (ring_thread_.joinable()) {
+        ring_thread_.join();
+    }
+    if (workers_) {
+        workers_->stop();
+    }
+}
+
+// ============================================================================
+// 提交
+// ============================================================================
+
+void DiskIoEngine::asyncWrite(size_t offset, std::vector<uint8_t> data, WriteCallback callback) {
+    auto request = request_pool_->acquire();
+    request->is_write = true;
+    request->offset = offset;
+    request->length = data.size();
+    request->data = std::move(data);
+    request->bytes = request->data.data();
+    request->on_write = std::move(callback);
+    submit(std::move(request));
+}
+
+void DiskIoEngine::asyncWrite(size_t offset, DiskBuffer buffer, size_t length, WriteCallback callback) {
+    auto request = request_pool_->acquire();
+    request->is_write = true;
+    request->offset = offset;
+    request->length = std::min(length, buffer.size());
+    request->bytes = buffer.data();
+    request->buffer = std::move(buffer);
+    request->on_write = std::move(callback);
+    submit(std::move(request));
+}
+
+void DiskIoEngine::asyncWrite(size_t offset, utils::BufferHandle buffer, WriteCallback callback) {
+    auto request = request_pool_->acquire();
+    request->is_write = true;
+    request->offset = offset;
+    request->length = buffer.size();
+    request->bytes = buffer.data();
+    request->pooled = std::move(buffer);
+    request->on_write = std::move(callback);
+    submit(std::move(request));
+}
+
+void DiskIoEngine::asyncWrite(size_t offset, DiskBuffer buffer, size_t length,
+                              std::weak_ptr<DiskWriteSink> sink, uint64_t tag) {
+    auto request = request_pool_->acquire();
+    request->is_write = true;
+    request->offset = offset;
+    request->length = std::min(length, buffer.size());
+    request->bytes = buffer.data();
+    request->buffer = std::move(buffer);
+    request->sink = std::move(sink);
+    request->tag = tag;
+    submit(std::move(request));
+}
+
+void DiskIoEngine::asyncWrite(size_t offset, utils::BufferHandle buffer,
+                              std::weak_ptr<DiskWriteSink> sink, uint64_t tag) {
+    auto request = request_pool_->acquire();
+    request->is_write = true;
+    request->offset = offset;
+    request->length = buffer.size();
+    request->bytes = buffer.data();
+    request->pooled = std::move(buffer);
+    request->sink = std::move(sink);
+    request->tag = tag;
+    submit(std::move(request));
+}
+
+void DiskIoEngine::asyncRead(size_t offset, size_t length, ReadCallback callback) {
+    auto request = request_pool_->acquire();
+    request->offset = offset;
+    request->length = length;
+    request->data.resize(length);
+    request->bytes = request->data.data();
+    request->on_read = std::move(callback);
+    submit(std::move(request));
+}
+
+void DiskIoEngine::asyncRead(size_t offset, utils::BufferHandle buffer, BufferReadCallback callback) {
+    auto request = request_pool_->acquire();
+    request->offset = offset;
+    request->length = buffer.size();
+    request->bytes = buffer.data();
+    request->pooled = std::move(buffer);
+    request->on_buffer_read = std::move(callback);
+    submit(std::move(request));
+}
+
+DiskBuffer DiskIoEngine::acquireBuffer() {
+    if (!buffer_pool_) {
+        return {};
+    }
+    std::lock_guard<std::mutex> lock(buffer_pool_->mutex);
+    if (buffer_pool_->free_list.empty()) {
+        return {};
+    }
+    size_t index = buffer_pool_->free_list.back();
+    buffer_pool_->free_list.pop_back();
+    return DiskBuffer(buffer_pool_, index);
+}
+
+void DiskIoEngine::submit(std::shared_ptr<Request> request) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stats_.submitted++;
+    stats_.in_flight++;
+
+    if (stopping_ || (!request->bytes && request->length > 0)) {
+        lock.unlock();
+        complete(std::move(request), false);
+        return;
+    }
+
+    if (backend_ == DiskIoBackend::IoUring) {
+        queue_.push_back(std::move(request));
+        lock.unlock();
+        queue_cv_.notify_one();
+    } else {
+        // 持锁投递，保证 stop() 之后不会再有新作业进入线程池
+        auto allocator = request->allocator();
+        workers_->post_to_least_loaded(asio::bind_allocator(allocator, [this, request = std::move(request)]() {
+            runBlocking(request);
+        }));
+    }
+}
+
+// ============================================================================
+// 统计
+// ============================================================================
+
+size_t DiskIoEngine::inFlight() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_.in_flight;
+}
+
+DiskIoStatistics DiskIoEngine::statistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// ============================================================================
+// 后端
+// ============================================================================
+
+void DiskIoEngine::runBlocking(const std::shared_ptr<Request>& request) {
+    bool ok = request->is_write
+        ? files_.write(request->offset, request->bytes, request->length)
+        : files_.readInto(request->offset, request->bytes, request->length);
+    complete(request, ok);
+}
+
+void DiskIoEngine::runRing() {
+#if MAGNET_HAS_IO_URING
+    using Op = Request::Op;
+
+    // 以下容器跨批次复用，稳态下提交和收割都不分配内存
+    std::vector<std::shared_ptr<Request>> incoming;
+    std::vector<Op*> ready;             // 等待进入提交队列的操作
+    size_t in_ring = 0;                 // 已提交、尚未完成的 SQE
+    std::vector<FileSlice> slices;
+
+    auto finishOp = [&](Op& op) {
+        Request* request = op.request;
+        if (--request->remaining_ops > 0) {
+            return;
+        }
+        auto owned = std::move(request->self);
+        complete(std::move(owned), request->ok);
+    };
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (in_ring == 0 && ready.empty()) {
+                queue_cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) {
+                    break;      // 已停止且没有剩余请求
+                }
+            }
+            incoming.swap(queue_);
+        }
+
+        // 按文件拆分；无法映射的请求直接失败
+        for (auto& request : incoming) {
+            if (request->length == 0) {
+                complete(std::move(request), true);
+                continue;
+            }
+            if (!files_.mapRange(request->offset, request->length, slices)) {
+                complete(std::move(request), false);
+                continue;
+            }
+
+            int buffer_index = (buffers_registered_ && request->buffer.valid())
+                ? static_cast<int>(request->buffer.index_) : -1;
+            request->ops.resize(slices.size());
+            request->remaining_ops = slices.size();
+            for (size_t i = 0; i < slices.size(); ++i) {
+                Op& op = request->ops[i];
+                op.request = request.get();
+                op.handle = std::move(slices[i].handle);
+                op.file_offset = slices[i].file_offset;
+                op.iov.iov_base = request->bytes + slices[i].buffer_offset;
+                op.iov.iov_len = slices[i].length;
+                op.buffer_index = buffer_index;
+                ready.push_back(&op);
+            }
+            Request* raw = request.get();
+            raw->self = std::move(request);
+        }
+        incoming.clear();
+
+        // 尽可能多地填入提交队列，一次系统调用提交
+        unsigned batch = 0;
+        size_t taken = 0;
+        while (taken < ready.size()) {
+            io_uring_sqe* sqe = ring_->nextSqe();
+            if (!sqe) {
+                break;
+            }
+            Op* op = ready[taken++];
+
+            bool is_write = op->request->is_write;
+            sqe->fd = op->handle->get();
+            sqe->off = op->file_offset;
+            sqe->user_data = reinterpret_cast<uint64_t>(op);
+            if (op->buffer_index >= 0) {
+                sqe->opcode = is_write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+                sqe->addr = reinterpret_cast<uint64_t>(op->iov.iov_base);
+                sqe->len = static_cast<uint32_t>(op->iov.iov_len);
+                sqe->buf_index = static_cast<uint16_t>(op->buffer_index);
+            } else {
+                sqe->opcode = is_write ? IORING_OP_WRITEV : IORING_OP_READV;
+                sqe->addr = reinterpret_cast<uint64_t>(&op->iov);
+                sqe->len = 1;
+            }
+            batch++;
+        }
+        ready.erase(ready.begin(), ready.begin() + static_cast<std::ptrdiff_t>(taken));
+        in_ring += batch;
+
+        if (batch > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.batches++;
+            stats_.max_batch = std::max<uint64_t>(stats_.max_batch, batch);
+        }
+
+        if (in_ring == 0) {
+            continue;
+        }
+
+        // 提交并等待至少一个完成；等待期间新到的请求留到下一批
+        int ret = ring_->enter(1);
+        if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+            LOG_ERROR("io_uring_enter failed: " + std::string(std::strerror(-ret)));
+        }
+
+        in_ring -= ring_->reap([&](const io_uring_cqe& cqe) {
+            auto* op = reinterpret_cast<Op*>(cqe.user_data);
+            Request* request = op->request;
+
+            if (cqe.res == -EAGAIN || cqe.res == -EINTR) {
+                ready.push_back(op);
+                return;
+            }
+            if (cqe.res < 0) {
+                LOG_ERROR(std::string(request->is_write ? "Disk write" : "Disk read") +
+                          " failed: " + std::strerror(-cqe.res));
+                request->ok = false;
+                finishOp(*op);
+                return;
+            }
+
+            auto done = static_cast<size_t>(cqe.res);
+            if (done < op->iov.iov_len) {
+                if (done == 0) {
+                    if (request->is_write) {
+                        request->ok = false;
+                    } else {
+                        // 文件比预期短（未预分配）：剩余部分按 0 填充
+                        std::memset(op->iov.iov_base, 0, op->iov.iov_len);
+                    }
+                    finishOp(*op);
+                    return;
+                }
+                // 短读/短写：推进后重新提交剩余部分
+                op->iov.iov_base = static_cast<uint8_t*>(op->iov.iov_base) + done;
+                op->iov.iov_len -= done;
+                op->file_offset += done;
+                ready.push_back(op);
+                return;
+            }
+            finishOp(*op);
+        });
+    }
+#endif
+}
+
+void DiskIoEngine::complete(std::shared_ptr<Request> request, bool success) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.in_flight--;
+        stats_.completed++;
+        if (!success) {
+            stats_.failed++;
+        } else if (request->is_write) {
+            stats_.bytes_written += request->length;
+        } else {
+            stats_.bytes_read += request->length;
+        }
+    }
+
+    // 固定缓冲和写入用的池化缓冲尽早归还，不等回调执行
+    request->buffer = DiskBuffer();
+    if (request->is_write || !success) {
+        request->pooled.reset();
+    }
+
+    auto allocator = request->allocator();
+    asio::post(io_context_, asio::bind_allocator(allocator,
+        [request = std::move(request), pool = request_pool_, success]() mutable {
+        if (request->is_write) {
+            if (auto sink = request->sink.lock()) {
+                sink->onDiskWrite(request->tag, success);
+            } else if (request->on_write) {
+                request->on_write(success);
+            }
+        } else if (request->on_buffer_read) {
+            request->on_buffer_read(success, std::move(request->pooled));
+        } else if (request->on_read) {
+            request->on_read(success, success ? std::move(request->data) : std::vector<uint8_t>{});
+        }
+        pool->release(std::move(request));
+    }));
+}
+
+} // namespace magnet::storage
@@ -0,0 +1,95 @@
+#include "magnet/storage/file_handle_cache.h"
+
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+
+namespace magnet::storage {
+
+// ============================================================================
+// FileDescriptor
+// ============================================================================
+
+FileDescriptor::~FileDescriptor() {
+    if (fd_ >= 0) {
+#ifdef _WIN32
+        ::_close(fd_);
+#else
+        ::close(fd_);
+#endif
+    }
+}
+
+// ============================================================================
+// FileHandleCache
+// ============================================================================
+
+FileHandleCache::FileHandleCache(size_t max_open)
+    : max_open_(std::max<size_t>(1, max_open))
+{
+}
+
+FileHandleCache::Handle FileHandleCache::acquire(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = entries_.find(path);
+    if (it != entries_.end()) {
+        // 命中：移到 LRU 头部
+        lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+        return it->second.handle;
+    }
+
+#ifdef _WIN32
+    int fd = ::_open(path.c_str(), _O_RDWR | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    int flags = O_RDWR | O_CREAT;
+#ifdef O_CLOEXEC
+    flags |= O_CLOEXEC;
+#endif
+    int fd = ::open(path.c_str(), flags, 0644);
+#endif
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    // 超过上限时淘汰最久未用的；正在使用的描述符由使用者的引用保持打开
+    while (entries_.size() >= max_open_ && !lru_.empty()) {
+        entries_.erase(lru_.back());
+        lru_.pop_back();
+    }
+
+    auto handle = std::make_shared<FileDescriptor>(fd);
+    lru_.push_front(path);
+    entries_.emplace(path, Entry{handle, lru_.begin()});
+    return handle;
+}
+
+void FileHandleCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    lru_.clear();
+}
+
+size_t FileHandleCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+std::vector<FileHandleCache::Handle> FileHandleCache::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<Handle> handles;
+    handles.reserve(entries_.size());
+    for (const auto& [path, entry] : entries_) {
+        handles.push_back(entry.handle);
+    }
+    return handles;
+}
+
+} // namespace magnet::storage
@@ -3,24 +3,73 @@
 
 #include <filesystem>
 #include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAGNET_STORAGE_POSIX 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#else
+#define MAGNET_STORAGE_POSIX 0
+#endif
 
 namespace magnet::storage {
 
 namespace fs = std::filesystem;
 
+namespace {
+
+// 单次 preadv/pwritev 的片段数上限（POSIX 保证 IOV_MAX >= 16，Linux 为 1024）
+constexpr size_t kMaxIoVectors = 1024;
+
+// 32 位平台地址空间有限，单个文件的映射上限
+constexpr size_t k32BitMappingLimit = 512 * 1024 * 1024;
+
+} // namespace
+
 // 日志宏
-#define LOG_DEBUG(msg) magnet::utils::Logger::instance().debug(msg)
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(msg)
 #define LOG_INFO(msg) magnet::utils::Logger::instance().info(msg)
 #define LOG_WARNING(msg) magnet::utils::Logger::instance().warn(msg)
 #define LOG_ERROR(msg) magnet::utils::Logger::instance().error(msg)
 
+const char* preallocateModeName(PreallocateMode mode) {
+    switch (mode) {
+        case PreallocateMode::None:   return "none";
+        case PreallocateMode::Sparse: return "sparse";
+        case PreallocateMode::Full:   return "full";
+        case PreallocateMode::Lazy:   return "lazy";
+    }
+    return "unknown";
+}
+
 // ============================================================================
 // 构造和析构
 // ============================================================================
 
 FileManager::FileManager(const StorageConfig& config)
     : config_(config)
+    , handles_(config.max_open_files)
 {
+    // 按起始偏移排序的文件区间，供二分查找；空文件不占地址空间
+    for (const auto& file : config_.files) {
+        if (file.size > 0) {
+            spans_.push_back({file.offset, file.size, &file, getFullPath(file.path)});
+        }
+    }
+    std::stable_sort(spans_.begin(), spans_.end(), [](const FileSpan& a, const FileSpan& b) {
+        return a.offset < b.offset;
+    });
+    if (config_.preallocate_mode == PreallocateMode::Lazy) {
+        lazy_reserved_ = std::make_unique<std::once_flag[]>(spans_.size());
+    }
+    
     LOG_DEBUG("FileManager created: " + config.base_path);
 }
 
@@ -34,7 +83,7 @@ FileManager::~FileManager() {
 // ============================================================================
 
 bool FileManager::initialize() {
-    if (initialized_) {
+    if (initialized_.load(std::memory_order_acquire)) {
         return true;
     }
     
@@ -51,15 +100,69 @@ bool FileManager::initialize() {
         return false;
     }
     
-    // 创建所有文件
-    for (const auto& file : config_.files) {
-        if (!createFile(file)) {
-            LOG_ERROR("Failed to create file: " + file.path);
-            return false;
+    // 创建所有文件，多文件时并行预分配（Full 模式下大文件的分配可能很慢）
+    size_t file_count = config_.files.size();
+    size_t threads = config_.preallocate_threads > 0
+        ? config_.preallocate_threads
+        : std::max<size_t>(1, std::thread::hardware_concurrency());
+    threads = std::max<size_t>(1, std::min(threads, file_count));
+    
+    allocation_stats_.assign(file_count, {});
+    std::atomic<size_t> next_file{0};
+    std::atomic<bool> all_created{true};
+    
+    auto worker = [&]() {
+        for (size_t i = next_file++; i < file_count; i = next_file++) {
+            const auto& file = config_.files[i];
+            auto& stats = allocation_stats_[i];
+            stats.path = file.path;
+            stats.size = file.size;
+            stats.mode = config_.preallocate_mode;
+            
+            auto start = std::chrono::steady_clock::now();
+            stats.success = createFile(file);
+            stats.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start);
+            
+            if (!stats.success) {
+                LOG_ERROR("Failed to create file: " + file.path);
+                all_created = false;
+            }
         }
+    };
+    
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; ++t) {
+        workers.emplace_back(worker);
     }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    auto total = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
     
-    initialized_ = true;
+    if (!all_created) {
+        return false;
+    }
+    
+    auto slowest = std::max_element(allocation_stats_.begin(), allocation_stats_.end(),
+        [](const FileAllocationStats& a, const FileAllocationStats& b) {
+            return a.elapsed < b.elapsed;
+        });
+    LOG_INFO(std::string("Preallocation (") + preallocateModeName(config_.preallocate_mode) +
+             ") took " + std::to_string(total.count()) + " ms on " + std::to_string(threads) +
+             " threads" + (slowest != allocation_stats_.end()
+                 ? ", slowest: " + slowest->path + " " +
+                   std::to_string(slowest->elapsed.count() / 1000) + " ms"
+                 : std::string()));
+    
+    if (config_.memory_map) {
+        mapFiles();
+    }
+    
+    initialized_.store(true, std::memory_order_release);
     LOG_INFO("Storage initialized successfully, " + 
              std::to_string(config_.files.size()) + " files");
     
@@ -71,137 +174,133 @@ bool FileManager::initialize() {
 // ============================================================================
 
 std::vector<uint8_t> FileManager::read(size_t offset, size_t length) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    if (!initialized_) {
-        LOG_ERROR("FileManager not initialized");
-        return {};
-    }
-    
-    if (offset + length > config_.total_size) {
-        LOG_ERROR("Read out of bounds: offset=" + std::to_string(offset) +
-                  " length=" + std::to_string(length));
+    std::vector<uint8_t> result(length);
+    IoBuffer buffer{result.data(), length};
+    if (!transfer(offset, &buffer, 1, false)) {
         return {};
     }
-    
-    std::vector<uint8_t> result;
-    result.reserve(length);
-    
-    size_t remaining = length;
-    size_t current_offset = offset;
-    
-    while (remaining > 0) {
-        // 找到包含当前偏移的文件
-        const FileEntry* file = getFileForOffset(current_offset);
-        if (!file) {
-            LOG_ERROR("No file found for offset: " + std::to_string(current_offset));
-            return {};
-        }
-        
-        // 计算文件内偏移
-        size_t file_offset = current_offset - file->offset;
-        
-        // 计算可以从该文件读取的长度
-        size_t can_read = std::min(remaining, file->size - file_offset);
-        
-        // 打开文件
-        std::fstream* fs = openFile(file->path);
-        if (!fs || !fs->is_open()) {
-            LOG_ERROR("Failed to open file: " + file->path);
-            return {};
-        }
-        
-        // 读取
-        fs->seekg(static_cast<std::streamoff>(file_offset));
-        if (!fs->good()) {
-            LOG_ERROR("Failed to seek in file: " + file->path);
-            return {};
-        }
-        
-        size_t old_size = result.size();
-        result.resize(old_size + can_read);
-        fs->read(reinterpret_cast<char*>(result.data() + old_size), 
-                 static_cast<std::streamsize>(can_read));
-        
-        if (fs->fail() && !fs->eof()) {
-            LOG_ERROR("Failed to read from file: " + file->path);
-            return {};
-        }
-        
-        current_offset += can_read;
-        remaining -= can_read;
-    }
-    
     return result;
 }
 
+bool FileManager::readInto(size_t offset, uint8_t* out, size_t length) {
+    IoBuffer buffer{out, length};
+    return transfer(offset, &buffer, 1, false);
+}
+
+bool FileManager::readv(size_t offset, const std::vector<IoBuffer>& buffers) {
+    return transfer(offset, buffers.data(), buffers.size(), false);
+}
+
 bool FileManager::write(size_t offset, const std::vector<uint8_t>& data) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    if (!initialized_) {
-        LOG_ERROR("FileManager not initialized");
-        return false;
-    }
-    
-    if (data.empty()) {
-        return true;
+    return write(offset, data.data(), data.size());
+}
+
+bool FileManager::write(size_t offset, const uint8_t* data, size_t length) {
+    // transfer 对写入只读取缓冲区，不会修改
+    IoBuffer buffer{const_cast<uint8_t*>(data), length};
+    return transfer(offset, &buffer, 1, true);
+}
+
+bool FileManager::writev(size_t offset, const std::vector<ConstIoBuffer>& buffers) {
+    std::vector<IoBuffer> iov;
+    iov.reserve(buffers.size());
+    for (const auto& buffer : buffers) {
+        iov.push_back({const_cast<uint8_t*>(buffer.data), buffer.size});
     }
+    return transfer(offset, iov.data(), iov.size(), true);
+}
+
+bool FileManager::mapRange(size_t offset, size_t length, std::vector<FileSlice>& slices) {
+    slices.clear();
     
-    if (offset + data.size() > config_.total_size) {
-        LOG_ERROR("Write out of bounds: offset=" + std::to_string(offset) +
-                  " size=" + std::to_string(data.size()));
+#if MAGNET_STORAGE_POSIX
+    if (!initialized_.load(std::memory_order_acquire) || offset + length > config_.total_size) {
         return false;
     }
     
-    size_t remaining = data.size();
-    size_t current_offset = offset;
-    size_t data_offset = 0;
-    
-    while (remaining > 0) {
-        // 找到包含当前偏移的文件
-        const FileEntry* file = getFileForOffset(current_offset);
-        if (!file) {
-            LOG_ERROR("No file found for offset: " + std::to_string(current_offset));
+    size_t done = 0;
+    while (done < length) {
+        const FileSpan* span = getFileForOffset(offset + done);
+        if (!span) {
             return false;
         }
         
-        // 计算文件内偏移
-        size_t file_offset = current_offset - file->offset;
-        
-        // 计算可以写入该文件的长度
-        size_t can_write = std::min(remaining, file->size - file_offset);
+        size_t file_offset = offset + done - span->offset;
+        size_t chunk = std::min(length - done, span->size - file_offset);
         
-        // 打开文件
-        std::fstream* fs = openFile(file->path);
-        if (!fs || !fs->is_open()) {
-            LOG_ERROR("Failed to open file for writing: " + file->path);
+        auto handle = handles_.acquire(span->full_path);
+        if (!handle) {
+            LOG_ERROR("Failed to open file: " + span->full_path + ": " + std::strerror(errno));
             return false;
         }
         
-        // 写入
-        fs->seekp(static_cast<std::streamoff>(file_offset));
-        if (!fs->good()) {
-            LOG_ERROR("Failed to seek for writing: " + file->path);
+        slices.push_back({std::move(handle), file_offset, done, chunk});
+        done += chunk;
+    }
+    return true;
+#else
+    (void)offset;
+    (void)length;
+    return false;
+#endif
+}
+
+bool FileManager::view(size_t offset, size_t length, std::vector<ConstIoBuffer>& segments) const {
+    segments.clear();
+    
+#if MAGNET_STORAGE_POSIX
+    if (mapped_files_ == 0 || !initialized_.load(std::memory_order_acquire) ||
+        offset + length > config_.total_size) {
+        return false;
+    }
+    
+    static const auto page_size = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+    
+    size_t done = 0;
+    while (done < length) {
+        const FileSpan* span = getFileForOffset(offset + done);
+        if (!span || !span->mapping) {
+            segments.clear();
             return false;
         }
         
-        fs->write(reinterpret_cast<const char*>(data.data() + data_offset),
-                  static_cast<std::streamsize>(can_write));
+        size_t file_offset = offset + done - span->offset;
+        size_t chunk = std::min(length - done, span->size - file_offset);
+        const uint8_t* data = span->mapping + file_offset;
         
-        if (fs->fail()) {
-            LOG_ERROR("Failed to write to file: " + file->path);
-            return false;
-        }
+        // 调用方马上要顺序访问这段数据（校验或上传），提前预读
+        auto begin = reinterpret_cast<uintptr_t>(data) & ~(page_size - 1);
+        auto end = reinterpret_cast<uintptr_t>(data) + chunk;
+        ::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED);
         
-        current_offset += can_write;
-        data_offset += can_write;
-        remaining -= can_write;
+        segments.push_back({data, chunk});
+        done += chunk;
     }
-    
     return true;
+#else
+    (void)offset;
+    (void)length;
+    return false;
+#endif
 }
 
 void FileManager::flush() {
+#if MAGNET_STORAGE_POSIX
+    for (const auto& span : spans_) {
+        if (span.mapping) {
+            ::msync(span.mapping, span.size, MS_SYNC);
+        }
+    }
+    unsynced_bytes_.store(0, std::memory_order_relaxed);
+    
+    for (const auto& handle : handles_.snapshot()) {
+#if defined(__APPLE__)
+        ::fsync(handle->get());
+#else
+        ::fdatasync(handle->get());
+#endif
+    }
+#else
     std::lock_guard<std::mutex> lock(mutex_);
     
     for (auto& [path, fs] : open_files_) {
@@ -209,9 +308,13 @@ void FileManager::flush() {
             fs->flush();
         }
     }
+#endif
 }
 
 void FileManager::close() {
+    unmapFiles();
+    handles_.clear();
+    
     std::lock_guard<std::mutex> lock(mutex_);
     
     for (auto& [path, fs] : open_files_) {
@@ -270,53 +373,114 @@ bool FileManager::createDirectories() {
 
 bool FileManager::createFile(const FileEntry& file) {
     std::string full_path = getFullPath(file.path);
+    PreallocateMode mode = config_.preallocate_mode;
+    
+#if MAGNET_STORAGE_POSIX
+    // 不使用 O_TRUNC：已有数据（断点续传）必须保留
+    int raw_fd = ::open(full_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (raw_fd < 0) {
+        LOG_ERROR("Failed to create file: " + full_path + ": " + std::strerror(errno));
+        return false;
+    }
+    FileDescriptor fd(raw_fd);
+    
+    struct stat st;
+    if (::fstat(fd.get(), &st) != 0) {
+        LOG_ERROR("Failed to stat file: " + full_path + ": " + std::strerror(errno));
+        return false;
+    }
+    auto existing_size = static_cast<size_t>(st.st_size);
     
+    if (existing_size > file.size) {
+        if (!config_.truncate_oversized) {
+            LOG_ERROR("Existing file is larger than expected (" + std::to_string(existing_size) +
+                      " > " + std::to_string(file.size) + "), refusing to truncate: " + full_path);
+            return false;
+        }
+        LOG_WARNING("Truncating oversized file: " + full_path);
+        if (::ftruncate(fd.get(), static_cast<off_t>(file.size)) != 0) {
+            LOG_ERROR("Failed to truncate file: " + full_path + ": " + std::strerror(errno));
+            return false;
+        }
+        existing_size = file.size;
+    }
+    
+    if (file.size > 0) {
+        if (mode == PreallocateMode::Full) {
+            // 空间不足应在启动时暴露，而不是下载到一半
+            if (!preallocateFile(fd.get(), file.size, false)) {
+                LOG_ERROR("Failed to preallocate file: " + full_path + ": " + std::strerror(errno));
+                return false;
+            }
+        } else if (mode != PreallocateMode::None && existing_size < file.size) {
+            if (::ftruncate(fd.get(), static_cast<off_t>(file.size)) != 0) {
+                LOG_WARNING("Failed to extend file: " + full_path + ": " + std::strerror(errno));
+            }
+        }
+    }
+#else
     try {
-        // 检查文件是否已存在
-        if (fs::exists(full_path)) {
-            size_t existing_size = fs::file_size(full_path);
-            if (existing_size == file.size) {
-                LOG_DEBUG("File already exists with correct size: " + file.path);
-                return true;
+        if (!fs::exists(full_path)) {
+            std::ofstream ofs(full_path, std::ios::binary | std::ios::out);
+            if (!ofs.is_open()) {
+                LOG_ERROR("Failed to create file: " + full_path);
+                return false;
             }
-            // 文件存在但大小不对，需要重新创建
-            LOG_DEBUG("File exists but size mismatch, recreating: " + file.path);
         }
         
-        // 创建文件
-        std::ofstream ofs(full_path, std::ios::binary | std::ios::out);
-        if (!ofs.is_open()) {
-            LOG_ERROR("Failed to create file: " + full_path);
+        size_t existing_size = fs::file_size(full_path);
+        if (existing_size > file.size && !config_.truncate_oversized) {
+            LOG_ERROR("Existing file is larger than expected, refusing to truncate: " + full_path);
             return false;
         }
-        ofs.close();
         
-        // 预分配空间
-        if (config_.preallocate && file.size > 0) {
-            if (!preallocateFile(full_path, file.size)) {
-                LOG_WARNING("Failed to preallocate file: " + file.path);
-                // 不视为致命错误
-            }
+        // 没有 fallocate，所有预分配方式都退化为设置逻辑大小
+        if (existing_size > file.size ||
+            (mode != PreallocateMode::None && existing_size < file.size)) {
+            fs::resize_file(full_path, file.size);
         }
-        
-        LOG_DEBUG("Created file: " + file.path + " (" + std::to_string(file.size) + " bytes)");
-        return true;
-        
     } catch (const std::exception& e) {
         LOG_ERROR("Failed to create file " + file.path + ": " + e.what());
         return false;
     }
+#endif
+    
+    LOG_DEBUG("Created file: " + file.path + " (" + std::to_string(file.size) + " bytes, " +
+              preallocateModeName(mode) + ")");
+    return true;
 }
 
-bool FileManager::preallocateFile(const std::string& path, size_t size) {
-    try {
-        // 使用 resize_file 预分配空间
-        fs::resize_file(path, size);
+bool FileManager::preallocateFile(int fd, size_t size, bool keep_size) {
+#if defined(__linux__)
+    int flags = keep_size ? FALLOC_FL_KEEP_SIZE : 0;
+    if (::fallocate(fd, flags, 0, static_cast<off_t>(size)) == 0) {
         return true;
-    } catch (const std::exception& e) {
-        LOG_WARNING("preallocate failed: " + std::string(e.what()));
+    }
+    if (errno != EOPNOTSUPP && errno != ENOSYS) {
+        return false;
+    }
+    if (keep_size) {
+        return false;
+    }
+    // 文件系统不支持 fallocate：posix_fallocate 由 libc 逐块写入模拟
+    int err = ::posix_fallocate(fd, 0, static_cast<off_t>(size));
+    errno = err;
+    return err == 0;
+#elif MAGNET_STORAGE_POSIX && !defined(__APPLE__)
+    if (keep_size) {
+        errno = EOPNOTSUPP;
         return false;
     }
+    int err = ::posix_fallocate(fd, 0, static_cast<off_t>(size));
+    errno = err;
+    return err == 0;
+#else
+    (void)fd;
+    (void)size;
+    (void)keep_size;
+    errno = EOPNOTSUPP;
+    return false;
+#endif
 }
 
 std::fstream* FileManager::openFile(const std::string& relative_path) {
@@ -343,13 +507,307 @@ std::fstream* FileManager::openFile(const std::string& relative_path) {
     return ptr;
 }
 
-const FileEntry* FileManager::getFileForOffset(size_t offset) const {
-    for (const auto& file : config_.files) {
-        if (offset >= file.offset && offset < file.offset + file.size) {
-            return &file;
+const FileManager::FileSpan* FileManager::getFileForOffset(size_t offset) const {
+    // 最后一个起始偏移 <= offset 的文件
+    auto it = std::upper_bound(spans_.begin(), spans_.end(), offset,
+                               [](size_t value, const FileSpan& span) {
+                                   return value < span.offset;
+                               });
+    if (it == spans_.begin()) {
+        return nullptr;
+    }
+    --it;
+    return offset < it->offset + it->size ? &*it : nullptr;
+}
+
+bool FileManager::transfer(size_t offset, const IoBuffer* iov, size_t iov_count, bool is_write) {
+    const char* op = is_write ? "Write" : "Read";
+    
+    if (!initialized_.load(std::memory_order_acquire)) {
+        LOG_ERROR("FileManager not initialized");
+        return false;
+    }
+    
+    size_t length = 0;
+    for (size_t i = 0; i < iov_count; ++i) {
+        length += iov[i].size;
+    }
+    if (length == 0) {
+        return true;
+    }
+    
+    if (offset + length > config_.total_size) {
+        LOG_ERROR(std::string(op) + " out of bounds: offset=" + std::to_string(offset) +
+                  " length=" + std::to_string(length));
+        return false;
+    }
+    
+#if !MAGNET_STORAGE_POSIX
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    
+    size_t iov_index = 0;
+    size_t iov_offset = 0;
+    size_t current_offset = offset;
+    size_t remaining = length;
+    // 每线程复用：单块读写（磁盘引擎的热路径）不再为片段列表分配内存
+    thread_local std::vector<IoBuffer> parts;
+    
+    while (remaining > 0) {
+        // 找到包含当前偏移的文件
+        const FileSpan* span = getFileForOffset(current_offset);
+        if (!span) {
+            LOG_ERROR("No file found for offset: " + std::to_string(current_offset));
+            return false;
+        }
+        
+        // 计算文件内偏移和本文件内的长度
+        size_t file_offset = current_offset - span->offset;
+        size_t chunk = std::min(remaining, span->size - file_offset);
+        
+        // 取出落在本文件内的缓冲片段
+        parts.clear();
+        for (size_t need = chunk; need > 0;) {
+            const auto& buffer = iov[iov_index];
+            size_t take = std::min(buffer.size - iov_offset, need);
+            if (take > 0) {
+                parts.push_back({buffer.data + iov_offset, take});
+            }
+            need -= take;
+            iov_offset += take;
+            if (iov_offset == buffer.size) {
+                iov_index++;
+                iov_offset = 0;
+            }
+        }
+        
+#if MAGNET_STORAGE_POSIX
+        // Lazy 模式：文件首次写入时分配磁盘块（不改变逻辑大小），失败不影响写入
+        if (is_write && lazy_reserved_) {
+            std::call_once(lazy_reserved_[static_cast<size_t>(span - spans_.data())], [this, span]() {
+                auto handle = handles_.acquire(span->full_path);
+                if (!handle || !preallocateFile(handle->get(), span->size, true)) {
+                    LOG_DEBUG("Lazy preallocation skipped: " + span->full_path);
+                }
+            });
+        }
+#endif
+        
+        if (!transferFile(*span, file_offset, parts, is_write)) {
+            return false;
+        }
+        
+        current_offset += chunk;
+        remaining -= chunk;
+    }
+    
+    return true;
+}
+
+bool FileManager::transferFile(const FileSpan& span, size_t file_offset,
+                               std::vector<IoBuffer>& parts, bool is_write) {
+#if MAGNET_STORAGE_POSIX
+    if (span.mapping) {
+        uint8_t* position = span.mapping + file_offset;
+        size_t total = 0;
+        for (const auto& part : parts) {
+            if (is_write) {
+                std::memcpy(position, part.data, part.size);
+            } else {
+                std::memcpy(part.data, position, part.size);
+            }
+            position += part.size;
+            total += part.size;
+        }
+        if (is_write) {
+            noteMappedWrite(total);
+        }
+        return true;
+    }
+    
+    auto handle = handles_.acquire(span.full_path);
+    if (!handle) {
+        LOG_ERROR("Failed to open file: " + span.full_path + ": " + std::strerror(errno));
+        return false;
+    }
+    
+    thread_local std::vector<struct iovec> vec;
+    vec.resize(parts.size());
+    for (size_t i = 0; i < parts.size(); ++i) {
+        vec[i].iov_base = parts[i].data;
+        vec[i].iov_len = parts[i].size;
+    }
+    
+    size_t index = 0;
+    auto position = static_cast<off_t>(file_offset);
+    
+    while (index < vec.size()) {
+        int count = static_cast<int>(std::min<size_t>(vec.size() - index, kMaxIoVectors));
+        ssize_t n;
+        if (count == 1) {
+            n = is_write ? ::pwrite(handle->get(), vec[index].iov_base, vec[index].iov_len, position)
+                         : ::pread(handle->get(), vec[index].iov_base, vec[index].iov_len, position);
+        } else {
+            n = is_write ? ::pwritev(handle->get(), &vec[index], count, position)
+                         : ::preadv(handle->get(), &vec[index], count, position);
+        }
+        
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR(std::string(is_write ? "Failed to write to file: " : "Failed to read from file: ") +
+                      span.full_path + ": " + std::strerror(errno));
+            return false;
+        }
+        
+        if (n == 0) {
+            if (is_write) {
+                LOG_ERROR("Short write to file: " + span.full_path);
+                return false;
+            }
+            // 文件比预期短（未预分配）：剩余部分按 0 填充
+            for (; index < vec.size(); ++index) {
+                std::memset(vec[index].iov_base, 0, vec[index].iov_len);
+            }
+            return true;
+        }
+        
+        // 部分完成时跳过已处理的片段
+        position += n;
+        auto done = static_cast<size_t>(n);
+        while (done > 0) {
+            if (done >= vec[index].iov_len) {
+                done -= vec[index].iov_len;
+                index++;
+            } else {
+                vec[index].iov_base = static_cast<uint8_t*>(vec[index].iov_base) + done;
+                vec[index].iov_len -= done;
+                done = 0;
+            }
+        }
+    }
+    
+    return true;
+#else
+    // 注意：调用时已持有 mutex_
+    std::fstream* fs = openFile(span.file->path);
+    if (!fs || !fs->is_open()) {
+        LOG_ERROR("Failed to open file: " + span.file->path);
+        return false;
+    }
+    
+    if (is_write) {
+        fs->seekp(static_cast<std::streamoff>(file_offset));
+    } else {
+        fs->seekg(static_cast<std::streamoff>(file_offset));
+    }
+    if (!fs->good()) {
+        LOG_ERROR("Failed to seek in file: " + span.file->path);
+        return false;
+    }
+    
+    for (const auto& part : parts) {
+        if (is_write) {
+            fs->write(reinterpret_cast<const char*>(part.data), static_cast<std::streamsize>(part.size));
+            if (fs->fail()) {
+                LOG_ERROR("Failed to write to file: " + span.file->path);
+                return false;
+            }
+        } else {
+            fs->read(reinterpret_cast<char*>(part.data), static_cast<std::streamsize>(part.size));
+            if (fs->fail() && !fs->eof()) {
+                LOG_ERROR("Failed to read from file: " + span.file->path);
+                return false;
+            }
+        }
+    }
+    
+    return true;
+#endif
+}
+
+void FileManager::mapFiles() {
+#if MAGNET_STORAGE_POSIX
+    size_t limit = config_.mmap_max_file_size;
+    if (sizeof(void*) < 8) {
+        limit = limit > 0 ? std::min(limit, k32BitMappingLimit) : k32BitMappingLimit;
+    }
+    
+    for (auto& span : spans_) {
+        if (limit > 0 && span.size > limit) {
+            LOG_DEBUG("File too large to map, using pread/pwrite: " + span.file->path);
+            continue;
+        }
+        
+        auto handle = handles_.acquire(span.full_path);
+        if (!handle) {
+            LOG_WARNING("Failed to open file for mapping: " + span.full_path);
+            continue;
+        }
+        
+        // 写入映射中的稀疏空洞时才分配磁盘块，此时空间不足没有错误码可返回，
+        // 只会触发 SIGBUS。映射前按完整大小实际分配（已分配的范围不重复分配），
+        // 分配不了（空间不足、文件系统或平台不支持）的文件不映射，走 pwrite 报错
+        if (span.size > 0 && !preallocateFile(handle->get(), span.size, false)) {
+            LOG_WARNING("Cannot allocate file for mapping, using pread/pwrite: " + span.full_path +
+                        ": " + std::strerror(errno));
+            continue;
+        }
+        
+        void* mapping = ::mmap(nullptr, span.size, PROT_READ | PROT_WRITE, MAP_SHARED, handle->get(), 0);
+        if (mapping == MAP_FAILED) {
+            LOG_WARNING("mmap failed, using pread/pwrite: " + span.full_path + ": " + std::strerror(errno));
+            continue;
+        }
+        
+        // 分片按稀有度乱序到达，关闭内核的顺序预读
+        ::madvise(mapping, span.size, MADV_RANDOM);
+        span.mapping = static_cast<uint8_t*>(mapping);
+        mapped_files_++;
+    }
+    
+    LOG_INFO("Memory mapped " + std::to_string(mapped_files_) + "/" +
+             std::to_string(spans_.size()) + " files");
+#endif
+}
+
+void FileManager::unmapFiles() {
+#if MAGNET_STORAGE_POSIX
+    for (auto& span : spans_) {
+        if (span.mapping) {
+            ::msync(span.mapping, span.size, MS_SYNC);
+            ::munmap(span.mapping, span.size);
+            span.mapping = nullptr;
+        }
+    }
+    mapped_files_ = 0;
+#endif
+}
+
+void FileManager::noteMappedWrite(size_t bytes) {
+#if MAGNET_STORAGE_POSIX
+    if (config_.mmap_sync_interval == 0) {
+        return;
+    }
+    
+    size_t total = unsynced_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    if (total < config_.mmap_sync_interval) {
+        return;
+    }
+    
+    // 只有一个线程负责这一轮 msync
+    if (!unsynced_bytes_.compare_exchange_strong(total, 0, std::memory_order_relaxed)) {
+        return;
+    }
+    for (const auto& span : spans_) {
+        if (span.mapping) {
+            ::msync(span.mapping, span.size, MS_ASYNC);
         }
     }
-    return nullptr;
+#else
+    (void)bytes;
+#endif
 }
 
 std::string FileManager::getFullPath(const std::string& relative_path) const {
@@ -0,0 +1,148 @@
+#include "magnet/storage/hash_pool.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace magnet::storage {
+
+// ============================================================================
+// 构造和析构
+// ============================================================================
+
+HashPool::HashPool(HashPoolConfig config)
+    : config_(std::move(config))
+{
+    if (config_.thread_count == 0) {
+        config_.thread_count = std::max<size_t>(1, std::thread::hardware_concurrency() / 2);
+    }
+    if (config_.max_pending_jobs == 0) {
+        config_.max_pending_jobs = 1;
+    }
+
+    workers_ = std::make_unique<async::EventLoopManager>(config_.thread_count);
+    workers_->start();
+    running_ = true;
+}
+
+HashPool::~HashPool() {
+    stop();
+}
+
+void HashPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(submit_mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+
+    // EventLoopManager::stop 会等待已投递的作业全部执行完
+    workers_->stop();
+}
+
+// ============================================================================
+// 提交
+// ============================================================================
+
+bool HashPool::submit(HashJob job, HashCallback callback) {
+    std::lock_guard<std::mutex> lock(submit_mutex_);
+    if (!running_) {
+        return false;
+    }
+
+    // 先占位再投递，保证 pending_ 不会超过上限
+    size_t pending = pending_.load(std::memory_order_acquire);
+    do {
+        if (pending >= config_.max_pending_jobs) {
+            std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+            rejected_++;
+            return false;
+        }
+    } while (!pending_.compare_exchange_weak(pending, pending + 1, std::memory_order_acq_rel));
+
+    {
+        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+        peak_pending_ = std::max(peak_pending_, pending + 1);
+    }
+
+    workers_->post_to_least_loaded(
+        [this, job = std::move(job), callback = std::move(callback)]() {
+            runJob(job, callback);
+        });
+    return true;
+}
+
+bool HashPool::saturated() const {
+    return pending_.load(std::memory_order_acquire) >= config_.max_pending_jobs;
+}
+
+// ============================================================================
+// 统计
+// ============================================================================
+
+HashPoolStatistics HashPool::statistics() const {
+    HashPoolStatistics stats;
+    stats.thread_count = config_.thread_count;
+
+    size_t pending = pending_.load(std::memory_order_acquire);
+    size_t running = running_jobs_.load(std::memory_order_acquire);
+    stats.running = std::min(running, pending);
+    stats.queued = pending - stats.running;
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats.peak_pending = peak_pending_;
+    stats.completed = completed_;
+    stats.rejected = rejected_;
+    stats.bytes_hashed = bytes_hashed_;
+    stats.busy_time = busy_time_;
+    return stats;
+}
+
+HashResult HashPool::hashBuffer(const uint8_t* data, size_t length) {
+    HashResult result;
+    result.digest = utils::sha1(data, length);
+    result.bytes = length;
+    result.success = true;
+    return result;
+}
+
+// ============================================================================
+// 内部方法
+// ============================================================================
+
+void HashPool::runJob(const HashJob& job, const HashCallback& callback) {
+    running_jobs_.fetch_add(1, std::memory_order_acq_rel);
+    auto start = std::chrono::steady_clock::now();
+
+    HashResult result;
+    try {
+        result = job();
+    } catch (...) {
+        result = HashResult{};
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        completed_++;
+        bytes_hashed_ += result.bytes;
+        busy_time_ += elapsed;
+    }
+    running_jobs_.fetch_sub(1, std::memory_order_acq_rel);
+
+    // 先释放名额再回调：调用方通常在回调投递的任务里补交积压的作业，
+    // 如果那时名额还没释放，最后一个作业完成后积压就再也不会被补交
+    pending_.fetch_sub(1, std::memory_order_acq_rel);
+
+    if (callback) {
+        try {
+            callback(std::move(result));
+        } catch (...) {
+            // 回调异常不应该影响工作线程
+        }
+    }
+}
+
+} // namespace magnet::storage
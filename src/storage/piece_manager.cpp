@@ -7,7 +7,7 @@
 namespace magnet::storage {
 
 // 日志宏
-#define LOG_DEBUG(msg) magnet::utils::Logger::instance().debug(msg)
+#define LOG_DEBUG(msg) MAGNET_LOG_DEBUG(msg)
 #define LOG_INFO(msg) magnet::utils::Logger::instance().info(msg)
 #define LOG_WARNING(msg) magnet::utils::Logger::instance().warn(msg)
 #define LOG_ERROR(msg) magnet::utils::Logger::instance().error(msg)
@@ -62,13 +62,7 @@ bool PieceManager::initialize() {
 size_t PieceManager::recoverFromExisting() {
     LOG_INFO("Recovering from existing data...");
     
-    size_t recovered = 0;
-    
-    for (size_t i = 0; i < piece_count_; ++i) {
-        if (verifyPiece(static_cast<uint32_t>(i))) {
-            recovered++;
-        }
-    }
+    size_t recovered = verifyAll();
     
     LOG_INFO("Recovered " + std::to_string(recovered) + " pieces");
     return recovered;
@@ -246,43 +240,106 @@ bool PieceManager::verifyPiece(uint32_t index) {
         return true;
     }
     
-    // 读取分片数据
-    auto data = readPiece(index);
-    if (data.empty()) {
-        return false;
-    }
-    
-    // 计算 SHA1
-    auto actual_hash = utils::sha1(data);
-    const auto& expected_hash = config_.piece_hashes[index];
-    
-    bool match = (actual_hash == expected_hash);
-    
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (match) {
-            pieces_[index].status = PieceStatus::Verified;
-            verified_count_.fetch_add(1);
-        } else {
-            pieces_[index].status = PieceStatus::Failed;
+    // 内存映射模式下直接对映射区域计算 SHA1，否则读出分片数据
+    utils::SHA1::Digest actual_hash;
+    std::vector<ConstIoBuffer> segments;
+    if (file_manager_.view(getPieceOffset(index), getPieceSize(index), segments)) {
+        utils::SHA1 hasher;
+        for (const auto& segment : segments) {
+            hasher.update(segment.data, segment.size);
         }
+        actual_hash = hasher.finalize();
+    } else {
+        auto data = readPiece(index);
+        if (data.size() != getPieceSize(index)) {
+            // 读不出完整分片，与哈希不匹配同样记为未通过
+            applyVerifyResult(index, false);
+            return false;
+        }
+        actual_hash = utils::sha1(data);
     }
+    bool match = (actual_hash == config_.piece_hashes[index]);
     
+    applyVerifyResult(index, match);
     return match;
 }
 
 size_t PieceManager::verifyAll() {
     size_t verified = 0;
+    size_t batch_size = utils::sha1MultiBufferLanes();
+    
+    std::vector<uint32_t> batch;
+    std::vector<const uint8_t*> pointers;
+    std::vector<std::vector<uint8_t>> buffers;  // 未映射时读出的分片数据
+    std::vector<ConstIoBuffer> segments;
+    
+    // 一批等长分片一起计算
+    auto flush = [&]() {
+        std::vector<utils::SHA1::Digest> digests(batch.size());
+        utils::sha1Many(pointers.data(), piece_length_, digests.data(), batch.size());
+        
+        for (size_t j = 0; j < batch.size(); ++j) {
+            bool match = digests[j] == config_.piece_hashes[batch[j]];
+            applyVerifyResult(batch[j], match);
+            if (match) {
+                verified++;
+            }
+        }
+        
+        batch.clear();
+        pointers.clear();
+        buffers.clear();
+    };
     
     for (size_t i = 0; i < piece_count_; ++i) {
-        if (verifyPiece(static_cast<uint32_t>(i))) {
-            verified++;
+        uint32_t index = static_cast<uint32_t>(i);
+        
+        // 没有期望哈希或长度不同的最后一个分片单独校验
+        if (batch_size <= 1 || index >= config_.piece_hashes.size() ||
+            getPieceSize(index) != piece_length_) {
+            if (verifyPiece(index)) {
+                verified++;
+            }
+            continue;
         }
+        
+        // 分片完整落在一个映射文件内时直接使用映射地址（零拷贝）
+        if (file_manager_.view(getPieceOffset(index), piece_length_, segments) &&
+            segments.size() == 1) {
+            pointers.push_back(segments[0].data);
+        } else {
+            auto data = readPiece(index);
+            if (data.size() != piece_length_) {
+                applyVerifyResult(index, false);
+                continue;
+            }
+            buffers.push_back(std::move(data));
+            pointers.push_back(buffers.back().data());
+        }
+        batch.push_back(index);
+        
+        if (batch.size() == batch_size) {
+            flush();
+        }
+    }
+    
+    if (!batch.empty()) {
+        flush();
     }
     
     return verified;
 }
 
+void PieceManager::applyVerifyResult(uint32_t index, bool match) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (match) {
+        pieces_[index].status = PieceStatus::Verified;
+        verified_count_.fetch_add(1);
+    } else {
+        pieces_[index].status = PieceStatus::Failed;
+    }
+}
+
 // ============================================================================
 // 状态查询
 // ============================================================================
@@ -0,0 +1,310 @@
+#include "magnet/storage/piece_picker.h"
+
+#include <algorithm>
+
+namespace magnet::storage {
+
+// ============================================================================
+// 构造
+// ============================================================================
+
+PiecePicker::PiecePicker(size_t piece_count)
+    : pieces_(piece_count)
+    , buckets_(1)
+    , rng_(std::random_device{}())
+{
+    buckets_[0].reserve(piece_count);
+    for (size_t i = 0; i < piece_count; ++i) {
+        bucketInsert(static_cast<uint32_t>(i));
+    }
+    pickable_count_ = piece_count;
+}
+
+// ============================================================================
+// 可用度更新
+// ============================================================================
+
+void PiecePicker::setPeerBitfield(const std::string& peer, const std::vector<bool>& bitfield) {
+    auto it = peers_.find(peer);
+    if (it != peers_.end()) {
+        removePeerContribution(it->second);
+    } else {
+        it = peers_.emplace(peer, PeerRecord{}).first;
+    }
+
+    auto& record = it->second;
+    record.have.assign(pieces_.size(), false);
+    record.wanted = 0;
+    size_t limit = std::min(bitfield.size(), pieces_.size());
+    for (size_t i = 0; i < limit; ++i) {
+        record.have[i] = bitfield[i];
+        if (bitfield[i] && pieces_[i].state == LocalState::Missing) {
+            record.wanted++;
+        }
+    }
+
+    addPeerContribution(record);
+}
+
+void PiecePicker::peerHas(const std::string& peer, uint32_t piece_index) {
+    if (piece_index >= pieces_.size()) {
+        return;
+    }
+
+    auto it = peers_.find(peer);
+    if (it == peers_.end()) {
+        // Have 早于 Bitfield（或对方不发 Bitfield）
+        PeerRecord record;
+        record.have.assign(pieces_.size(), false);
+        it = peers_.emplace(peer, std::move(record)).first;
+    }
+
+    auto& record = it->second;
+    if (record.is_seed || record.have[piece_index]) {
+        return;
+    }
+
+    record.have[piece_index] = true;
+    if (pieces_[piece_index].state == LocalState::Missing) {
+        record.wanted++;
+    }
+    incAvailability(piece_index);
+}
+
+void PiecePicker::removePeer(const std::string& peer) {
+    auto it = peers_.find(peer);
+    if (it == peers_.end()) {
+        return;
+    }
+
+    removePeerContribution(it->second);
+    peers_.erase(it);
+}
+
+// ============================================================================
+// 本地分片状态
+// ============================================================================
+
+void PiecePicker::markDownloading(uint32_t piece_index) {
+    if (piece_index >= pieces_.size()) {
+        return;
+    }
+
+    auto& entry = pieces_[piece_index];
+    if (entry.state == LocalState::Missing) {
+        bucketErase(piece_index);
+        pickable_count_--;
+        updateWanted(piece_index, false);
+    }
+    entry.state = LocalState::Downloading;
+}
+
+void PiecePicker::markHave(uint32_t piece_index) {
+    if (piece_index >= pieces_.size()) {
+        return;
+    }
+
+    auto& entry = pieces_[piece_index];
+    if (entry.state == LocalState::Missing) {
+        bucketErase(piece_index);
+        pickable_count_--;
+        updateWanted(piece_index, false);
+    }
+    entry.state = LocalState::Have;
+}
+
+void PiecePicker::markMissing(uint32_t piece_index) {
+    if (piece_index >= pieces_.size()) {
+        return;
+    }
+
+    auto& entry = pieces_[piece_index];
+    if (entry.state == LocalState::Missing) {
+        return;
+    }
+    entry.state = LocalState::Missing;
+    bucketInsert(piece_index);
+    pickable_count_++;
+    updateWanted(piece_index, true);
+}
+
+// ============================================================================
+// 选择
+// ============================================================================
+
+int32_t PiecePicker::pickPiece(const PieceFilter& filter) {
+    // 没有做种者时，可用度为 0 的桶里的分片没人能提供
+    size_t first_bucket = seeds_ > 0 ? 0 : 1;
+
+    for (size_t a = first_bucket; a < buckets_.size(); ++a) {
+        const auto& bucket = buckets_[a];
+        if (bucket.empty()) {
+            continue;
+        }
+
+        // 随机起点，桶内环形查找
+        std::uniform_int_distribution<size_t> dist(0, bucket.size() - 1);
+        size_t start = dist(rng_);
+
+        for (size_t n = 0; n < bucket.size(); ++n) {
+            uint32_t piece = bucket[(start + n) % bucket.size()];
+            if (!filter || filter(piece)) {
+                return static_cast<int32_t>(piece);
+            }
+        }
+    }
+
+    return -1;
+}
+
+int32_t PiecePicker::pickPieceFor(const std::string& peer) {
+    auto it = peers_.find(peer);
+    if (it == peers_.end() || it->second.wanted == 0) {
+        return -1;
+    }
+    if (it->second.is_seed) {
+        return pickPiece();
+    }
+
+    const auto& have = it->second.have;
+    return pickPiece([&have](uint32_t piece_index) { return have[piece_index]; });
+}
+
+// ============================================================================
+// 查询
+// ============================================================================
+
+size_t PiecePicker::availability(uint32_t piece_index) const {
+    if (piece_index >= pieces_.size()) {
+        return 0;
+    }
+    return pieces_[piece_index].availability + seeds_;
+}
+
+bool PiecePicker::peerHasPiece(const std::string& peer, uint32_t piece_index) const {
+    auto it = peers_.find(peer);
+    if (it == peers_.end() || piece_index >= it->second.have.size()) {
+        return false;
+    }
+    return it->second.have[piece_index];
+}
+
+const std::vector<bool>* PiecePicker::peerPieces(const std::string& peer) const {
+    auto it = peers_.find(peer);
+    return it != peers_.end() ? &it->second.have : nullptr;
+}
+
+size_t PiecePicker::wantedCount(const std::string& peer) const {
+    auto it = peers_.find(peer);
+    return it != peers_.end() ? it->second.wanted : 0;
+}
+
+// ============================================================================
+// 内部方法
+// ============================================================================
+
+void PiecePicker::incAvailability(uint32_t piece_index) {
+    auto& entry = pieces_[piece_index];
+    bool in_bucket = entry.state == LocalState::Missing;
+
+    if (in_bucket) {
+        bucketErase(piece_index);
+    }
+    entry.availability++;
+    if (in_bucket) {
+        bucketInsert(piece_index);
+    }
+}
+
+void PiecePicker::decAvailability(uint32_t piece_index) {
+    auto& entry = pieces_[piece_index];
+    if (entry.availability == 0) {
+        return;
+    }
+
+    bool in_bucket = entry.state == LocalState::Missing;
+
+    if (in_bucket) {
+        bucketErase(piece_index);
+    }
+    entry.availability--;
+    if (in_bucket) {
+        bucketInsert(piece_index);
+    }
+}
+
+void PiecePicker::bucketInsert(uint32_t piece_index) {
+    auto& entry = pieces_[piece_index];
+    if (entry.availability >= buckets_.size()) {
+        buckets_.resize(entry.availability + 1);
+    }
+
+    auto& bucket = buckets_[entry.availability];
+    entry.bucket_pos = static_cast<uint32_t>(bucket.size());
+    bucket.push_back(piece_index);
+}
+
+void PiecePicker::bucketErase(uint32_t piece_index) {
+    auto& entry = pieces_[piece_index];
+    if (entry.bucket_pos == kNotInBucket) {
+        return;
+    }
+
+    // 与桶尾交换后弹出，O(1)
+    auto& bucket = buckets_[entry.availability];
+    uint32_t last = bucket.back();
+    bucket[entry.bucket_pos] = last;
+    pieces_[last].bucket_pos = entry.bucket_pos;
+    bucket.pop_back();
+
+    entry.bucket_pos = kNotInBucket;
+}
+
+void PiecePicker::updateWanted(uint32_t piece_index, bool pickable) {
+    // 分片每次开始下载或重新缺失才调用一次，O(Peer 数)
+    for (auto& [key, record] : peers_) {
+        if (record.have[piece_index]) {
+            if (pickable) {
+                record.wanted++;
+            } else if (record.wanted > 0) {
+                record.wanted--;
+            }
+        }
+    }
+}
+
+void PiecePicker::addPeerContribution(PeerRecord& record) {
+    bool all = !record.have.empty() &&
+               std::all_of(record.have.begin(), record.have.end(), [](bool b) { return b; });
+
+    if (all) {
+        // 做种者整体平移所有分片的可用度，桶内顺序不变
+        record.is_seed = true;
+        seeds_++;
+        return;
+    }
+
+    record.is_seed = false;
+    for (size_t i = 0; i < record.have.size(); ++i) {
+        if (record.have[i]) {
+            incAvailability(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+void PiecePicker::removePeerContribution(const PeerRecord& record) {
+    if (record.is_seed) {
+        if (seeds_ > 0) {
+            seeds_--;
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < record.have.size(); ++i) {
+        if (record.have[i]) {
+            decAvailability(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+} // namespace magnet::storage
@@ -0,0 +1,203 @@
+#include "magnet/storage/read_cache.h"
+#include "magnet/storage/disk_io_engine.h"
+#include "magnet/storage/file_manager.h"
+
+#include <algorithm>
+
+namespace magnet::storage {
+
+ReadCache::ReadCache(FileManager& file_manager, size_t piece_length, size_t total_size,
+                     ReadCacheConfig config, DiskIoEngine* disk_io)
+    : file_manager_(file_manager)
+    , disk_io_(disk_io)
+    , piece_length_(piece_length)
+    , total_size_(total_size)
+    , config_(config)
+    , self_(std::make_shared<ReadCache*>(this))
+{
+}
+
+utils::BufferHandle ReadCache::read(uint32_t piece_index, uint32_t begin, uint32_t length) {
+    size_t piece_size = pieceSize(piece_index);
+    if (length == 0 || static_cast<size_t>(begin) + length > piece_size) {
+        return {};
+    }
+
+    Key key = makeKey(piece_index, begin);
+    if (auto cached = lookup(key, length)) {
+        statistics_.hits++;
+        return cached;
+    }
+
+    statistics_.misses++;
+    auto block = load(piece_index, begin, length);
+    if (!block) {
+        return {};
+    }
+    insert(key, block);
+
+    // 预读同一分片中随后的块（按相同块长切分），对方多半接着请求它们
+    size_t next = static_cast<size_t>(begin) + length;
+    for (size_t i = 0; i < config_.read_ahead_blocks && next < piece_size; ++i) {
+        auto next_begin = static_cast<uint32_t>(next);
+        auto next_length = static_cast<uint32_t>(std::min<size_t>(length, piece_size - next));
+        Key next_key = makeKey(piece_index, next_begin);
+
+        if (index_.find(next_key) == index_.end()) {
+            auto ahead = load(piece_index, next_begin, next_length);
+            if (!ahead) {
+                break;
+            }
+            insert(next_key, std::move(ahead));
+        }
+        next += next_length;
+    }
+
+    return block;
+}
+
+void ReadCache::asyncRead(uint32_t piece_index, uint32_t begin, uint32_t length,
+                          ReadCallback callback) {
+    size_t piece_size = pieceSize(piece_index);
+    if (length == 0 || static_cast<size_t>(begin) + length > piece_size) {
+        callback({});
+        return;
+    }
+
+    Key key = makeKey(piece_index, begin);
+    if (auto cached = lookup(key, length)) {
+        statistics_.hits++;
+        callback(std::move(cached));
+        return;
+    }
+
+    // 没有磁盘引擎，或文件已映射（读取只是从映射复制）：同步读取
+    if (!disk_io_ || file_manager_.isMapped()) {
+        callback(read(piece_index, begin, length));
+        return;
+    }
+
+    statistics_.misses++;
+    if (!loadAsync(piece_index, begin, length, callback)) {
+        callback(load(piece_index, begin, length));
+        return;
+    }
+
+    // 预读同一分片中随后的块，与 read() 相同
+    size_t next = static_cast<size_t>(begin) + length;
+    for (size_t i = 0; i < config_.read_ahead_blocks && next < piece_size; ++i) {
+        auto next_begin = static_cast<uint32_t>(next);
+        auto next_length = static_cast<uint32_t>(std::min<size_t>(length, piece_size - next));
+        if (index_.find(makeKey(piece_index, next_begin)) == index_.end()) {
+            loadAsync(piece_index, next_begin, next_length, nullptr);
+        }
+        next += next_length;
+    }
+}
+
+void ReadCache::clear() {
+    lru_.clear();
+    index_.clear();
+    statistics_.cached_bytes = 0;
+}
+
+ReadCacheStatistics ReadCache::statistics() const {
+    return statistics_;
+}
+
+size_t ReadCache::pieceSize(uint32_t piece_index) const {
+    size_t offset = static_cast<size_t>(piece_index) * piece_length_;
+    if (piece_length_ == 0 || offset >= total_size_) {
+        return 0;
+    }
+    return std::min(piece_length_, total_size_ - offset);
+}
+
+utils::BufferHandle ReadCache::load(uint32_t piece_index, uint32_t begin, uint32_t length) {
+    auto block = utils::BufferPool::instance().acquire(length);
+    size_t offset = static_cast<size_t>(piece_index) * piece_length_ + begin;
+    if (!file_manager_.readInto(offset, block.data(), length)) {
+        return {};
+    }
+    statistics_.bytes_read += length;
+    return block;
+}
+
+bool ReadCache::loadAsync(uint32_t piece_index, uint32_t begin, uint32_t length,
+                          ReadCallback callback) {
+    Key key = makeKey(piece_index, begin);
+    auto [it, inserted] = loading_.try_emplace(key);
+    auto& pending = it->second;
+    if (!inserted && pending.length != length) {
+        return false;
+    }
+    if (callback) {
+        pending.callbacks.push_back(std::move(callback));
+    }
+    if (!inserted) {
+        return true;
+    }
+    pending.length = length;
+
+    size_t offset = static_cast<size_t>(piece_index) * piece_length_ + begin;
+    std::weak_ptr<ReadCache*> weak = self_;
+    disk_io_->asyncRead(offset, utils::BufferPool::instance().acquire(length),
+        [weak, key](bool success, utils::BufferHandle data) {
+            auto self = weak.lock();
+            if (!self) {
+                return;
+            }
+            ReadCache* cache = *self;
+
+            auto it = cache->loading_.find(key);
+            if (it == cache->loading_.end()) {
+                return;
+            }
+            auto callbacks = std::move(it->second.callbacks);
+            cache->loading_.erase(it);
+
+            if (success) {
+                cache->statistics_.bytes_read += data.size();
+                cache->insert(key, data);
+            } else {
+                data.reset();
+            }
+            for (auto& callback : callbacks) {
+                callback(data);
+            }
+        });
+    return true;
+}
+
+utils::BufferHandle ReadCache::lookup(Key key, uint32_t length) {
+    auto it = index_.find(key);
+    if (it == index_.end() || it->second->data.size() != length) {
+        return {};
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->data;
+}
+
+void ReadCache::insert(Key key, utils::BufferHandle data) {
+    auto existing = index_.find(key);
+    if (existing != index_.end()) {
+        statistics_.cached_bytes -= existing->second->data.size();
+        lru_.erase(existing->second);
+        index_.erase(existing);
+    }
+
+    statistics_.cached_bytes += data.size();
+    lru_.push_front(Entry{key, std::move(data)});
+    index_[key] = lru_.begin();
+
+    // 淘汰最久未用的块（至少保留刚放入的这一个）
+    while (statistics_.cached_bytes > config_.capacity && lru_.size() > 1) {
+        auto& victim = lru_.back();
+        statistics_.cached_bytes -= victim.data.size();
+        index_.erase(victim.key);
+        lru_.pop_back();
+        statistics_.evictions++;
+    }
+}
+
+} // namespace magnet::storage
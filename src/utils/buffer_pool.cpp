@@ -0,0 +1,228 @@
+#include "magnet/utils/buffer_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace magnet::utils {
+
+namespace {
+
+constexpr std::align_val_t kAlignment{alignof(BufferHeader)};
+
+// 线程缓存每个级别最多保留的缓冲数，以及与全局链表交换的批量
+constexpr size_t kThreadCacheLimit = 64;
+constexpr size_t kThreadCacheBatch = 16;
+
+} // namespace
+
+// ============================================================================
+// 线程局部缓存（只服务 instance()）
+// ============================================================================
+
+struct BufferThreadCache {
+    std::array<std::vector<BufferHeader*>, BufferPool::kClassCount> free;
+
+    ~BufferThreadCache() {
+        // 全局池不析构，线程退出时把缓存的缓冲归还
+        auto& pool = BufferPool::instance();
+        std::lock_guard<std::mutex> lock(pool.mutex_);
+        for (auto& list : free) {
+            for (auto* header : list) {
+                pool.pushShared(header);
+            }
+            list.clear();
+        }
+    }
+};
+
+namespace {
+
+BufferThreadCache& threadCache() {
+    thread_local BufferThreadCache cache;
+    return cache;
+}
+
+} // namespace
+
+// ============================================================================
+// BufferHandle
+// ============================================================================
+
+void BufferHandle::reset() {
+    if (header_) {
+        if (header_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            header_->pool->release(header_);
+        }
+        header_ = nullptr;
+    }
+}
+
+// ============================================================================
+// BufferPool
+// ============================================================================
+
+BufferPool& BufferPool::instance() {
+    // 有意不析构：其他线程的线程缓存可能在静态对象析构之后才退出
+    static BufferPool* pool = [] {
+        auto* created = new BufferPool();
+        created->thread_cached_ = true;
+        return created;
+    }();
+    return *pool;
+}
+
+BufferPool::BufferPool(size_t slab_bytes)
+    : slab_bytes_(slab_bytes)
+{
+}
+
+BufferPool::~BufferPool() {
+    for (void* slab : slabs_) {
+        ::operator delete(slab, kAlignment);
+    }
+}
+
+uint32_t BufferPool::classFor(size_t size) {
+    for (uint32_t i = 0; i < kClassCount; ++i) {
+        if (size <= kClassSizes[i]) {
+            return i;
+        }
+    }
+    return kHeapClass;
+}
+
+size_t BufferPool::strideFor(uint32_t size_class) {
+    size_t align = alignof(BufferHeader);
+    size_t bytes = sizeof(BufferHeader) + kClassSizes[size_class];
+    return (bytes + align - 1) / align * align;
+}
+
+BufferHandle BufferPool::acquire(size_t size) {
+    uint32_t size_class = classFor(size);
+    BufferHeader* header = nullptr;
+
+    if (size_class == kHeapClass) {
+        // 超出最大级别：单独分配，释放时直接归还给堆
+        void* memory = ::operator new(sizeof(BufferHeader) + size, kAlignment);
+        header = new (memory) BufferHeader();
+        header->size_class = kHeapClass;
+        header->capacity = size;
+        header->pool = this;
+        heap_allocations_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        header = allocate(size_class);
+        header->refs.store(1, std::memory_order_relaxed);
+    }
+
+    header->size = size;
+    in_use_.fetch_add(1, std::memory_order_relaxed);
+    acquired_.fetch_add(1, std::memory_order_relaxed);
+    return BufferHandle(header);
+}
+
+BufferHandle BufferPool::copy(const uint8_t* data, size_t size) {
+    auto handle = acquire(size);
+    if (size > 0) {
+        std::memcpy(handle.data(), data, size);
+    }
+    return handle;
+}
+
+BufferPoolStatistics BufferPool::statistics() const {
+    BufferPoolStatistics stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats.slabs = slabs_.size();
+        stats.slab_bytes = slab_total_bytes_;
+        stats.slab_allocations = slab_allocations_;
+    }
+    stats.in_use = in_use_.load(std::memory_order_relaxed);
+    stats.acquired = acquired_.load(std::memory_order_relaxed);
+    stats.heap_allocations = heap_allocations_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+BufferHeader* BufferPool::allocate(uint32_t size_class) {
+    if (!thread_cached_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return popShared(size_class);
+    }
+
+    auto& cache = threadCache().free[size_class];
+    if (cache.empty()) {
+        // 从全局链表批量取一批，摊薄加锁开销
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < kThreadCacheBatch; ++i) {
+            cache.push_back(popShared(size_class));
+        }
+    }
+    BufferHeader* header = cache.back();
+    cache.pop_back();
+    return header;
+}
+
+void BufferPool::release(BufferHeader* header) {
+    in_use_.fetch_sub(1, std::memory_order_relaxed);
+
+    if (header->size_class == kHeapClass) {
+        header->~BufferHeader();
+        ::operator delete(header, kAlignment);
+        return;
+    }
+
+    header->size = 0;
+    if (!thread_cached_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pushShared(header);
+        return;
+    }
+
+    auto& cache = threadCache().free[header->size_class];
+    cache.push_back(header);
+    if (cache.size() > kThreadCacheLimit) {
+        // 缓存满了，归还一半给全局链表（跨线程释放时缓冲会流向释放方线程）
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (cache.size() > kThreadCacheLimit / 2) {
+            pushShared(cache.back());
+            cache.pop_back();
+        }
+    }
+}
+
+BufferHeader* BufferPool::popShared(uint32_t size_class) {
+    auto& list = free_[size_class];
+    if (list.empty()) {
+        allocateSlab(size_class);
+    }
+    BufferHeader* header = list.back();
+    list.pop_back();
+    return header;
+}
+
+void BufferPool::pushShared(BufferHeader* header) {
+    free_[header->size_class].push_back(header);
+}
+
+void BufferPool::allocateSlab(uint32_t size_class) {
+    size_t stride = strideFor(size_class);
+    size_t count = std::max<size_t>(1, slab_bytes_ / stride);
+    size_t bytes = count * stride;
+
+    auto* slab = static_cast<uint8_t*>(::operator new(bytes, kAlignment));
+    slabs_.push_back(slab);
+    slab_total_bytes_ += bytes;
+    slab_allocations_++;
+
+    auto& list = free_[size_class];
+    list.reserve(list.size() + count);
+    for (size_t i = count; i-- > 0;) {
+        auto* header = new (slab + i * stride) BufferHeader();
+        header->size_class = size_class;
+        header->capacity = kClassSizes[size_class];
+        header->pool = this;
+        list.push_back(header);
+    }
+}
+
+} // namespace magnet::utils
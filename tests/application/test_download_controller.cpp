@@ -0,0 +1,245 @@
+/**
+ * @file test_download_controller.cpp
+ * @brief DownloadController 单元测试（本地回环做种 Peer）
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/application/download_controller.h>
+#include <magnet/protocols/peer_connection.h>
+#include <magnet/utils/buffer_pool.h>
+#include <magnet/utils/sha1.h>
+#include "test_helpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+using namespace magnet;
+using namespace magnet::application;
+using namespace magnet::protocols;
+namespace fs = std::filesystem;
+using magnet::test::runUntil;
+
+// ========== 辅助函数 ==========
+
+namespace {
+
+std::vector<uint8_t> pattern(size_t length) {
+    std::vector<uint8_t> data(length);
+    for (size_t i = 0; i < length; ++i) {
+        data[i] = static_cast<uint8_t>(i * 7 + 3);
+    }
+    return data;
+}
+
+// 单文件、单分片（3 个块）的种子
+application::TorrentMetadata singlePieceMetadata(const InfoHash& info_hash, const std::vector<uint8_t>& data) {
+    application::TorrentMetadata meta;
+    meta.info_hash = info_hash;
+    meta.name = "payload.bin";
+    meta.total_size = data.size();
+    meta.piece_length = data.size();
+    meta.piece_count = 1;
+    utils::SHA1 hasher;
+    hasher.update(data.data(), data.size());
+    meta.piece_hashes.push_back(hasher.finalize());
+    meta.files.push_back({"payload.bin", data.size(), 0, 0});
+    return meta;
+}
+
+// 连接到 port 的做种方：拥有整个分片，收到请求立即发送
+std::shared_ptr<PeerConnection> connectSeeder(asio::io_context& io, const InfoHash& info_hash,
+                                              const std::vector<uint8_t>& data, uint16_t port) {
+    auto seeder = std::make_shared<PeerConnection>(io, info_hash, "-TS0001-seeder000000");
+    std::weak_ptr<PeerConnection> weak = seeder;
+    seeder->setMessageCallback([weak, &data](const BtMessage& msg) {
+        auto self = weak.lock();
+        if (self && msg.type() == BtMessageType::Request) {
+            auto b = msg.toBlockInfo();
+            self->sendPiece(b.piece_index, b.begin,
+                            utils::BufferPool::instance().copy(data.data() + b.begin, b.length));
+        }
+    });
+    seeder->connect({"127.0.0.1", port}, [weak](bool success) {
+        auto self = weak.lock();
+        if (success && self) {
+            self->sendBitfield({true});
+            self->sendUnchoke();
+        }
+    });
+    return seeder;
+}
+
+} // namespace
+
+// ========== 写盘失败 ==========
+
+TEST(DownloadControllerTest, FailedWriteRefetchesWholePiece) {
+    const size_t block = DownloadController::kBlockSize;
+    auto data = pattern(3 * block);
+    auto info_hash = InfoHash::fromHex("0123456789abcdef0123456789abcdef01234567");
+    ASSERT_TRUE(info_hash.has_value());
+
+    fs::path dir = fs::temp_directory_path() /
+                   ("magnet_dc_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()));
+    fs::remove_all(dir);
+    fs::path payload = dir / "payload.bin";
+
+    asio::io_context io;
+    auto controller = std::make_shared<DownloadController>(io);
+    bool completed = false;
+    controller->setCompletedCallback([&](bool success, const std::string&) {
+        completed = success;
+    });
+
+    DownloadConfig config;
+    config.magnet_uri = "magnet:?xt=urn:btih:" + info_hash->toHex();
+    config.save_path = dir.string();
+    config.listen_port = 0;
+    config.enable_dht = false;
+    config.hash_threads = 1;
+    config.disk_io_backend = storage::DiskIoBackend::ThreadPool;
+    ASSERT_TRUE(controller->start(config));
+    ASSERT_NE(controller->listenPort(), 0);
+    controller->setMetadata(singlePieceMetadata(*info_hash, data));
+    ASSERT_EQ(controller->state(), DownloadState::Downloading);
+
+    // 文件换成同名目录：写盘时打不开，磁盘引擎回报失败
+    fs::remove(payload);
+    fs::create_directory(payload);
+
+    // 做种方：文件恢复之前只发送块 0，其余请求扣住不发
+    auto seeder = std::make_shared<PeerConnection>(io, *info_hash, "-TS0001-seeder000000");
+    bool restored = false;
+    std::vector<BlockInfo> requests;
+    std::vector<BlockInfo> held;
+    std::vector<BlockInfo> cancels;
+    auto send = [&](const BlockInfo& b) {
+        seeder->sendPiece(b.piece_index, b.begin,
+                          utils::BufferPool::instance().copy(data.data() + b.begin, b.length));
+    };
+    seeder->setMessageCallback([&](const BtMessage& msg) {
+        if (msg.type() == BtMessageType::Request) {
+            auto b = msg.toBlockInfo();
+            requests.push_back(b);
+            if (restored || b.begin == 0) {
+                send(b);
+            } else {
+                held.push_back(b);
+            }
+        } else if (msg.type() == BtMessageType::Cancel) {
+            auto b = msg.toBlockInfo();
+            cancels.push_back(b);
+            held.erase(std::remove(held.begin(), held.end(), b), held.end());
+        }
+    });
+    seeder->connect({"127.0.0.1", controller->listenPort()}, [&](bool success) {
+        ASSERT_TRUE(success);
+        seeder->sendBitfield({true});
+        seeder->sendUnchoke();
+    });
+
+    // 块 0 写盘失败后，扣住的块 1、2 被取消
+    ASSERT_TRUE(runUntil(io, [&] { return cancels.size() >= 2; }));
+    EXPECT_TRUE(std::all_of(cancels.begin(), cancels.end(),
+                            [](const BlockInfo& b) { return b.begin != 0; }));
+
+    // 恢复文件，放行所有请求：整个分片重新请求并完成
+    fs::remove(payload);
+    restored = true;
+    for (const auto& b : held) {
+        send(b);
+    }
+    held.clear();
+    ASSERT_TRUE(runUntil(io, [&] { return completed; }));
+
+    for (uint32_t begin = 0; begin < data.size(); begin += block) {
+        EXPECT_GE(std::count_if(requests.begin(), requests.end(),
+                                [begin](const BlockInfo& b) { return b.begin == begin; }), 2)
+            << "block at " << begin << " was not requested again";
+    }
+
+    std::ifstream file(payload, std::ios::binary);
+    std::vector<uint8_t> written((std::istreambuf_iterator<char>(file)),
+                                 std::istreambuf_iterator<char>());
+    EXPECT_EQ(written, data);
+
+    seeder->disconnect();
+    controller->stop();
+    io.run_for(std::chrono::milliseconds(50));
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+}
+
+// ========== 共享接受器 ==========
+
+TEST(DownloadControllerTest, TorrentsShareOneAcceptor) {
+    const size_t block = DownloadController::kBlockSize;
+    auto data = pattern(2 * block);
+
+    asio::io_context io;
+    auto acceptor = std::make_shared<PeerAcceptor>(io);
+    ASSERT_TRUE(acceptor->listen(0));
+
+    struct Torrent {
+        InfoHash info_hash;
+        fs::path dir;
+        std::shared_ptr<DownloadController> controller;
+        std::shared_ptr<PeerConnection> seeder;
+        bool completed{false};
+    };
+    std::vector<Torrent> torrents(2);
+    const char* hashes[] = {"1111111111111111111111111111111111111111",
+                            "2222222222222222222222222222222222222222"};
+
+    for (size_t i = 0; i < torrents.size(); ++i) {
+        auto& torrent = torrents[i];
+        torrent.info_hash = *InfoHash::fromHex(hashes[i]);
+        torrent.dir = fs::temp_directory_path() /
+                      ("magnet_dc_shared_" + std::to_string(i) + "_" +
+                       std::to_string(::testing::UnitTest::GetInstance()->random_seed()));
+        fs::remove_all(torrent.dir);
+
+        torrent.controller = std::make_shared<DownloadController>(io);
+        torrent.controller->setCompletedCallback([&torrent](bool success, const std::string&) {
+            torrent.completed = success;
+        });
+
+        DownloadConfig config;
+        config.magnet_uri = "magnet:?xt=urn:btih:" + torrent.info_hash.toHex();
+        config.save_path = torrent.dir.string();
+        config.global_peer_acceptor = acceptor;     // listen_port 被忽略，不会再绑定 6881
+        config.enable_dht = false;
+        config.hash_threads = 1;
+        config.disk_io_backend = storage::DiskIoBackend::ThreadPool;
+        ASSERT_TRUE(torrent.controller->start(config));
+        EXPECT_EQ(torrent.controller->listenPort(), acceptor->localPort());
+        torrent.controller->setMetadata(singlePieceMetadata(torrent.info_hash, data));
+
+        torrent.seeder = connectSeeder(io, torrent.info_hash, data, acceptor->localPort());
+    }
+
+    // 两个种子的入站连接经同一个端口按 info_hash 分别路由
+    ASSERT_TRUE(runUntil(io, [&] { return torrents[0].completed && torrents[1].completed; }));
+    EXPECT_EQ(acceptor->getStatistics().routed, 2u);
+
+    // 任务结束只注销自己的 info_hash，共享接受器继续监听
+    auto late = connectSeeder(io, torrents[0].info_hash, data, acceptor->localPort());
+    ASSERT_TRUE(runUntil(io, [&] { return acceptor->getStatistics().rejected_unknown == 1; }));
+
+    late->disconnect();
+    for (auto& torrent : torrents) {
+        torrent.seeder->disconnect();
+        torrent.controller->stop();
+    }
+    acceptor->stop();
+    io.run_for(std::chrono::milliseconds(50));
+    std::error_code ec;
+    for (auto& torrent : torrents) {
+        fs::remove_all(torrent.dir, ec);
+    }
+}
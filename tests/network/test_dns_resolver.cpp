@@ -0,0 +1,139 @@
+/**
+ * @file test_dns_resolver.cpp
+ * @brief DnsResolver 缓存/合并查询与 TcpClient 异步解析连接单元测试
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/network/dns_resolver.h>
+#include <magnet/network/tcp_client.h>
+#include <magnet/network/tcp_listener.h>
+#include "test_helpers.h"
+
+#include <chrono>
+#include <functional>
+
+using namespace magnet::network;
+using magnet::test::runUntil;
+
+// ========== 辅助函数 ==========
+
+namespace {
+
+asio::ip::address addr(const char* text) {
+    return asio::ip::make_address(text);
+}
+
+} // namespace
+
+// ========== DnsResolver ==========
+
+TEST(DnsResolverTest, LiteralsBypassLookupAndCache) {
+    asio::io_context io;
+    auto resolver = std::make_shared<DnsResolver>(io);
+
+    DnsResolver::Addresses result;
+    bool done = false;
+    resolver->resolve("::1", [&](const asio::error_code& ec, const DnsResolver::Addresses& a) {
+        EXPECT_FALSE(ec);
+        result = a;
+        done = true;
+    });
+    EXPECT_FALSE(done);   // 回调总是异步
+    ASSERT_TRUE(runUntil(io, [&] { return done; }));
+
+    ASSERT_EQ(result.size(), 1u);
+    EXPECT_EQ(result[0], addr("::1"));
+    EXPECT_EQ(resolver->getStatistics().lookups, 0u);
+    EXPECT_EQ(resolver->getStatistics().cached_entries, 0u);
+}
+
+TEST(DnsResolverTest, ConcurrentLookupsCoalesceAndResultIsCached) {
+    asio::io_context io;
+    auto resolver = std::make_shared<DnsResolver>(io);
+
+    int completed = 0;
+    auto expect_loopback = [&](const asio::error_code& ec, const DnsResolver::Addresses& a) {
+        EXPECT_FALSE(ec);
+        ASSERT_FALSE(a.empty());
+        EXPECT_TRUE(a.front().is_loopback());
+        completed++;
+    };
+    resolver->resolve("localhost", expect_loopback);
+    resolver->resolve("localhost", expect_loopback);
+    ASSERT_TRUE(runUntil(io, [&] { return completed == 2; }));
+
+    auto stats = resolver->getStatistics();
+    EXPECT_EQ(stats.lookups, 1u);
+    EXPECT_EQ(stats.coalesced, 1u);
+    EXPECT_EQ(stats.cached_entries, 1u);
+
+    // 缓存命中，不再查询
+    resolver->resolve("localhost", expect_loopback);
+    ASSERT_TRUE(runUntil(io, [&] { return completed == 3; }));
+    EXPECT_EQ(resolver->getStatistics().lookups, 1u);
+    EXPECT_EQ(resolver->getStatistics().hits, 1u);
+
+    // 过期（清空）后重新查询
+    resolver->clear();
+    resolver->resolve("localhost", expect_loopback);
+    ASSERT_TRUE(runUntil(io, [&] { return completed == 4; }));
+    EXPECT_EQ(resolver->getStatistics().lookups, 2u);
+}
+
+TEST(DnsResolverTest, SharedInstancePerIoContext) {
+    asio::io_context io;
+    asio::io_context other;
+    auto first = DnsResolver::shared(io);
+    EXPECT_EQ(first, DnsResolver::shared(io));
+    EXPECT_NE(first, DnsResolver::shared(other));
+}
+
+TEST(DnsResolverTest, InterleavesAddressFamiliesStartingWithIpv6) {
+    DnsResolver::Addresses input = {
+        addr("10.0.0.1"), addr("10.0.0.2"), addr("10.0.0.3"), addr("2001:db8::1"),
+    };
+    DnsResolver::Addresses expected = {
+        addr("2001:db8::1"), addr("10.0.0.1"), addr("10.0.0.2"), addr("10.0.0.3"),
+    };
+    EXPECT_EQ(interleaveAddressFamilies(input), expected);
+}
+
+// ========== TcpClient 异步解析连接 ==========
+
+TEST(TcpClientResolveTest, ConnectsToHostname) {
+    asio::io_context io;
+    auto listener = std::make_shared<TcpListener>(io);
+    std::shared_ptr<TcpClient> server;
+    ASSERT_TRUE(listener->listen(0, [&](std::shared_ptr<TcpClient> accepted) {
+        server = std::move(accepted);
+    }));
+
+    auto client = std::make_shared<TcpClient>(io);
+    asio::error_code result = asio::error::would_block;
+    client->connect({"localhost", listener->localPort()},
+                    [&](const asio::error_code& ec) { result = ec; },
+                    std::chrono::seconds(5));
+    ASSERT_TRUE(runUntil(io, [&] { return result != asio::error::would_block && server; }));
+
+    EXPECT_FALSE(result);
+    EXPECT_TRUE(client->isConnected());
+    listener->close();
+    client->close();
+}
+
+TEST(TcpClientResolveTest, CloseDuringResolutionAbortsConnect) {
+    asio::io_context io;
+    auto client = std::make_shared<TcpClient>(io);
+
+    asio::error_code result;
+    bool done = false;
+    client->connect({"localhost", 1}, [&](const asio::error_code& ec) {
+        result = ec;
+        done = true;
+    });
+    client->close();
+    ASSERT_TRUE(runUntil(io, [&] { return done; }));
+
+    EXPECT_EQ(result, asio::error::operation_aborted);
+    EXPECT_EQ(client->state(), TcpConnectionState::Disconnected);
+}
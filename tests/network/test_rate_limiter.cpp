@@ -0,0 +1,224 @@
+/**
+ * @file test_rate_limiter.cpp
+ * @brief RateLimiter 令牌桶与 TcpClient 限速单元测试（本地回环实测）
+ *
+ * 速率按限速器自己的活动窗口（第一次到最后一次 consume）计算，连接建立和
+ * 测试开始前后的调度延迟不计入，所以可以双向检查 ±5%
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/network/rate_limiter.h>
+#include <magnet/network/tcp_client.h>
+#include <magnet/network/tcp_listener.h>
+#include "test_helpers.h"
+
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <vector>
+
+using namespace magnet::network;
+using Clock = std::chrono::steady_clock;
+using magnet::test::runUntil;
+
+// ========== 辅助函数 ==========
+
+namespace {
+
+constexpr size_t kRate = 2 * 1024 * 1024;       // 2 MB/s
+constexpr size_t kPayload = 1024 * 1024;        // 每次传输 1 MB，约 0.5 秒
+constexpr size_t kMessageSize = 16384;
+
+double seconds(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// 限速器实际放行的速率在配置值的 ±5% 以内
+void expectRateWithinTolerance(const RateLimiter& limiter, size_t rate) {
+    double tolerance = 0.05 * static_cast<double>(rate);
+    EXPECT_NEAR(limiter.getStatistics().activeRate(), static_cast<double>(rate), tolerance);
+}
+
+// 本地回环上的一对已连接 TcpClient
+struct LoopbackPair {
+    std::shared_ptr<TcpListener> listener;
+    std::shared_ptr<TcpClient> client;
+    std::shared_ptr<TcpClient> server;
+};
+
+LoopbackPair connectPair(asio::io_context& io) {
+    LoopbackPair pair;
+    pair.listener = std::make_shared<TcpListener>(io);
+    EXPECT_TRUE(pair.listener->listen(0, [&pair](std::shared_ptr<TcpClient> accepted) {
+        pair.server = std::move(accepted);
+    }));
+
+    bool connected = false;
+    pair.client = std::make_shared<TcpClient>(io);
+    pair.client->connect({"127.0.0.1", pair.listener->localPort()},
+                         [&](const asio::error_code& ec) { connected = !ec; });
+    EXPECT_TRUE(runUntil(io, [&] { return connected && pair.server != nullptr; }));
+
+    // 只需要这一个连接；关闭监听，回调不再引用局部变量
+    pair.listener->close();
+    return pair;
+}
+
+void sendPayload(TcpClient& sender, size_t total) {
+    for (size_t sent = 0; sent < total; sent += kMessageSize) {
+        sender.send(std::vector<uint8_t>(std::min(kMessageSize, total - sent), 0x5a));
+    }
+}
+
+} // namespace
+
+// ========== RateLimiter ==========
+
+TEST(RateLimiterTest, UnlimitedLevelNeverWaits) {
+    asio::io_context io;
+    auto limiter = std::make_shared<RateLimiter>(io);
+
+    limiter->consume(10 * 1024 * 1024);
+    EXPECT_TRUE(limiter->ready());
+    EXPECT_EQ(limiter->quantum(), std::numeric_limits<size_t>::max());
+    EXPECT_EQ(limiter->getStatistics().bytes_consumed, 10u * 1024 * 1024);
+}
+
+TEST(RateLimiterTest, DebtIsRepaidAtConfiguredRate) {
+    asio::io_context io;
+    auto start = Clock::now();
+    auto limiter = std::make_shared<RateLimiter>(io, 100 * 1024);
+
+    // 扣成负数后要等 50KB / 100KB/s = 0.5 秒（定时器不会提前触发）
+    limiter->consume(50 * 1024);
+    EXPECT_FALSE(limiter->ready());
+
+    Clock::time_point woke;
+    limiter->wait([&] { woke = Clock::now(); });
+    ASSERT_TRUE(runUntil(io, [&] { return woke != Clock::time_point{}; }));
+
+    EXPECT_GE(seconds(start, woke), 0.5);
+    EXPECT_LT(seconds(start, woke), 1.0);
+    EXPECT_TRUE(limiter->ready());
+    EXPECT_EQ(limiter->getStatistics().waits, 1u);
+}
+
+TEST(RateLimiterTest, ParentGatesChildren) {
+    asio::io_context io;
+    auto parent = std::make_shared<RateLimiter>(io, 100 * 1024);
+    auto first = std::make_shared<RateLimiter>(io, 0, parent);
+    auto second = std::make_shared<RateLimiter>(io, 0, parent);
+
+    // 子级不限速，但上级欠账时所有子级都要等
+    first->consume(10 * 1024);
+    EXPECT_FALSE(first->ready());
+    EXPECT_FALSE(second->ready());
+    EXPECT_EQ(parent->getStatistics().bytes_consumed, 10u * 1024);
+    EXPECT_EQ(second->quantum(), parent->quantum());
+
+    EXPECT_EQ(first->getStatistics().bytes_consumed, 10u * 1024);
+    EXPECT_EQ(second->getStatistics().bytes_consumed, 0u);
+}
+
+TEST(RateLimiterTest, ParentRateChangeWakesChildWaiters) {
+    asio::io_context io;
+    auto parent = std::make_shared<RateLimiter>(io, 10 * 1024);
+    auto child = std::make_shared<RateLimiter>(io, 0, parent);
+
+    // 按旧速率要等 10KB / 10KB/s = 1 秒，子级定时器已按此设置
+    parent->consume(10 * 1024);
+    Clock::time_point woke;
+    child->wait([&] { woke = Clock::now(); });
+    io.run_for(std::chrono::milliseconds(20));
+    io.restart();
+    ASSERT_EQ(woke, Clock::time_point{});
+
+    // 上级提速到 1MB/s 后欠账约 10 毫秒就能还清，只有新速率能这么快唤醒
+    auto changed = Clock::now();
+    parent->setRate(1024 * 1024);
+    ASSERT_TRUE(runUntil(io, [&] { return woke != Clock::time_point{}; }));
+    EXPECT_LT(seconds(changed, woke), 0.3);
+    EXPECT_TRUE(child->ready());
+}
+
+// ========== TcpClient 限速（本地回环实测） ==========
+
+TEST(RateLimitedTransferTest, UploadRateWithinTolerance) {
+    asio::io_context io;
+    auto pair = connectPair(io);
+    ASSERT_TRUE(pair.server);
+
+    auto limiter = std::make_shared<RateLimiter>(io, kRate);
+    pair.client->setRateLimiters(nullptr, limiter);
+
+    size_t received = 0;
+    pair.server->startReceive([&](const asio::error_code&, const std::vector<uint8_t>& data) {
+        received += data.size();
+    });
+
+    sendPayload(*pair.client, kPayload);
+    ASSERT_TRUE(runUntil(io, [&] { return received >= kPayload; }));
+
+    expectRateWithinTolerance(*limiter, kRate);
+    EXPECT_EQ(limiter->getStatistics().bytes_consumed, kPayload);
+
+    pair.client->close();
+    pair.server->close();
+}
+
+TEST(RateLimitedTransferTest, DownloadRateWithinTolerance) {
+    asio::io_context io;
+    auto pair = connectPair(io);
+    ASSERT_TRUE(pair.server);
+
+    // 发送方不限速，接收方按速率读取（内核缓冲区里的数据也要按速率取走）
+    auto limiter = std::make_shared<RateLimiter>(io, kRate);
+    pair.server->setRateLimiters(limiter, nullptr);
+
+    ReceiveBuffer buffer(TcpClient::kMinReadSpace);
+    size_t received = 0;
+    pair.server->startReceive(buffer, [&](const asio::error_code&, size_t bytes) {
+        received += bytes;
+        buffer.consume(buffer.size());
+    });
+
+    sendPayload(*pair.client, kPayload);
+    ASSERT_TRUE(runUntil(io, [&] { return received >= kPayload; }));
+
+    expectRateWithinTolerance(*limiter, kRate);
+
+    pair.client->close();
+    pair.server->close();
+}
+
+TEST(RateLimitedTransferTest, HierarchicalLimitSharedAcrossConnections) {
+    asio::io_context io;
+    auto first = connectPair(io);
+    auto second = connectPair(io);
+    ASSERT_TRUE(first.server && second.server);
+
+    // 两个连接各有一个不限速的 Peer 级限速器，共享一个种子级上限
+    auto torrent = std::make_shared<RateLimiter>(io, kRate);
+    first.client->setRateLimiters(nullptr, std::make_shared<RateLimiter>(io, 0, torrent));
+    second.client->setRateLimiters(nullptr, std::make_shared<RateLimiter>(io, 0, torrent));
+
+    size_t received = 0;
+    auto count = [&](const asio::error_code&, const std::vector<uint8_t>& data) {
+        received += data.size();
+    };
+    first.server->startReceive(count);
+    second.server->startReceive(count);
+
+    sendPayload(*first.client, kPayload / 2);
+    sendPayload(*second.client, kPayload / 2);
+    ASSERT_TRUE(runUntil(io, [&] { return received >= kPayload; }));
+
+    // 两个连接合计也不能超过种子级速率
+    expectRateWithinTolerance(*torrent, kRate);
+    EXPECT_EQ(torrent->getStatistics().bytes_consumed, kPayload);
+
+    for (auto* pair : {&first, &second}) {
+        pair->client->close();
+        pair->server->close();
+    }
+}
@@ -0,0 +1,126 @@
+/**
+ * @file test_receive_buffer.cpp
+ * @brief ReceiveBuffer 单元测试
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/network/receive_buffer.h>
+
+#include <cstring>
+#include <vector>
+
+using namespace magnet::network;
+
+// ========== 辅助函数 ==========
+
+namespace {
+
+std::vector<uint8_t> pattern(size_t length, uint8_t seed) {
+    std::vector<uint8_t> data(length);
+    for (size_t i = 0; i < length; ++i) {
+        data[i] = static_cast<uint8_t>(seed + i);
+    }
+    return data;
+}
+
+std::vector<uint8_t> contents(const ReceiveBuffer& buffer) {
+    return std::vector<uint8_t>(buffer.data(), buffer.data() + buffer.size());
+}
+
+} // namespace
+
+// ========== 基本操作测试 ==========
+
+TEST(ReceiveBufferTest, AppendAndConsume) {
+    ReceiveBuffer buffer(64);
+    auto data = pattern(40, 1);
+    buffer.append(data.data(), data.size());
+    EXPECT_EQ(buffer.size(), 40u);
+    EXPECT_EQ(contents(buffer), data);
+
+    buffer.consume(10);
+    EXPECT_EQ(contents(buffer), std::vector<uint8_t>(data.begin() + 10, data.end()));
+
+    // 超过剩余长度的 consume 只清空已有数据
+    buffer.consume(100);
+    EXPECT_TRUE(buffer.empty());
+}
+
+TEST(ReceiveBufferTest, ConsumeAllResetsCursors) {
+    ReceiveBuffer buffer(64);
+    auto data = pattern(48, 0);
+    buffer.append(data.data(), data.size());
+    buffer.consume(48);
+
+    // 读完后游标归零，尾部空间恢复为整个容量
+    EXPECT_EQ(buffer.writable(), buffer.capacity());
+}
+
+TEST(ReceiveBufferTest, PrepareCompactsBeforeGrowing) {
+    ReceiveBuffer buffer(64);
+    auto data = pattern(60, 3);
+    buffer.append(data.data(), data.size());
+    buffer.consume(50);
+
+    // 尾部只剩 4 字节，但搬移 10 字节未处理数据后足够，不应扩容
+    buffer.prepare(32);
+    EXPECT_EQ(buffer.capacity(), 64u);
+    EXPECT_GE(buffer.writable(), 32u);
+    EXPECT_EQ(contents(buffer), std::vector<uint8_t>(data.begin() + 50, data.end()));
+}
+
+TEST(ReceiveBufferTest, PrepareGrowsAndKeepsPendingData) {
+    ReceiveBuffer buffer(16);
+    auto data = pattern(12, 7);
+    buffer.append(data.data(), data.size());
+    buffer.consume(2);
+
+    buffer.prepare(100);
+    EXPECT_GE(buffer.writable(), 100u);
+    EXPECT_EQ(contents(buffer), std::vector<uint8_t>(data.begin() + 2, data.end()));
+}
+
+TEST(ReceiveBufferTest, PrepareCommitWritesInPlace) {
+    ReceiveBuffer buffer(32);
+    auto data = pattern(20, 9);
+
+    uint8_t* out = buffer.prepare(data.size());
+    std::memcpy(out, data.data(), data.size());
+    buffer.commit(data.size());
+    EXPECT_EQ(contents(buffer), data);
+
+    // commit 不会越过可写空间
+    buffer.prepare(0);
+    buffer.commit(buffer.writable() + 10);
+    EXPECT_EQ(buffer.size(), buffer.capacity());
+}
+
+TEST(ReceiveBufferTest, StreamedMessagesStayContiguous) {
+    // 模拟逐段到达的数据流：每次读到 7 字节，每 5 字节消费一条消息
+    ReceiveBuffer buffer(8);
+    auto stream = pattern(1000, 0);
+    std::vector<uint8_t> parsed;
+
+    for (size_t pos = 0; pos < stream.size(); pos += 7) {
+        size_t length = std::min<size_t>(7, stream.size() - pos);
+        buffer.append(stream.data() + pos, length);
+        while (buffer.size() >= 5) {
+            parsed.insert(parsed.end(), buffer.data(), buffer.data() + 5);
+            buffer.consume(5);
+        }
+    }
+    EXPECT_EQ(parsed, stream);
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_LE(buffer.capacity(), 16u);
+}
+
+TEST(ReceiveBufferTest, ClearKeepsCapacity) {
+    ReceiveBuffer buffer(16);
+    auto data = pattern(100, 0);
+    buffer.append(data.data(), data.size());
+    size_t capacity = buffer.capacity();
+
+    buffer.clear();
+    EXPECT_TRUE(buffer.empty());
+    EXPECT_EQ(buffer.capacity(), capacity);
+}
@@ -0,0 +1,234 @@
+/**
+ * @file test_tcp_client.cpp
+ * @brief TcpClient 单元测试（本地回环）
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/network/tcp_client.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace magnet::network;
+
+// ========== 辅助函数 ==========
+
+namespace {
+
+std::vector<uint8_t> pattern(size_t length, uint8_t seed) {
+    std::vector<uint8_t> data(length);
+    for (size_t i = 0; i < length; ++i) {
+        data[i] = static_cast<uint8_t>(seed + i * 7);
+    }
+    return data;
+}
+
+// 本地回环监听端，接受一个连接后写入 payload
+class LoopbackServer {
+public:
+    explicit LoopbackServer(asio::io_context& io)
+        : acceptor_(io, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0))
+        , socket_(io)
+    {
+    }
+
+    uint16_t port() const { return acceptor_.local_endpoint().port(); }
+
+    void acceptAndSend(std::vector<uint8_t> payload) {
+        payload_ = std::move(payload);
+        acceptor_.async_accept(socket_, [this](const asio::error_code& ec) {
+            ASSERT_FALSE(ec);
+            asio::async_write(socket_, asio::buffer(payload_),
+                [this](const asio::error_code& write_ec, size_t) {
+                    EXPECT_FALSE(write_ec);
+                    asio::error_code ignored;
+                    socket_.shutdown(asio::ip::tcp::socket::shutdown_send, ignored);
+                });
+        });
+    }
+
+private:
+    asio::ip::tcp::acceptor acceptor_;
+    asio::ip::tcp::socket socket_;
+    std::vector<uint8_t> payload_;
+};
+
+// 本地回环接收端，接受一个连接后读到 EOF
+class LoopbackSink {
+public:
+    explicit LoopbackSink(asio::io_context& io)
+        : acceptor_(io, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0))
+        , socket_(io)
+        , chunk_(65536)
+    {
+        acceptor_.async_accept(socket_, [this](const asio::error_code& ec) {
+            ASSERT_FALSE(ec);
+            readMore();
+        });
+    }
+
+    uint16_t port() const { return acceptor_.local_endpoint().port(); }
+    const std::vector<uint8_t>& received() const { return received_; }
+
+private:
+    void readMore() {
+        socket_.async_read_some(asio::buffer(chunk_), [this](const asio::error_code& ec, size_t n) {
+            received_.insert(received_.end(), chunk_.begin(), chunk_.begin() + n);
+            if (!ec) {
+                readMore();
+            }
+        });
+    }
+
+    asio::ip::tcp::acceptor acceptor_;
+    asio::ip::tcp::socket socket_;
+    std::vector<uint8_t> chunk_;
+    std::vector<uint8_t> received_;
+};
+
+} // namespace
+
+// ========== 缓冲区模式接收测试 ==========
+
+TEST(TcpClientTest, ReceivesDirectlyIntoCallerBuffer) {
+    asio::io_context io;
+    LoopbackServer server(io);
+    auto payload = pattern(1 << 20, 3);
+    server.acceptAndSend(payload);
+
+    // 初始容量很小，覆盖读取过程中缓冲区扩容
+    ReceiveBuffer buffer(1024);
+    auto client = std::make_shared<TcpClient>(io);
+    size_t notified = 0;
+    bool disconnected = false;
+
+    client->setDisconnectCallback([&disconnected](const asio::error_code&) {
+        disconnected = true;
+    });
+    client->connect({"127.0.0.1", server.port()}, [&](const asio::error_code& ec) {
+        ASSERT_FALSE(ec);
+        client->startReceive(buffer, [&](const asio::error_code& receive_ec, size_t bytes) {
+            EXPECT_FALSE(receive_ec);
+            notified += bytes;
+            EXPECT_EQ(buffer.size(), notified);
+        });
+    });
+    io.run();
+
+    EXPECT_TRUE(disconnected);
+    EXPECT_EQ(notified, payload.size());
+    ASSERT_EQ(buffer.size(), payload.size());
+    EXPECT_TRUE(std::equal(payload.begin(), payload.end(), buffer.data()));
+    EXPECT_EQ(client->getStatistics().bytes_received, payload.size());
+}
+
+TEST(TcpClientTest, ConsumingBetweenReadsKeepsStreamOrder) {
+    asio::io_context io;
+    LoopbackServer server(io);
+    auto payload = pattern(300000, 11);
+    server.acceptAndSend(payload);
+
+    // 模拟解析器：每次只消费完整的 1000 字节“消息”，余下的留待下次
+    ReceiveBuffer buffer(4096);
+    std::vector<uint8_t> parsed;
+    auto client = std::make_shared<TcpClient>(io);
+    client->connect({"127.0.0.1", server.port()}, [&](const asio::error_code& ec) {
+        ASSERT_FALSE(ec);
+        client->startReceive(buffer, [&](const asio::error_code&, size_t) {
+            while (buffer.size() >= 1000) {
+                parsed.insert(parsed.end(), buffer.data(), buffer.data() + 1000);
+                buffer.consume(1000);
+            }
+        });
+    });
+    io.run();
+
+    EXPECT_EQ(parsed, payload);
+    EXPECT_TRUE(buffer.empty());
+}
+
+// ========== 发送队列测试 ==========
+
+TEST(TcpClientTest, QueuedSendsAreCoalescedInOrder) {
+    asio::io_context io;
+    LoopbackSink sink(io);
+
+    auto client = std::make_shared<TcpClient>(io);
+    std::vector<uint8_t> expected;
+    std::vector<int> completed;
+
+    client->connect({"127.0.0.1", sink.port()}, [&](const asio::error_code& ec) {
+        ASSERT_FALSE(ec);
+        // 模拟流水线发送 128 个 REQUEST（每个 17 字节）
+        for (int i = 0; i < 128; ++i) {
+            auto message = pattern(17, static_cast<uint8_t>(i));
+            expected.insert(expected.end(), message.begin(), message.end());
+            client->send(std::move(message), [&, i](const asio::error_code& send_ec, size_t bytes) {
+                EXPECT_FALSE(send_ec);
+                EXPECT_EQ(bytes, 17u);
+                completed.push_back(i);
+                if (completed.size() == 128) {
+                    client->close();
+                }
+            });
+        }
+        EXPECT_EQ(client->pendingSendBytes(), 128u * 17);
+    });
+    io.run();
+
+    ASSERT_EQ(completed.size(), 128u);
+    EXPECT_TRUE(std::is_sorted(completed.begin(), completed.end()));
+    EXPECT_EQ(sink.received(), expected);
+
+    auto stats = client->getStatistics();
+    EXPECT_EQ(stats.messages_sent, 128u);
+    EXPECT_EQ(stats.bytes_sent, expected.size());
+    EXPECT_EQ(stats.write_calls, 2u);    // 每批最多 64 条
+    EXPECT_EQ(client->pendingSendBytes(), 0u);
+}
+
+TEST(TcpClientTest, WatermarkCallbackReportsBackPressure) {
+    asio::io_context io;
+    LoopbackSink sink(io);
+
+    auto client = std::make_shared<TcpClient>(io);
+    std::vector<bool> transitions;
+    client->setSendWatermark(1000, [&transitions](bool above) {
+        transitions.push_back(above);
+    });
+
+    client->connect({"127.0.0.1", sink.port()}, [&](const asio::error_code& ec) {
+        ASSERT_FALSE(ec);
+        for (int i = 0; i < 10; ++i) {
+            client->send(pattern(200, 0), [&, i](const asio::error_code&, size_t) {
+                if (i == 9) {
+                    client->close();
+                }
+            });
+        }
+    });
+    io.run();
+
+    EXPECT_EQ(transitions, (std::vector<bool>{true, false}));
+    EXPECT_EQ(sink.received().size(), 2000u);
+}
+
+TEST(TcpClientTest, SendAfterCloseFails) {
+    asio::io_context io;
+    LoopbackSink sink(io);
+
+    auto client = std::make_shared<TcpClient>(io);
+    bool failed = false;
+    client->connect({"127.0.0.1", sink.port()}, [&](const asio::error_code& ec) {
+        ASSERT_FALSE(ec);
+        client->close();
+        client->send(pattern(10, 0), [&failed](const asio::error_code& send_ec, size_t bytes) {
+            EXPECT_TRUE(send_ec);
+            EXPECT_EQ(bytes, 0u);
+            failed = true;
+        });
+    });
+    io.run();
+
+    EXPECT_TRUE(failed);
+}
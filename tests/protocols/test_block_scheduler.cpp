@@ -0,0 +1,294 @@
+/**
+ * @file test_block_scheduler.cpp
+ * @brief BlockScheduler 单元测试
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/protocols/block_scheduler.h>
+
+using namespace magnet::protocols;
+using namespace std::chrono_literals;
+
+// ========== 辅助函数 ==========
+
+namespace {
+
+const magnet::network::TcpEndpoint kPeerA{"10.0.0.1", 6881};
+const magnet::network::TcpEndpoint kPeerB{"10.0.0.2", 6881};
+
+BlockInfo makeBlock(uint32_t piece, uint32_t index) {
+    return BlockInfo(piece, index * BlockInfo::kDefaultBlockSize, BlockInfo::kDefaultBlockSize);
+}
+
+BlockSchedulerConfig testConfig() {
+    BlockSchedulerConfig config;
+    config.initial_queue_depth = 4;
+    config.min_queue_depth = 2;
+    config.max_queue_depth = 64;
+    config.queue_headroom = 2;
+    config.initial_block_timeout = 10s;
+    config.min_block_timeout = 1s;
+    config.max_block_timeout = 20s;
+    config.rate_sample_interval = 1s;
+    return config;
+}
+
+} // namespace
+
+// ========== Peer 管理测试 ==========
+
+TEST(BlockSchedulerTest, NewPeerIsChoked) {
+    BlockScheduler scheduler(testConfig());
+    scheduler.addPeer(kPeerA);
+
+    EXPECT_TRUE(scheduler.hasPeer(kPeerA));
+    EXPECT_EQ(scheduler.freeSlots(kPeerA), 0u);
+    EXPECT_TRUE(scheduler.requestablePeers().empty());
+}
+
+TEST(BlockSchedulerTest, UnchokedPeerUsesInitialDepth) {
+    BlockScheduler scheduler(testConfig());
+    scheduler.addPeer(kPeerA);
+    scheduler.setPeerChoked(kPeerA, false);
+
+    EXPECT_EQ(scheduler.queueDepth(kPeerA), 4u);
+    EXPECT_EQ(scheduler.freeSlots(kPeerA), 4u);
+    ASSERT_EQ(scheduler.requestablePeers().size(), 1u);
+}
+
+TEST(BlockSchedulerTest, RequestsConsumeSlots) {
+    BlockScheduler scheduler(testConfig());
+    scheduler.addPeer(kPeerA);
+    scheduler.setPeerChoked(kPeerA, false);
+
+    auto now = BlockScheduler::Clock::now();
+    for (uint32_t i = 0; i < 4; ++i) {
+        scheduler.onBlockRequested(kPeerA, makeBlock(0, i), now);
+    }
+
+    EXPECT_EQ(scheduler.outstanding(kPeerA), 4u);
+    EXPECT_EQ(scheduler.freeSlots(kPeerA), 0u);
+    EXPECT_EQ(scheduler.totalOutstanding(), 4u);
+    EXPECT_TRUE(scheduler.requestablePeers().empty());
+}
+
+TEST(BlockSchedulerTest, ChokeReturnsOutstandingBlocks) {
+    BlockScheduler scheduler(testConfig());
+    scheduler.addPeer(kPeerA);
+    scheduler.setPeerChoked(kPeerA, false);
+
+    auto now = BlockScheduler::Clock::now();
+    scheduler.onBlockRequested(kPeerA, makeBlock(3, 0), now);
+    scheduler.onBlockRequested(kPeerA, makeBlock(3, 1), now);
+
+    auto released = scheduler.setPeerChoked(kPeerA, true);
+    EXPECT_EQ(released.size(), 2u);
+    EXPECT_EQ(scheduler.outstanding(kPeerA), 0u);
+    EXPECT_EQ(scheduler.totalOutstanding(), 0u);
+}
+
+TEST(BlockSchedulerTest, RemovePeerReturnsOutstandingBlocks) {
+    BlockScheduler scheduler(testConfig());
+    scheduler.addPeer(kPeerA);
+    scheduler.setPeerChoked(kPeerA, false);
+
+    scheduler.onBlockRequested(kPeerA, makeBlock(1, 0), BlockScheduler::Clock::now());
+
+    auto released = scheduler.removePeer(kPeerA);
+    ASSERT_EQ(released.size(), 1u);
+    EXPECT_EQ(released[0], makeBlock(1, 0));
+    EXPECT_FALSE(scheduler.hasPeer(kPeerA));
+    EXPECT_EQ(scheduler.totalOutstanding(), 0u);
+}
+
+// ========== 收到数据测试 ==========
+
+TEST(BlockSchedulerTest, ReceiveFreesSlot) {
+    BlockScheduler scheduler(testConfig());
+    scheduler.addPeer(kPeerA);
+    scheduler.setPeerChoked(kPeerA, false);
+
+    auto now = BlockScheduler::Clock::now();
+    scheduler.onBlockRequested(kPeerA, makeBlock(0, 0), now);
+
+    EXPECT_TRUE(scheduler.onBlockReceived(kPeerA, makeBlock(0, 0), now + 50ms));
+    EXPECT_EQ(scheduler.outstanding(kPeerA), 0u);
+
+    // 未请求过的块不计入
+    EXPECT_FALSE(scheduler.onBlockReceived(kPeerA, makeBlock(0, 1), now + 60ms));
+    EXPECT_FALSE(scheduler.onBlockReceived(kPeerB, makeBlock(0, 0), now + 60ms));
+}
+
+TEST(BlockSchedulerTest, MalformedBlocksAreNotAccepted) {
+    BlockScheduler scheduler(testConfig());
+    scheduler.addPeer(kPeerA);
+    scheduler.setPeerChoked(kPeerA, false);
+
+    auto now = BlockScheduler::Clock::now();
+    auto block = makeBlock(0, 1);
+    scheduler.onBlockRequested(kPeerA, block, now);
+
+    // 超长的块会越过块边界写到相邻数据上
+    BlockInfo oversized(block.piece_index, block.begin, block.length + 1);
+    EXPECT_FALSE(scheduler.onBlockReceived(kPeerA, oversized, now + 10ms));
+
+    // 未对齐的块与任何请求都不匹配
+    BlockInfo misaligned(block.piece_index, block.begin + 1, block.length);
+    EXPECT_FALSE(scheduler.onBlockReceived(kPeerA, misaligned, now + 10ms));
+
+    // 请求仍在管道中，正确的块照常计入
+    EXPECT_EQ(scheduler.outstanding(kPeerA), 1u);
+    EXPECT_TRUE(scheduler.onBlockReceived(kPeerA, block, now + 20ms));
+    EXPECT_EQ(scheduler.outstanding(kPeerA), 0u);
+}
+
+TEST(BlockSchedulerTest, ReleaseBlockRemovesFromAllPeers) {
+    BlockScheduler scheduler(testConfig());
+    scheduler.addPeer(kPeerA);
+    scheduler.addPeer(kPeerB);
+    scheduler.setPeerChoked(kPeerA, false);
+    scheduler.setPeerChoked(kPeerB, false);
+
+    auto now = BlockScheduler::Clock::now();
+    scheduler.onBlockRequested(kPeerA, makeBlock(5, 2), now);
+    scheduler.onBlockRequested(kPeerB, makeBlock(5, 2), now);
+
+    auto holders = scheduler.releaseBlock(5, 2 * BlockInfo::kDefaultBlockSize);
+    EXPECT_EQ(holders.size(), 2u);
+    EXPECT_EQ(scheduler.totalOutstanding(), 0u);
+}
+
+// ========== 管道深度测试 ==========
+
+TEST(BlockSchedulerTest, DepthFollowsBandwidthDelayProduct) {
+    BlockScheduler scheduler(testConfig());
+    scheduler.addPeer(kPeerA);
+    scheduler.setPeerChoked(kPeerA, false);
+
+    // 模拟 100ms 延迟、每 10ms 一个块（约 1.6 MB/s）持续 2 秒
+    // BDP ≈ 1.6MB/s × 0.1s / 16KB ≈ 10 个块
+    auto start = BlockScheduler::Clock::now();
+    uint32_t index = 0;
+    for (int ms = 0; ms <= 2000; ms += 10) {
+        auto sent = start + std::chrono::milliseconds(ms);
+        auto block = makeBlock(index / 16, index % 16);
+        scheduler.onBlockRequested(kPeerA, block, sent);
+        scheduler.onBlockReceived(kPeerA, block, sent + 100ms);
+        ++index;
+    }
+
+    size_t depth = scheduler.queueDepth(kPeerA);
+    EXPECT_GE(depth, 10u);
+    EXPECT_LE(depth, 14u);
+    EXPECT_GT(scheduler.downloadRate(kPeerA), 1.0e6);
+}
+
+TEST(BlockSchedulerTest, DepthIsClamped) {
+    auto config = testConfig();
+    config.max_queue_depth = 8;
+    BlockScheduler scheduler(config);
+    scheduler.addPeer(kPeerA);
+    scheduler.setPeerChoked(kPeerA, false);
+
+    // 1ms 一个块、500ms 延迟：BDP 远超上限
+    auto start = BlockScheduler::Clock::now();
+    for (uint32_t i = 0; i < 2000; ++i) {
+        auto sent = start + std::chrono::milliseconds(i);
+        auto block = makeBlock(i / 16, i % 16);
+        scheduler.onBlockRequested(kPeerA, block, sent);
+        scheduler.onBlockReceived(kPeerA, block, sent + 500ms);
+    }
+
+    EXPECT_EQ(scheduler.queueDepth(kPeerA), 8u);
+}
+
+// ========== 超时测试 ==========
+
+TEST(BlockSchedulerTest, TimeoutIsPerBlock) {
+    BlockScheduler scheduler(testConfig());
+    scheduler.addPeer(kPeerA);
+    scheduler.setPeerChoked(kPeerA, false);
+
+    auto now = BlockScheduler::Clock::now();
+    scheduler.onBlockRequested(kPeerA, makeBlock(0, 0), now);
+    scheduler.onBlockRequested(kPeerA, makeBlock(0, 1), now + 5s);
+
+    // 没有延迟样本时使用初始超时（10s）
+    EXPECT_TRUE(scheduler.collectTimedOut(now + 9s).empty());
+
+    auto expired = scheduler.collectTimedOut(now + 11s);
+    ASSERT_EQ(expired.size(), 1u);
+    EXPECT_EQ(expired[0].block, makeBlock(0, 0));
+    EXPECT_EQ(expired[0].peer, kPeerA);
+
+    // 同一分片的另一个块不受影响
+    EXPECT_EQ(scheduler.outstanding(kPeerA), 1u);
+}
+
+TEST(BlockSchedulerTest, TimeoutAdaptsToLatency) {
+    BlockScheduler scheduler(testConfig());
+    scheduler.addPeer(kPeerA);
+    scheduler.setPeerChoked(kPeerA, false);
+
+    auto now = BlockScheduler::Clock::now();
+    for (uint32_t i = 0; i < 20; ++i) {
+        auto block = makeBlock(0, i);
+        scheduler.onBlockRequested(kPeerA, block, now);
+        scheduler.onBlockReceived(kPeerA, block, now + 200ms);
+    }
+
+    // 200ms × 3 = 600ms，被下限截到 1s
+    EXPECT_EQ(scheduler.blockTimeout(kPeerA), 1000ms);
+}
+
+// ========== 重复请求（endgame）测试 ==========
+
+TEST(BlockSchedulerTest, OutstandingBlocksCountsDuplicates) {
+    BlockScheduler scheduler(testConfig());
+    scheduler.addPeer(kPeerA);
+    scheduler.addPeer(kPeerB);
+    scheduler.setPeerChoked(kPeerA, false);
+    scheduler.setPeerChoked(kPeerB, false);
+
+    auto now = BlockScheduler::Clock::now();
+    scheduler.onBlockRequested(kPeerA, makeBlock(7, 0), now);
+    scheduler.onBlockRequested(kPeerA, makeBlock(7, 1), now);
+    scheduler.onBlockRequested(kPeerB, makeBlock(7, 1), now);
+
+    auto blocks = scheduler.outstandingBlocks();
+    ASSERT_EQ(blocks.size(), 2u);
+
+    // 请求数少的在前
+    EXPECT_EQ(blocks[0].block, makeBlock(7, 0));
+    EXPECT_EQ(blocks[0].requests, 1u);
+    EXPECT_EQ(blocks[1].block, makeBlock(7, 1));
+    EXPECT_EQ(blocks[1].requests, 2u);
+
+    EXPECT_TRUE(scheduler.isRequestedFrom(kPeerB, 7, BlockInfo::kDefaultBlockSize));
+    EXPECT_FALSE(scheduler.isRequestedFrom(kPeerB, 7, 0));
+    EXPECT_TRUE(scheduler.isRequested(7, 0));
+    EXPECT_FALSE(scheduler.isRequested(8, 0));
+}
+
+TEST(BlockSchedulerTest, FirstArrivalReleasesDuplicates) {
+    BlockScheduler scheduler(testConfig());
+    scheduler.addPeer(kPeerA);
+    scheduler.addPeer(kPeerB);
+    scheduler.setPeerChoked(kPeerA, false);
+    scheduler.setPeerChoked(kPeerB, false);
+
+    auto now = BlockScheduler::Clock::now();
+    auto block = makeBlock(9, 3);
+    scheduler.onBlockRequested(kPeerA, block, now);
+    scheduler.onBlockRequested(kPeerB, block, now);
+
+    // A 先送达，B 上的重复请求需要 CANCEL
+    EXPECT_TRUE(scheduler.onBlockReceived(kPeerA, block, now + 20ms));
+    auto holders = scheduler.releaseBlock(block.piece_index, block.begin);
+    ASSERT_EQ(holders.size(), 1u);
+    EXPECT_EQ(holders[0], kPeerB);
+
+    // B 迟到的副本不再计入
+    EXPECT_FALSE(scheduler.onBlockReceived(kPeerB, block, now + 30ms));
+    EXPECT_EQ(scheduler.totalOutstanding(), 0u);
+}
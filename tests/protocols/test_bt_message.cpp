@@ -0,0 +1,67 @@
+/**
+ * @file test_bt_message.cpp
+ * @brief BtMessage 编解码单元测试
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/protocols/bt_message.h>
+
+#include <vector>
+
+using namespace magnet::protocols;
+
+// ========== Piece 消息测试 ==========
+
+TEST(BtMessageTest, DecodedPieceReferencesInputBuffer) {
+    std::vector<uint8_t> block(16384);
+    for (size_t i = 0; i < block.size(); ++i) {
+        block[i] = static_cast<uint8_t>(i);
+    }
+    auto wire = BtMessage::createPiece(PieceBlock(3, 32768, block)).encode();
+
+    auto msg = BtMessage::decode(wire.data(), wire.size());
+    ASSERT_TRUE(msg.has_value());
+    ASSERT_TRUE(msg->isPiece());
+    EXPECT_EQ(msg->pieceIndex(), 3u);
+    EXPECT_EQ(msg->begin(), 32768u);
+
+    // 块数据不拷贝，直接指向输入缓冲区中 13 字节头部之后的位置
+    auto data = msg->data();
+    EXPECT_EQ(data.data(), wire.data() + 13);
+    EXPECT_EQ(data.size(), block.size());
+
+    auto view = msg->toPieceBlockView();
+    EXPECT_EQ(view.data.data(), data.data());
+    EXPECT_EQ(view.toBlockInfo(), BlockInfo(3, 32768, 16384));
+}
+
+TEST(BtMessageTest, PieceBlockCopyOutlivesInputBuffer) {
+    std::vector<uint8_t> block = {1, 2, 3, 4, 5};
+    auto wire = BtMessage::createPiece(PieceBlock(0, 0, block)).encode();
+
+    auto msg = BtMessage::decode(wire);
+    ASSERT_TRUE(msg.has_value());
+    PieceBlock copy = msg->toPieceBlock();
+    std::fill(wire.begin(), wire.end(), 0);
+
+    EXPECT_EQ(copy.data, block);
+}
+
+TEST(BtMessageTest, DecodedPieceReencodes) {
+    std::vector<uint8_t> block(100, 0x5A);
+    auto wire = BtMessage::createPiece(PieceBlock(7, 16384, block)).encode();
+
+    auto msg = BtMessage::decode(wire);
+    ASSERT_TRUE(msg.has_value());
+    EXPECT_EQ(msg->encode(), wire);
+}
+
+TEST(BtMessageTest, MessageLengthFromHeader) {
+    auto wire = BtMessage::createRequest(BlockInfo(1, 2, 16384)).encode();
+    EXPECT_EQ(BtMessage::getMessageLength(wire.data(), wire.size()), 17u);
+    EXPECT_EQ(BtMessage::getMessageLength(wire.data(), 3), 0u);
+
+    auto msg = BtMessage::decode(wire);
+    ASSERT_TRUE(msg.has_value());
+    EXPECT_EQ(msg->toBlockInfo(), BlockInfo(1, 2, 16384));
+}
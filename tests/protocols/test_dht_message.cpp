@@ -0,0 +1,155 @@
+/**
+ * @file test_dht_message.cpp
+ * @brief 紧凑地址格式、BEP 32（nodes6/want）与双栈 UdpClient 单元测试
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/protocols/dht_message.h>
+#include <magnet/network/udp_client.h>
+#include "test_helpers.h"
+
+using namespace magnet::protocols;
+using magnet::test::runUntil;
+
+// ========== 辅助函数 ==========
+
+namespace {
+
+NodeId nodeIdWithByte(uint8_t value) {
+    NodeId::ByteArray bytes{};
+    bytes.fill(value);
+    return NodeId(bytes);
+}
+
+DhtMessage roundTrip(const DhtMessage& msg) {
+    auto parsed = DhtMessage::parse(msg.encode());
+    EXPECT_TRUE(parsed.has_value());
+    return parsed.value_or(DhtMessage{});
+}
+
+} // namespace
+
+// ========== 紧凑格式 ==========
+
+TEST(CompactFormatTest, EncodesAndDecodesBothFamilies) {
+    auto v4 = encodeCompactAddress("10.1.2.3", 6881);
+    ASSERT_EQ(v4.size(), s_kCompactAddressSize);
+    EXPECT_EQ(v4, std::string("\x0a\x01\x02\x03\x1a\xe1", 6));
+
+    auto v6 = encodeCompactAddress("2001:db8::1", 51413);
+    ASSERT_EQ(v6.size(), s_kCompactAddress6Size);
+
+    auto decoded4 = decodeCompactAddress(reinterpret_cast<const uint8_t*>(v4.data()), v4.size());
+    auto decoded6 = decodeCompactAddress(reinterpret_cast<const uint8_t*>(v6.data()), v6.size());
+    ASSERT_TRUE(decoded4 && decoded6);
+    EXPECT_EQ(decoded4->toString(), "10.1.2.3:6881");
+    EXPECT_EQ(decoded6->ip, "2001:db8::1");
+    EXPECT_EQ(decoded6->port, 51413);
+
+    EXPECT_TRUE(encodeCompactAddress("not-an-ip", 1).empty());
+    EXPECT_FALSE(decodeCompactAddress(reinterpret_cast<const uint8_t*>(v6.data()), 10));
+}
+
+TEST(CompactFormatTest, ParsesIpv6Nodes) {
+    CompactNodeInfo node{nodeIdWithByte(0x42), "fe80::1234", 6881};
+    auto bytes = node.toBytes();
+    ASSERT_EQ(bytes.size(), CompactNodeInfo::s_kCompactNode6Size);
+
+    auto parsed = CompactNodeInfo::parseNodes(bytes + bytes, true);
+    ASSERT_EQ(parsed.size(), 2u);
+    EXPECT_EQ(parsed[0].id_, node.id_);
+    EXPECT_EQ(parsed[0].toDhtNode().ip_, "fe80::1234");
+    EXPECT_EQ(parsed[0].port_, 6881);
+
+    // 不足一个节点长度的尾部数据被忽略
+    EXPECT_TRUE(CompactNodeInfo::parseNodes(bytes.substr(0, 20), true).empty());
+}
+
+// ========== BEP 32 ==========
+
+TEST(DhtMessageTest, NodesAreSplitByFamily) {
+    std::vector<DhtNode> nodes = {
+        DhtNode(nodeIdWithByte(1), "1.2.3.4", 1000),
+        DhtNode(nodeIdWithByte(2), "2001:db8::2", 2000),
+        DhtNode(nodeIdWithByte(3), "5.6.7.8", 3000),
+    };
+    auto response = roundTrip(DhtMessage::createFindNodeResponse("aa", nodeIdWithByte(9), nodes));
+
+    auto encoded = response.toBencode().asDict().at(krpc::kResponse).asDict();
+    EXPECT_EQ(encoded.at(krpc::kNodes).asString().size(), 2 * CompactNodeInfo::s_kCompactNodeSize);
+    EXPECT_EQ(encoded.at(krpc::kNodes6).asString().size(), CompactNodeInfo::s_kCompactNode6Size);
+
+    auto parsed = response.getNodes();
+    ASSERT_EQ(parsed.size(), 3u);
+    EXPECT_EQ(parsed[0].ip_, "1.2.3.4");
+    EXPECT_EQ(parsed[1].ip_, "5.6.7.8");
+    EXPECT_EQ(parsed[2].ip_, "2001:db8::2");
+    EXPECT_EQ(parsed[2].port_, 2000);
+}
+
+TEST(DhtMessageTest, AppendedCompactNodesMatchDhtNodeEncoding) {
+    std::vector<DhtNode> nodes = {
+        DhtNode(nodeIdWithByte(1), "1.2.3.4", 1000),
+        DhtNode(nodeIdWithByte(2), "2001:db8::2", 2000),
+    };
+    auto expected = DhtMessage::createFindNodeResponse("aa", nodeIdWithByte(9), nodes).encode();
+
+    auto response = DhtMessage::createFindNodeResponse("aa", nodeIdWithByte(9), {});
+    for (const auto& node : nodes) {
+        auto address = encodeCompactAddress(node.ip_, node.port_);
+        response.appendCompactNode(node.id_, reinterpret_cast<const uint8_t*>(address.data()),
+                                   address.size());
+    }
+    // 长度不是 6 或 18 的地址被忽略
+    uint8_t garbage[4] = {};
+    response.appendCompactNode(nodeIdWithByte(3), garbage, sizeof(garbage));
+
+    EXPECT_EQ(response.encode(), expected);
+}
+
+TEST(DhtMessageTest, WantSurvivesRoundTrip) {
+    auto query = DhtMessage::createGetPeers(nodeIdWithByte(1), InfoHash{});
+    EXPECT_FALSE(roundTrip(query).hasWant());
+
+    query.setWant(false, true);
+    auto parsed = roundTrip(query);
+    EXPECT_TRUE(parsed.hasWant());
+    EXPECT_FALSE(parsed.wantsIpv4());
+    EXPECT_TRUE(parsed.wantsIpv6());
+}
+
+TEST(DhtMessageTest, ValuesCarryIpv6Peers) {
+    std::vector<PeerInfo> peers = {PeerInfo("9.8.7.6", 80), PeerInfo("2001:db8::7", 6881)};
+    auto response = roundTrip(DhtMessage::createGetPeersResponseWithPeers(
+        "bb", nodeIdWithByte(5), "tok", peers));
+
+    auto parsed = response.getPeers();
+    ASSERT_EQ(parsed.size(), 2u);
+    EXPECT_EQ(parsed[0].toString(), "9.8.7.6:80");
+    EXPECT_EQ(parsed[1].ip, "2001:db8::7");
+    EXPECT_EQ(parsed[1].port, 6881);
+}
+
+// ========== 双栈 UdpClient ==========
+
+TEST(UdpDualStackTest, Ipv4PeersAreReportedAsPlainIpv4) {
+    asio::io_context io;
+    auto receiver = std::make_shared<magnet::network::UdpClient>(io);
+    auto sender = std::make_shared<magnet::network::UdpClient>(io);
+
+    magnet::network::UdpMessage received;
+    bool done = false;
+    receiver->startReceive([&](const magnet::network::UdpMessage& message) {
+        received = message;
+        done = true;
+    });
+
+    sender->send({"127.0.0.1", receiver->localPort()}, {1, 2, 3});
+    ASSERT_TRUE(runUntil(io, [&] { return done; }));
+    EXPECT_EQ(received.remote_endpoint.ip, "127.0.0.1");
+    EXPECT_EQ(received.remote_endpoint.port, sender->localPort());
+    EXPECT_EQ(received.data, (std::vector<uint8_t>{1, 2, 3}));
+
+    receiver->close();
+    sender->close();
+}
@@ -0,0 +1,239 @@
+/**
+ * @file test_dht_state.cpp
+ * @brief DHT 状态持久化与热启动单元测试（本地回环上的两个 DhtClient）
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/protocols/dht_client.h>
+#include <magnet/protocols/dht_state.h>
+#include "test_helpers.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace magnet::protocols;
+using magnet::test::runUntil;
+
+// ========== 辅助函数 ==========
+
+namespace {
+
+std::string tempStatePath(const char* name) {
+    auto path = std::filesystem::temp_directory_path() /
+                ("magnet_dht_state_" + std::string(name) + "_" +
+                 std::to_string(::testing::UnitTest::GetInstance()->random_seed()));
+    std::filesystem::remove(path);
+    return path.string();
+}
+
+DhtClientConfig loopbackConfig(const std::string& state_file) {
+    DhtClientConfig config;
+    config.state_file = state_file;
+    config.bootstrap_nodes.clear();
+    config.min_warm_start_nodes = 1;
+    config.query_config.default_timeout = std::chrono::milliseconds(200);
+    config.query_config.default_max_retries = 0;
+    return config;
+}
+
+} // namespace
+
+// ========== 编解码 ==========
+
+TEST(DhtStateTest, RoundTripKeepsIdNodesAndSecrets) {
+    DhtState state;
+    state.node_id = NodeId::random();
+    state.nodes = {
+        DhtNode(NodeId::random(), "198.51.100.7", 6881),
+        DhtNode(NodeId::random(), "2001:db8::9", 51413),
+        DhtNode(NodeId::random(), "not-an-ip", 1),
+    };
+    state.token_secret = "current";
+    state.prev_token_secret = "previous";
+
+    auto decoded = DhtState::decode(state.encode());
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(decoded->node_id, state.node_id);
+    ASSERT_EQ(decoded->nodes.size(), 2u);     // 无效地址被跳过
+    EXPECT_EQ(decoded->nodes[0].id_, state.nodes[0].id_);
+    EXPECT_EQ(decoded->nodes[0].ip_, "198.51.100.7");
+    EXPECT_EQ(decoded->nodes[1].ip_, "2001:db8::9");
+    EXPECT_EQ(decoded->nodes[1].port_, 51413);
+    EXPECT_EQ(decoded->token_secret, "current");
+    EXPECT_EQ(decoded->prev_token_secret, "previous");
+
+    EXPECT_FALSE(DhtState::decode("garbage"));
+    EXPECT_FALSE(DhtState::decode("d2:id3:abce"));
+    EXPECT_FALSE(DhtState::load(tempStatePath("missing")));
+}
+
+TEST(DhtStateTest, SavedFileIsOwnerOnly) {
+    DhtState state;
+    state.node_id = NodeId::random();
+    state.token_secret = "secret";
+
+    std::string path = tempStatePath("perms");
+    ASSERT_TRUE(state.save(path));
+
+#ifndef _WIN32
+    // 含令牌密钥，其他用户不可读
+    auto perms = std::filesystem::status(path).permissions();
+    EXPECT_EQ(perms & std::filesystem::perms::all,
+              std::filesystem::perms::owner_read | std::filesystem::perms::owner_write);
+#endif
+
+    // 临时文件已重命名，目录里只剩状态文件本身
+    auto name = std::filesystem::path(path).filename().string();
+    for (const auto& entry : std::filesystem::directory_iterator(std::filesystem::path(path).parent_path())) {
+        auto other = entry.path().filename().string();
+        EXPECT_FALSE(other != name && other.rfind(name, 0) == 0) << "leftover " << other;
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST(DhtStateTest, ConcurrentSavesDoNotClobberEachOther) {
+    std::string path = tempStatePath("concurrent");
+    std::vector<std::thread> writers;
+    std::atomic<int> failures{0};
+    for (int i = 0; i < 4; ++i) {
+        writers.emplace_back([&path, &failures] {
+            DhtState state;
+            state.node_id = NodeId::random();
+            state.token_secret = std::string(64, 's');
+            for (int round = 0; round < 50; ++round) {
+                if (!state.save(path)) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+
+    // 每次保存都有自己的临时文件：不会失败，最终文件完整
+    EXPECT_EQ(failures.load(), 0);
+    auto loaded = DhtState::load(path);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->token_secret, std::string(64, 's'));
+
+    std::filesystem::remove(path);
+}
+
+// ========== 多实例 ==========
+
+TEST(DhtStateTest, SecondInstanceGetsFreshIdWhileStateIsLocked) {
+    asio::io_context io;
+    std::string path = tempStatePath("locked");
+    DhtState saved;
+    saved.node_id = NodeId::random();
+    saved.nodes = {DhtNode(NodeId::random(), "127.0.0.1", 6881)};
+    ASSERT_TRUE(saved.save(path));
+
+    {
+        auto first = std::make_shared<DhtClient>(io, loopbackConfig(path));
+        EXPECT_EQ(first->localId(), saved.node_id);
+
+        // 同一状态文件的第二个实例：新 ID，且不覆盖第一个实例的状态
+        auto second = std::make_shared<DhtClient>(io, loopbackConfig(path));
+        EXPECT_NE(second->localId(), saved.node_id);
+        EXPECT_FALSE(second->saveState());
+    }
+
+    // 第一个实例退出后锁被释放
+    auto third = std::make_shared<DhtClient>(io, loopbackConfig(path));
+    EXPECT_EQ(third->localId(), saved.node_id);
+    third.reset();
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + ".lock");
+}
+
+// ========== 热启动 ==========
+
+TEST(DhtStateTest, WarmStartFromSavedNodesKeepsNodeId) {
+    asio::io_context io;
+    auto peer = std::make_shared<DhtClient>(io, loopbackConfig(""));
+    peer->start();
+
+    std::string path = tempStatePath("warm");
+    DhtState saved;
+    saved.node_id = NodeId::random();
+    saved.nodes = {DhtNode(peer->localId(), "127.0.0.1", peer->localPort())};
+    ASSERT_TRUE(saved.save(path));
+
+    auto client = std::make_shared<DhtClient>(io, loopbackConfig(path));
+    EXPECT_EQ(client->localId(), saved.node_id);
+    client->start();
+
+    bool done = false;
+    bool success = false;
+    client->bootstrap([&](bool ok, size_t) {
+        success = ok;
+        done = true;
+    });
+    ASSERT_TRUE(runUntil(io, [&] { return done; }));
+
+    EXPECT_TRUE(success);
+    EXPECT_TRUE(client->getStatistics().warm_started);
+    EXPECT_EQ(client->nodeCount(), 1u);
+
+    // 停止时把路由表写回
+    client->stop();
+    auto reloaded = DhtState::load(path);
+    ASSERT_TRUE(reloaded.has_value());
+    EXPECT_EQ(reloaded->node_id, saved.node_id);
+    ASSERT_EQ(reloaded->nodes.size(), 1u);
+    EXPECT_EQ(reloaded->nodes[0].id_, peer->localId());
+
+    peer->stop();
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + ".lock");
+}
+
+TEST(DhtStateTest, FallsBackToBootstrapNodesWhenSavedNodesAreDead) {
+    asio::io_context io;
+    auto router = std::make_shared<DhtClient>(io, loopbackConfig(""));
+    router->start();
+
+    // 保存的节点指向一个已关闭的端口
+    std::string path = tempStatePath("fallback");
+    uint16_t dead_port = 0;
+    {
+        auto dead = std::make_shared<DhtClient>(io, loopbackConfig(""));
+        dead->start();
+        dead_port = dead->localPort();
+        dead->stop();
+    }
+    DhtState saved;
+    saved.node_id = NodeId::random();
+    saved.nodes = {DhtNode(NodeId::random(), "127.0.0.1", dead_port)};
+    ASSERT_TRUE(saved.save(path));
+
+    auto config = loopbackConfig(path);
+    config.bootstrap_nodes = {{"127.0.0.1", router->localPort()}};
+    auto client = std::make_shared<DhtClient>(io, config);
+    client->start();
+
+    bool done = false;
+    bool success = false;
+    client->bootstrap([&](bool ok, size_t) {
+        success = ok;
+        done = true;
+    });
+    ASSERT_TRUE(runUntil(io, [&] { return done; }));
+
+    EXPECT_TRUE(success);
+    EXPECT_FALSE(client->getStatistics().warm_started);
+
+    client->stop();
+    router->stop();
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + ".lock");
+}
@@ -0,0 +1,149 @@
+/**
+ * @file test_lookup_shortlist.cpp
+ * @brief LookupShortlist（有界候选列表、并发调度、慢节点与终止条件）单元测试
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/protocols/lookup_shortlist.h>
+
+#include <chrono>
+
+using namespace magnet::protocols;
+
+// ========== 辅助函数 ==========
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 目标全 0，节点 ID 的最后一个字节就是到目标的距离
+const NodeId kTarget;
+
+DhtNode nodeAtDistance(uint8_t distance) {
+    NodeId::ByteArray bytes{};
+    bytes.back() = distance;
+    return DhtNode(NodeId(bytes), "10.0.0." + std::to_string(distance), 6881);
+}
+
+LookupShortlist::SlowThreshold fixedThreshold(int ms) {
+    return [ms](const DhtNode&) { return std::chrono::milliseconds(ms); };
+}
+
+} // namespace
+
+// ========== 候选列表 ==========
+
+TEST(LookupShortlistTest, KeepsClosestCandidatesSortedAndBounded) {
+    LookupShortlist shortlist(kTarget, 2, 1, 1, 4);
+
+    for (uint8_t d : {50, 10, 40, 30, 20, 60}) {
+        shortlist.add(nodeAtDistance(d));
+    }
+    EXPECT_FALSE(shortlist.add(nodeAtDistance(20)));   // 重复
+    EXPECT_FALSE(shortlist.add(nodeAtDistance(70)));   // 比所有候选都远
+
+    const auto& entries = shortlist.entries();
+    ASSERT_EQ(entries.size(), 4u);
+    EXPECT_EQ(entries[0].node.port_, 6881);
+    EXPECT_EQ(entries[0].distance, kTarget.distance(nodeAtDistance(10).id_));
+    EXPECT_EQ(entries[3].distance, kTarget.distance(nodeAtDistance(40).id_));
+}
+
+TEST(LookupShortlistTest, KeepsAlphaQueriesInFlightClosestFirst) {
+    LookupShortlist shortlist(kTarget, 8, 2, 4);
+    for (uint8_t d = 1; d <= 5; ++d) {
+        shortlist.add(nodeAtDistance(d));
+    }
+
+    auto now = Clock::now();
+    auto first = shortlist.next(now, fixedThreshold(1000));
+    auto second = shortlist.next(now, fixedThreshold(1000));
+    ASSERT_TRUE(first && second);
+    EXPECT_EQ(first->id_, nodeAtDistance(1).id_);
+    EXPECT_EQ(second->id_, nodeAtDistance(2).id_);
+    EXPECT_FALSE(shortlist.next(now, fixedThreshold(1000)));   // 并发已满
+
+    // 一个响应到达立即补发，不等另一个
+    EXPECT_TRUE(shortlist.markResponded(first->id_));
+    auto third = shortlist.next(now, fixedThreshold(1000));
+    ASSERT_TRUE(third);
+    EXPECT_EQ(third->id_, nodeAtDistance(3).id_);
+    EXPECT_EQ(shortlist.inFlight(), 2u);
+    EXPECT_EQ(shortlist.queried(), 3u);
+}
+
+TEST(LookupShortlistTest, SlowNodesFreeTheirSlotUpToMaxOutstanding) {
+    LookupShortlist shortlist(kTarget, 8, 1, 2);
+    for (uint8_t d = 1; d <= 4; ++d) {
+        shortlist.add(nodeAtDistance(d));
+    }
+
+    auto now = Clock::now();
+    ASSERT_TRUE(shortlist.next(now, fixedThreshold(100)));
+    EXPECT_EQ(shortlist.nextDeadline(), now + std::chrono::milliseconds(100));
+    EXPECT_EQ(shortlist.markSlow(now + std::chrono::milliseconds(50)), 0u);
+
+    // 超过阈值：不再占用 alpha 名额，可以向下一个候选补发
+    EXPECT_EQ(shortlist.markSlow(now + std::chrono::milliseconds(100)), 1u);
+    EXPECT_EQ(shortlist.slow(), 1u);
+    ASSERT_TRUE(shortlist.next(now, fixedThreshold(100)));
+
+    // 在途总数（含慢节点）达到 max_outstanding
+    EXPECT_EQ(shortlist.markSlow(now + std::chrono::milliseconds(200)), 1u);
+    EXPECT_FALSE(shortlist.next(now, fixedThreshold(100)));
+
+    // 慢节点晚到的响应仍然计入
+    EXPECT_TRUE(shortlist.markResponded(nodeAtDistance(1).id_));
+    EXPECT_EQ(shortlist.slow(), 1u);
+    EXPECT_TRUE(shortlist.next(now, fixedThreshold(100)));
+}
+
+TEST(LookupShortlistTest, FinishesWhenKClosestResponded) {
+    LookupShortlist shortlist(kTarget, 2, 3, 3);
+    for (uint8_t d : {1, 2, 3, 4}) {
+        shortlist.add(nodeAtDistance(d));
+    }
+    EXPECT_FALSE(shortlist.finished());
+
+    // 只向最近的 k 个候选发查询
+    auto now = Clock::now();
+    ASSERT_TRUE(shortlist.next(now, fixedThreshold(100)));
+    ASSERT_TRUE(shortlist.next(now, fixedThreshold(100)));
+    EXPECT_FALSE(shortlist.next(now, fixedThreshold(100)));
+
+    // 失败的节点由下一个候选顶替
+    EXPECT_TRUE(shortlist.markFailed(nodeAtDistance(1).id_));
+    auto replacement = shortlist.next(now, fixedThreshold(100));
+    ASSERT_TRUE(replacement);
+    EXPECT_EQ(replacement->id_, nodeAtDistance(3).id_);
+
+    EXPECT_TRUE(shortlist.markResponded(nodeAtDistance(2).id_));
+    EXPECT_FALSE(shortlist.finished());
+
+    // 更近的节点加入后必须先查询它
+    shortlist.add(nodeAtDistance(0));
+    EXPECT_TRUE(shortlist.markResponded(nodeAtDistance(3).id_));
+    EXPECT_FALSE(shortlist.finished());
+    ASSERT_TRUE(shortlist.next(now, fixedThreshold(100)));
+    EXPECT_TRUE(shortlist.markResponded(nodeAtDistance(0).id_));
+    EXPECT_TRUE(shortlist.finished());
+    EXPECT_EQ(shortlist.responded(), 3u);
+}
+
+TEST(LookupShortlistTest, SlowNodesDoNotBlockTermination) {
+    LookupShortlist shortlist(kTarget, 2, 2, 4);
+    for (uint8_t d : {1, 2, 3}) {
+        shortlist.add(nodeAtDistance(d));
+    }
+
+    auto now = Clock::now();
+    ASSERT_TRUE(shortlist.next(now, fixedThreshold(10)));
+    ASSERT_TRUE(shortlist.next(now, fixedThreshold(10)));
+    EXPECT_TRUE(shortlist.markResponded(nodeAtDistance(2).id_));
+    EXPECT_EQ(shortlist.markSlow(now + std::chrono::milliseconds(10)), 1u);
+
+    ASSERT_TRUE(shortlist.next(now, fixedThreshold(10)));
+    EXPECT_FALSE(shortlist.finished());
+    EXPECT_TRUE(shortlist.markResponded(nodeAtDistance(3).id_));
+    EXPECT_TRUE(shortlist.finished());
+}
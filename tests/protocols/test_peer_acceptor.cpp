@@ -0,0 +1,322 @@
+/**
+ * @file test_peer_acceptor.cpp
+ * @brief TcpListener / PeerAcceptor 单元测试（本地回环 Peer）
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/network/tcp_listener.h>
+#include <magnet/protocols/peer_acceptor.h>
+#include <magnet/protocols/peer_manager.h>
+#include <magnet/utils/buffer_pool.h>
+#include "test_helpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+using namespace magnet;
+using namespace magnet::protocols;
+using magnet::test::runUntil;
+
+// ========== 辅助函数 ==========
+
+namespace {
+
+InfoHash makeInfoHash(uint8_t seed) {
+    InfoHash::ByteArray bytes{};
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<uint8_t>(seed + i);
+    }
+    return InfoHash(bytes);
+}
+
+network::TcpEndpoint loopback(uint16_t port) {
+    return {"127.0.0.1", port};
+}
+
+} // namespace
+
+// ========== TcpListener ==========
+
+TEST(TcpListenerTest, AcceptsLoopbackConnection) {
+    asio::io_context io;
+
+    std::shared_ptr<network::TcpClient> accepted;
+    auto listener = std::make_shared<network::TcpListener>(io);
+    ASSERT_TRUE(listener->listen(0, [&](std::shared_ptr<network::TcpClient> client) {
+        accepted = std::move(client);
+    }));
+    ASSERT_NE(listener->localPort(), 0);
+
+    auto client = std::make_shared<network::TcpClient>(io);
+    client->connect(loopback(listener->localPort()), [](const asio::error_code& ec) {
+        EXPECT_FALSE(ec);
+    });
+
+    ASSERT_TRUE(runUntil(io, [&] { return accepted != nullptr; }));
+    EXPECT_TRUE(accepted->isConnected());
+    EXPECT_EQ(accepted->remoteEndpoint().port, client->localEndpoint().port);
+    EXPECT_EQ(listener->getStatistics().accepted, 1u);
+
+    client->close();
+    accepted->close();
+    listener->close();
+}
+
+TEST(TcpListenerTest, AcceptsIpv4AndIpv6OnOnePort) {
+    asio::io_context io;
+
+    std::vector<std::shared_ptr<network::TcpClient>> accepted;
+    auto listener = std::make_shared<network::TcpListener>(io);
+    ASSERT_TRUE(listener->listen(0, [&](std::shared_ptr<network::TcpClient> client) {
+        accepted.push_back(std::move(client));
+    }));
+
+    // IPv4 对端：双栈监听下也报告为普通 IPv4 地址
+    auto client4 = std::make_shared<network::TcpClient>(io);
+    client4->connect(loopback(listener->localPort()), [](const asio::error_code& ec) {
+        EXPECT_FALSE(ec);
+    });
+    ASSERT_TRUE(runUntil(io, [&] { return accepted.size() == 1; }));
+    EXPECT_EQ(accepted[0]->remoteEndpoint().ip, "127.0.0.1");
+
+    if (!listener->isDualStack()) {
+        GTEST_SKIP() << "IPv6 unavailable, listener fell back to IPv4";
+    }
+
+    bool connected6 = false;
+    bool failed6 = false;
+    auto client6 = std::make_shared<network::TcpClient>(io);
+    client6->connect({"::1", listener->localPort()}, [&](const asio::error_code& ec) {
+        (ec ? failed6 : connected6) = true;
+    });
+    ASSERT_TRUE(runUntil(io, [&] { return connected6 || failed6; }));
+    if (failed6) {
+        GTEST_SKIP() << "IPv6 loopback unavailable";
+    }
+    ASSERT_TRUE(runUntil(io, [&] { return accepted.size() == 2; }));
+    EXPECT_EQ(accepted[1]->remoteEndpoint().ip, "::1");
+
+    client4->close();
+    client6->close();
+    for (auto& client : accepted) {
+        client->close();
+    }
+    listener->close();
+}
+
+// ========== PeerAcceptor ==========
+
+TEST(PeerAcceptorTest, RoutesIncomingPeerByInfoHash) {
+    asio::io_context io;
+    InfoHash wanted = makeInfoHash(1);
+    InfoHash other = makeInfoHash(100);
+
+    auto manager = std::make_shared<PeerManager>(io, wanted, "-TS0001-server000000");
+    auto bystander = std::make_shared<PeerManager>(io, other, "-TS0001-server000001");
+    std::shared_ptr<PeerConnection> server_side;
+    manager->setNewPeerCallback([&](std::shared_ptr<PeerConnection> conn) {
+        server_side = std::move(conn);
+    });
+    manager->start();
+    bystander->start();
+
+    auto acceptor = std::make_shared<PeerAcceptor>(io);
+    ASSERT_TRUE(acceptor->listen(0));
+    acceptor->registerTorrent(wanted, manager);
+    acceptor->registerTorrent(other, bystander);
+
+    // 主动连接方：普通的出站 PeerConnection
+    auto peer = std::make_shared<PeerConnection>(io, wanted, "-TC0001-client000000");
+    bool connected = false;
+    peer->connect(loopback(acceptor->localPort()), [&](bool success) {
+        connected = success;
+    });
+
+    ASSERT_TRUE(runUntil(io, [&] { return connected && server_side != nullptr; }));
+    EXPECT_EQ(manager->connectedCount(), 1u);
+    EXPECT_EQ(bystander->connectedCount(), 0u);
+    EXPECT_TRUE(server_side->isIncoming());
+    EXPECT_FALSE(peer->isIncoming());
+    EXPECT_EQ(peer->peerInfo().peerIdString(), "-TS0001-server000000");
+    EXPECT_EQ(server_side->peerInfo().peerIdString(), "-TC0001-client000000");
+
+    auto stats = acceptor->getStatistics();
+    EXPECT_EQ(stats.accepted, 1u);
+    EXPECT_EQ(stats.routed, 1u);
+    EXPECT_EQ(manager->getStatistics().incoming_accepted, 1u);
+
+    // 握手之后双方可以正常收发消息
+    bool unchoked = false;
+    peer->setMessageCallback([&](const BtMessage& msg) {
+        if (msg.type() == BtMessageType::Unchoke) {
+            unchoked = true;
+        }
+    });
+    server_side->sendUnchoke();
+    EXPECT_TRUE(runUntil(io, [&] { return unchoked; }));
+
+    peer->disconnect();
+    acceptor->stop();
+    manager->stop();
+    bystander->stop();
+}
+
+TEST(PeerAcceptorTest, ServesRequestedBlocksToIncomingPeer) {
+    asio::io_context io;
+    InfoHash info_hash = makeInfoHash(1);
+
+    auto manager = std::make_shared<PeerManager>(io, info_hash, "-TS0001-server000000");
+    manager->updateBitfield({true, false, true});
+    std::shared_ptr<PeerConnection> server_side;
+    manager->setNewPeerCallback([&](std::shared_ptr<PeerConnection> conn) {
+        server_side = std::move(conn);
+    });
+
+    // 上层的上传处理：取出请求，用块偏移填充数据后发送
+    PeerManager* pm = manager.get();
+    manager->setUploadRequestCallback([pm](const network::TcpEndpoint&, const BlockInfo&) {
+        for (auto& request : pm->takeUploadRequests(16)) {
+            auto data = utils::BufferPool::instance().acquire(request.block.length);
+            std::fill(data.data(), data.data() + data.size(),
+                      static_cast<uint8_t>(request.block.begin));
+            pm->sendBlock(request.endpoint, request.block.piece_index, request.block.begin,
+                          std::move(data));
+        }
+    });
+    manager->start();
+
+    auto acceptor = std::make_shared<PeerAcceptor>(io);
+    ASSERT_TRUE(acceptor->listen(0));
+    acceptor->registerTorrent(info_hash, manager);
+
+    auto peer = std::make_shared<PeerConnection>(io, info_hash, "-TC0001-client000000");
+    std::vector<bool> remote_bitfield;
+    bool unchoked = false;
+    std::vector<std::pair<BlockInfo, uint8_t>> received;
+    peer->setMessageCallback([&](const BtMessage& msg) {
+        if (msg.type() == BtMessageType::Bitfield) {
+            remote_bitfield = msg.bitfield();
+        } else if (msg.type() == BtMessageType::Unchoke) {
+            unchoked = true;
+        }
+    });
+    peer->setPieceCallback([&](const PieceBlockView& block) {
+        received.emplace_back(block.toBlockInfo(), block.data.data()[0]);
+    });
+    peer->connect(loopback(acceptor->localPort()));
+
+    // 握手后对方先收到我们的位图
+    ASSERT_TRUE(runUntil(io, [&] { return server_side != nullptr && !remote_bitfield.empty(); }));
+    ASSERT_GE(remote_bitfield.size(), 3u);
+    EXPECT_TRUE(remote_bitfield[0]);
+    EXPECT_FALSE(remote_bitfield[1]);
+    EXPECT_TRUE(remote_bitfield[2]);
+
+    server_side->sendUnchoke();
+    ASSERT_TRUE(runUntil(io, [&] { return unchoked; }));
+
+    peer->requestBlock({0, 0, 16});
+    peer->requestBlock({2, 32, 16});
+    ASSERT_TRUE(runUntil(io, [&] { return received.size() == 2; }));
+
+    EXPECT_EQ(received[0].first, (BlockInfo{0, 0, 16}));
+    EXPECT_EQ(received[0].second, 0);
+    EXPECT_EQ(received[1].first, (BlockInfo{2, 32, 16}));
+    EXPECT_EQ(received[1].second, 32);
+    EXPECT_EQ(manager->getStatistics().total_bytes_uploaded, 32u);
+    EXPECT_EQ(server_side->getStatistics().pieces_sent, 2u);
+    EXPECT_EQ(server_side->incomingRequestCount(), 0u);
+
+    peer->disconnect();
+    acceptor->stop();
+    manager->stop();
+}
+
+TEST(PeerAcceptorTest, RejectsUnknownInfoHash) {
+    asio::io_context io;
+    auto manager = std::make_shared<PeerManager>(io, makeInfoHash(1), "-TS0001-server000000");
+    manager->start();
+
+    auto acceptor = std::make_shared<PeerAcceptor>(io);
+    ASSERT_TRUE(acceptor->listen(0));
+    acceptor->registerTorrent(makeInfoHash(1), manager);
+
+    auto peer = std::make_shared<PeerConnection>(io, makeInfoHash(2), "-TC0001-client000000");
+    bool dropped = false;
+    peer->setStateCallback([&](PeerConnectionState state) {
+        if (state == PeerConnectionState::Disconnected) {
+            dropped = true;
+        }
+    });
+    peer->connect(loopback(acceptor->localPort()));
+
+    ASSERT_TRUE(runUntil(io, [&] { return dropped; }));
+    EXPECT_EQ(acceptor->getStatistics().rejected_unknown, 1u);
+    EXPECT_EQ(manager->connectedCount(), 0u);
+
+    acceptor->stop();
+    manager->stop();
+}
+
+TEST(PeerAcceptorTest, AppliesConnectionLimit) {
+    asio::io_context io;
+    InfoHash info_hash = makeInfoHash(1);
+
+    PeerManagerConfig config;
+    config.max_connections = 1;
+    auto manager = std::make_shared<PeerManager>(io, info_hash, "-TS0001-server000000", config);
+    manager->start();
+
+    auto acceptor = std::make_shared<PeerAcceptor>(io);
+    ASSERT_TRUE(acceptor->listen(0));
+    acceptor->registerTorrent(info_hash, manager);
+
+    auto first = std::make_shared<PeerConnection>(io, info_hash, "-TC0001-client000001");
+    bool first_connected = false;
+    first->connect(loopback(acceptor->localPort()), [&](bool success) {
+        first_connected = success;
+    });
+    ASSERT_TRUE(runUntil(io, [&] { return first_connected && manager->connectedCount() == 1; }));
+
+    auto second = std::make_shared<PeerConnection>(io, info_hash, "-TC0001-client000002");
+    bool second_dropped = false;
+    second->setStateCallback([&](PeerConnectionState state) {
+        if (state == PeerConnectionState::Disconnected) {
+            second_dropped = true;
+        }
+    });
+    second->connect(loopback(acceptor->localPort()));
+
+    ASSERT_TRUE(runUntil(io, [&] { return second_dropped; }));
+    EXPECT_EQ(acceptor->getStatistics().rejected_limit, 1u);
+    EXPECT_EQ(manager->getStatistics().incoming_rejected, 1u);
+    EXPECT_EQ(manager->connectedCount(), 1u);
+    EXPECT_TRUE(first->isConnected());
+
+    first->disconnect();
+    acceptor->stop();
+    manager->stop();
+}
+
+TEST(PeerAcceptorTest, DropsNonBitTorrentConnection) {
+    asio::io_context io;
+    auto acceptor = std::make_shared<PeerAcceptor>(io);
+    ASSERT_TRUE(acceptor->listen(0));
+
+    auto client = std::make_shared<network::TcpClient>(io);
+    bool closed = false;
+    client->setDisconnectCallback([&](const asio::error_code&) { closed = true; });
+    client->connect(loopback(acceptor->localPort()), [&](const asio::error_code& ec) {
+        ASSERT_FALSE(ec);
+        client->startReceive([](const asio::error_code&, const std::vector<uint8_t>&) {});
+        client->send(std::vector<uint8_t>{'G', 'E', 'T', ' ', '/', '\r', '\n'});
+    });
+
+    ASSERT_TRUE(runUntil(io, [&] { return closed; }));
+    EXPECT_EQ(acceptor->getStatistics().handshake_failures, 1u);
+
+    client->close();
+    acceptor->stop();
+}
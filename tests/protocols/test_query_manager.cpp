@@ -0,0 +1,247 @@
+/**
+ * @file test_query_manager.cpp
+ * @brief QueryManager 事务 ID 分配、精确超时、自适应超时与重试、槽位上限单元测试
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/protocols/query_manager.h>
+#include "test_helpers.h"
+
+#include <chrono>
+#include <functional>
+#include <optional>
+
+using namespace magnet::protocols;
+using magnet::network::UdpClient;
+using magnet::network::UdpMessage;
+
+// ========== 辅助函数 ==========
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using magnet::test::runUntil;
+
+/**
+ * @brief 回环上的 QueryManager 和一个对端：对端记录收到的查询，
+ *        answer 返回 true 时回复 ping 响应
+ */
+struct Loopback {
+    explicit Loopback(QueryManagerConfig config = {}) {
+        client = std::make_shared<UdpClient>(io);
+        peer = std::make_shared<UdpClient>(io);
+        manager = std::make_shared<QueryManager>(io, client, config);
+        manager->start();
+
+        client->startReceive([this](const UdpMessage& message) {
+            if (auto response = DhtMessage::parse(message.data)) {
+                manager->handleResponse(*response);
+            }
+        });
+        peer->startReceive([this](const UdpMessage& message) {
+            received.push_back(message.data);
+            auto query = DhtMessage::parse(message.data);
+            if (query && answer(received.size())) {
+                last_response = DhtMessage::createPingResponse(query->transactionId(), peer_id);
+                peer->send(message.remote_endpoint, last_response->encode());
+            }
+        });
+    }
+
+    ~Loopback() {
+        manager->stop();
+        client->close();
+        peer->close();
+    }
+
+    DhtNode peerNode() const {
+        return DhtNode(peer_id, "127.0.0.1", peer->localPort());
+    }
+
+    asio::io_context io;
+    std::shared_ptr<UdpClient> client;
+    std::shared_ptr<UdpClient> peer;
+    std::shared_ptr<QueryManager> manager;
+
+    NodeId peer_id = NodeId::random();
+    std::function<bool(size_t count)> answer = [](size_t) { return true; };
+    std::vector<std::vector<uint8_t>> received;
+    std::optional<DhtMessage> last_response;
+};
+
+} // namespace
+
+// ========== 事务 ID 与重试 ==========
+
+TEST(QueryManagerTest, RetriesResendTheSameEncodedQuery) {
+    QueryManagerConfig config;
+    config.default_timeout = std::chrono::milliseconds(50);
+    config.default_max_retries = 2;
+    Loopback loop(config);
+    loop.answer = [](size_t count) { return count == 2; };   // 只回复第一次重发
+
+    std::optional<QueryResult> result;
+    loop.manager->sendQuery(loop.peerNode(), DhtMessage::createPing(NodeId::random()),
+                            [&](QueryResult r) { result = std::move(r); });
+    ASSERT_TRUE(runUntil(loop.io, [&] { return result.has_value(); }));
+
+    ASSERT_TRUE(result->is_ok());
+    ASSERT_EQ(loop.received.size(), 2u);
+    EXPECT_EQ(loop.received[0], loop.received[1]);
+    EXPECT_EQ(result->value().transactionId().size(), 4u);
+
+    auto stats = loop.manager->getStatistics();
+    EXPECT_EQ(stats.retries_total, 1u);
+    EXPECT_EQ(stats.queries_succeeded, 1u);
+    EXPECT_EQ(loop.manager->pendingCount(), 0u);
+
+    // 同一个响应再到一次：槽位已释放，不再匹配
+    EXPECT_FALSE(loop.manager->handleResponse(*loop.last_response));
+}
+
+TEST(QueryManagerTest, ForeignTransactionIdsAreIgnored) {
+    Loopback loop;
+    loop.answer = [](size_t) { return false; };
+
+    loop.manager->sendQuery(loop.peerNode(), DhtMessage::createPing(NodeId::random()),
+                            [](QueryResult) {});
+    EXPECT_EQ(loop.manager->pendingCount(), 1u);
+
+    EXPECT_FALSE(loop.manager->handleResponse(DhtMessage::createPingResponse("aa", NodeId())));
+    EXPECT_FALSE(loop.manager->handleResponse(
+        DhtMessage::createPingResponse(std::string("\xff\xff\x00\x00", 4), NodeId())));
+    EXPECT_EQ(loop.manager->pendingCount(), 1u);
+}
+
+// ========== 超时 ==========
+
+TEST(QueryManagerTest, EachQueryTimesOutAtItsOwnDeadline) {
+    Loopback loop;
+    loop.answer = [](size_t) { return false; };
+
+    auto start = Clock::now();
+    std::optional<Clock::duration> short_elapsed;
+    std::optional<Clock::duration> long_elapsed;
+    loop.manager->sendQuery(loop.peerNode(), DhtMessage::createPing(NodeId::random()),
+        [&](QueryResult r) {
+            EXPECT_TRUE(r.is_err());
+            long_elapsed = Clock::now() - start;
+        }, std::chrono::milliseconds(150), 0);
+    loop.manager->sendQuery(loop.peerNode(), DhtMessage::createPing(NodeId::random()),
+        [&](QueryResult r) {
+            EXPECT_TRUE(r.is_err());
+            short_elapsed = Clock::now() - start;
+        }, std::chrono::milliseconds(40), 0);
+
+    ASSERT_TRUE(runUntil(loop.io, [&] { return short_elapsed && long_elapsed; }));
+
+    // 不再按固定检查间隔量化：各自在自己的截止时间附近触发
+    EXPECT_GE(*short_elapsed, std::chrono::milliseconds(40));
+    EXPECT_LT(*short_elapsed, std::chrono::milliseconds(120));
+    EXPECT_GE(*long_elapsed, std::chrono::milliseconds(150));
+    EXPECT_LT(*long_elapsed, std::chrono::milliseconds(230));
+    EXPECT_EQ(loop.manager->getStatistics().queries_timeout, 2u);
+}
+
+// ========== 自适应超时 ==========
+
+TEST(QueryManagerTest, AdaptiveTimeoutFollowsMeasuredRtt) {
+    QueryManagerConfig config;
+    config.default_timeout = std::chrono::milliseconds(2000);
+    config.min_timeout = std::chrono::milliseconds(30);
+    Loopback loop(config);
+
+    // 没有样本时用 default_timeout
+    EXPECT_EQ(loop.manager->queryTimeout(loop.peerNode()), std::chrono::milliseconds(2000));
+
+    for (int i = 0; i < 5; ++i) {
+        std::optional<QueryResult> result;
+        loop.manager->sendQuery(loop.peerNode(), DhtMessage::createPing(NodeId::random()),
+                                [&](QueryResult r) { result = std::move(r); });
+        ASSERT_TRUE(runUntil(loop.io, [&] { return result.has_value(); }));
+        ASSERT_TRUE(result->is_ok());
+    }
+
+    // 回环 RTT 不到 1ms：RTO 被限制在 min_timeout，没有样本的节点用全局 RTO
+    EXPECT_EQ(loop.manager->queryTimeout(loop.peerNode()), std::chrono::milliseconds(30));
+    EXPECT_EQ(loop.manager->queryTimeout(DhtNode(NodeId::random(), "127.0.0.1", 9)),
+              std::chrono::milliseconds(30));
+    EXPECT_LT(loop.manager->rttEstimate(loop.peerNode()), std::chrono::milliseconds(30));
+
+    auto stats = loop.manager->getStatistics();
+    EXPECT_GT(stats.smoothed_rtt_ms, 0);
+    EXPECT_EQ(stats.latency_histogram.total(), 5u);
+    EXPECT_EQ(stats.latency_histogram.percentile(0.9), LatencyHistogram::bound(0));
+    EXPECT_EQ(stats.timeout_histogram.total(), 5u);
+    EXPECT_EQ(stats.timeout_histogram.percentile(0.0), LatencyHistogram::bound(1));
+    EXPECT_EQ(stats.timeout_histogram.percentile(1.0), LatencyHistogram::bound(7));
+}
+
+TEST(QueryManagerTest, AdaptiveRetriesBackOffWithinQueryBudget) {
+    QueryManagerConfig config;
+    config.default_timeout = std::chrono::milliseconds(40);
+    config.min_timeout = std::chrono::milliseconds(20);
+    config.max_query_time = std::chrono::milliseconds(200);
+    config.default_max_retries = 5;
+    Loopback loop(config);
+    loop.answer = [](size_t) { return false; };
+
+    auto start = Clock::now();
+    std::optional<Clock::duration> elapsed;
+    loop.manager->sendQuery(loop.peerNode(), DhtMessage::createPing(NodeId::random()),
+        [&](QueryResult r) {
+            EXPECT_TRUE(r.is_err());
+            elapsed = Clock::now() - start;
+        });
+    ASSERT_TRUE(runUntil(loop.io, [&] { return elapsed.has_value(); }));
+
+    // 40ms、80ms，第三次只剩不到 80ms 的预算；之后预算用完，不再用满 5 次重试
+    EXPECT_EQ(loop.received.size(), 3u);
+    EXPECT_GE(*elapsed, std::chrono::milliseconds(190));
+    EXPECT_LT(*elapsed, std::chrono::milliseconds(300));
+
+    auto stats = loop.manager->getStatistics();
+    EXPECT_EQ(stats.retries_total, 2u);
+    EXPECT_EQ(stats.queries_timeout, 1u);
+    EXPECT_EQ(stats.timeout_histogram.total(), 3u);
+}
+
+TEST(QueryManagerTest, LatencyHistogramPercentiles) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(histogram.percentile(0.5), std::chrono::milliseconds(0));
+
+    for (int ms : {5, 10, 30, 60, 20000}) {
+        histogram.record(std::chrono::milliseconds(ms));
+    }
+    EXPECT_EQ(histogram.total(), 5u);
+    EXPECT_EQ(histogram.counts[0], 2u);
+    EXPECT_EQ(histogram.counts[LatencyHistogram::kBuckets - 1], 1u);
+    EXPECT_EQ(histogram.percentile(0.5), std::chrono::milliseconds(50));
+    EXPECT_EQ(histogram.percentile(1.0), std::chrono::milliseconds(6400));
+}
+
+// ========== 槽位 ==========
+
+TEST(QueryManagerTest, RejectsQueriesWhenAllSlotsAreInUse) {
+    QueryManagerConfig config;
+    config.max_pending_queries = 2;
+    Loopback loop(config);
+    loop.answer = [](size_t) { return false; };
+
+    std::optional<QueryError> error;
+    for (int i = 0; i < 3; ++i) {
+        loop.manager->sendQuery(loop.peerNode(), DhtMessage::createPing(NodeId::random()),
+            [&](QueryResult r) {
+                if (r.is_err()) {
+                    error = r.error();
+                }
+            });
+    }
+    ASSERT_TRUE(runUntil(loop.io, [&] { return error.has_value(); }));
+    EXPECT_EQ(*error, QueryError::QueueFull);
+    EXPECT_EQ(loop.manager->pendingCount(), 2u);
+
+    // 取消后槽位可以复用
+    loop.manager->cancelAll();
+    EXPECT_EQ(loop.manager->pendingCount(), 0u);
+}
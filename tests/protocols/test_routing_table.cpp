@@ -5,6 +5,8 @@
 
 #include <gtest/gtest.h>
 #include <magnet/protocols/routing_table.h>
+#include <algorithm>
+#include <array>
 #include <thread>
 
 using namespace magnet::protocols;
@@ -330,3 +332,53 @@ TEST(RoutingTableTest, ThreadSafeAddAndFind) {
     // 不崩溃就算通过
     EXPECT_GE(rt.nodeCount(), 1u);
 }
+
+// ========== 定长节点记录 ==========
+
+TEST(RoutingTableTest, FindClosestMatchesFullSort) {
+    NodeId local_id = NodeId::random();
+    RoutingTable rt(local_id);
+
+    std::vector<NodeId> ids;
+    for (int i = 0; i < 2000; ++i) {
+        NodeId id = NodeId::random();
+        if (rt.addNode(DhtNode(id, "10.0." + std::to_string(i / 256) + "." + std::to_string(i % 256), 6881))) {
+            ids.push_back(id);
+        }
+    }
+    // 让目标落在本地 ID 附近的桶，覆盖"目标桶 + 更低的桶"的收集路径
+    std::vector<NodeId> targets = {local_id, rt.getRandomIdInBucket(150), NodeId::random()};
+
+    for (const auto& target : targets) {
+        auto expected = ids;
+        std::sort(expected.begin(), expected.end(), [&target](const NodeId& a, const NodeId& b) {
+            return target.distance(a) < target.distance(b);
+        });
+
+        std::array<RoutingTable::NodeRecord, RoutingTable::s_kBucketSize> out;
+        size_t found = rt.findClosest(target, out.data(), out.size());
+        ASSERT_EQ(found, std::min(out.size(), expected.size()));
+        for (size_t i = 0; i < found; ++i) {
+            EXPECT_EQ(out[i].id, expected[i]);
+        }
+    }
+}
+
+TEST(RoutingTableTest, RecordsKeepBinaryAddressOfBothFamilies) {
+    RoutingTable rt(createNodeId(0x00));
+    rt.addNode(createDhtNode(0x10, "203.0.113.5", 51413));
+    rt.addNode(createDhtNode(0x20, "2001:db8::5", 6881));
+    EXPECT_FALSE(rt.addNode(createDhtNode(0x30, "not-an-ip", 6881)));
+
+    std::array<RoutingTable::NodeRecord, 2> out;
+    ASSERT_EQ(rt.findClosest(createNodeId(0x10), out.data(), out.size()), 2u);
+    EXPECT_EQ(out[0].address_size, s_kCompactAddressSize);
+    EXPECT_EQ(out[0].port(), 51413);
+    EXPECT_EQ(out[1].address_size, s_kCompactAddress6Size);
+
+    auto nodes = rt.findCloset(createNodeId(0x10));
+    ASSERT_EQ(nodes.size(), 2u);
+    EXPECT_EQ(nodes[0].ip_, "203.0.113.5");
+    EXPECT_EQ(nodes[1].ip_, "2001:db8::5");
+    EXPECT_EQ(nodes[1].port_, 6881);
+}
@@ -0,0 +1,172 @@
+/**
+ * @file test_disk_io_engine.cpp
+ * @brief DiskIoEngine 单元测试（两种后端）
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/storage/disk_io_engine.h>
+#include "test_helpers.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+using namespace magnet::storage;
+namespace fs = std::filesystem;
+using magnet::test::TempDir;
+
+// ========== 辅助函数 ==========
+
+namespace {
+
+// 两个文件：40000 + 60000 字节
+StorageConfig twoFileConfig(const std::string& base) {
+    StorageConfig config;
+    config.base_path = base;
+    config.piece_length = 16384;
+    config.total_size = 100000;
+    config.files = {
+        FileEntry("a.bin", 40000, 0),
+        FileEntry("b.bin", 60000, 40000),
+    };
+    return config;
+}
+
+std::vector<uint8_t> pattern(size_t length, uint8_t seed) {
+    std::vector<uint8_t> data(length);
+    for (size_t i = 0; i < length; ++i) {
+        data[i] = static_cast<uint8_t>(seed + i * 13);
+    }
+    return data;
+}
+
+class DiskIoEngineTest : public ::testing::TestWithParam<DiskIoBackend> {};
+
+} // namespace
+
+// ========== 读写测试 ==========
+
+TEST_P(DiskIoEngineTest, WritesThenReadsAcrossFiles) {
+    TempDir dir("magnet_dio");
+    FileManager files(twoFileConfig(dir.str()));
+    ASSERT_TRUE(files.initialize());
+
+    asio::io_context io;
+    DiskIoConfig config;
+    config.backend = GetParam();
+    config.queue_depth = 4;     // 小队列，覆盖提交队列满的情况
+    DiskIoEngine engine(io, files, config);
+
+    // 每块 16KB（最后一块较短），第 3 块跨越文件边界
+    const size_t block = 16384;
+    int written = 0;
+    for (size_t i = 0; i < 7; ++i) {
+        size_t length = std::min(block, 100000 - i * block);
+        engine.asyncWrite(i * block, pattern(length, static_cast<uint8_t>(i)), [&written](bool ok) {
+            EXPECT_TRUE(ok);
+            written++;
+        });
+    }
+    engine.stop();
+    io.run();
+    EXPECT_EQ(written, 7);
+
+    for (size_t i = 0; i < 7; ++i) {
+        size_t length = std::min(block, 100000 - i * block);
+        EXPECT_EQ(files.read(i * block, length), pattern(length, static_cast<uint8_t>(i)));
+    }
+
+    auto stats = engine.statistics();
+    EXPECT_EQ(stats.completed, 7u);
+    EXPECT_EQ(stats.failed, 0u);
+    EXPECT_EQ(stats.bytes_written, 100000u);
+    EXPECT_EQ(stats.in_flight, 0u);
+}
+
+TEST_P(DiskIoEngineTest, ReadCallbackDeliversData) {
+    TempDir dir("magnet_dio");
+    FileManager files(twoFileConfig(dir.str()));
+    ASSERT_TRUE(files.initialize());
+    auto data = pattern(20000, 9);
+    ASSERT_TRUE(files.write(30000, data));
+
+    asio::io_context io;
+    DiskIoConfig config;
+    config.backend = GetParam();
+    DiskIoEngine engine(io, files, config);
+
+    std::vector<uint8_t> result;
+    engine.asyncRead(30000, 20000, [&result](bool ok, std::vector<uint8_t> bytes) {
+        EXPECT_TRUE(ok);
+        result = std::move(bytes);
+    });
+    engine.asyncRead(99000, 2000, [](bool ok, std::vector<uint8_t> bytes) {
+        EXPECT_FALSE(ok);
+        EXPECT_TRUE(bytes.empty());
+    });
+    engine.stop();
+    io.run();
+
+    EXPECT_EQ(result, data);
+    EXPECT_EQ(engine.statistics().failed, 1u);
+}
+
+// ========== 固定缓冲测试 ==========
+
+TEST_P(DiskIoEngineTest, FixedBuffersAreRecycled) {
+    TempDir dir("magnet_dio");
+    FileManager files(twoFileConfig(dir.str()));
+    ASSERT_TRUE(files.initialize());
+
+    asio::io_context io;
+    DiskIoConfig config;
+    config.backend = GetParam();
+    config.registered_buffers = 2;
+    config.registered_buffer_size = 16384;
+    DiskIoEngine engine(io, files, config);
+
+    auto first = engine.acquireBuffer();
+    auto second = engine.acquireBuffer();
+    ASSERT_TRUE(first.valid() && second.valid());
+    EXPECT_FALSE(engine.acquireBuffer().valid());
+
+    auto data = pattern(16384, 42);
+    std::copy(data.begin(), data.end(), first.data());
+    bool done = false;
+    engine.asyncWrite(32768, std::move(first), data.size(), [&done](bool ok) {
+        EXPECT_TRUE(ok);
+        done = true;
+    });
+    engine.stop();
+    io.run();
+
+    EXPECT_TRUE(done);
+    EXPECT_EQ(files.read(32768, data.size()), data);
+    EXPECT_TRUE(engine.acquireBuffer().valid());
+}
+
+TEST_P(DiskIoEngineTest, StoppedEngineFailsNewRequests) {
+    TempDir dir("magnet_dio");
+    FileManager files(twoFileConfig(dir.str()));
+    ASSERT_TRUE(files.initialize());
+
+    asio::io_context io;
+    DiskIoConfig config;
+    config.backend = GetParam();
+    DiskIoEngine engine(io, files, config);
+    engine.stop();
+
+    bool called = false;
+    engine.asyncWrite(0, pattern(10, 0), [&called](bool ok) {
+        EXPECT_FALSE(ok);
+        called = true;
+    });
+    io.run();
+    EXPECT_TRUE(called);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, DiskIoEngineTest,
+                         ::testing::Values(DiskIoBackend::ThreadPool, DiskIoBackend::IoUring),
+                         [](const auto& info) {
+                             return std::string(info.param == DiskIoBackend::IoUring ? "IoUring" : "ThreadPool");
+                         });
@@ -0,0 +1,307 @@
+/**
+ * @file test_file_manager.cpp
+ * @brief FileManager 位置读写、描述符缓存、内存映射与预分配单元测试
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/storage/file_manager.h>
+#include "test_helpers.h"
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include <sys/stat.h>
+#include <vector>
+
+using namespace magnet::storage;
+namespace fs = std::filesystem;
+using magnet::test::TempDir;
+
+// ========== 辅助函数 ==========
+
+namespace {
+
+// 三个文件：100 + 50 + 0（空文件） + 150 字节
+StorageConfig multiFileConfig(const std::string& base, size_t max_open = 64) {
+    StorageConfig config;
+    config.base_path = base;
+    config.piece_length = 64;
+    config.total_size = 300;
+    config.max_open_files = max_open;
+    config.files = {
+        FileEntry("a.bin", 100, 0),
+        FileEntry("sub/b.bin", 50, 100),
+        FileEntry("empty.bin", 0, 150),
+        FileEntry("sub/c.bin", 150, 150),
+    };
+    return config;
+}
+
+// 文件实际占用的磁盘空间（字节）
+size_t allocatedBytes(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? static_cast<size_t>(st.st_blocks) * 512 : 0;
+}
+
+std::vector<uint8_t> pattern(size_t length, uint8_t seed) {
+    std::vector<uint8_t> data(length);
+    for (size_t i = 0; i < length; ++i) {
+        data[i] = static_cast<uint8_t>(seed + i * 7);
+    }
+    return data;
+}
+
+} // namespace
+
+// ========== 跨文件读写测试 ==========
+
+TEST(FileManagerTest, ReadWriteAcrossFileBoundaries) {
+    TempDir dir("magnet_fm");
+    FileManager manager(multiFileConfig(dir.str()));
+    ASSERT_TRUE(manager.initialize());
+
+    // 覆盖 a.bin 尾部、整个 b.bin 和 c.bin 开头
+    auto data = pattern(120, 3);
+    ASSERT_TRUE(manager.write(80, data));
+    EXPECT_EQ(manager.read(80, 120), data);
+
+    // 逐文件核对落盘位置
+    std::vector<uint8_t> tail(20);
+    ASSERT_TRUE(manager.readInto(80, tail.data(), tail.size()));
+    EXPECT_EQ(tail, std::vector<uint8_t>(data.begin(), data.begin() + 20));
+    EXPECT_EQ(fs::file_size(dir.str() + "/sub/b.bin"), 50u);
+
+    // 越界
+    EXPECT_FALSE(manager.write(290, pattern(20, 0)));
+    EXPECT_TRUE(manager.read(290, 20).empty());
+}
+
+TEST(FileManagerTest, VectoredIoSplitsAcrossFiles) {
+    TempDir dir("magnet_fm");
+    FileManager manager(multiFileConfig(dir.str()));
+    ASSERT_TRUE(manager.initialize());
+
+    auto first = pattern(30, 1);
+    auto second = pattern(0, 0);
+    auto third = pattern(90, 2);
+    ASSERT_TRUE(manager.writev(90, {{first.data(), first.size()},
+                                    {second.data(), second.size()},
+                                    {third.data(), third.size()}}));
+
+    std::vector<uint8_t> head(45);
+    std::vector<uint8_t> rest(75);
+    ASSERT_TRUE(manager.readv(90, {{head.data(), head.size()}, {rest.data(), rest.size()}}));
+
+    std::vector<uint8_t> expected(first);
+    expected.insert(expected.end(), third.begin(), third.end());
+    std::vector<uint8_t> actual(head);
+    actual.insert(actual.end(), rest.begin(), rest.end());
+    EXPECT_EQ(actual, expected);
+}
+
+TEST(FileManagerTest, UnpreallocatedFileReadsAsZeros) {
+    TempDir dir("magnet_fm");
+    auto config = multiFileConfig(dir.str());
+    config.preallocate_mode = PreallocateMode::None;
+    FileManager manager(config);
+    ASSERT_TRUE(manager.initialize());
+
+    ASSERT_TRUE(manager.write(0, pattern(10, 9)));
+    auto data = manager.read(0, 100);
+    ASSERT_EQ(data.size(), 100u);
+    EXPECT_EQ(std::vector<uint8_t>(data.begin() + 10, data.end()), std::vector<uint8_t>(90, 0));
+}
+
+// ========== 描述符缓存测试 ==========
+
+TEST(FileManagerTest, OpenDescriptorsBoundedByLru) {
+    TempDir dir("magnet_fm");
+    FileHandleCache cache(2);
+
+    auto a = cache.acquire(dir.str() + "/a");
+    auto b = cache.acquire(dir.str() + "/b");
+    ASSERT_TRUE(a && b);
+    EXPECT_EQ(cache.acquire(dir.str() + "/a"), a);
+
+    // b 最久未用，被淘汰；已取出的句柄仍然有效
+    auto c = cache.acquire(dir.str() + "/c");
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_EQ(cache.acquire(dir.str() + "/a"), a);
+    EXPECT_NE(cache.acquire(dir.str() + "/b"), b);
+    EXPECT_GE(b->get(), 0);
+
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(FileManagerTest, SingleDescriptorStillReadsEveryFile) {
+    TempDir dir("magnet_fm");
+    FileManager manager(multiFileConfig(dir.str(), 1));
+    ASSERT_TRUE(manager.initialize());
+
+    auto data = pattern(300, 5);
+    ASSERT_TRUE(manager.write(0, data));
+    manager.flush();
+    EXPECT_EQ(manager.read(0, 300), data);
+}
+
+// ========== 并发测试 ==========
+
+TEST(FileManagerTest, ConcurrentDisjointWrites) {
+    TempDir dir("magnet_fm");
+    FileManager manager(multiFileConfig(dir.str(), 2));
+    ASSERT_TRUE(manager.initialize());
+
+    // 每个线程写自己的 30 字节区间，多数区间跨文件
+    const size_t chunk = 30;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 10; ++t) {
+        threads.emplace_back([&manager, t, chunk]() {
+            for (int round = 0; round < 50; ++round) {
+                manager.write(t * chunk, pattern(chunk, static_cast<uint8_t>(t)));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t t = 0; t < 10; ++t) {
+        EXPECT_EQ(manager.read(t * chunk, chunk), pattern(chunk, static_cast<uint8_t>(t)))
+            << "chunk " << t;
+    }
+}
+
+// ========== 内存映射测试 ==========
+
+TEST(FileManagerTest, MemoryMappedReadWriteAndViews) {
+    TempDir dir("magnet_fm");
+    auto config = multiFileConfig(dir.str());
+    config.memory_map = true;
+    config.preallocate_mode = PreallocateMode::None;  // 映射前应自动扩展到完整大小
+    config.mmap_sync_interval = 64; // 覆盖周期性 msync
+    {
+        FileManager manager(config);
+        ASSERT_TRUE(manager.initialize());
+        ASSERT_TRUE(manager.isMapped());
+
+        // 不是稀疏文件：磁盘空间已实际分配，写入映射不会因空间不足触发 SIGBUS
+        for (const auto& file : config.files) {
+            EXPECT_EQ(fs::file_size(dir.str() + "/" + file.path), file.size) << file.path;
+            EXPECT_GE(allocatedBytes(dir.str() + "/" + file.path), file.size) << file.path;
+        }
+
+        auto data = pattern(300, 11);
+        ASSERT_TRUE(manager.write(0, data));
+        EXPECT_EQ(manager.read(50, 200), std::vector<uint8_t>(data.begin() + 50, data.begin() + 250));
+
+        // 跨越 a.bin / b.bin / c.bin 的视图（空文件不产生片段）
+        std::vector<ConstIoBuffer> segments;
+        ASSERT_TRUE(manager.view(90, 80, segments));
+        ASSERT_EQ(segments.size(), 3u);
+        EXPECT_EQ(segments[0].size, 10u);
+        EXPECT_EQ(segments[1].size, 50u);
+        EXPECT_EQ(segments[2].size, 20u);
+        std::vector<uint8_t> joined;
+        for (const auto& segment : segments) {
+            joined.insert(joined.end(), segment.data, segment.data + segment.size);
+        }
+        EXPECT_EQ(joined, std::vector<uint8_t>(data.begin() + 90, data.begin() + 170));
+        EXPECT_FALSE(manager.view(290, 20, segments));
+    }
+
+    // 解除映射后数据已落到文件
+    FileManager reopened(multiFileConfig(dir.str()));
+    ASSERT_TRUE(reopened.initialize());
+    EXPECT_EQ(reopened.read(0, 300), pattern(300, 11));
+}
+
+TEST(FileManagerTest, OversizedFilesFallBackToPositionalIo) {
+    TempDir dir("magnet_fm");
+    auto config = multiFileConfig(dir.str());
+    config.memory_map = true;
+    config.mmap_max_file_size = 100;    // c.bin（150 字节）不映射
+    FileManager manager(config);
+    ASSERT_TRUE(manager.initialize());
+
+    std::vector<ConstIoBuffer> segments;
+    EXPECT_TRUE(manager.view(0, 150, segments));
+    EXPECT_FALSE(manager.view(140, 20, segments));
+
+    auto data = pattern(300, 4);
+    ASSERT_TRUE(manager.write(0, data));
+    EXPECT_EQ(manager.read(0, 300), data);
+}
+
+// ========== 预分配测试 ==========
+
+TEST(FileManagerTest, FullPreallocationReservesBlocksInParallel) {
+    TempDir dir("magnet_fm");
+    StorageConfig config;
+    config.base_path = dir.str();
+    config.piece_length = 65536;
+    config.total_size = 4 * 1024 * 1024;
+    config.preallocate_mode = PreallocateMode::Full;
+    config.preallocate_threads = 4;
+    for (size_t i = 0; i < 4; ++i) {
+        config.files.emplace_back("f" + std::to_string(i), 1024 * 1024, i * 1024 * 1024);
+    }
+
+    FileManager manager(config);
+    ASSERT_TRUE(manager.initialize());
+
+    const auto& stats = manager.allocationStats();
+    ASSERT_EQ(stats.size(), 4u);
+    for (size_t i = 0; i < 4; ++i) {
+        EXPECT_TRUE(stats[i].success);
+        EXPECT_EQ(stats[i].path, "f" + std::to_string(i));
+        EXPECT_EQ(stats[i].mode, PreallocateMode::Full);
+        EXPECT_EQ(fs::file_size(dir.str() + "/f" + std::to_string(i)), 1024u * 1024u);
+        EXPECT_GE(allocatedBytes(dir.str() + "/f" + std::to_string(i)), 1024u * 1024u);
+    }
+}
+
+TEST(FileManagerTest, LazyPreallocationOnFirstWrite) {
+    TempDir dir("magnet_fm");
+    StorageConfig config;
+    config.base_path = dir.str();
+    config.piece_length = 65536;
+    config.total_size = 1024 * 1024;
+    config.preallocate_mode = PreallocateMode::Lazy;
+    config.files = {FileEntry("lazy.bin", 1024 * 1024, 0)};
+
+    FileManager manager(config);
+    ASSERT_TRUE(manager.initialize());
+    EXPECT_EQ(fs::file_size(dir.str() + "/lazy.bin"), 1024u * 1024u);
+
+    ASSERT_TRUE(manager.write(0, pattern(100, 1)));
+    EXPECT_GE(allocatedBytes(dir.str() + "/lazy.bin"), 1024u * 1024u);
+    EXPECT_EQ(fs::file_size(dir.str() + "/lazy.bin"), 1024u * 1024u);
+}
+
+TEST(FileManagerTest, ExistingFilesAreNotTruncated) {
+    TempDir dir("magnet_fm");
+    std::ofstream(dir.str() + "/a.bin", std::ios::binary) << "resume-data";
+    fs::create_directories(dir.str() + "/sub");
+    {
+        std::ofstream out(dir.str() + "/sub/c.bin", std::ios::binary);
+        out << std::string(200, 'x');   // 比预期的 150 字节大
+    }
+
+    // 较短的文件被扩展且保留原有数据；过大的文件默认拒绝截断
+    FileManager refused(multiFileConfig(dir.str()));
+    EXPECT_FALSE(refused.initialize());
+    auto head = refused.allocationStats();
+    EXPECT_TRUE(head[0].success);
+    EXPECT_FALSE(head[3].success);
+
+    auto config = multiFileConfig(dir.str());
+    config.truncate_oversized = true;
+    FileManager manager(config);
+    ASSERT_TRUE(manager.initialize());
+    EXPECT_EQ(fs::file_size(dir.str() + "/sub/c.bin"), 150u);
+
+    auto data = manager.read(0, 11);
+    EXPECT_EQ(std::string(data.begin(), data.end()), "resume-data");
+}
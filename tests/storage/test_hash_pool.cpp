@@ -0,0 +1,169 @@
+/**
+ * @file test_hash_pool.cpp
+ * @brief HashPool 单元测试
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/storage/hash_pool.h>
+
+#include <condition_variable>
+#include <future>
+#include <vector>
+
+using namespace magnet::storage;
+using namespace std::chrono_literals;
+
+// ========== 辅助函数 ==========
+
+namespace {
+
+// 阻塞作业的开关，用于把线程池占满
+class Gate {
+public:
+    void open() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = true;
+        cv_.notify_all();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return open_; });
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool open_{false};
+};
+
+HashPoolConfig smallPool(size_t threads, size_t max_jobs) {
+    HashPoolConfig config;
+    config.thread_count = threads;
+    config.max_pending_jobs = max_jobs;
+    return config;
+}
+
+} // namespace
+
+// ========== 哈希结果测试 ==========
+
+TEST(HashPoolTest, ResultMatchesDirectHash) {
+    HashPool pool(smallPool(2, 4));
+
+    std::vector<uint8_t> data(100000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>(i * 31);
+    }
+
+    std::promise<HashResult> done;
+    ASSERT_TRUE(pool.submit(
+        [&data]() { return HashPool::hashBuffer(data.data(), data.size()); },
+        [&done](HashResult result) { done.set_value(result); }));
+
+    auto result = done.get_future().get();
+    EXPECT_TRUE(result.success);
+    EXPECT_EQ(result.bytes, data.size());
+    EXPECT_EQ(result.digest, magnet::utils::sha1(data));
+}
+
+TEST(HashPoolTest, ThrowingJobReportsFailure) {
+    HashPool pool(smallPool(1, 4));
+
+    std::promise<HashResult> done;
+    ASSERT_TRUE(pool.submit(
+        []() -> HashResult { throw std::runtime_error("read failed"); },
+        [&done](HashResult result) { done.set_value(result); }));
+
+    EXPECT_FALSE(done.get_future().get().success);
+}
+
+// ========== 背压测试 ==========
+
+TEST(HashPoolTest, RejectsWhenSaturated) {
+    HashPool pool(smallPool(1, 2));
+    Gate gate;
+
+    auto blocking = [&gate]() {
+        gate.wait();
+        return HashResult{true, {}, 10};
+    };
+
+    EXPECT_TRUE(pool.submit(blocking, nullptr));
+    EXPECT_TRUE(pool.submit(blocking, nullptr));
+    EXPECT_TRUE(pool.saturated());
+    EXPECT_FALSE(pool.submit(blocking, nullptr));
+    EXPECT_EQ(pool.pendingJobs(), 2u);
+
+    gate.open();
+    pool.stop();
+
+    auto stats = pool.statistics();
+    EXPECT_EQ(stats.completed, 2u);
+    EXPECT_EQ(stats.rejected, 1u);
+    EXPECT_EQ(stats.peak_pending, 2u);
+    EXPECT_EQ(stats.bytes_hashed, 20u);
+    EXPECT_EQ(pool.pendingJobs(), 0u);
+    EXPECT_FALSE(pool.saturated());
+}
+
+TEST(HashPoolTest, SlotReleasedBeforeCallback) {
+    HashPool pool(smallPool(1, 1));
+
+    // 回调内名额已经释放：积压的作业可以立即补交
+    std::promise<bool> resubmitted;
+    ASSERT_TRUE(pool.submit(
+        []() { return HashResult{}; },
+        [&pool, &resubmitted](HashResult) {
+            bool saturated = pool.saturated();
+            resubmitted.set_value(!saturated && pool.submit([]() { return HashResult{}; }, nullptr));
+        }));
+
+    EXPECT_TRUE(resubmitted.get_future().get());
+}
+
+// ========== 统计与停止测试 ==========
+
+TEST(HashPoolTest, StatisticsReportQueueDepth) {
+    HashPool pool(smallPool(1, 8));
+    Gate gate;
+    std::promise<void> started;
+
+    ASSERT_TRUE(pool.submit(
+        [&gate, &started]() {
+            started.set_value();
+            gate.wait();
+            return HashResult{};
+        },
+        nullptr));
+    ASSERT_TRUE(pool.submit([]() { return HashResult{}; }, nullptr));
+    ASSERT_TRUE(pool.submit([]() { return HashResult{}; }, nullptr));
+
+    started.get_future().wait();
+    auto stats = pool.statistics();
+    EXPECT_EQ(stats.thread_count, 1u);
+    EXPECT_EQ(stats.running, 1u);
+    EXPECT_EQ(stats.queued, 2u);
+
+    gate.open();
+    pool.stop();
+    EXPECT_EQ(pool.statistics().completed, 3u);
+}
+
+TEST(HashPoolTest, StopDrainsThenRejects) {
+    HashPool pool(smallPool(2, 16));
+    std::atomic<int> callbacks{0};
+
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(pool.submit(
+            []() {
+                std::vector<uint8_t> data(4096, 0xab);
+                return HashPool::hashBuffer(data.data(), data.size());
+            },
+            [&callbacks](HashResult) { callbacks++; }));
+    }
+
+    pool.stop();
+    EXPECT_EQ(callbacks.load(), 10);
+    EXPECT_FALSE(pool.submit([]() { return HashResult{}; }, nullptr));
+}
@@ -0,0 +1,252 @@
+/**
+ * @file test_piece_picker.cpp
+ * @brief PiecePicker 单元测试
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/storage/piece_picker.h>
+
+using namespace magnet::storage;
+
+// ========== 辅助函数 ==========
+
+// 创建只拥有指定分片的位图
+std::vector<bool> makeBitfield(size_t count, std::initializer_list<uint32_t> have) {
+    std::vector<bool> bitfield(count, false);
+    for (auto i : have) {
+        bitfield[i] = true;
+    }
+    return bitfield;
+}
+
+// ========== 构造函数测试 ==========
+
+TEST(PiecePickerTest, ConstructorAllPickable) {
+    PiecePicker picker(10);
+
+    EXPECT_EQ(picker.pieceCount(), 10u);
+    EXPECT_EQ(picker.pickableCount(), 10u);
+    EXPECT_EQ(picker.peerCount(), 0u);
+}
+
+TEST(PiecePickerTest, NoPeersPicksNothing) {
+    PiecePicker picker(10);
+
+    // 没有任何 Peer 拥有分片，不应盲目选择
+    EXPECT_EQ(picker.pickPiece(), -1);
+}
+
+// ========== 可用度测试 ==========
+
+TEST(PiecePickerTest, BitfieldAndHaveUpdateAvailability) {
+    PiecePicker picker(4);
+
+    picker.setPeerBitfield("a", makeBitfield(4, {0, 1}));
+    picker.setPeerBitfield("b", makeBitfield(4, {1}));
+    picker.peerHas("b", 2);
+
+    EXPECT_EQ(picker.availability(0), 1u);
+    EXPECT_EQ(picker.availability(1), 2u);
+    EXPECT_EQ(picker.availability(2), 1u);
+    EXPECT_EQ(picker.availability(3), 0u);
+}
+
+TEST(PiecePickerTest, DuplicateHaveIgnored) {
+    PiecePicker picker(4);
+
+    picker.peerHas("a", 1);
+    picker.peerHas("a", 1);
+    picker.peerHas("a", 100);  // 越界
+
+    EXPECT_EQ(picker.availability(1), 1u);
+    EXPECT_EQ(picker.peerCount(), 1u);
+}
+
+TEST(PiecePickerTest, RemovePeerRevertsAvailability) {
+    PiecePicker picker(4);
+
+    picker.setPeerBitfield("a", makeBitfield(4, {0, 1}));
+    picker.peerHas("a", 3);
+    picker.removePeer("a");
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        EXPECT_EQ(picker.availability(i), 0u);
+    }
+    EXPECT_EQ(picker.peerCount(), 0u);
+    EXPECT_EQ(picker.pickPiece(), -1);
+}
+
+TEST(PiecePickerTest, BitfieldReplacesEarlierHave) {
+    PiecePicker picker(4);
+
+    picker.peerHas("a", 0);
+    picker.setPeerBitfield("a", makeBitfield(4, {1}));
+
+    EXPECT_EQ(picker.availability(0), 0u);
+    EXPECT_EQ(picker.availability(1), 1u);
+}
+
+TEST(PiecePickerTest, PaddingBitsIgnored) {
+    PiecePicker picker(3);
+
+    // Bitfield 消息按字节对齐，末尾填充位不应影响结果
+    std::vector<bool> bitfield(8, true);
+    picker.setPeerBitfield("seed", bitfield);
+
+    EXPECT_EQ(picker.seedCount(), 1u);
+    EXPECT_EQ(picker.availability(2), 1u);
+}
+
+// ========== 做种者测试 ==========
+
+TEST(PiecePickerTest, SeedCountedWithoutPerPieceWork) {
+    PiecePicker picker(4);
+
+    picker.setPeerBitfield("seed", std::vector<bool>(4, true));
+
+    EXPECT_EQ(picker.seedCount(), 1u);
+    for (uint32_t i = 0; i < 4; ++i) {
+        EXPECT_EQ(picker.availability(i), 1u);
+    }
+    EXPECT_GE(picker.pickPiece(), 0);
+
+    picker.removePeer("seed");
+    EXPECT_EQ(picker.seedCount(), 0u);
+    EXPECT_EQ(picker.pickPiece(), -1);
+}
+
+// ========== 稀有优先测试 ==========
+
+TEST(PiecePickerTest, PicksRarestPiece) {
+    PiecePicker picker(4);
+
+    picker.setPeerBitfield("a", makeBitfield(4, {0, 1, 2}));
+    picker.setPeerBitfield("b", makeBitfield(4, {0, 1}));
+    picker.setPeerBitfield("c", makeBitfield(4, {0}));
+
+    // 分片 2 只有一个 Peer 拥有
+    EXPECT_EQ(picker.pickPiece(), 2);
+}
+
+TEST(PiecePickerTest, RarestWithSeedPresent) {
+    PiecePicker picker(4);
+
+    picker.setPeerBitfield("seed", std::vector<bool>(4, true));
+    picker.setPeerBitfield("a", makeBitfield(4, {0, 1, 2}));
+
+    // 只有做种者拥有分片 3
+    EXPECT_EQ(picker.pickPiece(), 3);
+}
+
+TEST(PiecePickerTest, FilterSkipsPieces) {
+    PiecePicker picker(4);
+
+    picker.setPeerBitfield("a", makeBitfield(4, {0, 1}));
+    picker.setPeerBitfield("b", makeBitfield(4, {1}));
+
+    // 跳过最稀有的分片 0，应退到下一个桶
+    int32_t piece = picker.pickPiece([](uint32_t i) { return i != 0; });
+    EXPECT_EQ(piece, 1);
+
+    EXPECT_EQ(picker.pickPiece([](uint32_t) { return false; }), -1);
+}
+
+TEST(PiecePickerTest, PickForPeerUsesItsBitfield) {
+    PiecePicker picker(4);
+
+    picker.setPeerBitfield("a", makeBitfield(4, {0, 1}));
+    picker.setPeerBitfield("b", makeBitfield(4, {1, 2}));
+    EXPECT_EQ(picker.wantedCount("a"), 2u);
+
+    // 分片 0 和 2 同样稀有，但只有分片 0 是 a 拥有的
+    EXPECT_EQ(picker.pickPieceFor("a"), 0);
+    EXPECT_EQ(picker.pickPieceFor("b"), 2);
+    EXPECT_EQ(picker.pickPieceFor("unknown"), -1);
+
+    // 可选分片数随本地状态增减，为 0 时直接返回
+    picker.markDownloading(0);
+    picker.markHave(1);
+    EXPECT_EQ(picker.wantedCount("a"), 0u);
+    EXPECT_EQ(picker.wantedCount("b"), 1u);
+    EXPECT_EQ(picker.pickPieceFor("a"), -1);
+
+    picker.markMissing(0);
+    picker.peerHas("a", 3);
+    EXPECT_EQ(picker.wantedCount("a"), 2u);
+    int32_t piece = picker.pickPieceFor("a");
+    EXPECT_TRUE(piece == 0 || piece == 3);
+
+    // 做种者不需要过滤
+    picker.setPeerBitfield("seed", std::vector<bool>(4, true));
+    EXPECT_EQ(picker.wantedCount("seed"), 3u);
+    EXPECT_GE(picker.pickPieceFor("seed"), 0);
+}
+
+// ========== 本地状态测试 ==========
+
+TEST(PiecePickerTest, DownloadingAndHaveNotPicked) {
+    PiecePicker picker(3);
+
+    picker.setPeerBitfield("seed", std::vector<bool>(3, true));
+
+    picker.markDownloading(0);
+    picker.markHave(1);
+    EXPECT_EQ(picker.pickableCount(), 1u);
+    EXPECT_EQ(picker.pickPiece(), 2);
+
+    picker.markDownloading(2);
+    EXPECT_EQ(picker.pickPiece(), -1);
+
+    // 超时后重新可选
+    picker.markMissing(0);
+    EXPECT_EQ(picker.pickableCount(), 1u);
+    EXPECT_EQ(picker.pickPiece(), 0);
+}
+
+TEST(PiecePickerTest, AvailabilityTrackedWhileDownloading) {
+    PiecePicker picker(3);
+
+    picker.setPeerBitfield("a", makeBitfield(3, {0, 1}));
+    picker.setPeerBitfield("b", makeBitfield(3, {1}));
+
+    // 下载中的分片可用度变化后，重新变为 Missing 时应进入正确的桶
+    picker.markDownloading(1);
+    picker.removePeer("b");
+    picker.peerHas("c", 0);
+    picker.markMissing(1);
+
+    EXPECT_EQ(picker.availability(0), 2u);
+    EXPECT_EQ(picker.availability(1), 1u);
+    EXPECT_EQ(picker.pickPiece(), 1);
+}
+
+TEST(PiecePickerTest, ManyPeersBucketsStayConsistent) {
+    const size_t count = 256;
+    PiecePicker picker(count);
+
+    // 分片 i 的可用度为 i % 8
+    for (int p = 0; p < 8; ++p) {
+        std::vector<bool> bitfield(count, false);
+        for (size_t i = 0; i < count; ++i) {
+            bitfield[i] = static_cast<int>(i % 8) > p;
+        }
+        picker.setPeerBitfield("peer" + std::to_string(p), bitfield);
+    }
+
+    // 依次取出并标记下载，可用度应单调不减
+    size_t last = 0;
+    for (size_t n = 0; n < count; ++n) {
+        int32_t piece = picker.pickPiece();
+        if (piece < 0) {
+            break;
+        }
+        size_t avail = picker.availability(static_cast<uint32_t>(piece));
+        EXPECT_GE(avail, last);
+        EXPECT_GT(avail, 0u);
+        last = avail;
+        picker.markDownloading(static_cast<uint32_t>(piece));
+    }
+
+    // 只剩可用度为 0 的分片
+    EXPECT_EQ(picker.pickableCount(), count / 8);
+}
@@ -0,0 +1,180 @@
+/**
+ * @file test_read_cache.cpp
+ * @brief ReadCache 命中、分片内预读与 LRU 淘汰单元测试
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/storage/read_cache.h>
+#include <magnet/storage/disk_io_engine.h>
+#include <magnet/storage/file_manager.h>
+#include "test_helpers.h"
+
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+using namespace magnet::storage;
+namespace fs = std::filesystem;
+using magnet::test::runUntil;
+
+// ========== 辅助函数 ==========
+
+namespace {
+
+constexpr size_t kPieceLength = 64;
+constexpr size_t kTotalSize = 200;   // 4 个分片，最后一个 8 字节
+constexpr uint32_t kBlock = 16;
+
+class ReadCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        path_ = fs::temp_directory_path() /
+                ("magnet_rc_" + std::string(
+                    ::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(path_);
+        fs::create_directories(path_);
+
+        StorageConfig config;
+        config.base_path = path_.string();
+        config.piece_length = kPieceLength;
+        config.total_size = kTotalSize;
+        config.files = {FileEntry("data.bin", kTotalSize, 0)};
+        file_manager_ = std::make_unique<FileManager>(config);
+        ASSERT_TRUE(file_manager_->initialize());
+
+        data_.resize(kTotalSize);
+        for (size_t i = 0; i < data_.size(); ++i) {
+            data_[i] = static_cast<uint8_t>(i * 13 + 1);
+        }
+        ASSERT_TRUE(file_manager_->write(0, data_));
+    }
+
+    void TearDown() override {
+        file_manager_.reset();
+        std::error_code ec;
+        fs::remove_all(path_, ec);
+    }
+
+    bool matches(const magnet::utils::BufferHandle& block, size_t offset) const {
+        return block && std::memcmp(block.data(), data_.data() + offset, block.size()) == 0;
+    }
+
+    fs::path path_;
+    std::unique_ptr<FileManager> file_manager_;
+    std::vector<uint8_t> data_;
+};
+
+} // namespace
+
+// ========== 读取 ==========
+
+TEST_F(ReadCacheTest, ReadsBlockAndReadsAheadWithinPiece) {
+    ReadCacheConfig config;
+    config.read_ahead_blocks = 2;
+    ReadCache cache(*file_manager_, kPieceLength, kTotalSize, config);
+
+    auto first = cache.read(1, 0, kBlock);
+    ASSERT_TRUE(first);
+    EXPECT_EQ(first.size(), kBlock);
+    EXPECT_TRUE(matches(first, kPieceLength));
+
+    auto stats = cache.statistics();
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.bytes_read, 3u * kBlock);   // 请求的块 + 预读的 2 块
+
+    // 预读过的块直接命中
+    auto second = cache.read(1, kBlock, kBlock);
+    auto third = cache.read(1, 2 * kBlock, kBlock);
+    EXPECT_TRUE(matches(second, kPieceLength + kBlock));
+    EXPECT_TRUE(matches(third, kPieceLength + 2 * kBlock));
+    EXPECT_EQ(cache.statistics().hits, 2u);
+    EXPECT_EQ(cache.statistics().misses, 1u);
+}
+
+TEST_F(ReadCacheTest, ReadAheadStopsAtPieceBoundary) {
+    ReadCache cache(*file_manager_, kPieceLength, kTotalSize);
+
+    // 最后一个分片只有 8 字节
+    auto last = cache.read(3, 0, 8);
+    ASSERT_TRUE(last);
+    EXPECT_TRUE(matches(last, 3 * kPieceLength));
+    EXPECT_EQ(cache.statistics().bytes_read, 8u);
+
+    // 分片内最后一块：不会预读到下一个分片
+    auto tail = cache.read(0, kPieceLength - kBlock, kBlock);
+    EXPECT_TRUE(matches(tail, kPieceLength - kBlock));
+    EXPECT_EQ(cache.statistics().bytes_read, 8u + kBlock);
+}
+
+TEST_F(ReadCacheTest, RejectsOutOfRangeRequests) {
+    ReadCache cache(*file_manager_, kPieceLength, kTotalSize);
+
+    EXPECT_FALSE(cache.read(0, kPieceLength - 8, kBlock));   // 跨分片
+    EXPECT_FALSE(cache.read(3, 0, kBlock));                  // 超出最后一个分片
+    EXPECT_FALSE(cache.read(4, 0, 8));                       // 分片不存在
+    EXPECT_FALSE(cache.read(0, 0, 0));
+    EXPECT_EQ(cache.statistics().bytes_read, 0u);
+}
+
+TEST_F(ReadCacheTest, AsyncMissIsLoadedByDiskEngine) {
+    asio::io_context io;
+    DiskIoEngine engine(io, *file_manager_);
+    ReadCacheConfig config;
+    config.read_ahead_blocks = 1;
+    ReadCache cache(*file_manager_, kPieceLength, kTotalSize, config, &engine);
+
+    // 未命中：不在调用线程上读盘，完成后由事件循环回调；同一块的并发请求只读一次
+    std::vector<magnet::utils::BufferHandle> results;
+    auto collect = [&results](magnet::utils::BufferHandle block) {
+        results.push_back(std::move(block));
+    };
+    cache.asyncRead(1, 0, kBlock, collect);
+    cache.asyncRead(1, 0, kBlock, collect);
+    EXPECT_TRUE(results.empty());
+
+    runUntil(io, [&] { return results.size() >= 2 && cache.statistics().cached_bytes >= 2 * kBlock; });
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_TRUE(matches(results[0], kPieceLength));
+    EXPECT_TRUE(matches(results[1], kPieceLength));
+    EXPECT_EQ(engine.statistics().bytes_read, 2u * kBlock);    // 请求的块 + 预读的 1 块
+    EXPECT_EQ(cache.statistics().misses, 2u);
+
+    // 预读的块已在缓存中，立即回调
+    results.clear();
+    cache.asyncRead(1, kBlock, kBlock, collect);
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_TRUE(matches(results[0], kPieceLength + kBlock));
+    EXPECT_EQ(cache.statistics().hits, 1u);
+
+    // 越界请求立即以空句柄回调
+    results.clear();
+    cache.asyncRead(3, 0, kBlock, collect);
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_FALSE(results[0]);
+
+    engine.stop();
+}
+
+TEST_F(ReadCacheTest, EvictsLeastRecentlyUsedBlocks) {
+    ReadCacheConfig config;
+    config.capacity = 2 * kBlock;
+    config.read_ahead_blocks = 0;
+    ReadCache cache(*file_manager_, kPieceLength, kTotalSize, config);
+
+    cache.read(0, 0, kBlock);
+    cache.read(1, 0, kBlock);
+    cache.read(0, 0, kBlock);                 // 0:0 变为最近使用
+    cache.read(2, 0, kBlock);                 // 淘汰 1:0
+
+    auto stats = cache.statistics();
+    EXPECT_EQ(stats.evictions, 1u);
+    EXPECT_EQ(stats.cached_bytes, 2u * kBlock);
+
+    cache.read(0, 0, kBlock);
+    EXPECT_EQ(cache.statistics().misses, 3u);  // 0:0 仍在缓存
+    cache.read(1, 0, kBlock);
+    EXPECT_EQ(cache.statistics().misses, 4u);  // 1:0 已被淘汰
+
+    cache.clear();
+    EXPECT_EQ(cache.statistics().cached_bytes, 0u);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+/**
+ * @file test_helpers.h
+ * @brief 测试共用的辅助工具：驱动事件循环、每个测试一个临时目录
+ */
+
+#include <gtest/gtest.h>
+#include <asio.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <string>
+
+namespace magnet::test {
+
+/**
+ * @brief 运行事件循环直到条件满足或超时
+ * @return 条件是否满足
+ *
+ * 每轮最多运行 1ms 就重新检查条件，计时类测试的误差不超过这一粒度
+ */
+inline bool runUntil(asio::io_context& io, const std::function<bool()>& done,
+                     std::chrono::milliseconds timeout = std::chrono::seconds(10)) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!done() && std::chrono::steady_clock::now() < deadline) {
+        io.run_for(std::chrono::milliseconds(1));
+        io.restart();
+    }
+    return done();
+}
+
+/**
+ * @class TempDir
+ * @brief 每个测试一个临时目录（前缀 + 测试名 + 随机种子），析构时删除
+ */
+class TempDir {
+public:
+    explicit TempDir(const std::string& prefix) {
+        // 参数化测试名含 '/'，替换掉以免生成子目录
+        std::string name = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        std::replace(name.begin(), name.end(), '/', '_');
+        path_ = std::filesystem::temp_directory_path() /
+                (prefix + "_" + name + "_" +
+                 std::to_string(::testing::UnitTest::GetInstance()->random_seed()));
+        std::filesystem::remove_all(path_);
+        std::filesystem::create_directories(path_);
+    }
+
+    ~TempDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path_, ec);
+    }
+
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    const std::filesystem::path& path() const { return path_; }
+    std::string str() const { return path_.string(); }
+
+private:
+    std::filesystem::path path_;
+};
+
+} // namespace magnet::test
@@ -0,0 +1,108 @@
+/**
+ * @file test_buffer_pool.cpp
+ * @brief BufferPool 单元测试
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/utils/buffer_pool.h>
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace magnet::utils;
+
+// ========== 借出与归还测试 ==========
+
+TEST(BufferPoolTest, AcquireUsesSizeClasses) {
+    BufferPool pool;
+
+    auto small = pool.acquire(17);
+    EXPECT_EQ(small.size(), 17u);
+    EXPECT_EQ(small.capacity(), 256u);
+
+    auto block = pool.acquire(16384 + 13);
+    EXPECT_EQ(block.size(), 16384u + 13);
+    EXPECT_GE(block.capacity(), 16384u + 13);
+
+    // 数据按缓存行对齐
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(block.data()) % 64, 0u);
+
+    auto stats = pool.statistics();
+    EXPECT_EQ(stats.in_use, 2u);
+    EXPECT_EQ(stats.heap_allocations, 0u);
+}
+
+TEST(BufferPoolTest, ReleasedBuffersAreReused) {
+    BufferPool pool;
+
+    uint8_t* first = nullptr;
+    {
+        auto block = pool.acquire(16384);
+        first = block.data();
+    }
+    EXPECT_EQ(pool.statistics().in_use, 0u);
+
+    auto again = pool.acquire(16000);
+    EXPECT_EQ(again.data(), first);
+
+    // 稳态借还不再分配新的 slab
+    size_t slabs = pool.statistics().slab_allocations;
+    for (int i = 0; i < 1000; ++i) {
+        auto block = pool.acquire(16384);
+        block.data()[0] = static_cast<uint8_t>(i);
+    }
+    EXPECT_EQ(pool.statistics().slab_allocations, slabs);
+}
+
+TEST(BufferPoolTest, CopiesShareTheBuffer) {
+    BufferPool pool;
+    const uint8_t bytes[] = {1, 2, 3, 4};
+    auto original = pool.copy(bytes, sizeof(bytes));
+
+    auto shared = original;
+    EXPECT_EQ(shared.data(), original.data());
+    EXPECT_EQ(original.useCount(), 2u);
+    EXPECT_EQ(std::memcmp(shared.data(), bytes, sizeof(bytes)), 0);
+
+    original.reset();
+    EXPECT_FALSE(original.valid());
+    EXPECT_EQ(shared.useCount(), 1u);
+    EXPECT_EQ(pool.statistics().in_use, 1u);
+
+    shared.reset();
+    EXPECT_EQ(pool.statistics().in_use, 0u);
+}
+
+TEST(BufferPoolTest, OversizedRequestsFallBackToHeap) {
+    BufferPool pool;
+    {
+        auto large = pool.acquire(1 << 20);
+        EXPECT_EQ(large.size(), 1u << 20);
+        std::memset(large.data(), 0xCD, large.size());
+    }
+    auto stats = pool.statistics();
+    EXPECT_EQ(stats.heap_allocations, 1u);
+    EXPECT_EQ(stats.in_use, 0u);
+}
+
+TEST(BufferPoolTest, GlobalPoolAcrossThreads) {
+    auto& pool = BufferPool::instance();
+    size_t before = pool.statistics().in_use;
+
+    // 一个线程借出、另一个线程释放（与接收线程 → 磁盘线程的流向一致）
+    std::vector<BufferHandle> handles;
+    std::thread producer([&handles, &pool] {
+        for (int i = 0; i < 200; ++i) {
+            handles.push_back(pool.acquire(16384));
+        }
+    });
+    producer.join();
+
+    std::thread consumer([&handles] {
+        handles.clear();
+    });
+    consumer.join();
+
+    EXPECT_EQ(pool.statistics().in_use, before);
+}
@@ -0,0 +1,163 @@
+/**
+ * @file test_sha1.cpp
+ * @brief SHA1 各后端与多缓冲模式单元测试
+ */
+
+#include <gtest/gtest.h>
+#include <magnet/utils/sha1.h>
+
+#include <string>
+#include <vector>
+
+using namespace magnet::utils;
+
+// ========== 辅助函数 ==========
+
+namespace {
+
+std::string toHex(const SHA1::Digest& digest) {
+    static const char* hex = "0123456789abcdef";
+    std::string result;
+    for (auto byte : digest) {
+        result += hex[byte >> 4];
+        result += hex[byte & 0xf];
+    }
+    return result;
+}
+
+std::string hashString(const std::string& text) {
+    return toHex(sha1(reinterpret_cast<const uint8_t*>(text.data()), text.size()));
+}
+
+std::vector<uint8_t> makeData(size_t length, uint32_t seed) {
+    std::vector<uint8_t> data(length);
+    uint32_t x = seed * 2654435761u + 1;
+    for (auto& byte : data) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        byte = static_cast<uint8_t>(x);
+    }
+    return data;
+}
+
+const SHA1Backend kAllBackends[] = {
+    SHA1Backend::Scalar, SHA1Backend::X86ShaNi, SHA1Backend::ArmCrypto
+};
+
+// 测试期间切换后端，结束时恢复
+class BackendGuard {
+public:
+    BackendGuard() : saved_(sha1Backend()), multi_buffer_(sha1MultiBufferEnabled()) {}
+    ~BackendGuard() {
+        setSHA1Backend(saved_);
+        setSHA1MultiBuffer(multi_buffer_);
+    }
+
+private:
+    SHA1Backend saved_;
+    bool multi_buffer_;
+};
+
+} // namespace
+
+// ========== 标准向量测试 ==========
+
+TEST(SHA1Test, KnownVectorsOnEveryBackend) {
+    BackendGuard guard;
+
+    for (auto backend : kAllBackends) {
+        if (!setSHA1Backend(backend)) {
+            continue;
+        }
+        SCOPED_TRACE(sha1BackendName(backend));
+
+        EXPECT_EQ(hashString(""), "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+        EXPECT_EQ(hashString("abc"), "a9993e364706816aba3e25717850c26c9cd0d89d");
+        EXPECT_EQ(hashString("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+                  "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+        EXPECT_EQ(hashString(std::string(1000000, 'a')),
+                  "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+    }
+}
+
+TEST(SHA1Test, ScalarAlwaysSupported) {
+    EXPECT_TRUE(sha1BackendSupported(SHA1Backend::Scalar));
+    EXPECT_TRUE(sha1BackendSupported(sha1Backend()));
+}
+
+// ========== 增量更新测试 ==========
+
+TEST(SHA1Test, ChunkedUpdateMatchesOneShot) {
+    BackendGuard guard;
+    auto data = makeData(10000, 7);
+
+    for (auto backend : kAllBackends) {
+        if (!setSHA1Backend(backend)) {
+            continue;
+        }
+        SCOPED_TRACE(sha1BackendName(backend));
+
+        auto expected = sha1(data);
+
+        // 各种不与 64 字节对齐的分段方式
+        for (size_t chunk : {1u, 3u, 63u, 64u, 65u, 1000u, 16384u}) {
+            SHA1 hasher;
+            for (size_t offset = 0; offset < data.size(); offset += chunk) {
+                hasher.update(data.data() + offset, std::min(chunk, data.size() - offset));
+            }
+            EXPECT_EQ(hasher.finalize(), expected) << "chunk=" << chunk;
+        }
+    }
+}
+
+TEST(SHA1Test, BackendsAgreeOnPaddingBoundaries) {
+    BackendGuard guard;
+
+    for (size_t length : {0u, 1u, 55u, 56u, 63u, 64u, 119u, 120u, 128u, 16384u}) {
+        auto data = makeData(length, static_cast<uint32_t>(length));
+
+        ASSERT_TRUE(setSHA1Backend(SHA1Backend::Scalar));
+        auto expected = sha1(data);
+
+        for (auto backend : kAllBackends) {
+            if (setSHA1Backend(backend)) {
+                EXPECT_EQ(sha1(data), expected)
+                    << sha1BackendName(backend) << " length=" << length;
+            }
+        }
+    }
+}
+
+// ========== 多缓冲测试 ==========
+
+TEST(SHA1Test, ManyMatchesSingleStream) {
+    BackendGuard guard;
+
+    for (bool multi : {false, true}) {
+        if (!setSHA1MultiBuffer(multi)) {
+            continue;
+        }
+        SCOPED_TRACE(multi ? "multi-buffer" : "single-stream");
+
+        // 缓冲区数不是 8 的倍数时，剩余部分走单流
+        for (size_t length : {0u, 55u, 56u, 64u, 1000u, 32768u}) {
+            const size_t count = 11;
+            std::vector<std::vector<uint8_t>> buffers;
+            std::vector<const uint8_t*> pointers;
+            for (size_t i = 0; i < count; ++i) {
+                buffers.push_back(makeData(length, static_cast<uint32_t>(i * 100 + length)));
+            }
+            for (const auto& buffer : buffers) {
+                pointers.push_back(buffer.data());
+            }
+
+            std::vector<SHA1::Digest> digests(count);
+            sha1Many(pointers.data(), length, digests.data(), count);
+
+            for (size_t i = 0; i < count; ++i) {
+                EXPECT_EQ(digests[i], sha1(buffers[i])) << "length=" << length << " i=" << i;
+            }
+        }
+    }
+}